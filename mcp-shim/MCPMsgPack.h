@@ -0,0 +1,32 @@
+// MCPMsgPack.h
+// Minimal MessagePack codec and length-prefixed framing for the shim<->app socket
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Framing name advertised in the initialize handshake
+extern NSString *const MCPFramingMsgPack;
+
+/// Upper bound for a single frame; anything larger is treated as a protocol error
+extern const uint32_t MCPMaxFrameLength;
+
+@interface MCPMsgPack : NSObject
+
+/// Encode a JSON-compatible object graph (NSDictionary, NSArray, NSString,
+/// NSNumber, NSNull, NSData) as MessagePack. Returns nil for unsupported types.
++ (nullable NSData *)encodeObject:(id)object;
+
+/// Decode a single MessagePack value that spans the whole buffer
++ (nullable id)decodeData:(NSData *)data;
+
+/// Encode object and prepend a 4-byte big-endian length
++ (nullable NSData *)frameWithObject:(id)object;
+
+/// Pop the next complete frame off the front of buffer and decode it.
+/// Returns nil when no complete frame is buffered yet; sets *error on malformed input.
++ (nullable id)nextObjectFromBuffer:(NSMutableData *)buffer error:(NSError * _Nullable * _Nullable)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,305 @@
+// MCPMsgPack.m
+// Minimal MessagePack codec and length-prefixed framing for the shim<->app socket
+
+#import "MCPMsgPack.h"
+
+NSString *const MCPFramingMsgPack = @"msgpack";
+const uint32_t MCPMaxFrameLength = 64 * 1024 * 1024;
+
+#pragma mark - Encoder
+
+static void appendByte(NSMutableData *out, uint8_t byte) {
+    [out appendBytes:&byte length:1];
+}
+
+static void appendBE16(NSMutableData *out, uint16_t value) {
+    uint16_t be = CFSwapInt16HostToBig(value);
+    [out appendBytes:&be length:2];
+}
+
+static void appendBE32(NSMutableData *out, uint32_t value) {
+    uint32_t be = CFSwapInt32HostToBig(value);
+    [out appendBytes:&be length:4];
+}
+
+static void appendBE64(NSMutableData *out, uint64_t value) {
+    uint64_t be = CFSwapInt64HostToBig(value);
+    [out appendBytes:&be length:8];
+}
+
+static void appendInteger(NSMutableData *out, long long value) {
+    if (value >= 0) {
+        uint64_t u = (uint64_t)value;
+        if (u <= 0x7f) {
+            appendByte(out, (uint8_t)u);
+        } else if (u <= UINT8_MAX) {
+            appendByte(out, 0xcc); appendByte(out, (uint8_t)u);
+        } else if (u <= UINT16_MAX) {
+            appendByte(out, 0xcd); appendBE16(out, (uint16_t)u);
+        } else if (u <= UINT32_MAX) {
+            appendByte(out, 0xce); appendBE32(out, (uint32_t)u);
+        } else {
+            appendByte(out, 0xcf); appendBE64(out, u);
+        }
+    } else if (value >= -32) {
+        appendByte(out, (uint8_t)(int8_t)value);
+    } else if (value >= INT8_MIN) {
+        appendByte(out, 0xd0); appendByte(out, (uint8_t)(int8_t)value);
+    } else if (value >= INT16_MIN) {
+        appendByte(out, 0xd1); appendBE16(out, (uint16_t)(int16_t)value);
+    } else if (value >= INT32_MIN) {
+        appendByte(out, 0xd2); appendBE32(out, (uint32_t)(int32_t)value);
+    } else {
+        appendByte(out, 0xd3); appendBE64(out, (uint64_t)value);
+    }
+}
+
+static void appendLengthHeader(NSMutableData *out, NSUInteger length,
+                               uint8_t fixBase, NSUInteger fixMax,
+                               uint8_t op8, uint8_t op16, uint8_t op32) {
+    if (fixBase && length <= fixMax) {
+        appendByte(out, (uint8_t)(fixBase | length));
+    } else if (op8 && length <= UINT8_MAX) {
+        appendByte(out, op8); appendByte(out, (uint8_t)length);
+    } else if (length <= UINT16_MAX) {
+        appendByte(out, op16); appendBE16(out, (uint16_t)length);
+    } else {
+        appendByte(out, op32); appendBE32(out, (uint32_t)length);
+    }
+}
+
+static BOOL encodeValue(NSMutableData *out, id object) {
+    if (!object || object == [NSNull null]) {
+        appendByte(out, 0xc0);
+        return YES;
+    }
+
+    if ([object isKindOfClass:[NSString class]]) {
+        NSData *utf8 = [(NSString *)object dataUsingEncoding:NSUTF8StringEncoding];
+        appendLengthHeader(out, utf8.length, 0xa0, 31, 0xd9, 0xda, 0xdb);
+        [out appendData:utf8];
+        return YES;
+    }
+
+    if ([object isKindOfClass:[NSNumber class]]) {
+        CFNumberRef number = (__bridge CFNumberRef)object;
+        if (CFGetTypeID(number) == CFBooleanGetTypeID()) {
+            appendByte(out, [object boolValue] ? 0xc3 : 0xc2);
+        } else if (CFNumberIsFloatType(number)) {
+            double d = [object doubleValue];
+            uint64_t bits;
+            memcpy(&bits, &d, sizeof(bits));
+            appendByte(out, 0xcb);
+            appendBE64(out, bits);
+        } else if ([object compare:@(LLONG_MAX)] == NSOrderedDescending) {
+            appendByte(out, 0xcf);
+            appendBE64(out, [object unsignedLongLongValue]);
+        } else {
+            appendInteger(out, [object longLongValue]);
+        }
+        return YES;
+    }
+
+    if ([object isKindOfClass:[NSDictionary class]]) {
+        NSDictionary *dict = object;
+        appendLengthHeader(out, dict.count, 0x80, 15, 0, 0xde, 0xdf);
+        __block BOOL ok = YES;
+        [dict enumerateKeysAndObjectsUsingBlock:^(id key, id value, BOOL *stop) {
+            if (!encodeValue(out, key) || !encodeValue(out, value)) {
+                ok = NO;
+                *stop = YES;
+            }
+        }];
+        return ok;
+    }
+
+    if ([object isKindOfClass:[NSArray class]]) {
+        NSArray *array = object;
+        appendLengthHeader(out, array.count, 0x90, 15, 0, 0xdc, 0xdd);
+        for (id item in array) {
+            if (!encodeValue(out, item)) return NO;
+        }
+        return YES;
+    }
+
+    if ([object isKindOfClass:[NSData class]]) {
+        NSData *data = object;
+        appendLengthHeader(out, data.length, 0, 0, 0xc4, 0xc5, 0xc6);
+        [out appendData:data];
+        return YES;
+    }
+
+    return NO;
+}
+
+#pragma mark - Decoder
+
+typedef struct {
+    const uint8_t *bytes;
+    NSUInteger length;
+    NSUInteger offset;
+} MCPReader;
+
+static BOOL readBytes(MCPReader *r, NSUInteger count, const uint8_t **out) {
+    if (r->length - r->offset < count) return NO;
+    *out = r->bytes + r->offset;
+    r->offset += count;
+    return YES;
+}
+
+static BOOL readUInt(MCPReader *r, NSUInteger width, uint64_t *value) {
+    const uint8_t *p;
+    if (!readBytes(r, width, &p)) return NO;
+    uint64_t v = 0;
+    for (NSUInteger i = 0; i < width; i++) {
+        v = (v << 8) | p[i];
+    }
+    *value = v;
+    return YES;
+}
+
+static id decodeValue(MCPReader *r, int depth);
+
+static NSString *decodeString(MCPReader *r, uint64_t length) {
+    const uint8_t *p;
+    if (!readBytes(r, (NSUInteger)length, &p)) return nil;
+    return [[NSString alloc] initWithBytes:p length:(NSUInteger)length encoding:NSUTF8StringEncoding];
+}
+
+static NSData *decodeBinary(MCPReader *r, uint64_t length) {
+    const uint8_t *p;
+    if (!readBytes(r, (NSUInteger)length, &p)) return nil;
+    return [NSData dataWithBytes:p length:(NSUInteger)length];
+}
+
+static NSArray *decodeArray(MCPReader *r, uint64_t count, int depth) {
+    if (count > r->length - r->offset) return nil;  // Each element needs at least one byte
+    NSMutableArray *array = [NSMutableArray arrayWithCapacity:(NSUInteger)count];
+    for (uint64_t i = 0; i < count; i++) {
+        id item = decodeValue(r, depth + 1);
+        if (!item) return nil;
+        [array addObject:item];
+    }
+    return array;
+}
+
+static NSDictionary *decodeMap(MCPReader *r, uint64_t count, int depth) {
+    if (count > (r->length - r->offset) / 2) return nil;
+    NSMutableDictionary *dict = [NSMutableDictionary dictionaryWithCapacity:(NSUInteger)count];
+    for (uint64_t i = 0; i < count; i++) {
+        id key = decodeValue(r, depth + 1);
+        id value = decodeValue(r, depth + 1);
+        if (!key || !value || ![key conformsToProtocol:@protocol(NSCopying)]) return nil;
+        dict[key] = value;
+    }
+    return dict;
+}
+
+static id decodeValue(MCPReader *r, int depth) {
+    if (depth > 64) return nil;  // Guard against hostile nesting
+
+    const uint8_t *p;
+    if (!readBytes(r, 1, &p)) return nil;
+    uint8_t type = *p;
+    uint64_t n;
+
+    if (type <= 0x7f) return @(type);
+    if (type >= 0xe0) return @((int8_t)type);
+    if ((type & 0xe0) == 0xa0) return decodeString(r, type & 0x1f);
+    if ((type & 0xf0) == 0x90) return decodeArray(r, type & 0x0f, depth);
+    if ((type & 0xf0) == 0x80) return decodeMap(r, type & 0x0f, depth);
+
+    switch (type) {
+        case 0xc0: return [NSNull null];
+        case 0xc2: return @NO;
+        case 0xc3: return @YES;
+        case 0xc4: return readUInt(r, 1, &n) ? decodeBinary(r, n) : nil;
+        case 0xc5: return readUInt(r, 2, &n) ? decodeBinary(r, n) : nil;
+        case 0xc6: return readUInt(r, 4, &n) ? decodeBinary(r, n) : nil;
+        case 0xca: {
+            if (!readUInt(r, 4, &n)) return nil;
+            uint32_t bits = (uint32_t)n;
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            return @(f);
+        }
+        case 0xcb: {
+            if (!readUInt(r, 8, &n)) return nil;
+            double d;
+            memcpy(&d, &n, sizeof(d));
+            return @(d);
+        }
+        case 0xcc: return readUInt(r, 1, &n) ? @(n) : nil;
+        case 0xcd: return readUInt(r, 2, &n) ? @(n) : nil;
+        case 0xce: return readUInt(r, 4, &n) ? @(n) : nil;
+        case 0xcf: return readUInt(r, 8, &n) ? @(n) : nil;
+        case 0xd0: return readUInt(r, 1, &n) ? @((int8_t)n) : nil;
+        case 0xd1: return readUInt(r, 2, &n) ? @((int16_t)n) : nil;
+        case 0xd2: return readUInt(r, 4, &n) ? @((int32_t)n) : nil;
+        case 0xd3: return readUInt(r, 8, &n) ? @((int64_t)n) : nil;
+        case 0xd9: return readUInt(r, 1, &n) ? decodeString(r, n) : nil;
+        case 0xda: return readUInt(r, 2, &n) ? decodeString(r, n) : nil;
+        case 0xdb: return readUInt(r, 4, &n) ? decodeString(r, n) : nil;
+        case 0xdc: return readUInt(r, 2, &n) ? decodeArray(r, n, depth) : nil;
+        case 0xdd: return readUInt(r, 4, &n) ? decodeArray(r, n, depth) : nil;
+        case 0xde: return readUInt(r, 2, &n) ? decodeMap(r, n, depth) : nil;
+        case 0xdf: return readUInt(r, 4, &n) ? decodeMap(r, n, depth) : nil;
+        default:
+            // Ext types are not used on this socket
+            return nil;
+    }
+}
+
+#pragma mark - MCPMsgPack
+
+@implementation MCPMsgPack
+
++ (NSData *)encodeObject:(id)object {
+    NSMutableData *out = [NSMutableData data];
+    return encodeValue(out, object) ? out : nil;
+}
+
++ (id)decodeData:(NSData *)data {
+    MCPReader reader = { data.bytes, data.length, 0 };
+    id value = decodeValue(&reader, 0);
+    if (reader.offset != reader.length) return nil;  // Trailing garbage
+    return value;
+}
+
++ (NSData *)frameWithObject:(id)object {
+    NSMutableData *frame = [NSMutableData dataWithLength:4];
+    if (!encodeValue(frame, object)) return nil;
+
+    uint32_t be = CFSwapInt32HostToBig((uint32_t)(frame.length - 4));
+    [frame replaceBytesInRange:NSMakeRange(0, 4) withBytes:&be];
+    return frame;
+}
+
++ (id)nextObjectFromBuffer:(NSMutableData *)buffer error:(NSError **)error {
+    if (buffer.length < 4) return nil;
+
+    uint32_t be;
+    [buffer getBytes:&be length:4];
+    uint32_t length = CFSwapInt32BigToHost(be);
+
+    if (length > MCPMaxFrameLength) {
+        if (error) {
+            *error = [NSError errorWithDomain:@"MCPMsgPack" code:1
+                                     userInfo:@{NSLocalizedDescriptionKey: @"Frame exceeds maximum length"}];
+        }
+        return nil;
+    }
+    if (buffer.length < 4 + (NSUInteger)length) return nil;
+
+    NSData *payload = [buffer subdataWithRange:NSMakeRange(4, length)];
+    [buffer replaceBytesInRange:NSMakeRange(0, 4 + (NSUInteger)length) withBytes:NULL length:0];
+
+    id object = [self decodeData:payload];
+    if (!object && error) {
+        *error = [NSError errorWithDomain:@"MCPMsgPack" code:2
+                                 userInfo:@{NSLocalizedDescriptionKey: @"Malformed MessagePack payload"}];
+    }
+    return object;
+}
+
+@end
@@ -0,0 +1,53 @@
+// MCPServerConnection.h
+// One shim connection to the app socket and the framing negotiated on it
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * A connected app socket. The initialize handshake offers MessagePack frames;
+ * the server's choice belongs to this connection only, so a reconnect starts
+ * over in JSON lines and a forwarder still draining an old socket keeps
+ * decoding it the way that socket negotiated.
+ */
+@interface MCPServerConnection : NSObject
+
+/// Socket descriptor, closed when the connection is deallocated
+@property (nonatomic, readonly) int fileDescriptor;
+
+/// YES once the server accepted MessagePack framing in its initialize response
+@property (nonatomic, readonly) BOOL binaryFraming;
+
+/// Take ownership of a connected stream socket
+- (instancetype)initWithFileDescriptor:(int)fd NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Send initialize offering MessagePack, wait up to timeout for the response,
+/// adopt the framing it picks and send notifications/initialized.
+/// Returns the initialize response, or nil if none arrived.
+- (nullable NSDictionary *)initializeWithTimeout:(NSTimeInterval)timeout;
+
+/// Write one message in this connection's framing.
+/// Raises like -[NSFileHandle writeData:] once the socket is gone.
+- (void)sendMessage:(NSDictionary *)message;
+
+/// Forward a client line: verbatim over JSON lines, re-encoded from request over
+/// MessagePack (dropped if the line didn't parse). Raises like -sendMessage:.
+- (void)forwardClientLine:(NSString *)line request:(nullable NSDictionary *)request;
+
+/// Read until the response with reqId, skipping notifications; nil after timeout
+/// per message, on EOF or on malformed data. Bytes past it stay buffered.
+- (nullable NSDictionary *)readResponseWithId:(id)reqId timeout:(NSTimeInterval)timeout;
+
+/// Pass server messages to handler as JSON lines until the socket closes or a
+/// frame is malformed, starting with whatever the handshake read past its last
+/// response. Each call carries one or more complete lines.
+- (void)forwardServerMessagesTo:(void (^)(NSData *lines))handler;
+
+/// Shut the socket down in both directions, unblocking a pending read
+- (void)shutdown;
+
+@end
+
+NS_ASSUME_NONNULL_END
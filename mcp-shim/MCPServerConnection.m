@@ -0,0 +1,229 @@
+// MCPServerConnection.m
+// One shim connection to the app socket and the framing negotiated on it
+
+#import "MCPServerConnection.h"
+#import "MCPMsgPack.h"
+#import <os/log.h>
+#import <sys/socket.h>
+#import <errno.h>
+#import <poll.h>
+#import <unistd.h>
+
+static os_log_t connectionLog(void) {
+    static os_log_t log;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        log = os_log_create("com.mcpwa.shim", "connection");
+    });
+    return log;
+}
+
+@interface MCPServerConnection ()
+@property (nonatomic, strong) NSFileHandle *handle;
+@property (nonatomic, strong) NSMutableData *readBuffer;  // Read but not yet consumed
+@property (nonatomic, assign, readwrite) BOOL binaryFraming;
+@end
+
+@implementation MCPServerConnection
+
+- (instancetype)initWithFileDescriptor:(int)fd {
+    self = [super init];
+    if (self) {
+        _fileDescriptor = fd;
+        _handle = [[NSFileHandle alloc] initWithFileDescriptor:fd closeOnDealloc:YES];
+        _readBuffer = [NSMutableData data];
+    }
+    return self;
+}
+
+#pragma mark - Handshake
+
+- (NSDictionary *)initializeWithTimeout:(NSTimeInterval)timeout {
+    NSDictionary *initRequest = @{
+        @"jsonrpc": @"2.0",
+        @"id": @"mcp-shim-initialize",
+        @"method": @"initialize",
+        @"params": @{
+            @"protocolVersion": @"2024-11-05",
+            @"clientInfo": @{@"name": @"mcp-shim", @"version": @"1.0"},
+            @"capabilities": @{
+                @"experimental": @{
+                    @"mcpwa/transport": @{@"framings": @[MCPFramingMsgPack]}
+                }
+            }
+        }
+    };
+    self.binaryFraming = NO;
+    [self sendMessage:initRequest];
+    os_log_info(connectionLog(), "Sent initialize to server");
+
+    NSDictionary *initResponse = [self readResponseWithId:initRequest[@"id"] timeout:timeout];
+    if (!initResponse) return nil;
+    os_log_info(connectionLog(), "Server responded to initialize");
+
+    // Everything after the initialize response uses the framing the server picked
+    NSDictionary *transport = initResponse[@"result"][@"capabilities"][@"experimental"][@"mcpwa/transport"];
+    if ([transport isKindOfClass:[NSDictionary class]] &&
+        [transport[@"framing"] isEqual:MCPFramingMsgPack]) {
+        self.binaryFraming = YES;
+        os_log_info(connectionLog(), "Server accepted MessagePack framing");
+    }
+
+    [self sendMessage:@{@"jsonrpc": @"2.0", @"method": @"notifications/initialized"}];
+    os_log_info(connectionLog(), "Sent initialized notification to server");
+    return initResponse;
+}
+
+#pragma mark - Writing
+
+- (void)sendMessage:(NSDictionary *)message {
+    if (self.binaryFraming) {
+        NSData *frame = [MCPMsgPack frameWithObject:message];
+        if (frame) {
+            [self.handle writeData:frame];
+        } else {
+            os_log_error(connectionLog(), "Failed to encode message as MessagePack");
+        }
+        return;
+    }
+
+    NSMutableData *line = [[NSJSONSerialization dataWithJSONObject:message options:0 error:nil] mutableCopy];
+    [line appendBytes:"\n" length:1];
+    [self.handle writeData:line];
+}
+
+- (void)forwardClientLine:(NSString *)line request:(NSDictionary *)request {
+    if (!self.binaryFraming) {
+        [self.handle writeData:[[line stringByAppendingString:@"\n"] dataUsingEncoding:NSUTF8StringEncoding]];
+        return;
+    }
+    if (!request) {
+        os_log_error(connectionLog(), "Dropping unparseable client message in binary mode");
+        return;
+    }
+    [self sendMessage:request];
+}
+
+#pragma mark - Reading
+
+/// Pop one complete message (JSON line or MessagePack frame) off the read buffer
+- (NSDictionary *)nextBufferedMessage:(BOOL *)malformed {
+    if (self.binaryFraming) {
+        NSError *error = nil;
+        id object = [MCPMsgPack nextObjectFromBuffer:self.readBuffer error:&error];
+        if (error) *malformed = YES;
+        return [object isKindOfClass:[NSDictionary class]] ? object : nil;
+    }
+
+    NSMutableData *buffer = self.readBuffer;
+    NSRange newline = [buffer rangeOfData:[NSData dataWithBytes:"\n" length:1]
+                                  options:0
+                                    range:NSMakeRange(0, buffer.length)];
+    if (newline.location == NSNotFound) return nil;
+
+    NSData *line = [buffer subdataWithRange:NSMakeRange(0, newline.location)];
+    [buffer replaceBytesInRange:NSMakeRange(0, newline.location + 1) withBytes:NULL length:0];
+    id json = [NSJSONSerialization JSONObjectWithData:line options:0 error:nil];
+    if (![json isKindOfClass:[NSDictionary class]]) *malformed = YES;
+    return [json isKindOfClass:[NSDictionary class]] ? json : nil;
+}
+
+/// Read one message, giving up after timeout. Bytes past it stay buffered.
+- (NSDictionary *)readMessageWithTimeout:(NSTimeInterval)timeout {
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:timeout];
+
+    while (YES) {
+        BOOL malformed = NO;
+        NSDictionary *message = [self nextBufferedMessage:&malformed];
+        if (message) return message;
+        if (malformed) {
+            os_log_error(connectionLog(), "Malformed message from server during handshake");
+            return nil;
+        }
+
+        int remainingMs = (int)([deadline timeIntervalSinceNow] * 1000);
+        if (remainingMs <= 0) {
+            os_log_error(connectionLog(), "Timed out waiting for server response");
+            return nil;
+        }
+
+        struct pollfd pfd = { .fd = self.fileDescriptor, .events = POLLIN };
+        int ready = poll(&pfd, 1, remainingMs);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0) {
+            os_log_error(connectionLog(), "Timed out waiting for server response");
+            return nil;
+        }
+
+        uint8_t chunk[4096];
+        ssize_t n = read(self.fileDescriptor, chunk, sizeof(chunk));
+        if (n <= 0) {
+            os_log_error(connectionLog(), "Server closed during handshake");
+            return nil;
+        }
+        [self.readBuffer appendBytes:chunk length:n];
+    }
+}
+
+- (NSDictionary *)readResponseWithId:(id)reqId timeout:(NSTimeInterval)timeout {
+    while (YES) {
+        NSDictionary *message = [self readMessageWithTimeout:timeout];
+        if (!message) return nil;
+        if ([message[@"id"] isEqual:reqId]) return message;
+        os_log_info(connectionLog(), "Skipping unrelated message during handshake");
+    }
+}
+
+- (void)forwardServerMessagesTo:(void (^)(NSData *lines))handler {
+    NSData *newline = [NSData dataWithBytes:"\n" length:1];
+    NSMutableData *pending = self.readBuffer;
+    uint8_t chunk[16384];
+
+    // The buffer may already hold messages the handshake read past its last response
+    BOOL haveBytes = pending.length > 0;
+    while (YES) {
+        if (!haveBytes) {
+            ssize_t n = read(self.fileDescriptor, chunk, sizeof(chunk));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            [pending appendBytes:chunk length:n];
+        }
+        haveBytes = NO;
+
+        if (!self.binaryFraming) {
+            // Every complete line at once, keeping any partial trailing line. Progress
+            // notifications reach the client as soon as their line is complete.
+            NSRange lastNewline = [pending rangeOfData:newline
+                                               options:NSDataSearchBackwards
+                                                 range:NSMakeRange(0, pending.length)];
+            if (lastNewline.location == NSNotFound) continue;
+            NSUInteger end = NSMaxRange(lastNewline);
+            handler([pending subdataWithRange:NSMakeRange(0, end)]);
+            [pending replaceBytesInRange:NSMakeRange(0, end) withBytes:NULL length:0];
+            continue;
+        }
+
+        // Transcode each complete frame to a JSON line
+        NSError *frameError = nil;
+        id message;
+        while ((message = [MCPMsgPack nextObjectFromBuffer:pending error:&frameError])) {
+            if (![NSJSONSerialization isValidJSONObject:message]) {
+                os_log_error(connectionLog(), "Dropping frame that has no JSON representation");
+                continue;
+            }
+            NSMutableData *line = [[NSJSONSerialization dataWithJSONObject:message options:0 error:nil] mutableCopy];
+            [line appendData:newline];
+            handler(line);
+        }
+        if (frameError) {
+            os_log_error(connectionLog(), "Bad frame from server: %{public}@", frameError.localizedDescription);
+            break;
+        }
+    }
+}
+
+- (void)shutdown {
+    shutdown(self.fileDescriptor, SHUT_RDWR);
+}
+
+@end
@@ -1,22 +1,62 @@
-// mcp-shim.m - with MCP handshake handling and hardcoded tools
+// mcp-shim.m - with MCP handshake handling and cached tool schema
 
 #import <Foundation/Foundation.h>
 #import <os/log.h>
+#import "MCPServerConnection.h"
 #import <sys/socket.h>
 #import <sys/un.h>
 #import <errno.h>
+#import <fcntl.h>
+#import <unistd.h>
 
 static os_log_t logger;
 static NSString *socketPath = @"/tmp/mcpwa.sock";
 static NSFileHandle *stdoutHandle;
-static NSFileHandle *serverHandle;
-static int serverSocket = -1;  // Keep raw socket fd for cleanup
 static BOOL stdinClosed = NO;
 
+// The current app connection, nil while disconnected. Framing is negotiated per
+// connection and lives on it, not here.
+static MCPServerConnection *serverConnection;
+
+// Reconnect signalling: the socket directory watcher and server disconnects
+// wake the connect loop immediately instead of waiting for the next poll
+static dispatch_semaphore_t connectSignal;
+static dispatch_source_t socketDirWatcher;
+
+// Tools last advertised to the client (cached live schema or hardcoded fallback)
+static NSArray *servedTools;
+static BOOL liveToolsFetched = NO;
+
+static const NSTimeInterval kHandshakeTimeout = 2.0;     // Per-message deadline during handshake
+static const NSTimeInterval kReconnectFallbackPoll = 5.0; // Safety net if the watcher misses an event
+
 #pragma mark - Tool Definitions
 
+/// Add the optional "account" argument to every tool that drives WhatsApp
+NSArray* withAccountParameter(NSArray *tools) {
+    NSDictionary *account = @{
+        @"type": @"string",
+        @"description": @"Optional WhatsApp instance when several run side by side: 'personal', 'business', or an account listed by whatsapp_status (default: the first running)"
+    };
+    NSMutableArray *result = [NSMutableArray arrayWithCapacity:tools.count];
+    for (NSDictionary *tool in tools) {
+        if ([tool[@"name"] isEqualToString:@"whatsapp_status"]) {
+            [result addObject:tool];
+            continue;
+        }
+        NSMutableDictionary *schema = [tool[@"inputSchema"] mutableCopy];
+        NSMutableDictionary *properties = [schema[@"properties"] mutableCopy];
+        properties[@"account"] = account;
+        schema[@"properties"] = properties;
+        NSMutableDictionary *updated = [tool mutableCopy];
+        updated[@"inputSchema"] = schema;
+        [result addObject:updated];
+    }
+    return result;
+}
+
 NSArray* getMcpwaTools(void) {
-    return @[
+    return withAccountParameter(@[
         @{
             @"name": @"whatsapp_start_session",
             @"description": @"Call this at the START of processing any user prompt that requires WhatsApp access. Initializes WhatsApp by navigating to Chats tab and clearing stale search state. Pattern: start_session -> [your WhatsApp operations] -> stop_session.",
@@ -37,7 +77,7 @@ NSArray* getMcpwaTools(void) {
         },
         @{
             @"name": @"whatsapp_status",
-            @"description": @"Check WhatsApp accessibility status - whether the app is running and permissions are granted",
+            @"description": @"Check WhatsApp accessibility status - whether the app is running and permissions are granted. Also lists the running WhatsApp instances (personal and Business) that other tools accept as 'account'; calls against different accounts run in parallel.",
             @"inputSchema": @{
                 @"type": @"object",
                 @"properties": @{},
@@ -46,7 +86,7 @@ NSArray* getMcpwaTools(void) {
         },
         @{
             @"name": @"whatsapp_list_chats",
-            @"description": @"Get list of recent visible WhatsApp chats with last message preview. Returns chat names, last messages, timestamps, and whether chats are pinned or group chats. Optionally filter by: 'all' (default), 'unread', 'favorites', or 'groups'.",
+            @"description": @"Get list of recent visible WhatsApp chats with last message preview. Returns chat names, last messages, timestamps, and whether chats are pinned or group chats. Optionally filter by: 'all' (default), 'unread', 'favorites', or 'groups'. Request only the fields you need.",
             @"inputSchema": @{
                 @"type": @"object",
                 @"properties": @{
@@ -54,6 +94,20 @@ NSArray* getMcpwaTools(void) {
                         @"type": @"string",
                         @"description": @"Optional filter: 'all' (default), 'unread', 'favorites', or 'groups'",
                         @"enum": @[@"all", @"unread", @"favorites", @"groups"]
+                    },
+                    @"fields": @{
+                        @"type": @"array",
+                        @"description": @"Optional list of fields to return (default: all). 'name', 'is_selected' and 'index' are cheapest.",
+                        @"items": @{
+                            @"type": @"string",
+                            @"enum": @[@"name", @"last_message", @"timestamp", @"sender",
+                                       @"is_pinned", @"is_group", @"is_unread", @"is_selected", @"index"]
+                        }
+                    },
+                    @"limit": @{
+                        @"type": @"integer",
+                        @"description": @"Maximum chats (default 20)",
+                        @"minimum": @1
                     }
                 },
                 @"required": @[]
@@ -61,10 +115,15 @@ NSArray* getMcpwaTools(void) {
         },
         @{
             @"name": @"whatsapp_get_current_chat",
-            @"description": @"Get the currently open chat's name and all visible messages. Use this to read the conversation that's currently on screen in WhatsApp.",
+            @"description": @"Get the currently open chat's name and all visible messages. Use this to read the conversation that's currently on screen in WhatsApp. Every message has a fingerprint; pass the last one back as since on the next read to get only what arrived after it.",
             @"inputSchema": @{
                 @"type": @"object",
-                @"properties": @{},
+                @"properties": @{
+                    @"since": @{
+                        @"type": @"string",
+                        @"description": @"Optional fingerprint of the newest message already seen; only newer messages are returned, and watermark_found says whether it was still on screen"
+                    }
+                },
                 @"required": @[]
             }
         },
@@ -84,13 +143,37 @@ NSArray* getMcpwaTools(void) {
         },
         @{
             @"name": @"whatsapp_get_messages",
-            @"description": @"Get messages from a specific chat. Opens the chat if not already open, then returns all visible messages.",
+            @"description": @"Get messages from a specific chat. Opens the chat if not already open, then returns visible messages. Request only the fields you need.",
             @"inputSchema": @{
                 @"type": @"object",
                 @"properties": @{
                     @"chat_name": @{
                         @"type": @"string",
                         @"description": @"Name of the chat to get messages from"
+                    },
+                    @"fields": @{
+                        @"type": @"array",
+                        @"description": @"Optional list of fields to return (default: all)",
+                        @"items": @{
+                            @"type": @"string",
+                            @"enum": @[@"text", @"sender", @"timestamp", @"direction",
+                                       @"reply_to", @"reply_text", @"reactions", @"is_read", @"fingerprint",
+                                       @"media_type"]
+                        }
+                    },
+                    @"limit": @{
+                        @"type": @"integer",
+                        @"description": @"Maximum messages (default 20)",
+                        @"minimum": @1
+                    },
+                    @"since": @{
+                        @"type": @"string",
+                        @"description": @"Optional lower bound: HH:MM returns messages from its most recent occurrence on (the bound may be yesterday, e.g. 23:30 read after midnight); a message fingerprint from an earlier read returns only messages newer than it (reading stops at that message)"
+                    },
+                    @"max_age": @{
+                        @"type": @"number",
+                        @"description": @"Optional: accept messages prefetched in the background up to this many seconds ago instead of opening the chat (default 0: always read live)",
+                        @"minimum": @0
                     }
                 },
                 @"required": @[@"chat_name"]
@@ -138,11 +221,126 @@ NSArray* getMcpwaTools(void) {
                         @"type": @"string",
                         @"description": @"Optional filter: 'all' (default), 'unread', 'favorites', or 'groups'",
                         @"enum": @[@"all", @"unread", @"favorites", @"groups"]
+                    },
+                    @"limit": @{
+                        @"type": @"integer",
+                        @"description": @"Maximum message matches (default 20); chat matches are always returned in full",
+                        @"minimum": @1
                     }
                 },
                 @"required": @[@"query"]
             }
         },
+        @{
+            @"name": @"whatsapp_batch",
+            @"description": @"Run several WhatsApp operations in one call instead of separate open_chat/get_messages/search/send calls. Reads are grouped per chat so each chat is opened once, repeated searches reuse results, and filter changes that are already in effect are skipped. Sends, searches and filter changes keep their position. A read or send without 'chat' uses the chat named by the closest earlier operation (or the open chat). Returns per-operation results in request order, each with ok, error and duration_ms, plus the execution plan. No start_session/stop_session calls needed around a batch.",
+            @"inputSchema": @{
+                @"type": @"object",
+                @"properties": @{
+                    @"operations": @{
+                        @"type": @"array",
+                        @"description": @"Ordered operations",
+                        @"minItems": @1,
+                        @"items": @{
+                            @"type": @"object",
+                            @"properties": @{
+                                @"op": @{
+                                    @"type": @"string",
+                                    @"enum": @[@"open", @"read", @"search", @"send", @"filter"]
+                                },
+                                @"chat": @{
+                                    @"type": @"string",
+                                    @"description": @"open/read/send: chat name (case-insensitive partial match)"
+                                },
+                                @"query": @{
+                                    @"type": @"string",
+                                    @"description": @"search: keywords"
+                                },
+                                @"cursor": @{
+                                    @"type": @"string",
+                                    @"description": @"search: next_cursor of an earlier search to fetch its next message matches instead of searching again"
+                                },
+                                @"message": @{
+                                    @"type": @"string",
+                                    @"description": @"send: message text"
+                                },
+                                @"filter": @{
+                                    @"type": @"string",
+                                    @"description": @"filter (required) or search (optional): chat list filter",
+                                    @"enum": @[@"all", @"unread", @"favorites", @"groups"]
+                                },
+                                @"limit": @{
+                                    @"type": @"integer",
+                                    @"description": @"read: maximum messages; search: message matches per page (default 20)",
+                                    @"minimum": @1
+                                },
+                                @"fields": @{
+                                    @"type": @"array",
+                                    @"description": @"read: message fields to return (default: all)",
+                                    @"items": @{
+                                        @"type": @"string",
+                                        @"enum": @[@"text", @"sender", @"timestamp", @"direction",
+                                                   @"reply_to", @"reply_text", @"reactions", @"is_read", @"fingerprint",
+                                                   @"media_type"]
+                                    }
+                                },
+                                @"since": @{
+                                    @"type": @"string",
+                                    @"description": @"read: optional HH:MM lower bound (its most recent occurrence, may be yesterday), or a fingerprint to read only newer messages"
+                                },
+                                @"max_age": @{
+                                    @"type": @"number",
+                                    @"description": @"read: accept a background-prefetched copy up to this many seconds old (default 0: read live)",
+                                    @"minimum": @0
+                                }
+                            },
+                            @"required": @[@"op"]
+                        }
+                    },
+                    @"clear_search": @{
+                        @"type": @"boolean",
+                        @"description": @"Clear any active search when done (default true)"
+                    }
+                },
+                @"required": @[@"operations"]
+            }
+        },
+        @{
+            @"name": @"whatsapp_send_bulk",
+            @"description": @"Send several messages, or one message to several chats, in one call. Messages are grouped by chat so each chat is opened once; within a chat they go out in request order. Each send is confirmed by a new outgoing message with the same text appearing in the chat. Sends that did not go out (chat not found, text left in the compose box) are retried with backoff; a send that left the compose box but never showed up is reported 'unconfirmed' rather than resent, to avoid duplicates. Returns per-message status (confirmed, unconfirmed or failed) in request order, with the fingerprint of each confirmed message.",
+            @"inputSchema": @{
+                @"type": @"object",
+                @"properties": @{
+                    @"messages": @{
+                        @"type": @"array",
+                        @"description": @"Messages to send, each to its own chat",
+                        @"items": @{
+                            @"type": @"object",
+                            @"properties": @{
+                                @"chat": @{
+                                    @"type": @"string",
+                                    @"description": @"Chat name (case-insensitive partial match)"
+                                },
+                                @"message": @{
+                                    @"type": @"string",
+                                    @"description": @"Message text"
+                                }
+                            },
+                            @"required": @[@"chat", @"message"]
+                        }
+                    },
+                    @"chats": @{
+                        @"type": @"array",
+                        @"description": @"Chats that all receive 'message'",
+                        @"items": @{@"type": @"string"}
+                    },
+                    @"message": @{
+                        @"type": @"string",
+                        @"description": @"Message text sent to every chat in 'chats'"
+                    }
+                }
+            }
+        },
         @{
             @"name": @"whatsapp_clear_search",
             @"description": @"Clear the search field and return to normal chat list view.",
@@ -194,7 +392,52 @@ NSArray* getMcpwaTools(void) {
                 @"required": @[]
             }
         }
-    ];
+    ]);
+}
+
+#pragma mark - Tool Schema Cache
+
+NSString* toolsCachePath(void) {
+    NSString *caches = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES).firstObject;
+    return [caches stringByAppendingPathComponent:@"mcpwa/tools-cache.json"];
+}
+
+NSArray* loadCachedTools(void) {
+    NSData *data = [NSData dataWithContentsOfFile:toolsCachePath()];
+    if (!data) return nil;
+
+    NSArray *tools = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+    if (![tools isKindOfClass:[NSArray class]] || tools.count == 0) {
+        os_log_error(logger, "Ignoring malformed tools cache");
+        return nil;
+    }
+    return tools;
+}
+
+void saveCachedTools(NSArray *tools) {
+    NSString *path = toolsCachePath();
+    [[NSFileManager defaultManager] createDirectoryAtPath:[path stringByDeletingLastPathComponent]
+                              withIntermediateDirectories:YES
+                                               attributes:nil
+                                                    error:nil];
+    NSData *data = [NSJSONSerialization dataWithJSONObject:tools options:0 error:nil];
+    if ([data writeToFile:path atomically:YES]) {
+        os_log_info(logger, "Saved %lu tools to cache", (unsigned long)tools.count);
+    } else {
+        os_log_error(logger, "Failed to write tools cache at %{public}@", path);
+    }
+}
+
+NSArray* currentServedTools(void) {
+    @synchronized ([NSProcessInfo processInfo]) {
+        return servedTools;
+    }
+}
+
+void setServedTools(NSArray *tools) {
+    @synchronized ([NSProcessInfo processInfo]) {
+        servedTools = tools;
+    }
 }
 
 #pragma mark - Socket Connection
@@ -219,11 +462,46 @@ int connectToServer(void) {
     return sock;
 }
 
+/// Watch the socket's parent directory so we connect as soon as the app creates the socket
+void startSocketWatcher(void) {
+    NSString *dir = [socketPath stringByDeletingLastPathComponent];
+    int dirFd = open(dir.fileSystemRepresentation, O_EVTONLY);
+    if (dirFd < 0) {
+        os_log_error(logger, "Cannot watch %{public}@: %{public}s", dir, strerror(errno));
+        return;
+    }
+
+    socketDirWatcher = dispatch_source_create(DISPATCH_SOURCE_TYPE_VNODE, dirFd,
+                                              DISPATCH_VNODE_WRITE,
+                                              dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0));
+    // /tmp changes constantly; only wake the connect loop once the socket exists
+    const char *socketFile = strdup(socketPath.fileSystemRepresentation);
+    dispatch_source_set_event_handler(socketDirWatcher, ^{
+        if (!serverConnection && access(socketFile, F_OK) == 0) {
+            dispatch_semaphore_signal(connectSignal);
+        }
+    });
+    dispatch_source_set_cancel_handler(socketDirWatcher, ^{
+        close(dirFd);
+        free((void *)socketFile);
+    });
+    dispatch_resume(socketDirWatcher);
+    os_log_info(logger, "Watching %{public}@ for socket creation", dir);
+}
+
 #pragma mark - Response Helpers
 
+/// Single writer for stdout: forwarded server lines and shim-generated messages
+/// come from different threads and must never interleave mid-line
+void writeToClient(NSData *data) {
+    @synchronized (stdoutHandle) {
+        [stdoutHandle writeData:data];
+    }
+}
+
 void sendResponse(NSString *response) {
     NSString *line = [response stringByAppendingString:@"\n"];
-    [stdoutHandle writeData:[line dataUsingEncoding:NSUTF8StringEncoding]];
+    writeToClient([line dataUsingEncoding:NSUTF8StringEncoding]);
 }
 
 void sendJsonResponse(NSDictionary *dict) {
@@ -231,44 +509,47 @@ void sendJsonResponse(NSDictionary *dict) {
     sendResponse([[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding]);
 }
 
-void sendToServer(NSFileHandle *handle, NSDictionary *message) {
-    NSData *data = [NSJSONSerialization dataWithJSONObject:message options:0 error:nil];
-    NSString *line = [[[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding] stringByAppendingString:@"\n"];
-    [handle writeData:[line dataUsingEncoding:NSUTF8StringEncoding]];
-}
-
 #pragma mark - Server Initialization
 
-BOOL initializeServer(NSFileHandle *handle) {
-    NSDictionary *initRequest = @{
-        @"jsonrpc": @"2.0",
-        @"id": @1,
-        @"method": @"initialize",
-        @"params": @{
-            @"protocolVersion": @"2024-11-05",
-            @"clientInfo": @{@"name": @"mcp-shim", @"version": @"1.0"},
-            @"capabilities": @{}
-        }
-    };
-    
+/// Handshake with the app. Anything read past the last handshake response stays
+/// buffered on the connection for its forwarder.
+BOOL initializeServer(MCPServerConnection *connection) {
     @try {
-        sendToServer(handle, initRequest);
-        os_log_info(logger, "Sent initialize to server");
-        
-        NSData *response = [handle availableData];
-        if (response.length == 0) {
-            os_log_error(logger, "Server closed during initialize");
+        if (![connection initializeWithTimeout:kHandshakeTimeout]) {
+            os_log_error(logger, "No initialize response within %.1fs", kHandshakeTimeout);
             return NO;
         }
-        os_log_info(logger, "Server responded to initialize");
-        
-        NSDictionary *initializedNotif = @{
-            @"jsonrpc": @"2.0",
-            @"method": @"notifications/initialized"
-        };
-        sendToServer(handle, initializedNotif);
-        os_log_info(logger, "Sent initialized notification to server");
-        
+
+        // Fetch the live tool schema once per shim process and refresh the cache
+        if (!liveToolsFetched) {
+            NSDictionary *listRequest = @{
+                @"jsonrpc": @"2.0",
+                @"id": @"mcp-shim-tools-list",
+                @"method": @"tools/list"
+            };
+            [connection sendMessage:listRequest];
+
+            NSDictionary *listResponse = [connection readResponseWithId:listRequest[@"id"] timeout:kHandshakeTimeout];
+            NSArray *liveTools = listResponse[@"result"][@"tools"];
+            if ([liveTools isKindOfClass:[NSArray class]] && liveTools.count > 0) {
+                liveToolsFetched = YES;
+                if (![liveTools isEqual:loadCachedTools()]) {
+                    saveCachedTools(liveTools);
+                }
+                if (![liveTools isEqual:currentServedTools()]) {
+                    setServedTools(liveTools);
+                    NSDictionary *notification = @{
+                        @"jsonrpc": @"2.0",
+                        @"method": @"notifications/tools/list_changed"
+                    };
+                    sendJsonResponse(notification);
+                    os_log_info(logger, "Live tool schema differs, sent tools/list_changed");
+                }
+            } else {
+                os_log_error(logger, "Server did not return a tool list, keeping served schema");
+            }
+        }
+
         return YES;
     } @catch (NSException *e) {
         os_log_error(logger, "Exception during server init: %{public}@", e.reason);
@@ -299,14 +580,15 @@ void handleLocalRequest(NSDictionary *request) {
         os_log_info(logger, "Got initialized notification");
     }
     else if ([method isEqualToString:@"tools/list"]) {
-        // Return hardcoded mcpwa tools
+        // Return cached live schema (or hardcoded fallback)
+        NSArray *tools = currentServedTools();
         NSDictionary *response = @{
             @"jsonrpc": @"2.0",
             @"id": reqId,
-            @"result": @{@"tools": getMcpwaTools()}
+            @"result": @{@"tools": tools}
         };
         sendJsonResponse(response);
-        os_log_info(logger, "Returned mcpwa tools list (15 tools, server not connected)");
+        os_log_info(logger, "Returned mcpwa tools list (%lu tools, server not connected)", (unsigned long)tools.count);
     }
     else if ([method isEqualToString:@"tools/call"]) {
         // Server not connected - return error
@@ -330,14 +612,12 @@ void handleLocalRequest(NSDictionary *request) {
     }
 }
 
-void forwardToServer(NSString *line) {
-    if (serverHandle) {
-        @try {
-            [serverHandle writeData:[[line stringByAppendingString:@"\n"] dataUsingEncoding:NSUTF8StringEncoding]];
-        } @catch (NSException *e) {
-            os_log_error(logger, "Failed to forward to server");
-            serverHandle = nil;
-        }
+void forwardToServer(MCPServerConnection *connection, NSString *line, NSDictionary *request) {
+    @try {
+        [connection forwardClientLine:line request:request];
+    } @catch (NSException *e) {
+        os_log_error(logger, "Failed to forward to server");
+        if (serverConnection == connection) serverConnection = nil;
     }
 }
 
@@ -354,44 +634,45 @@ int main(int argc, const char *argv[]) {
         
         os_log_info(logger, "Shim started, socket: %{public}@", socketPath);
         
-        // Background: keep trying to connect to server
+        // Serve the last known live schema on cold start, hardcoded list otherwise
+        NSArray *cachedTools = loadCachedTools();
+        setServedTools(cachedTools ?: getMcpwaTools());
+        os_log_info(logger, "Serving %{public}s tool schema", cachedTools ? "cached" : "built-in");
+
+        connectSignal = dispatch_semaphore_create(0);
+        startSocketWatcher();
+
+        // Background: connect as soon as the socket appears, reconnect on disconnect
         dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
             while (!stdinClosed) {
-                if (!serverHandle) {
+                if (!serverConnection) {
                     int sock = connectToServer();
                     if (sock >= 0) {
-                        serverSocket = sock;  // Store for cleanup
-                        NSFileHandle *handle = [[NSFileHandle alloc] initWithFileDescriptor:sock closeOnDealloc:YES];
-                        
-                        if (!initializeServer(handle)) {
+                        MCPServerConnection *connection = [[MCPServerConnection alloc] initWithFileDescriptor:sock];
+                        if (!initializeServer(connection)) {
                             os_log_error(logger, "Failed to initialize server, will retry");
+                            dispatch_semaphore_wait(connectSignal,
+                                dispatch_time(DISPATCH_TIME_NOW, (int64_t)(kReconnectFallbackPoll * NSEC_PER_SEC)));
                             continue;
                         }
                         
-                        serverHandle = handle;
-                        
-                        // Notify Claude that tools changed (server now available)
-                        NSDictionary *notification = @{
-                            @"jsonrpc": @"2.0",
-                            @"method": @"notifications/tools/list_changed"
-                        };
-                        sendJsonResponse(notification);
-                        os_log_info(logger, "Sent tools/list_changed notification to Claude");
+                        serverConnection = connection;
                         
-                        // Forward server responses to stdout
+                        // Forward server responses and notifications to stdout as each
+                        // message completes, transcoding frames to JSON lines
                         dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
-                            NSFileHandle *h = serverHandle;
-                            NSData *data;
-                            while (h && (data = [h availableData]) && data.length > 0) {
-                                [stdoutHandle writeData:data];
-                            }
+                            [connection forwardServerMessagesTo:^(NSData *lines) {
+                                writeToClient(lines);
+                            }];
                             os_log_info(logger, "Server disconnected");
-                            serverHandle = nil;
-                            serverSocket = -1;
+                            if (serverConnection == connection) serverConnection = nil;
+                            dispatch_semaphore_signal(connectSignal);
                         });
                     }
                 }
-                usleep(500000);
+                // Sleep until the socket directory changes or the server drops
+                dispatch_semaphore_wait(connectSignal,
+                    dispatch_time(DISPATCH_TIME_NOW, (int64_t)(kReconnectFallbackPoll * NSEC_PER_SEC)));
             }
         });
         
@@ -413,8 +694,9 @@ int main(int argc, const char *argv[]) {
                 NSData *jsonData = [line dataUsingEncoding:NSUTF8StringEncoding];
                 NSDictionary *request = [NSJSONSerialization JSONObjectWithData:jsonData options:0 error:nil];
                 
-                if (serverHandle) {
-                    forwardToServer(line);
+                MCPServerConnection *connection = serverConnection;
+                if (connection) {
+                    forwardToServer(connection, line, request);
                 } else {
                     handleLocalRequest(request);
                 }
@@ -426,15 +708,19 @@ int main(int argc, const char *argv[]) {
         
         os_log_info(logger, "stdin closed, exiting");
         stdinClosed = YES;
+        if (socketDirWatcher) {
+            dispatch_source_cancel(socketDirWatcher);
+        }
+        dispatch_semaphore_signal(connectSignal);
 
-        // Close the server socket to unblock any threads waiting on availableData
+        // Close the server socket to unblock any threads blocked reading it
         // This is critical - without this, the process hangs because background
         // threads are blocked on socket reads even after main() wants to exit
-        if (serverSocket >= 0) {
+        MCPServerConnection *connection = serverConnection;
+        if (connection) {
             os_log_info(logger, "Closing server socket to unblock threads");
-            shutdown(serverSocket, SHUT_RDWR);  // Unblock any pending reads
-            close(serverSocket);
-            serverSocket = -1;
+            [connection shutdown];  // Unblock any pending reads
+            serverConnection = nil;
         }
 
         // Give threads a moment to notice the socket closed
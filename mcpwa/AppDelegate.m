@@ -13,31 +13,154 @@
 #import "BotChatWindowController.h"
 #import "DebugConfigWindowController.h"
 #import "SettingsWindowController.h"
+#import "RAGClient.h"
+#import "WAConversationStore.h"
+#import "WAToolMetrics.h"
+#import <sys/sysctl.h>
+#import <sys/time.h>
 
 @interface AppDelegate ()
 @property (nonatomic, strong) BotChatWindowController *botChatController;
 @property (nonatomic, weak) NSMenuItem *debugMenuItem;
+
+// Log lines received before the log window is first opened
+@property (nonatomic, strong) NSMutableArray<NSAttributedString *> *pendingLogLines;
+
+// Last known probe results, rendered by updateStatusLabel without re-probing
+@property (nonatomic, assign) BOOL statusKnown;
+@property (nonatomic, assign) BOOL hasAccessibilityPermission;
+@property (nonatomic, assign) BOOL whatsAppAvailable;
 @end
 
+/// Upper bound on buffered log lines while the log window has never been shown
+static const NSUInteger kMaxPendingLogLines = 5000;
+
 @implementation AppDelegate
 
 - (void)applicationDidFinishLaunching:(NSNotification *)notification {
-    [self setupLogWindow];
+    self.pendingLogLines = [NSMutableArray array];
     [self setupDebugMenu];
-    [self checkInitialStatus];
 
     // Apply saved theme preference
     [SettingsWindowController applyThemeToAllWindows];
 
-    // Subscribe to WALogger notifications
+    // Subscribe to WALogger notifications (buffered until the log window exists)
     [[NSNotificationCenter defaultCenter] addObserver:self
                                              selector:@selector(handleLogNotification:)
                                                  name:WALogNotification
                                                object:nil];
 
-    // Show Bot Chat as main window
+    // Show Bot Chat as main window before any probing
     self.botChatController = [BotChatWindowController sharedController];
     [self.botChatController showWindow];
+
+    // Everything below runs after the window is on screen
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self logTimeToFirstInteractive];
+        [self.botChatController populateModelSelector];
+        [self runStartupProbes];
+    });
+}
+
+#pragma mark - Startup
+
+/// Milliseconds since the kernel started this process
+- (double)millisecondsSinceProcessStart {
+    struct kinfo_proc info;
+    size_t size = sizeof(info);
+    int mib[4] = { CTL_KERN, KERN_PROC, KERN_PROC_PID, getpid() };
+    if (sysctl(mib, 4, &info, &size, NULL, 0) != 0 || size == 0) {
+        return -1;
+    }
+
+    struct timeval start = info.kp_proc.p_starttime;
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (now.tv_sec - start.tv_sec) * 1000.0 + (now.tv_usec - start.tv_usec) / 1000.0;
+}
+
+- (void)logTimeToFirstInteractive {
+    double elapsed = [self millisecondsSinceProcessStart];
+    if (elapsed < 0) {
+        [WALogger warn:@"[Startup] Could not read process start time"];
+        return;
+    }
+    [WALogger info:@"[Startup] Time to first interactive window: %.0f ms", elapsed];
+}
+
+/// Run permission, WhatsApp and RAG probes concurrently; each reports as soon as it finishes
+- (void)runStartupProbes {
+    [self appendLog:@"Startup checks:"];
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+
+    dispatch_queue_t probeQueue = dispatch_get_global_queue(QOS_CLASS_UTILITY, 0);
+
+    dispatch_async(probeQueue, ^{
+        BOOL hasPermission = AXIsProcessTrusted();
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self reportPermission:hasPermission];
+        });
+
+        if (!hasPermission) return;
+
+        WAAccessibility *wa = [WAAccessibility shared];
+        BOOL isAvailable = [wa isWhatsAppAvailable];
+
+        // If not available on first check, try to ensure WhatsApp is visible
+        if (!isAvailable) {
+            [self appendLog:@"WhatsApp not immediately available, trying to make visible..."];
+            if ([wa ensureWhatsAppVisible]) {
+                isAvailable = [wa isWhatsAppAvailable];
+            }
+        }
+
+        double elapsed = (CFAbsoluteTimeGetCurrent() - start) * 1000.0;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self reportWhatsAppAvailable:isAvailable elapsed:elapsed];
+        });
+    });
+
+    [self.botChatController.ragClient checkHealthWithCompletion:^(BOOL available, NSString *error) {
+        double elapsed = (CFAbsoluteTimeGetCurrent() - start) * 1000.0;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self appendLog:[NSString stringWithFormat:@"  • RAG service: %@ (%.0f ms)",
+                             available ? @"✅ Available" : [NSString stringWithFormat:@"⚠️ %@", error ?: @"Unavailable"],
+                             elapsed]
+                      color:available ? NSColor.greenColor : NSColor.yellowColor];
+        });
+    }];
+}
+
+- (void)reportPermission:(BOOL)hasPermission {
+    self.hasAccessibilityPermission = hasPermission;
+
+    [self appendLog:[NSString stringWithFormat:@"  • Accessibility permission: %@",
+                     hasPermission ? @"✅ Granted" : @"❌ Not granted"]
+              color:hasPermission ? NSColor.greenColor : NSColor.redColor];
+
+    if (!hasPermission) {
+        self.statusKnown = YES;
+        [self updateStatusLabel];
+        [self appendLog:@"⚠️  Please grant Accessibility permission:" color:NSColor.yellowColor];
+        [self appendLog:@"   System Settings → Privacy & Security → Accessibility" color:NSColor.yellowColor];
+        [self appendLog:@"   Add and enable this app, then click 'Check Status'" color:NSColor.yellowColor];
+        [self appendLog:@""];
+    }
+}
+
+- (void)reportWhatsAppAvailable:(BOOL)isAvailable elapsed:(double)elapsed {
+    self.whatsAppAvailable = isAvailable;
+    self.statusKnown = YES;
+    [self updateStatusLabel];
+
+    [self appendLog:[NSString stringWithFormat:@"  • WhatsApp accessible: %@ (%.0f ms)",
+                     isAvailable ? @"✅ Yes" : @"⚠️ No", elapsed]
+              color:isAvailable ? NSColor.greenColor : NSColor.yellowColor];
+
+    if (!isAvailable) {
+        [self appendLog:@"ℹ️  Launch WhatsApp Desktop to enable message reading" color:NSColor.systemBlueColor];
+        [self appendLog:@""];
+    }
 }
 
 - (void)setupDebugMenu {
@@ -64,7 +187,7 @@
 }
 
 - (void)setupLogWindow {
-    // Create log window (secondary, shown on demand with Cmd+B)
+    // Create log window (secondary, built the first time it is shown with Cmd+B)
     NSRect frame = NSMakeRect(100, 100, 800, 500);
     NSWindowStyleMask style = NSWindowStyleMaskTitled |
     NSWindowStyleMaskClosable |
@@ -127,59 +250,32 @@
     scrollView.documentView = self.logView;
     [contentView addSubview:scrollView];
 
-    // Do NOT show log window on startup - it opens on demand with Cmd+B
-
-    // Welcome message
-    [self appendLog:@"╔══════════════════════════════════════════════════════════════╗" color:NSColor.cyanColor];
-    [self appendLog:@"║           WhatsApp Assistant v1.0                            ║" color:NSColor.cyanColor];
-    [self appendLog:@"║   Backend-powered chat with WhatsApp integration             ║" color:NSColor.cyanColor];
-    [self appendLog:@"╚══════════════════════════════════════════════════════════════╝" color:NSColor.cyanColor];
-    [self appendLog:@""];
-}
-
-- (void)checkInitialStatus {
-    WAAccessibility *wa = [WAAccessibility shared];
-
-    // Check if accessibility is trusted
-    BOOL hasPermission = AXIsProcessTrusted();
-
-    BOOL isAvailable = [wa isWhatsAppAvailable];
-
-    // If not available on first check, try to ensure WhatsApp is visible
-    if (hasPermission && !isAvailable) {
-        [self appendLog:@"WhatsApp not immediately available, trying to make visible..."];
-        if ([wa ensureWhatsAppVisible]) {
-            isAvailable = [wa isWhatsAppAvailable];
-        }
+    // Welcome message goes above everything logged before the window existed
+    NSArray<NSAttributedString *> *pending = self.pendingLogLines;
+    self.pendingLogLines = nil;
+
+    NSColor *cyan = NSColor.cyanColor;
+    for (NSString *banner in @[@"╔══════════════════════════════════════════════════════════════╗",
+                               @"║           WhatsApp Assistant v1.0                            ║",
+                               @"║   Backend-powered chat with WhatsApp integration             ║",
+                               @"╚══════════════════════════════════════════════════════════════╝",
+                               @""]) {
+        [self.logView.textStorage appendAttributedString:[self attributedLogLine:banner color:cyan]];
     }
-
-    [self appendLog:@"Startup checks:"];
-    [self appendLog:[NSString stringWithFormat:@"  • Accessibility permission: %@",
-                     hasPermission ? @"✅ Granted" : @"❌ Not granted"]
-              color:hasPermission ? NSColor.greenColor : NSColor.redColor];
-    [self appendLog:[NSString stringWithFormat:@"  • WhatsApp accessible: %@",
-                     isAvailable ? @"✅ Yes" : @"⚠️ No"]
-              color:isAvailable ? NSColor.greenColor : NSColor.yellowColor];
-    [self appendLog:@""];
-
-    [self updateStatusLabel];
-
-    if (!hasPermission) {
-        [self appendLog:@"⚠️  Please grant Accessibility permission:" color:NSColor.yellowColor];
-        [self appendLog:@"   System Settings → Privacy & Security → Accessibility" color:NSColor.yellowColor];
-        [self appendLog:@"   Add and enable this app, then click 'Check Status'" color:NSColor.yellowColor];
-        [self appendLog:@""];
+    for (NSAttributedString *line in pending) {
+        [self.logView.textStorage appendAttributedString:line];
     }
+    [self.logView scrollToEndOfDocument:nil];
 
-    if (hasPermission && !isAvailable) {
-        [self appendLog:@"ℹ️  Launch WhatsApp Desktop to enable message reading" color:NSColor.systemBlueColor];
-        [self appendLog:@""];
-    }
+    [self updateStatusLabel];
 }
 
+/// Render the cached probe results; probing happens in runStartupProbes and checkPermissions:
 - (void)updateStatusLabel {
-    BOOL hasPermission = AXIsProcessTrusted();
-    BOOL isAvailable = [[WAAccessibility shared] isWhatsAppAvailable];
+    if (!self.statusLabel || !self.statusKnown) return;
+
+    BOOL hasPermission = self.hasAccessibilityPermission;
+    BOOL isAvailable = self.whatsAppAvailable;
 
     NSString *icon;
     NSString *text;
@@ -214,6 +310,10 @@
     WAAccessibility *wa = [WAAccessibility shared];
     BOOL isAvailable = [wa isWhatsAppAvailable];
 
+    self.hasAccessibilityPermission = hasPermission;
+    self.whatsAppAvailable = isAvailable;
+    self.statusKnown = YES;
+
     [self appendLog:[NSString stringWithFormat:@"  • Accessibility: %@",
                      hasPermission ? @"✅ Granted" : @"❌ Not granted"]
               color:hasPermission ? NSColor.greenColor : NSColor.redColor];
@@ -250,24 +350,37 @@
 
 - (void)appendLog:(NSString *)message color:(NSColor *)color {
     dispatch_async(dispatch_get_main_queue(), ^{
-        NSString *timestamp = [self currentTimestamp];
-        NSString *line = message.length > 0 ?
-        [NSString stringWithFormat:@"[%@] %@\n", timestamp, message] :
-        @"\n";
-
-        NSColor *textColor = color ?: [NSColor colorWithWhite:0.85 alpha:1.0];
-        NSDictionary *attrs = @{
-            NSForegroundColorAttributeName: textColor,
-            NSFontAttributeName: [NSFont monospacedSystemFontOfSize:11 weight:NSFontWeightRegular]
-        };
-
-        NSAttributedString *attrString = [[NSAttributedString alloc] initWithString:line attributes:attrs];
+        NSAttributedString *attrString = [self attributedLogLine:message color:color];
+
+        // Until the log window is first opened, keep lines in memory instead of laying out text
+        if (!self.logView) {
+            if (self.pendingLogLines.count >= kMaxPendingLogLines) {
+                [self.pendingLogLines removeObjectAtIndex:0];
+            }
+            [self.pendingLogLines addObject:attrString];
+            return;
+        }
 
         [self.logView.textStorage appendAttributedString:attrString];
         [self.logView scrollToEndOfDocument:nil];
     });
 }
 
+- (NSAttributedString *)attributedLogLine:(NSString *)message color:(NSColor *)color {
+    NSString *timestamp = [self currentTimestamp];
+    NSString *line = message.length > 0 ?
+    [NSString stringWithFormat:@"[%@] %@\n", timestamp, message] :
+    @"\n";
+
+    NSColor *textColor = color ?: [NSColor colorWithWhite:0.85 alpha:1.0];
+    NSDictionary *attrs = @{
+        NSForegroundColorAttributeName: textColor,
+        NSFontAttributeName: [NSFont monospacedSystemFontOfSize:11 weight:NSFontWeightRegular]
+    };
+
+    return [[NSAttributedString alloc] initWithString:line attributes:attrs];
+}
+
 - (NSString *)currentTimestamp {
     static NSDateFormatter *formatter = nil;
     if (!formatter) {
@@ -330,7 +443,9 @@
 }
 
 - (void)applicationWillTerminate:(NSNotification *)notification {
-    // Cleanup if needed
+    // Conversation logs are written as messages arrive; only the index update is batched
+    [[WAConversationStore shared] flush];
+    [[WAToolMetrics shared] logSummary];
 }
 
 #pragma mark - Menu Actions
@@ -520,6 +635,15 @@
 - (IBAction)debugTestParsing:(id)sender {
     dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
         [WAAccessibilityTest testParsingUnitTests];
+        [WAAccessibilityTest testLocalRetriever];
+        [WAAccessibilityTest testEndpointPool];
+        [WAAccessibilityTest testTreeWalker];
+        [WAAccessibilityTest testBatchSearch];
+        [WAAccessibilityTest testMessageCellDecoder];
+        [WAAccessibilityTest testShimFraming];
+        [WAAccessibilityTest testChatDirectory];
+        [WAAccessibilityTest testSendQueueOpenChat];
+        [WAAccessibilityTest testResultPager];
     });
 }
 
@@ -632,6 +756,9 @@
 #pragma mark - Log Window Actions
 
 - (IBAction)toggleLogWindow:(id)sender {
+    if (!self.window) {
+        [self setupLogWindow];
+    }
     if (self.window.isVisible) {
         [self.window orderOut:nil];
     } else {
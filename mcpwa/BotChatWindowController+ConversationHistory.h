@@ -0,0 +1,32 @@
+//
+//  BotChatWindowController+ConversationHistory.h
+//  mcpwa
+//
+//  Conversation persistence and bounded-memory history paging
+//
+
+#import "BotChatWindowController.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface BotChatWindowController (ConversationHistory) <NSMenuDelegate>
+
+/// Observe chat scrolling so older/newer messages are paged in from disk
+- (void)setupConversationHistory;
+
+/// Add the saved-conversations menu button to the title bar
+- (void)setupHistoryButtonInTitleBar:(NSView *)titleBarView;
+
+/// Persist a message and show it, evicting the oldest resident messages
+/// once more than a window's worth are in memory
+- (void)appendDisplayMessage:(ChatDisplayMessage *)message;
+
+/// Clear the window and start persisting into a fresh conversation
+- (void)startNewConversation;
+
+/// Replace the window contents with the newest messages of a saved conversation
+- (BOOL)openConversationWithIdentifier:(NSString *)identifier;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,335 @@
+//
+//  BotChatWindowController+ConversationHistory.m
+//  mcpwa
+//
+//  Conversation persistence and bounded-memory history paging
+//
+
+#import "BotChatWindowController+ConversationHistory.h"
+#import "BotChatWindowController+MessageRendering.h"
+#import "BotChatWindowController+ScrollManagement.h"
+#import "WAConversationStore.h"
+#import "WALogger.h"
+
+// At most this many messages (and their bubble views) stay in memory
+static const NSUInteger kResidentMessageLimit = 120;
+// Messages loaded per scroll-back step
+static const NSUInteger kHistoryPageSize = 40;
+// Start paging when the visible area is this close to either end of the content
+static const CGFloat kPagingThreshold = 200.0;
+// Saved conversations listed in the history menu
+static const NSUInteger kHistoryMenuLimit = 25;
+
+static NSString *const kDefaultTitle = @"WhatsApp Assistant";
+
+@implementation BotChatWindowController (ConversationHistory)
+
+#pragma mark - Setup
+
+- (void)setupConversationHistory {
+    NSClipView *clipView = self.chatScrollView.contentView;
+    clipView.postsBoundsChangedNotifications = YES;
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(chatScrollViewDidScroll:)
+                                                 name:NSViewBoundsDidChangeNotification
+                                               object:clipView];
+}
+
+- (void)setupHistoryButtonInTitleBar:(NSView *)titleBarView {
+    NSPopUpButton *button = [[NSPopUpButton alloc] initWithFrame:NSZeroRect pullsDown:YES];
+    button.translatesAutoresizingMaskIntoConstraints = NO;
+    button.bordered = NO;
+    button.toolTip = @"Conversations";
+
+    // The first item of a pull-down menu is the button face
+    NSMenuItem *face = [[NSMenuItem alloc] initWithTitle:@"" action:nil keyEquivalent:@""];
+    NSImageSymbolConfiguration *config = [NSImageSymbolConfiguration configurationWithPointSize:12 weight:NSFontWeightMedium];
+    face.image = [[NSImage imageWithSystemSymbolName:@"clock.arrow.circlepath" accessibilityDescription:@"Conversations"]
+                  imageWithSymbolConfiguration:config];
+    [button.menu addItem:face];
+    button.menu.delegate = self;
+    [titleBarView addSubview:button];
+    self.historyButton = button;
+
+    [NSLayoutConstraint activateConstraints:@[
+        [button.trailingAnchor constraintEqualToAnchor:titleBarView.trailingAnchor constant:-12],
+        [button.centerYAnchor constraintEqualToAnchor:titleBarView.centerYAnchor]
+    ]];
+}
+
+#pragma mark - NSMenuDelegate
+
+- (void)menuNeedsUpdate:(NSMenu *)menu {
+    if (menu != self.historyButton.menu) return;
+
+    // Keep the face item, rebuild the rest from the index
+    while (menu.numberOfItems > 1) {
+        [menu removeItemAtIndex:1];
+    }
+
+    NSMenuItem *newItem = [[NSMenuItem alloc] initWithTitle:@"New Conversation"
+                                                     action:@selector(newConversation:)
+                                              keyEquivalent:@""];
+    newItem.target = self;
+    [menu addItem:newItem];
+    [menu addItem:[NSMenuItem separatorItem]];
+
+    NSArray<WAConversationInfo *> *saved = [[WAConversationStore shared] conversations];
+    if (saved.count == 0) {
+        NSMenuItem *empty = [[NSMenuItem alloc] initWithTitle:@"No Saved Conversations" action:nil keyEquivalent:@""];
+        empty.enabled = NO;
+        [menu addItem:empty];
+        return;
+    }
+
+    NSDateFormatter *formatter = [[NSDateFormatter alloc] init];
+    formatter.dateStyle = NSDateFormatterShortStyle;
+    formatter.timeStyle = NSDateFormatterShortStyle;
+    formatter.doesRelativeDateFormatting = YES;
+
+    for (WAConversationInfo *info in [saved subarrayWithRange:NSMakeRange(0, MIN(saved.count, kHistoryMenuLimit))]) {
+        NSString *title = [NSString stringWithFormat:@"%@ — %@", info.title ?: @"Untitled",
+                           [formatter stringFromDate:info.updatedAt]];
+        NSMenuItem *item = [[NSMenuItem alloc] initWithTitle:title
+                                                      action:@selector(openSavedConversation:)
+                                               keyEquivalent:@""];
+        item.target = self;
+        item.representedObject = info.identifier;
+        item.state = [info.identifier isEqualToString:self.conversation.identifier] ? NSControlStateValueOn : NSControlStateValueOff;
+        [menu addItem:item];
+    }
+}
+
+#pragma mark - Actions
+
+- (void)newConversation:(id)sender {
+    if (self.isProcessing) {
+        [self updateStatus:@"Stop the current request first"];
+        return;
+    }
+    [self startNewConversation];
+}
+
+- (void)openSavedConversation:(NSMenuItem *)sender {
+    if (self.isProcessing) {
+        [self updateStatus:@"Stop the current request first"];
+        return;
+    }
+    if (![self openConversationWithIdentifier:sender.representedObject]) {
+        [self updateStatus:@"Conversation could not be opened"];
+    }
+}
+
+#pragma mark - Conversations
+
+- (void)startNewConversation {
+    [self clearResidentMessages];
+    // Created lazily on the first user message, so idle launches leave nothing on disk
+    self.conversation = nil;
+    self.firstResidentIndex = 0;
+    self.hasTitleBeenGenerated = NO;
+    self.firstUserMessage = nil;
+    self.titleLabel.stringValue = kDefaultTitle;
+    [self updateStatus:@"Ready"];
+}
+
+- (BOOL)openConversationWithIdentifier:(NSString *)identifier {
+    WAConversation *conversation = [[WAConversationStore shared] openConversation:identifier];
+    if (!conversation) return NO;
+
+    self.conversation = conversation;
+    self.hasTitleBeenGenerated = YES;   // Keep the saved title
+    self.titleLabel.stringValue = conversation.title ?: kDefaultTitle;
+    [self showConversationTail];
+    [self updateStatus:@"Ready"];
+    return YES;
+}
+
+- (void)appendDisplayMessage:(ChatDisplayMessage *)message {
+    if (!self.conversation && message.type == ChatMessageTypeUser) {
+        // First real exchange: persist the greeting shown so far, then everything after it
+        self.conversation = [[WAConversationStore shared] createConversation];
+        for (ChatDisplayMessage *resident in self.messages) {
+            [self.conversation appendMessage:resident];
+        }
+    }
+
+    // New messages always land at the bottom; jump back there if the user paged away
+    if (![self isTailResident]) {
+        [self showConversationTail];
+    }
+
+    [self.conversation appendMessage:message];
+    [self.messages addObject:message];
+    [self addMessageBubble:message];
+
+    if (self.conversation) {
+        [self evictOldestResidentMessages];
+    }
+}
+
+#pragma mark - Resident Window
+
+- (BOOL)isTailResident {
+    if (!self.conversation) return YES;
+    return self.firstResidentIndex + self.messages.count >= self.conversation.messageCount;
+}
+
+- (void)clearResidentMessages {
+    [self removeBottomSpacer];
+    for (NSView *view in [self.chatStackView.arrangedSubviews copy]) {
+        [self.chatStackView removeArrangedSubview:view];
+        [view removeFromSuperview];
+    }
+    [self.messages removeAllObjects];
+    [self.messageViews removeAllObjects];
+}
+
+/// Load the newest window of the conversation and scroll to it
+- (void)showConversationTail {
+    NSUInteger count = self.conversation.messageCount;
+    NSUInteger start = count > kResidentMessageLimit ? count - kResidentMessageLimit : 0;
+
+    [self clearResidentMessages];
+    self.firstResidentIndex = start;
+    for (ChatDisplayMessage *message in [self.conversation messagesInRange:NSMakeRange(start, count - start)]) {
+        [self insertResidentMessage:message atIndex:self.messages.count];
+    }
+    [self scrollToBottom];
+}
+
+/// Add a bubble for a message paged in from disk (no prompt-at-top spacer handling)
+- (void)insertResidentMessage:(ChatDisplayMessage *)message atIndex:(NSUInteger)index {
+    NSView *bubbleContainer = [self bubbleContainerForMessage:message];
+
+    // Resident bubbles are contiguous from the top of the stack
+    NSUInteger arrangedIndex = index < self.messageViews.count
+        ? [self.chatStackView.arrangedSubviews indexOfObjectIdenticalTo:self.messageViews[index]]
+        : (self.messageViews.count > 0
+           ? [self.chatStackView.arrangedSubviews indexOfObjectIdenticalTo:self.messageViews.lastObject] + 1
+           : 0);
+    [self.chatStackView insertArrangedSubview:bubbleContainer atIndex:arrangedIndex];
+    [bubbleContainer.widthAnchor constraintEqualToAnchor:self.chatStackView.widthAnchor constant:-48].active = YES;
+
+    [self.messages insertObject:message atIndex:index];
+    [self.messageViews insertObject:bubbleContainer atIndex:index];
+}
+
+- (void)removeResidentMessagesInRange:(NSRange)range {
+    for (NSView *view in [self.messageViews subarrayWithRange:range]) {
+        [self.chatStackView removeArrangedSubview:view];
+        [view removeFromSuperview];
+    }
+    [self.messages removeObjectsInRange:range];
+    [self.messageViews removeObjectsInRange:range];
+}
+
+/// Drop messages off the top once the window is over budget (never past the active prompt)
+- (void)evictOldestResidentMessages {
+    if (self.messages.count <= kResidentMessageLimit) return;
+
+    NSUInteger excess = self.messages.count - kResidentMessageLimit;
+    NSUInteger promptIndex = self.lastUserBubble ? [self.messageViews indexOfObjectIdenticalTo:self.lastUserBubble] : NSNotFound;
+    if (promptIndex != NSNotFound) excess = MIN(excess, promptIndex);
+    if (excess == 0) return;
+
+    [self preservingScrollPositionOfView:self.messageViews[excess] changes:^{
+        [self removeResidentMessagesInRange:NSMakeRange(0, excess)];
+    }];
+    self.firstResidentIndex += excess;
+}
+
+/// Drop messages off the bottom after scrolling back. Skipped while a response is being
+/// shown, since the streaming bubble and prompt spacer sit below the resident bubbles.
+- (void)evictNewestResidentMessages {
+    if (self.messages.count <= kResidentMessageLimit) return;
+    if (self.isProcessing || self.bottomSpacerView || self.streamingBubbleView) return;
+
+    NSUInteger excess = self.messages.count - kResidentMessageLimit;
+    NSUInteger keep = self.messages.count - excess;
+    [self preservingScrollPositionOfView:self.messageViews[keep - 1] changes:^{
+        [self removeResidentMessagesInRange:NSMakeRange(keep, excess)];
+    }];
+}
+
+/// Apply layout changes while keeping anchor at the same place on screen
+- (void)preservingScrollPositionOfView:(NSView *)anchor changes:(void (^)(void))changes {
+    NSClipView *clipView = self.chatScrollView.contentView;
+    NSView *documentView = self.chatScrollView.documentView;
+
+    [self.window layoutIfNeeded];
+    CGFloat offset = NSMinY([anchor convertRect:anchor.bounds toView:documentView]) - NSMinY(clipView.bounds);
+
+    changes();
+
+    [self.window layoutIfNeeded];
+    CGFloat scrollY = NSMinY([anchor convertRect:anchor.bounds toView:documentView]) - offset;
+    CGFloat maxScrollY = NSHeight(documentView.bounds) - NSHeight(clipView.bounds);
+    scrollY = MAX(0, MIN(scrollY, MAX(0, maxScrollY)));
+    [clipView scrollToPoint:NSMakePoint(0, scrollY)];
+    [self.chatScrollView reflectScrolledClipView:clipView];
+}
+
+#pragma mark - Paging
+
+- (void)chatScrollViewDidScroll:(NSNotification *)notification {
+    if (self.isPagingHistory || !self.conversation) return;
+
+    NSClipView *clipView = self.chatScrollView.contentView;
+    NSView *documentView = self.chatScrollView.documentView;
+    CGFloat documentHeight = NSHeight(documentView.bounds);
+    BOOL flipped = documentView.isFlipped;
+    CGFloat distanceToTop = flipped ? NSMinY(clipView.bounds) : documentHeight - NSMaxY(clipView.bounds);
+    CGFloat distanceToBottom = flipped ? documentHeight - NSMaxY(clipView.bounds) : NSMinY(clipView.bounds);
+
+    BOOL pageOlder = distanceToTop < kPagingThreshold && self.firstResidentIndex > 0;
+    BOOL pageNewer = !pageOlder && distanceToBottom < kPagingThreshold && ![self isTailResident];
+    if (!pageOlder && !pageNewer) return;
+
+    // Mutate the stack outside the bounds-change notification; scrolling done by the
+    // paging itself must not trigger another page
+    self.isPagingHistory = YES;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        if (pageOlder) {
+            [self pageInOlderMessages];
+        } else {
+            [self pageInNewerMessages];
+        }
+        self.isPagingHistory = NO;
+    });
+}
+
+- (void)pageInOlderMessages {
+    NSUInteger count = MIN(kHistoryPageSize, self.firstResidentIndex);
+    if (count == 0 || self.messageViews.count == 0) return;
+
+    NSRange range = NSMakeRange(self.firstResidentIndex - count, count);
+    NSArray<ChatDisplayMessage *> *older = [self.conversation messagesInRange:range];
+    [WALogger debug:@"[History] Paging in %lu older messages from %lu", (unsigned long)older.count, (unsigned long)range.location];
+
+    [self preservingScrollPositionOfView:self.messageViews.firstObject changes:^{
+        [older enumerateObjectsWithOptions:NSEnumerationReverse usingBlock:^(ChatDisplayMessage *message, NSUInteger idx, BOOL *stop) {
+            [self insertResidentMessage:message atIndex:0];
+        }];
+    }];
+    self.firstResidentIndex -= older.count;
+    [self evictNewestResidentMessages];
+}
+
+- (void)pageInNewerMessages {
+    NSUInteger next = self.firstResidentIndex + self.messages.count;
+    NSUInteger count = MIN(kHistoryPageSize, self.conversation.messageCount - next);
+    if (count == 0 || self.messageViews.count == 0) return;
+
+    NSArray<ChatDisplayMessage *> *newer = [self.conversation messagesInRange:NSMakeRange(next, count)];
+    [WALogger debug:@"[History] Paging in %lu newer messages from %lu", (unsigned long)newer.count, (unsigned long)next];
+
+    [self preservingScrollPositionOfView:self.messageViews.lastObject changes:^{
+        for (ChatDisplayMessage *message in newer) {
+            [self insertResidentMessage:message atIndex:self.messages.count];
+        }
+    }];
+    [self evictOldestResidentMessages];
+}
+
+@end
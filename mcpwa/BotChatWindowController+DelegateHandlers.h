@@ -16,6 +16,7 @@ NS_ASSUME_NONNULL_BEGIN
 - (void)ragClient:(RAGClient *)client didReceiveStatusUpdate:(NSString *)stage message:(NSString *)message;
 - (void)ragClient:(RAGClient *)client didReceiveStreamChunk:(NSString *)chunk;
 - (void)ragClient:(RAGClient *)client didCompleteQueryWithResponse:(RAGQueryResponse *)response;
+- (void)ragClient:(RAGClient *)client didReceiveLocalSearchResults:(RAGSearchResult *)response;
 - (void)ragClient:(RAGClient *)client didCompleteSearchWithResponse:(RAGSearchResult *)response;
 - (void)ragClient:(RAGClient *)client didFailWithError:(NSError *)error;
 
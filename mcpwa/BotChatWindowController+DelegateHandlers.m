@@ -105,9 +105,37 @@
     });
 }
 
+- (void)ragClient:(RAGClient *)client didReceiveLocalSearchResults:(RAGSearchResult *)response {
+    // Must dispatch to main thread for UI updates
+    dispatch_async(dispatch_get_main_queue(), ^{
+        if (self.isCancelled) return;
+
+        // Shown in the streaming bubble so the remote results can replace it
+        if (!self.streamingBubbleView) {
+            [self createStreamingBubble];
+        }
+        [self updateStreamingBubble:[self textForSearchResponse:response
+                                                        heading:@"**Search Results (offline, updating...):**\n\n"]];
+        [self updateStatus:@"Searching..."];
+    });
+}
+
 - (void)ragClient:(RAGClient *)client didCompleteSearchWithResponse:(RAGSearchResult *)response {
+    // Must dispatch to main thread for UI updates
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self showSearchResponse:response];
+    });
+}
+
+- (void)showSearchResponse:(RAGSearchResult *)response {
     if (self.isCancelled) return;
 
+    // Replace provisional offline results, if any were shown
+    if (self.streamingBubbleView) {
+        [self.streamingBubbleView removeFromSuperview];
+        [self finalizeStreamingBubble];
+    }
+
     if (response.error) {
         [self addErrorMessage:response.error];
         [self setProcessing:NO];
@@ -115,8 +143,15 @@
         return;
     }
 
+    NSString *heading = response.isLocalFallback ? @"**Search Results (offline):**\n\n" : @"**Search Results:**\n\n";
+    [self addBotMessage:[self textForSearchResponse:response heading:heading]];
+    [self setProcessing:NO];
+    [self updateStatus:@"Ready"];
+}
+
+- (NSString *)textForSearchResponse:(RAGSearchResult *)response heading:(NSString *)heading {
     // Format search results
-    NSMutableString *responseText = [NSMutableString stringWithString:@"**Search Results:**\n\n"];
+    NSMutableString *responseText = [NSMutableString stringWithString:heading];
 
     if (response.results.count == 0) {
         [responseText appendString:@"No results found."];
@@ -131,10 +166,7 @@
             [responseText appendFormat:@"**%@**\n%@\n\n", title, content];
         }
     }
-
-    [self addBotMessage:responseText];
-    [self setProcessing:NO];
-    [self updateStatus:@"Ready"];
+    return responseText;
 }
 
 - (void)ragClient:(RAGClient *)client didFailWithError:(NSError *)error {
@@ -29,6 +29,9 @@ NS_ASSUME_NONNULL_BEGIN
 /// Add a message bubble to the chat (core bubble rendering)
 - (void)addMessageBubble:(ChatDisplayMessage *)message;
 
+/// Build the bubble view for a message without adding it to the stack view
+- (NSView *)bubbleContainerForMessage:(ChatDisplayMessage *)message;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -10,6 +10,7 @@
 #import "BotChatWindowController+ScrollManagement.h"
 #import "BotChatWindowController+ZoomActions.h"
 #import "BotChatWindowController+MarkdownParser.h"
+#import "BotChatWindowController+ConversationHistory.h"
 
 @implementation BotChatWindowController (MessageRendering)
 
@@ -19,8 +20,7 @@
     ChatDisplayMessage *msg = [[ChatDisplayMessage alloc] init];
     msg.type = ChatMessageTypeUser;
     msg.text = text;
-    [self.messages addObject:msg];
-    [self addMessageBubble:msg];
+    [self appendDisplayMessage:msg];
 }
 
 - (void)addBotMessage:(NSString *)text {
@@ -28,9 +28,8 @@
     ChatDisplayMessage *msg = [[ChatDisplayMessage alloc] init];
     msg.type = ChatMessageTypeBot;
     msg.text = text;
-    [self.messages addObject:msg];
-    NSLog(@"[RAG UI] addBotMessage calling addMessageBubble");
-    [self addMessageBubble:msg];
+    NSLog(@"[RAG UI] addBotMessage calling appendDisplayMessage");
+    [self appendDisplayMessage:msg];
     // Update spacer after adding content
     [self updateSpacerForCurrentContent];
     NSLog(@"[RAG UI] addBotMessage END");
@@ -41,8 +40,7 @@
     msg.type = ChatMessageTypeFunction;
     msg.functionName = functionName;
     msg.text = result;
-    [self.messages addObject:msg];
-    [self addMessageBubble:msg];
+    [self appendDisplayMessage:msg];
     // Update spacer after adding content
     [self updateSpacerForCurrentContent];
 }
@@ -51,19 +49,17 @@
     ChatDisplayMessage *msg = [[ChatDisplayMessage alloc] init];
     msg.type = ChatMessageTypeSystem;
     msg.text = text;
-    [self.messages addObject:msg];
-    [self addMessageBubble:msg];
+    [self appendDisplayMessage:msg];
 }
 
 - (void)addErrorMessage:(NSString *)text {
     ChatDisplayMessage *msg = [[ChatDisplayMessage alloc] init];
     msg.type = ChatMessageTypeError;
     msg.text = text;
-    [self.messages addObject:msg];
-    [self addMessageBubble:msg];
+    [self appendDisplayMessage:msg];
 }
 
-- (void)addMessageBubble:(ChatDisplayMessage *)message {
+- (NSView *)bubbleContainerForMessage:(ChatDisplayMessage *)message {
     NSView *bubbleContainer = [[NSView alloc] initWithFrame:NSZeroRect];
     bubbleContainer.translatesAutoresizingMaskIntoConstraints = NO;
 
@@ -229,6 +225,12 @@
         [bubble.bottomAnchor constraintEqualToAnchor:bubbleContainer.bottomAnchor]
     ]];
 
+    return bubbleContainer;
+}
+
+- (void)addMessageBubble:(ChatDisplayMessage *)message {
+    NSView *bubbleContainer = [self bubbleContainerForMessage:message];
+
     // Add to stack view - insert before spacer if present (for non-user messages)
     if (message.type != ChatMessageTypeUser && self.bottomSpacerView) {
         NSUInteger spacerIndex = [self.chatStackView.arrangedSubviews indexOfObject:self.bottomSpacerView];
@@ -239,6 +241,7 @@
 
     // Container spans full width (margins handled by stackView edgeInsets)
     [bubbleContainer.widthAnchor constraintEqualToAnchor:self.chatStackView.widthAnchor constant:-48].active = YES;
+    [self.messageViews addObject:bubbleContainer];
 
     // ChatGPT-style scrolling: for user messages, add spacer to position prompt at top
     if (message.type == ChatMessageTypeUser) {
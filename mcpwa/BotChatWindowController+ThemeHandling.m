@@ -143,6 +143,7 @@ NSColor *secondaryTextColor(void) {
     }
 
     // Re-add all messages with updated colors
+    [self.messageViews removeAllObjects];
     for (ChatDisplayMessage *message in self.messages) {
         [self addMessageBubble:message];
     }
@@ -9,6 +9,8 @@
 #import "RAGClient.h"
 #import "SettingsWindowController.h"
 
+@class WAConversation;
+
 NS_ASSUME_NONNULL_BEGIN
 
 // Message types for display
@@ -56,8 +58,15 @@ typedef NS_ENUM(NSInteger, ChatMessageType) {
 // API Client
 @property (nonatomic, strong) RAGClient *ragClient;
 
-// Messages
+// Messages - only a window of the conversation is resident; the rest is paged from disk
 @property (nonatomic, strong) NSMutableArray<ChatDisplayMessage *> *messages;
+@property (nonatomic, strong) NSMutableArray<NSView *> *messageViews;   // Bubble per resident message, parallel to messages
+
+// Conversation History
+@property (nonatomic, strong, nullable) WAConversation *conversation;
+@property (nonatomic, assign) NSUInteger firstResidentIndex;            // Conversation index of messages[0]
+@property (nonatomic, assign) BOOL isPagingHistory;
+@property (nonatomic, strong, nullable) NSPopUpButton *historyButton;
 
 // UI Components - Title Bar
 @property (nonatomic, strong) NSView *titleBarView;
@@ -14,7 +14,10 @@
 #import "BotChatWindowController+MessageRendering.h"
 #import "BotChatWindowController+InputHandling.h"
 #import "BotChatWindowController+DelegateHandlers.h"
+#import "BotChatWindowController+ConversationHistory.h"
 #import "WAAccessibility.h"
+#import "WAChatDirectory.h"
+#import "WAConversationStore.h"
 #import "DebugConfigWindowController.h"
 #import "SettingsWindowController.h"
 #import "WALogger.h"
@@ -45,6 +48,7 @@
     self = [super init];
     if (self) {
         _messages = [NSMutableArray array];
+        _messageViews = [NSMutableArray array];
         _streamingResponse = [NSMutableString string];
 
         // Load saved font size or use default
@@ -52,6 +56,7 @@
         _currentFontSize = (savedFontSize >= kMinFontSize && savedFontSize <= kMaxFontSize) ? savedFontSize : kDefaultFontSize;
 
         [self setupWindow];
+        [self setupConversationHistory];
         [self setupRAGClient];
 
         // Listen to theme change notification from Settings
@@ -199,6 +204,9 @@
     [titleBarView addSubview:titleLabel];
     self.titleLabel = titleLabel;
 
+    // Saved conversations menu on the right of the title bar
+    [self setupHistoryButtonInTitleBar:titleBarView];
+
     // Title bar constraints - narrow height to align with traffic lights (~28px)
     [NSLayoutConstraint activateConstraints:@[
         [titleBarView.topAnchor constraintEqualToAnchor:contentView.topAnchor],
@@ -476,12 +484,14 @@
 #pragma mark - Client Setup
 
 - (void)setupRAGClient {
-    NSString *ragURL = [SettingsWindowController ragServiceURL];
-    self.ragClient = [[RAGClient alloc] initWithBaseURL:ragURL];
+    NSArray<NSString *> *ragURLs = [SettingsWindowController ragServiceURLs];
+    self.ragClient = [[RAGClient alloc] initWithBaseURLs:ragURLs];
     self.ragClient.delegate = self;
 
-    // Fetch available models from the server
-    [self populateModelSelector];
+    // Seed the chat-name directory so open_chat can resolve off-screen chats
+    [[WAAccessibility shared].chatDirectory refreshFromRAGClient:self.ragClient];
+
+    // The model list is fetched by the app's startup pipeline once the window is visible
     [self updateStatus:@"Ready"];
 }
 
@@ -620,7 +630,7 @@
     self.hasTitleBeenGenerated = YES;
 
     // Request title generation from backend
-    NSString *ragURL = [SettingsWindowController ragServiceURL];
+    NSString *ragURL = self.ragClient.baseURL ?: [SettingsWindowController ragServiceURLs].firstObject;
     NSString *urlString = [NSString stringWithFormat:@"%@/generate-title", ragURL];
     NSURL *url = [NSURL URLWithString:urlString];
 
@@ -657,6 +667,7 @@
 
             dispatch_async(dispatch_get_main_queue(), ^{
                 self.titleLabel.stringValue = title;
+                self.conversation.title = title;
             });
         }
     }];
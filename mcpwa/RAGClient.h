@@ -7,6 +7,9 @@
 
 #import <Foundation/Foundation.h>
 
+@class WALocalRetriever;
+@class RAGEndpointPool;
+
 NS_ASSUME_NONNULL_BEGIN
 
 /// RAG query response with answer and sources
@@ -21,8 +24,20 @@ NS_ASSUME_NONNULL_BEGIN
 @interface RAGSearchResult : NSObject
 @property (nonatomic, strong, nullable) NSArray<NSDictionary *> *results;
 @property (nonatomic, copy, nullable) NSString *error;
+@property (nonatomic, assign) BOOL isLocalFallback;   // Remote search failed; results are from the offline index only
+@end
+
+/// One query of a batch search
+@interface RAGSearchQuery : NSObject
+@property (nonatomic, copy) NSString *query;
+@property (nonatomic, assign) NSInteger k;            // 1-50, 0 = server default (5)
+@property (nonatomic, assign) NSInteger chatFilter;   // chat_id, 0 = no filter
++ (instancetype)queryWithText:(NSString *)query k:(NSInteger)k chatFilter:(NSInteger)chatFilter;
 @end
 
+/// Receives one query's result of a batch search, by its position in the batch
+typedef void (^RAGBatchSearchHandler)(NSUInteger index, RAGSearchResult *result);
+
 /// RAG chat item (matches API ChatInfo response)
 @interface RAGChatItem : NSObject
 @property (nonatomic, assign) NSInteger chatId;
@@ -46,6 +61,9 @@ NS_ASSUME_NONNULL_BEGIN
 - (void)ragClient:(id)client didReceiveStatusUpdate:(NSString *)stage message:(NSString *)message;
 - (void)ragClient:(id)client didCompleteQueryWithResponse:(RAGQueryResponse *)response;
 - (void)ragClient:(id)client didCompleteSearchWithResponse:(RAGSearchResult *)response;
+/// Provisional results from the offline index, delivered before the remote search completes.
+/// didCompleteSearchWithResponse: follows with the fused (or fallback) list.
+- (void)ragClient:(id)client didReceiveLocalSearchResults:(RAGSearchResult *)response;
 - (void)ragClient:(id)client didFailWithError:(NSError *)error;
 @end
 
@@ -53,11 +71,30 @@ NS_ASSUME_NONNULL_BEGIN
 @interface RAGClient : NSObject
 
 @property (nonatomic, weak, nullable) id<RAGClientDelegate> delegate;
+/// Base URL of the fastest healthy endpoint in the pool; setting it replaces
+/// the pool with that single endpoint
 @property (nonatomic, copy) NSString *baseURL;
 
+/// Replicas this client routes between, with their latency and error stats
+@property (nonatomic, strong, readonly) RAGEndpointPool *endpointPool;
+
+/// Offline index used for instant search results and as a fallback when the
+/// service fails (defaults to [WAAccessibility shared].localRetriever; nil disables it)
+@property (nonatomic, strong, nullable) WALocalRetriever *localRetriever;
+
 /// Initialize with base URL
 - (instancetype)initWithBaseURL:(NSString *)baseURL;
 
+/// Initialize with several replicas of the RAG service. Each request goes to the
+/// fastest healthy one; search and chat listing are hedged to a second replica
+/// when the first is slower than its p95 latency.
+- (instancetype)initWithBaseURLs:(NSArray<NSString *> *)baseURLs;
+
+/// initWithBaseURLs: with a custom session configuration (e.g. stub protocol classes);
+/// request and resource timeouts are set on a copy
+- (instancetype)initWithBaseURLs:(NSArray<NSString *> *)baseURLs
+            sessionConfiguration:(NSURLSessionConfiguration *)configuration;
+
 /// Load RAG URL from config
 + (nullable NSString *)loadRAGURL;
 
@@ -89,13 +126,31 @@ NS_ASSUME_NONNULL_BEGIN
 /// Simple query with defaults (streaming)
 - (void)queryStream:(NSString *)prompt;
 
-/// Semantic search without LLM
+/// Semantic search without LLM, fused with the offline BM25 index.
+/// Local hits arrive first via ragClient:didReceiveLocalSearchResults: (when chatFilter is 0,
+/// since the offline index has no chat ids); the final list is merged by reciprocal-rank fusion.
+/// The remote request is hedged across replicas.
 /// @param query Search query text
 /// @param k Number of results (1-50, default 5)
 /// @param chatFilter Optional chat_id filter (pass 0 for no filter)
 - (void)search:(NSString *)query k:(NSInteger)k chatFilter:(NSInteger)chatFilter;
 
-/// List all chats
+/// Several searches in one POST /search/batch. The service streams NDJSON, one
+/// {"id", "results"} or {"id", "error"} line per query as each finishes, and
+/// resultHandler fires per query in arrival order. Queries the stream doesn't
+/// answer, or all of them when the service has no batch endpoint (404/405,
+/// remembered for this client), fan out concurrently as hedged /search requests.
+/// Each result is fused with the offline index like search:k:chatFilter:.
+/// The delegate is not called; both blocks run on the client's callback queue.
+/// @param completion Results in query order, once every query has one
+- (void)searchBatch:(NSArray<RAGSearchQuery *> *)queries
+      resultHandler:(nullable RAGBatchSearchHandler)resultHandler
+         completion:(void(^)(NSArray<RAGSearchResult *> *results))completion;
+
+/// NO once the service has answered /search/batch with 404 or 405
+@property (readonly) BOOL supportsBatchSearch;
+
+/// List all chats (hedged across replicas)
 - (void)listChatsWithCompletion:(void(^)(NSArray<RAGChatItem *> * _Nullable chats, NSString * _Nullable error))completion;
 
 /// List available models from the server
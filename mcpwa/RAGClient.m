@@ -6,8 +6,21 @@
 //
 
 #import "RAGClient.h"
+#import "RAGEndpointPool.h"
+#import "WALocalRetriever.h"
+#import "WAAccessibility.h"
 #import "WALogger.h"
 
+static const NSUInteger kMaxHedgedAttempts = 2;
+static const NSTimeInterval kHealthPingInterval = 30.0;
+
+typedef void (^RAGResponseHandler)(NSData * _Nullable data, NSHTTPURLResponse * _Nullable response, NSError * _Nullable error);
+
+/// Our own cancellation (user or losing hedge), as opposed to a failure
+static BOOL RAGIsCancellation(NSError * _Nullable error) {
+    return [error.domain isEqualToString:NSURLErrorDomain] && error.code == NSURLErrorCancelled;
+}
+
 #pragma mark - RAGQueryResponse
 
 @implementation RAGQueryResponse
@@ -18,6 +31,20 @@
 @implementation RAGSearchResult
 @end
 
+#pragma mark - RAGSearchQuery
+
+@implementation RAGSearchQuery
+
++ (instancetype)queryWithText:(NSString *)query k:(NSInteger)k chatFilter:(NSInteger)chatFilter {
+    RAGSearchQuery *item = [[self alloc] init];
+    item.query = query;
+    item.k = k;
+    item.chatFilter = chatFilter;
+    return item;
+}
+
+@end
+
 #pragma mark - RAGChatItem
 
 @implementation RAGChatItem
@@ -28,31 +55,104 @@
 @implementation RAGModelItem
 @end
 
+#pragma mark - RAGHedgedRequest
+
+/// One idempotent request raced across up to kMaxHedgedAttempts endpoints.
+/// Only touched on the session's delegate queue.
+@interface RAGHedgedRequest : NSObject
+@property (nonatomic, copy) NSArray<NSString *> *endpoints;   // Ranked, best first
+@property (nonatomic, copy) NSURLRequest *(^makeRequest)(NSString *endpoint);
+@property (nonatomic, copy) RAGResponseHandler completion;
+@property (nonatomic, strong) NSMutableArray<NSURLSessionDataTask *> *tasks;
+@property (nonatomic, assign) NSUInteger launched;
+@property (nonatomic, assign) NSUInteger settled;
+@property (nonatomic, assign) BOOL finished;
+@end
+
+@implementation RAGHedgedRequest
+
+- (NSUInteger)maxAttempts {
+    return MIN(self.endpoints.count, kMaxHedgedAttempts);
+}
+
+- (void)cancel {
+    self.finished = YES;
+    for (NSURLSessionDataTask *task in self.tasks) {
+        [task cancel];
+    }
+}
+
+@end
+
+#pragma mark - RAGBatchSearch
+
+/// State of one searchBatch: call. Only touched on the session's delegate queue.
+@interface RAGBatchSearch : NSObject
+@property (nonatomic, copy) NSArray<RAGSearchQuery *> *queries;
+@property (nonatomic, copy) NSArray<NSArray<NSDictionary *> *> *localResults;   // Offline hits per query
+@property (nonatomic, strong) NSMutableArray *results;                          // RAGSearchResult or NSNull
+@property (nonatomic, assign) NSUInteger delivered;
+@property (nonatomic, assign) NSUInteger streamed;                              // Delivered from the batch stream
+@property (nonatomic, copy) RAGBatchSearchHandler resultHandler;
+@property (nonatomic, copy) void (^completion)(NSArray<RAGSearchResult *> *results);
+@property (nonatomic, assign) CFAbsoluteTime start;
+
+// Batch endpoint stream
+@property (nonatomic, strong, nullable) NSURLSessionDataTask *task;
+@property (nonatomic, copy, nullable) NSString *endpoint;
+@property (nonatomic, strong, nullable) NSHTTPURLResponse *response;
+@property (nonatomic, assign) NSTimeInterval responseLatency;                   // Time to headers, fed to the pool
+@property (nonatomic, strong) NSMutableData *buffer;                            // Bytes after the last complete line
+
+// Fan-out
+@property (nonatomic, strong) NSMutableArray<RAGHedgedRequest *> *hedges;
+@property (nonatomic, assign) BOOL finished;
+@end
+
+@implementation RAGBatchSearch
+@end
+
 #pragma mark - RAGClient
 
 @interface RAGClient () <NSURLSessionDataDelegate>
 @property (nonatomic, strong) NSURLSession *session;
+@property (nonatomic, strong, readwrite) RAGEndpointPool *endpointPool;
 @property (nonatomic, strong, nullable) NSURLSessionDataTask *currentTask;
+@property (atomic, copy, nullable) NSString *streamEndpoint;   // Endpoint of the stream query until its outcome is recorded
+@property (atomic, assign) CFAbsoluteTime streamStart;
+@property (atomic, strong, nullable) RAGHedgedRequest *currentHedge;   // Cleared on the delegate queue
 @property (nonatomic, strong) NSMutableString *streamBuffer;
 @property (nonatomic, strong) NSMutableString *accumulatedResponse;
 @property (nonatomic, strong, nullable) NSHTTPURLResponse *pendingErrorResponse;
 @property (nonatomic, assign) BOOL streamCompleted;
+@property (nonatomic, copy, nullable) NSString *fallbackPrompt;   // Prompt of the in-flight query, for offline fallback
+@property (nonatomic, strong) NSMutableSet<RAGBatchSearch *> *batchSearches;                  // Delegate queue only
+@property (nonatomic, strong) NSMutableDictionary<NSNumber *, RAGBatchSearch *> *batchStreams; // By task id; delegate queue only
+@property (atomic, assign) BOOL batchEndpointMissing;
 @end
 
 @implementation RAGClient
 
 - (instancetype)initWithBaseURL:(NSString *)baseURL {
+    return [self initWithBaseURLs:@[baseURL]];
+}
+
+- (instancetype)initWithBaseURLs:(NSArray<NSString *> *)baseURLs {
+    return [self initWithBaseURLs:baseURLs sessionConfiguration:[NSURLSessionConfiguration defaultSessionConfiguration]];
+}
+
+- (instancetype)initWithBaseURLs:(NSArray<NSString *> *)baseURLs
+            sessionConfiguration:(NSURLSessionConfiguration *)configuration {
     self = [super init];
     if (self) {
-        // Remove trailing slash if present
-        if ([baseURL hasSuffix:@"/"]) {
-            baseURL = [baseURL substringToIndex:baseURL.length - 1];
-        }
-        _baseURL = [baseURL copy];
+        _endpointPool = [[RAGEndpointPool alloc] initWithBaseURLs:baseURLs];
         _streamBuffer = [NSMutableString string];
         _accumulatedResponse = [NSMutableString string];
+        _localRetriever = [WAAccessibility shared].localRetriever;   // The account the app drives
+        _batchSearches = [NSMutableSet set];
+        _batchStreams = [NSMutableDictionary dictionary];
 
-        NSURLSessionConfiguration *config = [NSURLSessionConfiguration defaultSessionConfiguration];
+        NSURLSessionConfiguration *config = [configuration copy];
         config.timeoutIntervalForRequest = 60.0;
         config.timeoutIntervalForResource = 120.0;
         // Use a background queue for delegate callbacks to avoid blocking main thread
@@ -63,10 +163,26 @@
         _session = [NSURLSession sessionWithConfiguration:config
                                                  delegate:self
                                             delegateQueue:delegateQueue];
+
+        // Real traffic only measures the endpoint it lands on; pings keep the others ranked
+        if (_endpointPool.baseURLs.count > 1) {
+            [WALogger info:@"[RAG] Routing across %lu endpoints: %@",
+                (unsigned long)_endpointPool.baseURLs.count, [_endpointPool.baseURLs componentsJoinedByString:@", "]];
+            [_endpointPool startHealthPingsWithSession:_session interval:kHealthPingInterval];
+        }
     }
     return self;
 }
 
+- (NSString *)baseURL {
+    return [self.endpointPool bestEndpoint];
+}
+
+- (void)setBaseURL:(NSString *)baseURL {
+    [self.endpointPool stopHealthPings];
+    self.endpointPool = [[RAGEndpointPool alloc] initWithBaseURLs:@[baseURL]];
+}
+
 #pragma mark - Configuration
 
 + (nullable NSString *)loadRAGURL {
@@ -104,7 +220,8 @@
 #pragma mark - Health Check
 
 - (void)checkHealthWithCompletion:(void(^)(BOOL available, NSString * _Nullable error))completion {
-    NSString *urlString = [NSString stringWithFormat:@"%@/health", self.baseURL];
+    NSString *endpoint = self.baseURL;
+    NSString *urlString = [NSString stringWithFormat:@"%@/health", endpoint];
     NSURL *url = [NSURL URLWithString:urlString];
 
     if (!url) {
@@ -114,14 +231,14 @@
 
     NSURLRequest *request = [NSURLRequest requestWithURL:url];
 
-    NSURLSessionDataTask *task = [self.session dataTaskWithRequest:request
-                                                 completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+    NSURLSessionDataTask *task = [self trackedTaskWithRequest:request
+                                                     endpoint:endpoint
+                                                   completion:^(NSData *data, NSHTTPURLResponse *httpResponse, NSError *error) {
         if (error) {
             completion(NO, error.localizedDescription);
             return;
         }
 
-        NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
         if (httpResponse.statusCode == 200) {
             completion(YES, nil);
         } else {
@@ -139,8 +256,10 @@
 
 - (void)query:(NSString *)prompt k:(NSInteger)k chatFilter:(NSInteger)chatFilter model:(NSString *)model systemPrompt:(NSString *)systemPrompt {
     [WALogger info:@"[RAG] Query: %@", prompt];
+    self.fallbackPrompt = chatFilter > 0 ? nil : prompt;
 
-    NSString *urlString = [NSString stringWithFormat:@"%@/query", self.baseURL];
+    NSString *endpoint = self.baseURL;
+    NSString *urlString = [NSString stringWithFormat:@"%@/query", endpoint];
     NSURL *url = [NSURL URLWithString:urlString];
 
     if (!url) {
@@ -175,19 +294,21 @@
         return;
     }
 
-    self.currentTask = [self.session dataTaskWithRequest:request
-                                       completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+    self.currentTask = [self trackedTaskWithRequest:request
+                                           endpoint:endpoint
+                                         completion:^(NSData *data, NSHTTPURLResponse *httpResponse, NSError *error) {
         if (error) {
-            [self notifyError:error.localizedDescription];
+            if (RAGIsCancellation(error)) return;
+            [self failQueryWithMessage:error.localizedDescription];
             return;
         }
 
-        NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
         if (httpResponse.statusCode != 200) {
-            [self handleHTTPError:httpResponse data:data];
+            [self failQueryWithMessage:[self messageForHTTPError:httpResponse data:data]];
             return;
         }
 
+        self.fallbackPrompt = nil;
         [self parseQueryResponse:data];
     }];
     [self.currentTask resume];
@@ -222,12 +343,14 @@
 
 - (void)queryStream:(NSString *)prompt k:(NSInteger)k chatFilter:(NSInteger)chatFilter model:(NSString *)model systemPrompt:(NSString *)systemPrompt {
     [WALogger info:@"[RAG] Stream query: %@", prompt];
+    self.fallbackPrompt = chatFilter > 0 ? nil : prompt;
 
     [self.streamBuffer setString:@""];
     [self.accumulatedResponse setString:@""];
     self.streamCompleted = NO;
 
-    NSString *urlString = [NSString stringWithFormat:@"%@/query/stream", self.baseURL];
+    NSString *endpoint = self.baseURL;
+    NSString *urlString = [NSString stringWithFormat:@"%@/query/stream", endpoint];
     NSURL *url = [NSURL URLWithString:urlString];
 
     if (!url) {
@@ -265,13 +388,38 @@
 
     // Use delegate-based task for streaming
     self.currentTask = [self.session dataTaskWithRequest:request];
+    self.streamEndpoint = endpoint;
+    self.streamStart = CFAbsoluteTimeGetCurrent();
     [self.currentTask resume];
 }
 
+/// Feed the stream query's outcome to the endpoint pool, once. Like batch streams it
+/// is timed to the response headers; the body lasts as long as the model keeps talking.
+- (void)recordStreamOutcomeWithStatus:(NSInteger)statusCode {
+    NSString *endpoint = self.streamEndpoint;
+    if (!endpoint) return;
+    self.streamEndpoint = nil;
+
+    if (statusCode == 0 || statusCode >= 500) {
+        [self.endpointPool recordFailureForEndpoint:endpoint];
+    } else {
+        [self.endpointPool recordSuccessForEndpoint:endpoint latency:CFAbsoluteTimeGetCurrent() - self.streamStart];
+    }
+}
+
 #pragma mark - NSURLSessionDataDelegate
 
 - (void)URLSession:(NSURLSession *)session dataTask:(NSURLSessionDataTask *)dataTask didReceiveResponse:(NSURLResponse *)response completionHandler:(void (^)(NSURLSessionResponseDisposition))completionHandler {
+    RAGBatchSearch *batch = self.batchStreams[@(dataTask.taskIdentifier)];
+    if (batch) {
+        batch.response = [response isKindOfClass:[NSHTTPURLResponse class]] ? (NSHTTPURLResponse *)response : nil;
+        batch.responseLatency = CFAbsoluteTimeGetCurrent() - batch.start;
+        completionHandler(NSURLSessionResponseAllow);
+        return;
+    }
+
     NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
+    [self recordStreamOutcomeWithStatus:httpResponse.statusCode];
 
     if (httpResponse.statusCode != 200) {
         // For non-200 responses, allow data to come through so we can parse the error
@@ -284,9 +432,15 @@
 }
 
 - (void)URLSession:(NSURLSession *)session dataTask:(NSURLSessionDataTask *)dataTask didReceiveData:(NSData *)data {
+    RAGBatchSearch *batch = self.batchStreams[@(dataTask.taskIdentifier)];
+    if (batch) {
+        [self batchSearch:batch didReceiveData:data];
+        return;
+    }
+
     // Check if this is an error response
     if (self.pendingErrorResponse) {
-        [self handleHTTPError:self.pendingErrorResponse data:data];
+        [self failQueryWithMessage:[self messageForHTTPError:self.pendingErrorResponse data:data]];
         self.pendingErrorResponse = nil;
         [self.currentTask cancel];
         return;
@@ -419,16 +573,29 @@
 }
 
 - (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task didCompleteWithError:(NSError *)error {
+    RAGBatchSearch *batch = self.batchStreams[@(task.taskIdentifier)];
+    if (batch) {
+        [self.batchStreams removeObjectForKey:@(task.taskIdentifier)];
+        [self batchSearch:batch didCompleteWithError:error];
+        return;
+    }
+
     [WALogger info:@"[RAG] URLSession didCompleteWithError called, error: %@", error];
 
     if (error) {
         // Check if it was cancelled
-        if (error.code == NSURLErrorCancelled) {
+        if (RAGIsCancellation(error)) {
             [WALogger info:@"[RAG] Request was cancelled"];
+            self.streamEndpoint = nil;
             return;
         }
         [WALogger info:@"[RAG] Request failed with error: %@", error.localizedDescription];
-        [self notifyError:error.localizedDescription];
+        [self recordStreamOutcomeWithStatus:0];   // No-op if headers already arrived
+        if (self.accumulatedResponse.length == 0) {
+            [self failQueryWithMessage:error.localizedDescription];
+        } else {
+            [self notifyError:error.localizedDescription];
+        }
     } else {
         // Connection completed successfully - process any remaining buffer
         [WALogger info:@"[RAG] Stream connection completed successfully"];
@@ -470,6 +637,20 @@
 - (void)search:(NSString *)query k:(NSInteger)k chatFilter:(NSInteger)chatFilter {
     [WALogger info:@"[RAG] Search: %@", query];
 
+    // The offline index answers immediately; it has no chat ids, so skip it when filtering
+    NSArray<NSDictionary *> *localResults = @[];
+    if (chatFilter <= 0 && self.localRetriever) {
+        localResults = [self.localRetriever search:query k:k > 0 ? k : 5];
+    }
+    if (localResults.count > 0 && [self.delegate respondsToSelector:@selector(ragClient:didReceiveLocalSearchResults:)]) {
+        RAGSearchResult *provisional = [[RAGSearchResult alloc] init];
+        provisional.results = localResults;
+        // Same queue as the remote completion, so provisional results always arrive first
+        [self.session.delegateQueue addOperationWithBlock:^{
+            [self.delegate ragClient:self didReceiveLocalSearchResults:provisional];
+        }];
+    }
+
     NSString *urlString = [NSString stringWithFormat:@"%@/search", self.baseURL];
     NSURL *url = [NSURL URLWithString:urlString];
 
@@ -478,71 +659,380 @@
         return;
     }
 
-    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:url];
-    request.HTTPMethod = @"POST";
-    [request setValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
-
-    // Build request body according to API spec
-    NSMutableDictionary *body = [NSMutableDictionary dictionaryWithObject:query forKey:@"query"];
-    if (k > 0) {
-        body[@"k"] = @(k);
-    }
-    if (chatFilter > 0) {
-        body[@"chat_filter"] = @(chatFilter);
-    }
-
     NSError *jsonError;
-    request.HTTPBody = [NSJSONSerialization dataWithJSONObject:body options:0 error:&jsonError];
+    NSData *bodyData = [NSJSONSerialization dataWithJSONObject:[RAGClient searchBodyForQuery:query k:k chatFilter:chatFilter]
+                                                       options:0
+                                                         error:&jsonError];
 
     if (jsonError) {
         [self notifyError:jsonError.localizedDescription];
         return;
     }
 
-    self.currentTask = [self.session dataTaskWithRequest:request
-                                       completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+    // Search is read-only, so it is safe to race a duplicate against a second replica
+    self.currentHedge = [self sendHedgedRequest:^NSURLRequest *(NSString *endpoint) {
+        NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:[endpoint stringByAppendingString:@"/search"]]];
+        request.HTTPMethod = @"POST";
+        [request setValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
+        request.HTTPBody = bodyData;
+        return request;
+    } completion:^(NSData *data, NSHTTPURLResponse *httpResponse, NSError *error) {
         if (error) {
-            [self notifyError:error.localizedDescription];
+            if (RAGIsCancellation(error)) return;
+            [self failSearchWithMessage:error.localizedDescription localResults:localResults];
             return;
         }
 
-        NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
         if (httpResponse.statusCode != 200) {
-            [self handleHTTPError:httpResponse data:data];
+            [self failSearchWithMessage:[self messageForHTTPError:httpResponse data:data] localResults:localResults];
             return;
         }
 
-        [self parseSearchResponse:data];
+        [self parseSearchResponse:data localResults:localResults limit:k > 0 ? k : 5];
     }];
-    [self.currentTask resume];
 }
 
-- (void)parseSearchResponse:(NSData *)data {
+- (void)parseSearchResponse:(NSData *)data localResults:(NSArray<NSDictionary *> *)localResults limit:(NSInteger)limit {
     NSError *error;
-    // API returns array directly, not wrapped in object
-    NSArray *jsonArray = [NSJSONSerialization JSONObjectWithData:data options:0 error:&error];
+    NSArray *remoteResults = [RAGClient remoteSearchResultsFromData:data error:&error];
 
-    if (error) {
-        [self notifyError:error.localizedDescription];
+    if (!remoteResults) {
+        [self failSearchWithMessage:error.localizedDescription localResults:localResults];
         return;
     }
 
+    [WALogger info:@"[RAG] Search completed, results: %lu", (unsigned long)remoteResults.count];
+    RAGSearchResult *result = [self searchResultWithRemoteResults:remoteResults localResults:localResults limit:limit];
+
+    if ([self.delegate respondsToSelector:@selector(ragClient:didCompleteSearchWithResponse:)]) {
+        [self.delegate ragClient:self didCompleteSearchWithResponse:result];
+    }
+}
+
+/// Request body for one query, according to the API spec
++ (NSDictionary *)searchBodyForQuery:(NSString *)query k:(NSInteger)k chatFilter:(NSInteger)chatFilter {
+    NSMutableDictionary *body = [NSMutableDictionary dictionaryWithObject:query forKey:@"query"];
+    if (k > 0) {
+        body[@"k"] = @(k);
+    }
+    if (chatFilter > 0) {
+        body[@"chat_filter"] = @(chatFilter);
+    }
+    return body;
+}
+
+/// Results of a /search response: the API returns the array directly, older
+/// versions wrap it in {"results": [...]}. nil with *error if unparseable.
++ (nullable NSArray *)remoteSearchResultsFromData:(NSData *)data error:(NSError **)error {
+    id json = [NSJSONSerialization JSONObjectWithData:data options:0 error:error];
+    if ([json isKindOfClass:[NSArray class]]) return json;
+    if ([json isKindOfClass:[NSDictionary class]]) {
+        NSArray *results = json[@"results"];
+        return [results isKindOfClass:[NSArray class]] ? results : @[];
+    }
+    if (json && error) {
+        *error = [NSError errorWithDomain:@"RAGClientError" code:-1
+                                 userInfo:@{NSLocalizedDescriptionKey: @"Invalid response format"}];
+    }
+    return nil;
+}
+
+/// Remote results, merged with the offline hits for the same query if there are any
+- (RAGSearchResult *)searchResultWithRemoteResults:(NSArray *)remoteResults
+                                      localResults:(NSArray<NSDictionary *> *)localResults
+                                             limit:(NSInteger)limit {
     RAGSearchResult *result = [[RAGSearchResult alloc] init];
-    if ([jsonArray isKindOfClass:[NSArray class]]) {
-        result.results = jsonArray;
+    result.results = remoteResults;
+    if (localResults.count > 0) {
+        result.results = [WALocalRetriever fuseLocalResults:localResults remoteResults:remoteResults limit:limit];
+        [WALogger info:@"[RAG] Fused %lu remote + %lu local results", (unsigned long)remoteResults.count, (unsigned long)localResults.count];
+    }
+    return result;
+}
+
+#pragma mark - Batch Search
+
+- (BOOL)supportsBatchSearch {
+    return !self.batchEndpointMissing;
+}
+
+- (void)searchBatch:(NSArray<RAGSearchQuery *> *)queries
+      resultHandler:(RAGBatchSearchHandler)resultHandler
+         completion:(void (^)(NSArray<RAGSearchResult *> *))completion {
+    [WALogger info:@"[RAG] Batch search: %lu queries", (unsigned long)queries.count];
+
+    RAGBatchSearch *batch = [[RAGBatchSearch alloc] init];
+    batch.queries = queries;
+    batch.resultHandler = resultHandler;
+    batch.completion = completion;
+    batch.results = [NSMutableArray arrayWithCapacity:queries.count];
+    batch.hedges = [NSMutableArray array];
+    batch.buffer = [NSMutableData data];
+    batch.start = CFAbsoluteTimeGetCurrent();
+
+    // Offline hits are looked up now, as search:k:chatFilter: does, and fused as results arrive
+    NSMutableArray<NSArray<NSDictionary *> *> *localResults = [NSMutableArray arrayWithCapacity:queries.count];
+    for (RAGSearchQuery *query in queries) {
+        [batch.results addObject:[NSNull null]];
+        BOOL useLocal = query.chatFilter <= 0 && self.localRetriever;
+        [localResults addObject:useLocal ? [self.localRetriever search:query.query k:query.k > 0 ? query.k : 5] : @[]];
+    }
+    batch.localResults = localResults;
+
+    [self.session.delegateQueue addOperationWithBlock:^{
+        [self.batchSearches addObject:batch];
+        if (queries.count == 0) {
+            [self finishBatchSearch:batch];
+        } else if (queries.count == 1 || self.batchEndpointMissing) {
+            [self fanOutBatchSearch:batch];
+        } else {
+            [self startBatchStream:batch];
+        }
+    }];
+}
+
+- (void)startBatchStream:(RAGBatchSearch *)batch {
+    NSString *endpoint = [self.endpointPool bestEndpoint];
+    NSURL *url = [NSURL URLWithString:[endpoint stringByAppendingString:@"/search/batch"]];
+
+    NSMutableArray *items = [NSMutableArray arrayWithCapacity:batch.queries.count];
+    [batch.queries enumerateObjectsUsingBlock:^(RAGSearchQuery *query, NSUInteger index, BOOL *stop) {
+        NSMutableDictionary *item = [[RAGClient searchBodyForQuery:query.query k:query.k chatFilter:query.chatFilter] mutableCopy];
+        item[@"id"] = @(index);
+        [items addObject:item];
+    }];
+    NSData *bodyData = [NSJSONSerialization dataWithJSONObject:@{@"queries": items} options:0 error:nil];
+
+    if (!url || !bodyData) {
+        [self fanOutBatchSearch:batch];
+        return;
+    }
+
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:url];
+    request.HTTPMethod = @"POST";
+    [request setValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
+    [request setValue:@"application/x-ndjson" forHTTPHeaderField:@"Accept"];
+    request.HTTPBody = bodyData;
+
+    // Delegate-based so lines can be handed out as they arrive; not hedged, the
+    // fan-out below covers whatever the stream fails to answer
+    batch.endpoint = endpoint;
+    batch.task = [self.session dataTaskWithRequest:request];
+    self.batchStreams[@(batch.task.taskIdentifier)] = batch;
+    [batch.task resume];
+}
+
+- (void)batchSearch:(RAGBatchSearch *)batch didReceiveData:(NSData *)data {
+    [batch.buffer appendData:data];
+    // Error bodies are read whole on completion
+    if (batch.response.statusCode == 200) {
+        [self drainBatchBuffer:batch final:NO];
+    }
+}
+
+/// Deliver every complete NDJSON line in the buffer (and the unterminated rest if final)
+- (void)drainBatchBuffer:(RAGBatchSearch *)batch final:(BOOL)final {
+    const char *bytes = batch.buffer.bytes;
+    NSUInteger length = batch.buffer.length;
+    NSUInteger lineStart = 0;
+    for (NSUInteger i = 0; i < length; i++) {
+        if (bytes[i] != '\n') continue;
+        [self handleBatchLine:[NSData dataWithBytes:bytes + lineStart length:i - lineStart] batch:batch];
+        lineStart = i + 1;
+    }
+    if (final && lineStart < length) {
+        [self handleBatchLine:[NSData dataWithBytes:bytes + lineStart length:length - lineStart] batch:batch];
+        lineStart = length;
+    }
+    [batch.buffer replaceBytesInRange:NSMakeRange(0, lineStart) withBytes:NULL length:0];
+}
+
+- (void)handleBatchLine:(NSData *)line batch:(RAGBatchSearch *)batch {
+    if (line.length == 0 || batch.finished) return;
+
+    NSDictionary *item = [NSJSONSerialization JSONObjectWithData:line options:0 error:nil];
+    if (![item isKindOfClass:[NSDictionary class]] || ![item[@"id"] isKindOfClass:[NSNumber class]]) {
+        [WALogger warn:@"[RAG] Skipping malformed batch search line (%lu bytes)", (unsigned long)line.length];
+        return;
+    }
+    NSInteger index = [item[@"id"] integerValue];
+    if (index < 0 || index >= (NSInteger)batch.queries.count) return;
+
+    RAGSearchQuery *query = batch.queries[index];
+    RAGSearchResult *result;
+    if ([item[@"error"] isKindOfClass:[NSString class]]) {
+        result = [self fallbackSearchResultWithMessage:item[@"error"] localResults:batch.localResults[index]];
     } else {
-        // Fallback if response is wrapped in object
-        NSDictionary *dict = (NSDictionary *)jsonArray;
-        result.results = dict[@"results"];
+        NSArray *remoteResults = [item[@"results"] isKindOfClass:[NSArray class]] ? item[@"results"] : @[];
+        result = [self searchResultWithRemoteResults:remoteResults
+                                        localResults:batch.localResults[index]
+                                               limit:query.k > 0 ? query.k : 5];
+    }
+    if ([self deliverResult:result atIndex:index ofBatchSearch:batch]) {
+        batch.streamed++;
     }
+}
 
-    [WALogger info:@"[RAG] Search completed, results: %lu", (unsigned long)result.results.count];
+- (void)batchSearch:(RAGBatchSearch *)batch didCompleteWithError:(NSError *)error {
+    batch.task = nil;
+    if (batch.finished || RAGIsCancellation(error)) return;
 
+    NSInteger statusCode = batch.response.statusCode;
+    if (error || statusCode >= 500) {
+        [self.endpointPool recordFailureForEndpoint:batch.endpoint];
+    } else {
+        [self.endpointPool recordSuccessForEndpoint:batch.endpoint latency:batch.responseLatency];
+    }
+
+    if (!error && (statusCode == 404 || statusCode == 405)) {
+        [WALogger info:@"[RAG] %@ has no batch search endpoint, fanning out", batch.endpoint];
+        self.batchEndpointMissing = YES;
+    } else if (!error && statusCode == 200) {
+        [self drainBatchBuffer:batch final:YES];
+        if (batch.finished) return;
+        [WALogger warn:@"[RAG] Batch stream ended with %lu of %lu results, fanning out the rest",
+            (unsigned long)batch.delivered, (unsigned long)batch.queries.count];
+    } else {
+        NSString *message = error ? error.localizedDescription : [self messageForHTTPError:batch.response data:batch.buffer];
+        [WALogger warn:@"[RAG] Batch search failed (%@), fanning out", message];
+    }
+    [self fanOutBatchSearch:batch];
+}
+
+/// Send every unanswered query as its own hedged /search request, all at once
+- (void)fanOutBatchSearch:(RAGBatchSearch *)batch {
+    [batch.queries enumerateObjectsUsingBlock:^(RAGSearchQuery *query, NSUInteger index, BOOL *stop) {
+        if (batch.results[index] != [NSNull null]) return;
+
+        NSArray<NSDictionary *> *localResults = batch.localResults[index];
+        NSData *bodyData = [NSJSONSerialization dataWithJSONObject:[RAGClient searchBodyForQuery:query.query k:query.k chatFilter:query.chatFilter]
+                                                           options:0
+                                                             error:nil];
+        RAGHedgedRequest *hedge = [self sendHedgedRequest:^NSURLRequest *(NSString *endpoint) {
+            NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:[endpoint stringByAppendingString:@"/search"]]];
+            request.HTTPMethod = @"POST";
+            [request setValue:@"application/json" forHTTPHeaderField:@"Content-Type"];
+            request.HTTPBody = bodyData;
+            return request;
+        } completion:^(NSData *data, NSHTTPURLResponse *httpResponse, NSError *error) {
+            if (batch.finished || RAGIsCancellation(error)) return;
+
+            RAGSearchResult *result;
+            NSError *parseError;
+            NSArray *remoteResults = nil;
+            if (error) {
+                result = [self fallbackSearchResultWithMessage:error.localizedDescription localResults:localResults];
+            } else if (httpResponse.statusCode != 200) {
+                result = [self fallbackSearchResultWithMessage:[self messageForHTTPError:httpResponse data:data] localResults:localResults];
+            } else if (!(remoteResults = [RAGClient remoteSearchResultsFromData:data error:&parseError])) {
+                result = [self fallbackSearchResultWithMessage:parseError.localizedDescription localResults:localResults];
+            } else {
+                result = [self searchResultWithRemoteResults:remoteResults localResults:localResults limit:query.k > 0 ? query.k : 5];
+            }
+            [self deliverResult:result atIndex:index ofBatchSearch:batch];
+        }];
+        [batch.hedges addObject:hedge];
+    }];
+}
+
+/// Record one query's result and hand it out; NO if it already had one
+- (BOOL)deliverResult:(RAGSearchResult *)result atIndex:(NSUInteger)index ofBatchSearch:(RAGBatchSearch *)batch {
+    if (batch.finished || batch.results[index] != [NSNull null]) return NO;
+    batch.results[index] = result;
+    batch.delivered++;
+    if (batch.resultHandler) {
+        batch.resultHandler(index, result);
+    }
+    if (batch.delivered == batch.queries.count) {
+        [self finishBatchSearch:batch];
+    }
+    return YES;
+}
+
+- (void)finishBatchSearch:(RAGBatchSearch *)batch {
+    if (batch.finished) return;
+    batch.finished = YES;
+    [self.batchSearches removeObject:batch];
+    [batch.task cancel];
+
+    [WALogger info:@"[RAG] Batch search completed: %lu queries (%lu streamed) in %ldms",
+        (unsigned long)batch.queries.count, (unsigned long)batch.streamed,
+        (long)llround((CFAbsoluteTimeGetCurrent() - batch.start) * 1000.0)];
+    batch.completion([batch.results copy]);
+}
+
+- (void)cancelBatchSearches {
+    for (RAGBatchSearch *batch in self.batchSearches) {
+        batch.finished = YES;
+        [batch.task cancel];
+        for (RAGHedgedRequest *hedge in batch.hedges) {
+            [hedge cancel];
+        }
+    }
+    [self.batchSearches removeAllObjects];
+}
+
+#pragma mark - Offline Fallback
+
+/// Result for a failed query of a batch: its offline hits, or the error if there are none
+- (RAGSearchResult *)fallbackSearchResultWithMessage:(NSString *)message localResults:(NSArray<NSDictionary *> *)localResults {
+    RAGSearchResult *result = [[RAGSearchResult alloc] init];
+    if (localResults.count > 0) {
+        result.results = localResults;
+        result.isLocalFallback = YES;
+    } else {
+        result.error = message;
+    }
+    return result;
+}
+
+/// Finish a failed search with the offline results if there are any
+- (void)failSearchWithMessage:(NSString *)message localResults:(NSArray<NSDictionary *> *)localResults {
+    if (localResults.count == 0) {
+        [self notifyError:message];
+        return;
+    }
+
+    [WALogger warn:@"[RAG] Search failed (%@), using %lu offline results", message, (unsigned long)localResults.count];
+    RAGSearchResult *result = [[RAGSearchResult alloc] init];
+    result.results = localResults;
+    result.isLocalFallback = YES;
     if ([self.delegate respondsToSelector:@selector(ragClient:didCompleteSearchWithResponse:)]) {
         [self.delegate ragClient:self didCompleteSearchWithResponse:result];
     }
 }
 
+/// Answer a failed query with the closest offline matches instead of a bare error
+- (void)failQueryWithMessage:(NSString *)message {
+    NSString *prompt = self.fallbackPrompt;
+    self.fallbackPrompt = nil;
+
+    NSArray<NSDictionary *> *localResults = prompt ? [self.localRetriever search:prompt k:5] : @[];
+    if (localResults.count == 0) {
+        [self notifyError:message];
+        return;
+    }
+
+    [WALogger warn:@"[RAG] Query failed (%@), answering from %lu offline results", message, (unsigned long)localResults.count];
+
+    NSMutableString *answer = [NSMutableString stringWithFormat:
+        @"The RAG service is unavailable (%@). Closest matches from messages read on this Mac:\n\n", message];
+    for (NSDictionary *hit in localResults) {
+        NSString *when = hit[@"timestamp"] ? [NSString stringWithFormat:@", %@", hit[@"timestamp"]] : @"";
+        [answer appendFormat:@"- **%@** (%@%@): %@\n", hit[@"chat_name"], hit[@"sender"] ?: @"?", when, hit[@"text"]];
+    }
+
+    RAGQueryResponse *response = [[RAGQueryResponse alloc] init];
+    response.answer = answer;
+    response.sources = localResults;
+    response.model = @"local-bm25";
+    self.streamCompleted = YES;
+
+    if ([self.delegate respondsToSelector:@selector(ragClient:didCompleteQueryWithResponse:)]) {
+        [self.delegate ragClient:self didCompleteQueryWithResponse:response];
+    }
+}
+
 #pragma mark - List Chats
 
 - (void)listChatsWithCompletion:(void(^)(NSArray<RAGChatItem *> * _Nullable chats, NSString * _Nullable error))completion {
@@ -554,16 +1044,14 @@
         return;
     }
 
-    NSURLRequest *request = [NSURLRequest requestWithURL:url];
-
-    NSURLSessionDataTask *task = [self.session dataTaskWithRequest:request
-                                                 completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+    [self sendHedgedRequest:^NSURLRequest *(NSString *endpoint) {
+        return [NSURLRequest requestWithURL:[NSURL URLWithString:[endpoint stringByAppendingString:@"/chats"]]];
+    } completion:^(NSData *data, NSHTTPURLResponse *httpResponse, NSError *error) {
         if (error) {
             completion(nil, error.localizedDescription);
             return;
         }
 
-        NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
         if (httpResponse.statusCode != 200) {
             completion(nil, [NSString stringWithFormat:@"HTTP %ld", (long)httpResponse.statusCode]);
             return;
@@ -594,13 +1082,13 @@
         [WALogger info:@"[RAG] Listed %lu chats", (unsigned long)chats.count];
         completion(chats, nil);
     }];
-    [task resume];
 }
 
 #pragma mark - List Models
 
 - (void)listModelsWithCompletion:(void(^)(NSArray<RAGModelItem *> * _Nullable models, NSString * _Nullable error))completion {
-    NSString *urlString = [NSString stringWithFormat:@"%@/models", self.baseURL];
+    NSString *endpoint = self.baseURL;
+    NSString *urlString = [NSString stringWithFormat:@"%@/models", endpoint];
     NSURL *url = [NSURL URLWithString:urlString];
 
     if (!url) {
@@ -610,14 +1098,14 @@
 
     NSURLRequest *request = [NSURLRequest requestWithURL:url];
 
-    NSURLSessionDataTask *task = [self.session dataTaskWithRequest:request
-                                                 completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+    NSURLSessionDataTask *task = [self trackedTaskWithRequest:request
+                                                     endpoint:endpoint
+                                                   completion:^(NSData *data, NSHTTPURLResponse *httpResponse, NSError *error) {
         if (error) {
             completion(nil, error.localizedDescription);
             return;
         }
 
-        NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
         if (httpResponse.statusCode != 200) {
             completion(nil, [NSString stringWithFormat:@"HTTP %ld", (long)httpResponse.statusCode]);
             return;
@@ -657,18 +1145,133 @@
     [task resume];
 }
 
+#pragma mark - Endpoint Routing
+
+/// Data task that feeds its outcome into the endpoint pool. Transport errors and
+/// 5xx count against the endpoint; 4xx are the caller's problem and count as answers.
+- (NSURLSessionDataTask *)trackedTaskWithRequest:(NSURLRequest *)request
+                                        endpoint:(NSString *)endpoint
+                                      completion:(RAGResponseHandler)completion {
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    return [self.session dataTaskWithRequest:request
+                           completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+        NSHTTPURLResponse *httpResponse = [response isKindOfClass:[NSHTTPURLResponse class]] ? (NSHTTPURLResponse *)response : nil;
+        if (RAGIsCancellation(error)) {
+            // Cancelled by us (user or losing hedge) - says nothing about the endpoint
+        } else if (error || httpResponse.statusCode >= 500) {
+            [self.endpointPool recordFailureForEndpoint:endpoint];
+        } else {
+            [self.endpointPool recordSuccessForEndpoint:endpoint latency:CFAbsoluteTimeGetCurrent() - start];
+        }
+        completion(data, httpResponse, error);
+    }];
+}
+
+/// Send an idempotent request to the fastest endpoint. If it has not answered within
+/// that endpoint's hedge delay (its p95), the same request goes to the runner-up and
+/// the first usable answer wins; the other task is cancelled. A failed attempt fails
+/// over immediately instead of waiting for the timer.
+- (RAGHedgedRequest *)sendHedgedRequest:(NSURLRequest *(^)(NSString *endpoint))makeRequest
+                             completion:(RAGResponseHandler)completion {
+    RAGHedgedRequest *hedge = [[RAGHedgedRequest alloc] init];
+    hedge.endpoints = [self.endpointPool rankedEndpoints];
+    hedge.makeRequest = makeRequest;
+    hedge.completion = completion;
+    hedge.tasks = [NSMutableArray array];
+
+    [self.session.delegateQueue addOperationWithBlock:^{
+        [self launchNextAttemptOfHedge:hedge];
+    }];
+    return hedge;
+}
+
+- (void)launchNextAttemptOfHedge:(RAGHedgedRequest *)hedge {
+    if (hedge.finished || hedge.launched >= hedge.maxAttempts) return;
+
+    NSString *endpoint = hedge.endpoints[hedge.launched++];
+    NSURLRequest *request = hedge.makeRequest(endpoint);
+    if (!request.URL) {
+        NSError *error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorBadURL
+                                         userInfo:@{NSLocalizedDescriptionKey: @"Invalid URL"}];
+        [self settleAttemptOfHedge:hedge data:nil response:nil error:error];
+        return;
+    }
+
+    if (hedge.launched > 1) {
+        [WALogger info:@"[RAG] Hedging %@ to %@", request.URL.path, endpoint];
+    }
+
+    NSURLSessionDataTask *task = [self trackedTaskWithRequest:request
+                                                     endpoint:endpoint
+                                                   completion:^(NSData *data, NSHTTPURLResponse *response, NSError *error) {
+        [self settleAttemptOfHedge:hedge data:data response:response error:error];
+    }];
+    [hedge.tasks addObject:task];
+    [task resume];
+
+    // Arm the hedge timer; it is a no-op if a failover already launched the next attempt
+    if (hedge.launched < hedge.maxAttempts) {
+        NSUInteger launchedSoFar = hedge.launched;
+        NSTimeInterval delay = [self.endpointPool hedgeDelayForEndpoint:endpoint];
+        __weak typeof(self) weakSelf = self;
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)),
+                       dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+            [weakSelf.session.delegateQueue addOperationWithBlock:^{
+                if (hedge.launched == launchedSoFar) {
+                    [weakSelf launchNextAttemptOfHedge:hedge];
+                }
+            }];
+        });
+    }
+}
+
+- (void)settleAttemptOfHedge:(RAGHedgedRequest *)hedge
+                        data:(nullable NSData *)data
+                    response:(nullable NSHTTPURLResponse *)response
+                       error:(nullable NSError *)error {
+    if (hedge.finished) return;
+    hedge.settled++;
+
+    BOOL usable = !error && response.statusCode < 500;
+    if (!usable && hedge.settled < hedge.maxAttempts) {
+        // Another attempt is still in flight, or can be started now
+        if (hedge.launched == hedge.settled) {
+            [self launchNextAttemptOfHedge:hedge];
+        }
+        return;
+    }
+
+    hedge.finished = YES;
+    for (NSURLSessionDataTask *task in hedge.tasks) {
+        if (task.state == NSURLSessionTaskStateRunning) [task cancel];
+    }
+    if (self.currentHedge == hedge) self.currentHedge = nil;
+    hedge.completion(data, response, error);
+}
+
 #pragma mark - Cancel
 
 - (void)cancelRequest {
     [self.currentTask cancel];
     self.currentTask = nil;
+    RAGHedgedRequest *hedge = self.currentHedge;
+    self.currentHedge = nil;
+    if (hedge) {
+        [self.session.delegateQueue addOperationWithBlock:^{
+            [hedge cancel];
+        }];
+    }
+    [self.session.delegateQueue addOperationWithBlock:^{
+        [self cancelBatchSearches];
+    }];
+    self.fallbackPrompt = nil;
     [self.streamBuffer setString:@""];
     [self.accumulatedResponse setString:@""];
 }
 
 #pragma mark - Helpers
 
-- (void)handleHTTPError:(NSHTTPURLResponse *)response data:(NSData *)data {
+- (NSString *)messageForHTTPError:(NSHTTPURLResponse *)response data:(NSData *)data {
     NSInteger statusCode = response.statusCode;
     NSString *errorMessage = nil;
 
@@ -729,7 +1332,7 @@
     }
 
     [WALogger error:@"[RAG] HTTP Error: %@", finalMessage];
-    [self notifyError:finalMessage];
+    return finalMessage;
 }
 
 - (void)notifyError:(NSString *)message {
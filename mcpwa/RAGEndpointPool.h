@@ -0,0 +1,64 @@
+//
+//  RAGEndpointPool.h
+//  mcpwa
+//
+//  Latency and error tracking across RAG service replicas
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Snapshot of one endpoint's observed behaviour
+@interface RAGEndpointStats : NSObject
+@property (nonatomic, copy, readonly) NSString *baseURL;
+@property (nonatomic, assign, readonly) NSTimeInterval ewmaLatency;   // Seconds; 0 until the first success
+@property (nonatomic, assign, readonly) NSTimeInterval p95Latency;    // Over the recent sample window
+@property (nonatomic, assign, readonly) double errorRate;             // EWMA of failures, 0..1
+@property (nonatomic, assign, readonly) NSUInteger sampleCount;
+@property (nonatomic, assign, readonly) NSUInteger consecutiveFailures;
+@property (nonatomic, assign, readonly, getter=isHealthy) BOOL healthy;
+@end
+
+/**
+ * Keeps per-endpoint latency (EWMA and p95) and error-rate estimates fed by
+ * real requests and periodic /health pings, and ranks endpoints so each
+ * request goes to the fastest healthy replica.
+ *
+ * An endpoint with three consecutive failures is benched for a short
+ * cooldown; if every endpoint is benched they are all eligible again.
+ */
+@interface RAGEndpointPool : NSObject
+
+- (instancetype)initWithBaseURLs:(NSArray<NSString *> *)baseURLs NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+@property (nonatomic, copy, readonly) NSArray<NSString *> *baseURLs;
+
+/// Healthy endpoints first, cheapest (latency weighted by error rate) first
+- (NSArray<NSString *> *)rankedEndpoints;
+
+/// First entry of rankedEndpoints
+- (NSString *)bestEndpoint;
+
+/// Record the outcome of a request (or health ping) against endpoint
+- (void)recordSuccessForEndpoint:(NSString *)endpoint latency:(NSTimeInterval)latency;
+- (void)recordFailureForEndpoint:(NSString *)endpoint;
+
+/// How long to wait on endpoint before sending a hedged duplicate elsewhere:
+/// its p95 latency, clamped to a sane range, or a default until enough samples exist
+- (NSTimeInterval)hedgeDelayForEndpoint:(NSString *)endpoint;
+
+/// Current stats for every endpoint, in configuration order
+- (NSArray<RAGEndpointStats *> *)allStats;
+
+/// Ping GET /health on every endpoint now, then every interval seconds (0 = once)
+- (void)startHealthPingsWithSession:(NSURLSession *)session interval:(NSTimeInterval)interval;
+- (void)stopHealthPings;
+
+/// Trim whitespace and trailing slashes; drop empties and duplicates
++ (NSArray<NSString *> *)normalizedBaseURLs:(NSArray<NSString *> *)baseURLs;
+
+@end
+
+NS_ASSUME_NONNULL_END
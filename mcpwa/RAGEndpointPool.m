@@ -0,0 +1,270 @@
+//
+//  RAGEndpointPool.m
+//  mcpwa
+//
+//  Latency and error tracking across RAG service replicas
+//
+
+#import "RAGEndpointPool.h"
+#import "WALogger.h"
+
+static const double kLatencyAlpha = 0.3;            // EWMA weight of the newest latency sample
+static const double kErrorAlpha = 0.2;              // EWMA weight of the newest success/failure
+static const NSUInteger kLatencyWindow = 64;        // Samples kept for p95
+static const NSUInteger kMinSamplesForP95 = 8;
+static const NSUInteger kFailuresBeforeBench = 3;
+static const NSTimeInterval kBenchCooldown = 10.0;
+static const NSTimeInterval kDefaultHedgeDelay = 0.5;
+static const NSTimeInterval kMinHedgeDelay = 0.05;
+static const NSTimeInterval kMaxHedgeDelay = 3.0;
+
+#pragma mark - RAGEndpointStats
+
+@interface RAGEndpointStats ()
+@property (nonatomic, copy, readwrite) NSString *baseURL;
+@property (nonatomic, assign, readwrite) NSTimeInterval ewmaLatency;
+@property (nonatomic, assign, readwrite) NSTimeInterval p95Latency;
+@property (nonatomic, assign, readwrite) double errorRate;
+@property (nonatomic, assign, readwrite) NSUInteger sampleCount;
+@property (nonatomic, assign, readwrite) NSUInteger consecutiveFailures;
+@property (nonatomic, assign, readwrite) BOOL healthy;
+
+// Internal
+@property (nonatomic, strong) NSMutableArray<NSNumber *> *recentLatencies;
+@property (nonatomic, strong, nullable) NSDate *benchedUntil;
+@end
+
+@implementation RAGEndpointStats
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@ ewma=%.0fms p95=%.0fms err=%.2f n=%lu%@>",
+            self.baseURL, self.ewmaLatency * 1000.0, self.p95Latency * 1000.0, self.errorRate,
+            (unsigned long)self.sampleCount, self.healthy ? @"" : @" benched"];
+}
+
+- (void)updateP95 {
+    if (self.recentLatencies.count < kMinSamplesForP95) {
+        self.p95Latency = 0;
+        return;
+    }
+    NSArray<NSNumber *> *sorted = [self.recentLatencies sortedArrayUsingSelector:@selector(compare:)];
+    NSUInteger index = (NSUInteger)ceil(0.95 * sorted.count) - 1;
+    self.p95Latency = sorted[MIN(index, sorted.count - 1)].doubleValue;
+}
+
+- (RAGEndpointStats *)snapshot {
+    RAGEndpointStats *copy = [[RAGEndpointStats alloc] init];
+    copy.baseURL = self.baseURL;
+    copy.ewmaLatency = self.ewmaLatency;
+    copy.p95Latency = self.p95Latency;
+    copy.errorRate = self.errorRate;
+    copy.sampleCount = self.sampleCount;
+    copy.consecutiveFailures = self.consecutiveFailures;
+    copy.healthy = self.healthy;
+    return copy;
+}
+
+@end
+
+#pragma mark - RAGEndpointPool
+
+@interface RAGEndpointPool ()
+@property (nonatomic, copy, readwrite) NSArray<NSString *> *baseURLs;
+@property (nonatomic, strong) NSDictionary<NSString *, RAGEndpointStats *> *stats;
+@property (nonatomic, strong, nullable) dispatch_source_t pingTimer;
+@end
+
+@implementation RAGEndpointPool
+
++ (NSArray<NSString *> *)normalizedBaseURLs:(NSArray<NSString *> *)baseURLs {
+    NSMutableOrderedSet<NSString *> *result = [NSMutableOrderedSet orderedSet];
+    for (NSString *url in baseURLs) {
+        if (![url isKindOfClass:[NSString class]]) continue;
+        NSString *trimmed = [url stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+        // Remove trailing slash if present
+        while ([trimmed hasSuffix:@"/"]) {
+            trimmed = [trimmed substringToIndex:trimmed.length - 1];
+        }
+        if (trimmed.length > 0) [result addObject:trimmed];
+    }
+    return result.array;
+}
+
+- (instancetype)initWithBaseURLs:(NSArray<NSString *> *)baseURLs {
+    self = [super init];
+    if (self) {
+        _baseURLs = [RAGEndpointPool normalizedBaseURLs:baseURLs];
+        if (_baseURLs.count == 0) {
+            _baseURLs = @[@"http://localhost:8000"];
+        }
+
+        NSMutableDictionary *stats = [NSMutableDictionary dictionary];
+        for (NSString *url in _baseURLs) {
+            RAGEndpointStats *entry = [[RAGEndpointStats alloc] init];
+            entry.baseURL = url;
+            entry.healthy = YES;
+            entry.recentLatencies = [NSMutableArray array];
+            stats[url] = entry;
+        }
+        _stats = [stats copy];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [self stopHealthPings];
+}
+
+#pragma mark - Ranking
+
+/// Expected cost of sending a request to entry (lower is better). Unmeasured
+/// endpoints borrow the best measured latency so they get tried early.
+- (double)costOfEntry:(RAGEndpointStats *)entry fallbackLatency:(NSTimeInterval)fallbackLatency {
+    NSTimeInterval latency = entry.ewmaLatency > 0 ? entry.ewmaLatency : fallbackLatency;
+    return latency * (1.0 + 4.0 * entry.errorRate);
+}
+
+- (NSArray<NSString *> *)rankedEndpoints {
+    @synchronized (self) {
+        if (self.baseURLs.count == 1) return self.baseURLs;
+
+        NSDate *now = [NSDate date];
+        NSTimeInterval fallbackLatency = DBL_MAX;
+        for (RAGEndpointStats *entry in self.stats.allValues) {
+            // Cooldown over: give the endpoint another chance
+            if (!entry.healthy && [entry.benchedUntil compare:now] != NSOrderedDescending) {
+                entry.healthy = YES;
+                entry.benchedUntil = nil;
+            }
+            if (entry.ewmaLatency > 0) fallbackLatency = MIN(fallbackLatency, entry.ewmaLatency);
+        }
+        if (fallbackLatency == DBL_MAX) fallbackLatency = 0;
+
+        return [self.baseURLs sortedArrayWithOptions:NSSortStable usingComparator:^NSComparisonResult(NSString *a, NSString *b) {
+            RAGEndpointStats *sa = self.stats[a], *sb = self.stats[b];
+            if (sa.healthy != sb.healthy) return sa.healthy ? NSOrderedAscending : NSOrderedDescending;
+            double ca = [self costOfEntry:sa fallbackLatency:fallbackLatency];
+            double cb = [self costOfEntry:sb fallbackLatency:fallbackLatency];
+            if (ca == cb) return NSOrderedSame;
+            return ca < cb ? NSOrderedAscending : NSOrderedDescending;
+        }];
+    }
+}
+
+- (NSString *)bestEndpoint {
+    return [self rankedEndpoints].firstObject;
+}
+
+#pragma mark - Recording
+
+- (void)recordSuccessForEndpoint:(NSString *)endpoint latency:(NSTimeInterval)latency {
+    @synchronized (self) {
+        RAGEndpointStats *entry = self.stats[endpoint];
+        if (!entry) return;
+
+        entry.ewmaLatency = entry.ewmaLatency > 0
+            ? kLatencyAlpha * latency + (1.0 - kLatencyAlpha) * entry.ewmaLatency
+            : latency;
+        entry.errorRate = (1.0 - kErrorAlpha) * entry.errorRate;
+        entry.sampleCount++;
+        entry.consecutiveFailures = 0;
+        entry.healthy = YES;
+        entry.benchedUntil = nil;
+
+        [entry.recentLatencies addObject:@(latency)];
+        if (entry.recentLatencies.count > kLatencyWindow) {
+            [entry.recentLatencies removeObjectAtIndex:0];
+        }
+        [entry updateP95];
+    }
+}
+
+- (void)recordFailureForEndpoint:(NSString *)endpoint {
+    @synchronized (self) {
+        RAGEndpointStats *entry = self.stats[endpoint];
+        if (!entry) return;
+
+        entry.errorRate = kErrorAlpha + (1.0 - kErrorAlpha) * entry.errorRate;
+        entry.sampleCount++;
+        entry.consecutiveFailures++;
+
+        if (entry.healthy && entry.consecutiveFailures >= kFailuresBeforeBench && self.baseURLs.count > 1) {
+            entry.healthy = NO;
+            entry.benchedUntil = [NSDate dateWithTimeIntervalSinceNow:kBenchCooldown];
+            [WALogger warn:@"[RAG] Endpoint %@ benched after %lu failures", endpoint, (unsigned long)entry.consecutiveFailures];
+        }
+    }
+}
+
+- (NSTimeInterval)hedgeDelayForEndpoint:(NSString *)endpoint {
+    @synchronized (self) {
+        NSTimeInterval p95 = self.stats[endpoint].p95Latency;
+        if (p95 <= 0) return kDefaultHedgeDelay;
+        return MIN(MAX(p95, kMinHedgeDelay), kMaxHedgeDelay);
+    }
+}
+
+- (NSArray<RAGEndpointStats *> *)allStats {
+    @synchronized (self) {
+        NSMutableArray *result = [NSMutableArray arrayWithCapacity:self.baseURLs.count];
+        for (NSString *url in self.baseURLs) {
+            [result addObject:[self.stats[url] snapshot]];
+        }
+        return result;
+    }
+}
+
+#pragma mark - Health Pings
+
+- (void)pingAllWithSession:(NSURLSession *)session {
+    for (NSString *endpoint in self.baseURLs) {
+        NSURL *url = [NSURL URLWithString:[endpoint stringByAppendingString:@"/health"]];
+        if (!url) continue;
+
+        NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:url];
+        request.timeoutInterval = 5.0;
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+
+        __weak typeof(self) weakSelf = self;
+        NSURLSessionDataTask *task = [session dataTaskWithRequest:request
+                                                completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+            NSInteger status = [response isKindOfClass:[NSHTTPURLResponse class]] ? ((NSHTTPURLResponse *)response).statusCode : 0;
+            if (!error && status == 200) {
+                [weakSelf recordSuccessForEndpoint:endpoint latency:CFAbsoluteTimeGetCurrent() - start];
+            } else {
+                [weakSelf recordFailureForEndpoint:endpoint];
+            }
+        }];
+        [task resume];
+    }
+}
+
+- (void)startHealthPingsWithSession:(NSURLSession *)session interval:(NSTimeInterval)interval {
+    [self stopHealthPings];
+    [self pingAllWithSession:session];
+    if (interval <= 0) return;
+
+    dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0,
+                                                     dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+    dispatch_source_set_timer(timer,
+                              dispatch_time(DISPATCH_TIME_NOW, (int64_t)(interval * NSEC_PER_SEC)),
+                              (uint64_t)(interval * NSEC_PER_SEC),
+                              (uint64_t)(NSEC_PER_SEC));
+    __weak typeof(self) weakSelf = self;
+    __weak NSURLSession *weakSession = session;
+    dispatch_source_set_event_handler(timer, ^{
+        NSURLSession *strongSession = weakSession;
+        if (strongSession) [weakSelf pingAllWithSession:strongSession];
+    });
+    dispatch_resume(timer);
+    self.pingTimer = timer;
+}
+
+- (void)stopHealthPings {
+    if (self.pingTimer) {
+        dispatch_source_cancel(self.pingTimer);
+        self.pingTimer = nil;
+    }
+}
+
+@end
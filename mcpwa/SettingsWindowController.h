@@ -40,9 +40,12 @@ extern NSString *const WAThemeDidChangeNotification;
 /// Current theme mode preference
 @property (class, readonly) WAThemeMode currentThemeMode;
 
-/// Current RAG service URL
+/// Current RAG service URL (may hold several comma-separated replicas)
 @property (class, readonly) NSString *ragServiceURL;
 
+/// The RAG service URL setting split into individual replica base URLs
+@property (class, readonly) NSArray<NSString *> *ragServiceURLs;
+
 /// Current RAG environment
 @property (class, readonly) WARAGEnvironment ragEnvironment;
 
@@ -54,6 +54,15 @@ static NSString *const kDevelopmentRAGURL = @"http://localhost:8001";
     return [self ragEnvironment] == WARAGEnvironmentDevelopment ? kDevelopmentRAGURL : kProductionRAGURL;
 }
 
++ (NSArray<NSString *> *)ragServiceURLs {
+    NSCharacterSet *separators = [NSCharacterSet characterSetWithCharactersInString:@", \n"];
+    NSMutableArray<NSString *> *urls = [NSMutableArray array];
+    for (NSString *part in [[self ragServiceURL] componentsSeparatedByCharactersInSet:separators]) {
+        if (part.length > 0) [urls addObject:part];
+    }
+    return urls.count > 0 ? urls : @[kProductionRAGURL];
+}
+
 + (WARAGEnvironment)ragEnvironment {
     return [[NSUserDefaults standardUserDefaults] integerForKey:WARAGEnvironmentKey];
 }
@@ -205,7 +214,7 @@ static NSString *const kDevelopmentRAGURL = @"http://localhost:8001";
     // URL field
     self.ragURLField = [[NSTextField alloc] initWithFrame:NSZeroRect];
     self.ragURLField.translatesAutoresizingMaskIntoConstraints = NO;
-    self.ragURLField.placeholderString = @"http://localhost:8000";
+    self.ragURLField.placeholderString = @"http://localhost:8000, http://replica:8000";
     self.ragURLField.stringValue = [[self class] ragServiceURL];
     self.ragURLField.delegate = self;
     self.ragURLField.font = [NSFont systemFontOfSize:12];
@@ -300,6 +309,9 @@ static NSString *const kDevelopmentRAGURL = @"http://localhost:8001";
     // Save the URL
     [[self class] setRAGServiceURL:url];
 
+    // With several replicas configured, test the first one
+    url = [[self class] ragServiceURLs].firstObject;
+
     self.testConnectionButton.enabled = NO;
     self.connectionStatusLabel.stringValue = @"Testing...";
     self.connectionStatusLabel.textColor = [NSColor secondaryLabelColor];
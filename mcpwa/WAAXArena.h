@@ -0,0 +1,68 @@
+// WAAXArena.h
+// Scoped ownership of accessibility element references
+
+#import <Foundation/Foundation.h>
+#import <ApplicationServices/ApplicationServices.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Owns the AXUIElementRefs acquired during one tool call.
+ *
+ * Code running inside the arena hands references to it and gets them back
+ * borrowed: they stay valid until the arena closes and must not be released
+ * by the caller. Closing releases everything at once and counts the
+ * references that survive it, which is how leaks are caught.
+ *
+ * Arenas nest per thread like autorelease pools; +currentArena is the
+ * innermost open one. Code that may run outside any arena treats a nil
+ * current arena as "caller keeps its own references alive".
+ */
+@interface WAAXArena : NSObject
+
+- (instancetype)initWithName:(NSString *)name NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+@property (nonatomic, copy, readonly) NSString *name;
+
+/// Innermost arena opened on this thread, or nil
++ (nullable WAAXArena *)currentArena;
+
+/// Make this the current arena on this thread
+- (void)open;
+
+/// Release every owned reference and restore the previous current arena.
+/// Must be called on the thread that opened it.
+- (void)close;
+
+/// Take over a +1 reference (from a Copy or Create call); returns it borrowed
+- (nullable AXUIElementRef)adopt:(nullable AXUIElementRef CF_CONSUMED)element;
+
+/// -adopt: into the current arena. With no arena open the reference is
+/// autoreleased instead, so either way the caller never releases it.
++ (nullable AXUIElementRef)adoptInCurrentArena:(nullable AXUIElementRef CF_CONSUMED)element;
+
+/// Retain a +0 reference until the arena closes; returns it borrowed
+- (nullable AXUIElementRef)borrow:(nullable AXUIElementRef)element;
+
+/// -borrow: for each element of an array of bridged references
+- (void)borrowElements:(NSArray *)elements;
+
+/// References taken over since the arena was created
+@property (readonly) NSUInteger createdCount;
+
+/// References owned right now
+@property (readonly) NSUInteger ownedCount;
+
+/// Highest ownedCount seen
+@property (readonly) NSUInteger peakCount;
+
+/// After -close: references something outside the arena still retained when
+/// it let go of them, i.e. leaked by a manual CFRetain or kept past the call.
+/// Also counts references handed to the arena after it closed. Based on
+/// CFGetRetainCount, so it is a hint for the logs rather than a proof.
+@property (readonly) NSUInteger outstandingCount;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,136 @@
+// WAAXArena.m
+// Scoped ownership of accessibility element references
+
+#import "WAAXArena.h"
+#import "WALogger.h"
+
+static NSString * const kArenaStackKey = @"WAAXArenaStack";
+
+@interface WAAXArena ()
+@property (nonatomic, strong) NSMutableArray *elements;   // Bridged references, retained by the array
+@property (nonatomic, assign) BOOL closed;
+@property (readwrite) NSUInteger createdCount;
+@property (readwrite) NSUInteger peakCount;
+@property (readwrite) NSUInteger outstandingCount;
+@end
+
+@implementation WAAXArena
+
+- (instancetype)initWithName:(NSString *)name {
+    self = [super init];
+    if (self) {
+        _name = [name copy];
+        _elements = [NSMutableArray array];
+    }
+    return self;
+}
+
+/// Open arenas of the calling thread, innermost last
++ (NSMutableArray<WAAXArena *> *)threadStack {
+    NSMutableDictionary *threadDictionary = [NSThread currentThread].threadDictionary;
+    NSMutableArray<WAAXArena *> *stack = threadDictionary[kArenaStackKey];
+    if (!stack) {
+        stack = [NSMutableArray array];
+        threadDictionary[kArenaStackKey] = stack;
+    }
+    return stack;
+}
+
++ (WAAXArena *)currentArena {
+    return [NSThread currentThread].threadDictionary[kArenaStackKey].lastObject;
+}
+
+- (void)open {
+    [[WAAXArena threadStack] addObject:self];
+}
+
+- (void)close {
+    NSMutableArray<WAAXArena *> *stack = [WAAXArena threadStack];
+    NSUInteger index = [stack indexOfObjectIdenticalTo:self];
+    if (index != NSNotFound) {
+        if (index + 1 < stack.count) {
+            // Inner arenas left open are popped with this one (their references stay owned)
+            [WALogger warn:@"WAAXArena: closing '%@' with %lu inner arena(s) still open",
+                self.name, (unsigned long)(stack.count - index - 1)];
+        }
+        [stack removeObjectsInRange:NSMakeRange(index, stack.count - index)];
+    }
+
+    @synchronized (self) {
+        self.closed = YES;
+        self.outstandingCount = [self survivorsOfRelease];
+    }
+}
+
+/// Release the owned references and count those something else still holds.
+/// A reference may be owned several times; beyond those retains it should
+/// have none left.
+- (NSUInteger)survivorsOfRelease {
+    NSCountedSet<NSValue *> *ownership = [NSCountedSet set];
+    for (id element in self.elements) {
+        [ownership addObject:[NSValue valueWithPointer:(__bridge const void *)element]];
+    }
+    NSUInteger survivors = 0;
+    for (NSValue *pointer in ownership) {
+        if ((NSUInteger)CFGetRetainCount(pointer.pointerValue) > [ownership countForObject:pointer]) {
+            survivors++;
+        }
+    }
+    [self.elements removeAllObjects];
+    return survivors;
+}
+
+- (AXUIElementRef)adopt:(AXUIElementRef)element {
+    if (!element) return NULL;
+    [self own:(__bridge_transfer id)element];
+    return element;
+}
+
++ (AXUIElementRef)adoptInCurrentArena:(AXUIElementRef)element {
+    if (!element) return NULL;
+    WAAXArena *arena = [WAAXArena currentArena];
+    if (arena) return [arena adopt:element];
+    return (AXUIElementRef)CFAutorelease(element);
+}
+
+- (AXUIElementRef)borrow:(AXUIElementRef)element {
+    if (!element) return NULL;
+    [self own:(__bridge id)element];
+    return element;
+}
+
+- (void)borrowElements:(NSArray *)elements {
+    if (elements.count == 0) return;
+    @synchronized (self) {
+        [self warnIfClosed];
+        [self.elements addObjectsFromArray:elements];
+        self.createdCount += elements.count;
+        self.peakCount = MAX(self.peakCount, self.elements.count);
+    }
+}
+
+- (void)own:(id)element {
+    @synchronized (self) {
+        [self warnIfClosed];
+        [self.elements addObject:element];
+        self.createdCount++;
+        self.peakCount = MAX(self.peakCount, self.elements.count);
+    }
+}
+
+/// Kept rather than released so the borrower's reference stays valid; it
+/// shows up as outstanding instead
+- (void)warnIfClosed {
+    if (self.closed) {
+        [WALogger warn:@"WAAXArena: reference handed to '%@' after it closed", self.name];
+        self.outstandingCount++;
+    }
+}
+
+- (NSUInteger)ownedCount {
+    @synchronized (self) {
+        return self.elements.count;
+    }
+}
+
+@end
@@ -0,0 +1,26 @@
+// WAAXElementProvider.h
+// WAAXTreeWalker provider backed by live AXUIElements
+
+#import <Foundation/Foundation.h>
+#import "WAAXTreeWalker.h"
+#import "WAMessageCellDecoder.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Fetches role, identifier and children of an AXUIElement with a single
+ * AXUIElementCopyMultipleAttributeValues call instead of three round-trips.
+ * Snapshots for the message cell decoder add description and value to the
+ * same call. Nodes are AXUIElementRefs bridged to id.
+ */
+@interface WAAXElementProvider : NSObject <WAAXTreeProvider, WAMessageCellSource>
+
+/// Applied to role and identifier strings (e.g. to strip direction marks)
+@property (nonatomic, copy, nullable) NSString * _Nullable (^stringTransform)(NSString *string);
+
+/// Dump line format; nil falls back to the walker's default
+@property (nonatomic, copy, nullable) NSString * (^lineFormatter)(id node, NSString *role, NSString * _Nullable identifier, NSUInteger childCount);
+
+@end
+
+NS_ASSUME_NONNULL_END
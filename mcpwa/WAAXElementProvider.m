@@ -0,0 +1,89 @@
+// WAAXElementProvider.m
+// WAAXTreeWalker provider backed by live AXUIElements
+
+#import "WAAXElementProvider.h"
+#import <ApplicationServices/ApplicationServices.h>
+
+@implementation WAAXElementProvider
+
+/// Value from a CopyMultipleAttributeValues result, or nil if the attribute
+/// failed (failures come back as AXValues of type kAXValueAXErrorType)
+static id WAAttributeValue(NSArray *values, NSUInteger index, CFTypeID expectedType) {
+    if (index >= values.count) return nil;
+    CFTypeRef value = (__bridge CFTypeRef)values[index];
+    if (!value || CFGetTypeID(value) != expectedType) return nil;
+    return (__bridge id)value;
+}
+
+- (BOOL)fetchNode:(id)node role:(NSString **)role identifier:(NSString **)identifier children:(NSArray **)children {
+    AXUIElementRef element = (__bridge AXUIElementRef)node;
+    if (!element || CFGetTypeID(element) != AXUIElementGetTypeID()) return NO;
+
+    NSArray *attributes = @[(__bridge NSString *)kAXRoleAttribute, @"AXIdentifier", (__bridge NSString *)kAXChildrenAttribute];
+    CFArrayRef valuesRef = NULL;
+    AXError err = AXUIElementCopyMultipleAttributeValues(element, (__bridge CFArrayRef)attributes, 0, &valuesRef);
+    if (err != kAXErrorSuccess || !valuesRef) {
+        // Element is invalid or stale
+        return NO;
+    }
+    NSArray *values = (__bridge_transfer NSArray *)valuesRef;
+
+    NSString *roleValue = WAAttributeValue(values, 0, CFStringGetTypeID());
+    if (!roleValue) {
+        // Same rule as the single-attribute path: no role means a stale element
+        return NO;
+    }
+    NSString *identifierValue = WAAttributeValue(values, 1, CFStringGetTypeID());
+    NSArray *childrenValue = WAAttributeValue(values, 2, CFArrayGetTypeID());
+
+    if (self.stringTransform) {
+        roleValue = self.stringTransform(roleValue);
+        identifierValue = identifierValue ? self.stringTransform(identifierValue) : nil;
+    }
+
+    *role = roleValue;
+    *identifier = identifierValue;
+    *children = childrenValue ?: @[];
+    return YES;
+}
+
+- (NSDictionary *)snapshotOfNode:(id)node {
+    AXUIElementRef element = (__bridge AXUIElementRef)node;
+    if (!element || CFGetTypeID(element) != AXUIElementGetTypeID()) return nil;
+
+    NSArray *attributes = @[(__bridge NSString *)kAXRoleAttribute, @"AXIdentifier",
+                            (__bridge NSString *)kAXDescriptionAttribute, (__bridge NSString *)kAXValueAttribute,
+                            (__bridge NSString *)kAXChildrenAttribute];
+    CFArrayRef valuesRef = NULL;
+    AXError err = AXUIElementCopyMultipleAttributeValues(element, (__bridge CFArrayRef)attributes, 0, &valuesRef);
+    if (err != kAXErrorSuccess || !valuesRef) return nil;
+    NSArray *values = (__bridge_transfer NSArray *)valuesRef;
+
+    NSString *role = WAAttributeValue(values, 0, CFStringGetTypeID());
+    if (!role) return nil;
+
+    NSMutableDictionary *snapshot = [NSMutableDictionary dictionaryWithCapacity:5];
+    NSArray<NSString *> *keys = @[@"role", @"id", @"desc", @"value"];
+    for (NSUInteger i = 0; i < keys.count; i++) {
+        // Non-string values (e.g. a checkbox's number) are left out
+        NSString *string = WAAttributeValue(values, i, CFStringGetTypeID());
+        if (string && self.stringTransform) string = self.stringTransform(string);
+        if (string) snapshot[keys[i]] = string;
+    }
+    snapshot[@"children"] = WAAttributeValue(values, 4, CFArrayGetTypeID()) ?: @[];
+    return snapshot;
+}
+
+- (BOOL)respondsToSelector:(SEL)selector {
+    // Only offer dump lines when a formatter is set, so the walker's default applies otherwise
+    if (selector == @selector(dumpLineForNode:role:identifier:childCount:)) {
+        return self.lineFormatter != nil;
+    }
+    return [super respondsToSelector:selector];
+}
+
+- (NSString *)dumpLineForNode:(id)node role:(NSString *)role identifier:(NSString *)identifier childCount:(NSUInteger)childCount {
+    return self.lineFormatter(node, role, identifier, childCount);
+}
+
+@end
@@ -0,0 +1,106 @@
+// WAAXTreeWalker.h
+// Concurrent, order-preserving traversal of accessibility-style trees
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Source of tree nodes. Implementations must be safe to call from several
+/// threads at once; the walker fetches sibling subtrees concurrently.
+@protocol WAAXTreeProvider <NSObject>
+
+/// Fetch what the walker needs about node, ideally in one round-trip.
+/// Return NO if the node is stale/invalid; it is then skipped with its subtree.
+- (BOOL)fetchNode:(id)node
+             role:(NSString * _Nullable * _Nonnull)role
+       identifier:(NSString * _Nullable * _Nonnull)identifier
+         children:(NSArray * _Nullable * _Nonnull)children;
+
+@optional
+/// One line describing node in a tree dump (without indentation)
+- (NSString *)dumpLineForNode:(id)node
+                         role:(NSString *)role
+                   identifier:(nullable NSString *)identifier
+                   childCount:(NSUInteger)childCount;
+
+@end
+
+/// Matches are tested with the node's role and identifier ("" when missing)
+typedef BOOL (^WAAXNodePredicate)(id node, NSString *role, NSString *identifier, NSUInteger depth);
+
+/// A matching node and where it sits in the tree
+@interface WAAXTreeMatch : NSObject
+@property (nonatomic, strong, readonly) id node;
+@property (nonatomic, copy, readonly) NSString *role;
+@property (nonatomic, copy, readonly) NSString *identifier;
+@property (nonatomic, assign, readonly) NSUInteger depth;
+@property (nonatomic, strong, readonly) NSIndexPath *path;   // Child indexes from the root
+@end
+
+/**
+ * Walks a tree with a bounded pool of concurrent fetches.
+ *
+ * Pending nodes are kept sorted by path, and free workers always take the
+ * earliest one in depth-first pre-order, so the walk behaves like a depth-first
+ * search with a few subtrees of lookahead. Results are therefore identical to
+ * a sequential recursive walk:
+ *  - findAll returns matches in depth-first pre-order
+ *  - findFirst returns the first pre-order match; once a match is known, every
+ *    pending node that comes after it is dropped
+ *  - dumps emit lines in pre-order as soon as everything before them is
+ *    fetched, and release each subtree once written
+ *
+ * Walks are synchronous; the calling thread waits for the workers.
+ */
+@interface WAAXTreeWalker : NSObject
+
+- (instancetype)initWithProvider:(id<WAAXTreeProvider>)provider NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+@property (nonatomic, strong, readonly) id<WAAXTreeProvider> provider;
+
+/// Fetches in flight at once (default 4; 1 = sequential)
+@property (nonatomic, assign) NSUInteger maxConcurrency;
+
+/// Nodes at this depth or deeper are not visited (root is depth 0; default 25)
+@property (nonatomic, assign) NSUInteger maxDepth;
+
+/// Per-branch depth budgets: below a node whose identifier starts with a key,
+/// at most that many further levels are visited (0 = don't descend at all)
+@property (nonatomic, copy, nullable) NSDictionary<NSString *, NSNumber *> *identifierPrefixDepthLimits;
+
+/// All matches, in depth-first pre-order
+- (NSArray<WAAXTreeMatch *> *)findAllFrom:(id)root matching:(WAAXNodePredicate)predicate;
+
+/// First match in depth-first pre-order
+- (nullable WAAXTreeMatch *)findFirstFrom:(id)root matching:(WAAXNodePredicate)predicate;
+
+/// Depth-first dump; lineHandler gets indented lines in order, on a private serial queue
+- (void)dumpFrom:(id)root lineHandler:(void (^)(NSString *line))lineHandler;
+
+/// Nodes fetched and wall time of the most recent walk
+@property (atomic, readonly) NSUInteger lastNodesFetched;
+@property (atomic, readonly) NSTimeInterval lastDuration;
+
+@end
+
+/**
+ * In-memory tree with artificial per-fetch latency, for exercising the walker
+ * without a live accessibility tree. Nodes are dictionaries with "role",
+ * optional "id" and optional "children".
+ */
+@interface WASyntheticAXTreeProvider : NSObject <WAAXTreeProvider>
+
+/// Sleep per fetch, simulating one IPC round-trip
+@property (nonatomic, assign) NSTimeInterval latency;
+
+/// Fetches served so far
+@property (atomic, readonly) NSUInteger fetchCount;
+
+/// Complete tree: every node has breadth children down to depth. Identifiers
+/// are "n" followed by the path, e.g. "n.0.2.1", so prefixes select branches.
++ (NSDictionary *)treeWithBreadth:(NSUInteger)breadth depth:(NSUInteger)depth;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,401 @@
+// WAAXTreeWalker.m
+// Concurrent, order-preserving traversal of accessibility-style trees
+
+#import "WAAXTreeWalker.h"
+
+static const NSUInteger kDefaultMaxConcurrency = 4;
+static const NSUInteger kDefaultMaxDepth = 25;
+
+#pragma mark - WAAXTreeMatch
+
+@interface WAAXTreeMatch ()
+@property (nonatomic, strong, readwrite) id node;
+@property (nonatomic, copy, readwrite) NSString *role;
+@property (nonatomic, copy, readwrite) NSString *identifier;
+@property (nonatomic, assign, readwrite) NSUInteger depth;
+@property (nonatomic, strong, readwrite) NSIndexPath *path;
+@end
+
+@implementation WAAXTreeMatch
+@end
+
+#pragma mark - Walk State
+
+/// A node known to the walk. Only dumps keep these linked into a tree; searches
+/// drop each record as soon as its fetch has been handled.
+@interface WAAXWalkNode : NSObject
+@property (nonatomic, strong, nullable) id element;
+@property (nonatomic, strong) NSIndexPath *path;
+@property (nonatomic, assign) NSUInteger depth;
+@property (nonatomic, assign) NSUInteger depthLimit;        // Children at this depth or deeper are not visited
+@property (nonatomic, assign) BOOL fetched;
+@property (nonatomic, assign) BOOL emitted;
+@property (nonatomic, copy, nullable) NSString *line;
+@property (nonatomic, strong, nullable) NSArray<WAAXWalkNode *> *children;
+@property (nonatomic, assign) NSUInteger nextChild;         // Dump cursor
+@end
+
+@implementation WAAXWalkNode
+@end
+
+@interface WAAXWalkState : NSObject
+@property (nonatomic, copy, nullable) WAAXNodePredicate predicate;
+@property (nonatomic, copy, nullable) void (^lineHandler)(NSString *line);
+@property (nonatomic, assign) BOOL firstOnly;
+@property (nonatomic, strong) NSMutableArray<WAAXWalkNode *> *frontier;     // Sorted by path
+@property (nonatomic, strong) NSMutableArray<WAAXTreeMatch *> *matches;
+@property (nonatomic, strong, nullable) NSIndexPath *bestPath;             // findFirst: earliest match so far
+@property (nonatomic, strong) NSMutableArray<WAAXWalkNode *> *emitStack;
+@property (nonatomic, assign) NSUInteger inFlight;
+@property (nonatomic, assign) NSUInteger fetched;
+@property (nonatomic, assign) BOOL finished;
+@property (nonatomic, strong) dispatch_semaphore_t done;
+@end
+
+@implementation WAAXWalkState
+@end
+
+static NSComparisonResult WAComparePaths(WAAXWalkNode *a, WAAXWalkNode *b) {
+    return [a.path compare:b.path];
+}
+
+#pragma mark - WAAXTreeWalker
+
+@interface WAAXTreeWalker ()
+@property (nonatomic, strong, readwrite) id<WAAXTreeProvider> provider;
+@property (atomic, readwrite) NSUInteger lastNodesFetched;
+@property (atomic, readwrite) NSTimeInterval lastDuration;
+@end
+
+@implementation WAAXTreeWalker
+
+- (instancetype)initWithProvider:(id<WAAXTreeProvider>)provider {
+    self = [super init];
+    if (self) {
+        _provider = provider;
+        _maxConcurrency = kDefaultMaxConcurrency;
+        _maxDepth = kDefaultMaxDepth;
+    }
+    return self;
+}
+
+#pragma mark - Public API
+
+- (NSArray<WAAXTreeMatch *> *)findAllFrom:(id)root matching:(WAAXNodePredicate)predicate {
+    WAAXWalkState *state = [self newStateWithPredicate:predicate];
+    [self runWalkFrom:root state:state];
+    return [state.matches copy];
+}
+
+- (WAAXTreeMatch *)findFirstFrom:(id)root matching:(WAAXNodePredicate)predicate {
+    WAAXWalkState *state = [self newStateWithPredicate:predicate];
+    state.firstOnly = YES;
+    [self runWalkFrom:root state:state];
+    // Matches arrive in completion order; the earliest path wins
+    WAAXTreeMatch *first = nil;
+    for (WAAXTreeMatch *match in state.matches) {
+        if (!first || [match.path compare:first.path] == NSOrderedAscending) {
+            first = match;
+        }
+    }
+    return first;
+}
+
+- (void)dumpFrom:(id)root lineHandler:(void (^)(NSString *line))lineHandler {
+    WAAXWalkState *state = [self newStateWithPredicate:nil];
+    state.lineHandler = lineHandler;
+    [self runWalkFrom:root state:state];
+}
+
+#pragma mark - Engine
+
+- (WAAXWalkState *)newStateWithPredicate:(WAAXNodePredicate)predicate {
+    WAAXWalkState *state = [[WAAXWalkState alloc] init];
+    state.predicate = predicate;
+    state.frontier = [NSMutableArray array];
+    state.matches = [NSMutableArray array];
+    state.emitStack = [NSMutableArray array];
+    state.done = dispatch_semaphore_create(0);
+    return state;
+}
+
+- (void)runWalkFrom:(id)root state:(WAAXWalkState *)state {
+    NSDate *start = [NSDate date];
+
+    WAAXWalkNode *rootNode = [[WAAXWalkNode alloc] init];
+    rootNode.element = root;
+    rootNode.path = [[NSIndexPath alloc] init];
+    rootNode.depth = 0;
+    rootNode.depthLimit = self.maxDepth;
+
+    if (self.maxDepth == 0) {
+        self.lastNodesFetched = 0;
+        self.lastDuration = 0;
+        return;
+    }
+
+    // All walk state is confined to this serial queue; workers only fetch
+    dispatch_queue_t coordinator = dispatch_queue_create("com.mcpwa.axwalker", DISPATCH_QUEUE_SERIAL);
+    dispatch_async(coordinator, ^{
+        [state.frontier addObject:rootNode];
+        if (state.lineHandler) {
+            [state.emitStack addObject:rootNode];
+        }
+        [self pumpState:state coordinator:coordinator];
+    });
+
+    dispatch_semaphore_wait(state.done, DISPATCH_TIME_FOREVER);
+
+    self.lastNodesFetched = state.fetched;
+    self.lastDuration = [[NSDate date] timeIntervalSinceDate:start];
+}
+
+/// Start fetches for the earliest pending nodes until the pool is full.
+/// Must run on the coordinator queue.
+- (void)pumpState:(WAAXWalkState *)state coordinator:(dispatch_queue_t)coordinator {
+    NSUInteger limit = MAX(self.maxConcurrency, 1);
+    dispatch_queue_t workers = dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+
+    while (state.inFlight < limit && state.frontier.count > 0) {
+        WAAXWalkNode *node = state.frontier.firstObject;
+        [state.frontier removeObjectAtIndex:0];
+        state.inFlight++;
+
+        dispatch_async(workers, ^{
+            NSString *role = nil;
+            NSString *identifier = nil;
+            NSArray *children = nil;
+            BOOL ok = [self.provider fetchNode:node.element role:&role identifier:&identifier children:&children];
+
+            BOOL matched = NO;
+            NSString *line = nil;
+            if (ok) {
+                role = role ?: @"";
+                if (state.predicate) {
+                    @try {
+                        matched = state.predicate(node.element, role, identifier ?: @"", node.depth);
+                    } @catch (NSException *exception) {
+                        // Treat a failing predicate as no match, like a stale element
+                    }
+                }
+                if (state.lineHandler) {
+                    line = [self dumpLineForNode:node.element role:role identifier:identifier childCount:children.count];
+                }
+            }
+
+            dispatch_async(coordinator, ^{
+                [self finishNode:node ok:ok role:role identifier:identifier children:children
+                         matched:matched line:line state:state];
+                [self pumpState:state coordinator:coordinator];
+            });
+        });
+    }
+
+    if (state.inFlight == 0 && state.frontier.count == 0 && !state.finished) {
+        state.finished = YES;
+        dispatch_semaphore_signal(state.done);
+    }
+}
+
+/// Record a fetch result, queue the node's children and flush any dump lines
+/// that are now in order. Must run on the coordinator queue.
+- (void)finishNode:(WAAXWalkNode *)node
+                ok:(BOOL)ok
+              role:(NSString *)role
+        identifier:(NSString *)identifier
+          children:(NSArray *)children
+           matched:(BOOL)matched
+              line:(NSString *)line
+             state:(WAAXWalkState *)state {
+    state.inFlight--;
+    state.fetched++;
+    node.fetched = YES;
+
+    if (!ok) {
+        node.children = @[];
+        [self emitLinesForState:state];
+        return;
+    }
+
+    node.line = line ? [[@"" stringByPaddingToLength:node.depth * 2 withString:@" " startingAtIndex:0]
+                        stringByAppendingString:line] : nil;
+
+    // findFirst: anything after the best match is moot, including results of
+    // fetches that were already in flight when it was found
+    if (state.firstOnly && state.bestPath && [node.path compare:state.bestPath] == NSOrderedDescending) {
+        return;
+    }
+
+    if (matched) {
+        WAAXTreeMatch *match = [[WAAXTreeMatch alloc] init];
+        match.node = node.element ?: [NSNull null];
+        match.role = role;
+        match.identifier = identifier ?: @"";
+        match.depth = node.depth;
+        match.path = node.path;
+        [state.matches addObject:match];
+
+        if (state.firstOnly) {
+            state.bestPath = node.path;
+            [self dropFrontierAfterPath:node.path state:state];
+            // Children come after their parent in pre-order
+            return;
+        }
+    }
+
+    NSUInteger childLimit = [self depthLimitForNode:node identifier:identifier];
+    NSUInteger childDepth = node.depth + 1;
+    NSMutableArray<WAAXWalkNode *> *childNodes = [NSMutableArray arrayWithCapacity:children.count];
+
+    if (childDepth < childLimit) {
+        [children enumerateObjectsUsingBlock:^(id child, NSUInteger idx, BOOL *stop) {
+            WAAXWalkNode *childNode = [[WAAXWalkNode alloc] init];
+            childNode.element = child;
+            childNode.path = [node.path indexPathByAddingIndex:idx];
+            childNode.depth = childDepth;
+            childNode.depthLimit = childLimit;
+            [childNodes addObject:childNode];
+        }];
+        [self insertIntoFrontier:childNodes state:state];
+    } else if (state.lineHandler && childDepth == self.maxDepth) {
+        // Mark truncation in dumps, one line per unvisited child
+        NSString *marker = [[@"" stringByPaddingToLength:childDepth * 2 withString:@" " startingAtIndex:0]
+                            stringByAppendingString:@"... (max depth)"];
+        for (NSUInteger i = 0; i < children.count; i++) {
+            WAAXWalkNode *childNode = [[WAAXWalkNode alloc] init];
+            childNode.path = [node.path indexPathByAddingIndex:i];
+            childNode.depth = childDepth;
+            childNode.fetched = YES;
+            childNode.line = marker;
+            [childNodes addObject:childNode];
+        }
+    }
+
+    if (state.lineHandler) {
+        node.children = childNodes;
+        [self emitLinesForState:state];
+    }
+}
+
+/// Depth below which node's children may not go: inherited from the parent and
+/// tightened by any identifier-prefix budget the node matches
+- (NSUInteger)depthLimitForNode:(WAAXWalkNode *)node identifier:(NSString *)identifier {
+    NSUInteger limit = node.depthLimit;
+    if (identifier.length > 0) {
+        for (NSString *prefix in self.identifierPrefixDepthLimits) {
+            if ([identifier hasPrefix:prefix]) {
+                NSUInteger budget = node.depth + 1 + self.identifierPrefixDepthLimits[prefix].unsignedIntegerValue;
+                limit = MIN(limit, budget);
+            }
+        }
+    }
+    return limit;
+}
+
+- (void)insertIntoFrontier:(NSArray<WAAXWalkNode *> *)nodes state:(WAAXWalkState *)state {
+    if (nodes.count == 0) return;
+
+    // Siblings are contiguous in pre-order and nothing pending lies between
+    // them (their descendants aren't known yet), so one insertion point suffices
+    NSUInteger index = [state.frontier indexOfObject:nodes.firstObject
+                                       inSortedRange:NSMakeRange(0, state.frontier.count)
+                                             options:NSBinarySearchingInsertionIndex
+                                     usingComparator:^NSComparisonResult(id a, id b) {
+        return WAComparePaths(a, b);
+    }];
+    [state.frontier insertObjects:nodes atIndexes:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(index, nodes.count)]];
+}
+
+- (void)dropFrontierAfterPath:(NSIndexPath *)path state:(WAAXWalkState *)state {
+    WAAXWalkNode *probe = [[WAAXWalkNode alloc] init];
+    probe.path = path;
+    NSUInteger index = [state.frontier indexOfObject:probe
+                                       inSortedRange:NSMakeRange(0, state.frontier.count)
+                                             options:NSBinarySearchingInsertionIndex | NSBinarySearchingLastEqual
+                                     usingComparator:^NSComparisonResult(id a, id b) {
+        return WAComparePaths(a, b);
+    }];
+    if (index < state.frontier.count) {
+        [state.frontier removeObjectsInRange:NSMakeRange(index, state.frontier.count - index)];
+    }
+}
+
+/// Write every dump line whose predecessors are all written, freeing finished subtrees
+- (void)emitLinesForState:(WAAXWalkState *)state {
+    if (!state.lineHandler) return;
+
+    while (state.emitStack.count > 0) {
+        WAAXWalkNode *top = state.emitStack.lastObject;
+        if (!top.emitted) {
+            if (!top.fetched) break;
+            if (top.line) state.lineHandler(top.line);
+            top.emitted = YES;
+            top.line = nil;
+            top.element = nil;
+        }
+        if (top.nextChild < top.children.count) {
+            [state.emitStack addObject:top.children[top.nextChild]];
+            top.nextChild++;
+        } else {
+            top.children = nil;
+            [state.emitStack removeLastObject];
+        }
+    }
+}
+
+- (NSString *)dumpLineForNode:(id)node role:(NSString *)role identifier:(NSString *)identifier childCount:(NSUInteger)childCount {
+    if ([self.provider respondsToSelector:@selector(dumpLineForNode:role:identifier:childCount:)]) {
+        return [self.provider dumpLineForNode:node role:role identifier:identifier childCount:childCount];
+    }
+    NSMutableString *line = [NSMutableString stringWithString:role];
+    if (identifier.length > 0) [line appendFormat:@" id=\"%@\"", identifier];
+    if (childCount > 0) [line appendFormat:@" [%lu children]", (unsigned long)childCount];
+    return line;
+}
+
+@end
+
+#pragma mark - WASyntheticAXTreeProvider
+
+@interface WASyntheticAXTreeProvider ()
+@property (atomic, readwrite) NSUInteger fetchCount;
+@end
+
+@implementation WASyntheticAXTreeProvider
+
+- (BOOL)fetchNode:(id)node role:(NSString **)role identifier:(NSString **)identifier children:(NSArray **)children {
+    @synchronized (self) {
+        self.fetchCount = self.fetchCount + 1;
+    }
+    if (self.latency > 0) {
+        usleep((useconds_t)(self.latency * 1000000));
+    }
+    if (![node isKindOfClass:[NSDictionary class]]) return NO;
+
+    NSDictionary *dict = node;
+    *role = dict[@"role"];
+    *identifier = dict[@"id"];
+    *children = dict[@"children"] ?: @[];
+    return YES;
+}
+
++ (NSDictionary *)treeWithBreadth:(NSUInteger)breadth depth:(NSUInteger)depth {
+    return [self nodeWithIdentifier:@"n" breadth:breadth remaining:depth];
+}
+
++ (NSDictionary *)nodeWithIdentifier:(NSString *)identifier breadth:(NSUInteger)breadth remaining:(NSUInteger)remaining {
+    NSMutableArray *children = [NSMutableArray array];
+    if (remaining > 0) {
+        for (NSUInteger i = 0; i < breadth; i++) {
+            NSString *childId = [NSString stringWithFormat:@"%@.%lu", identifier, (unsigned long)i];
+            [children addObject:[self nodeWithIdentifier:childId breadth:breadth remaining:remaining - 1]];
+        }
+    }
+    return @{
+        @"role": children.count > 0 ? @"AXGroup" : @"AXStaticText",
+        @"id": identifier,
+        @"children": children
+    };
+}
+
+@end
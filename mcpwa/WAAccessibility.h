@@ -6,6 +6,12 @@
 //
 
 #import <Cocoa/Cocoa.h>
+#import "WAMessage.h"
+
+@class WAProgressReporter;
+@class WAChatPrefetcher;
+@class WAChatDirectory;
+@class WALocalRetriever;
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -19,6 +25,27 @@ typedef NS_ENUM(NSInteger, WAChatFilter) {
     WAChatFilterGroups
 };
 
+/// Chat fields that can be requested individually. Everything except name,
+/// selection and index is parsed out of the row's AXValue, so leaving those
+/// fields out skips the AXValue fetch altogether.
+typedef NS_OPTIONS(NSUInteger, WAChatField) {
+    WAChatFieldName        = 1 << 0,
+    WAChatFieldLastMessage = 1 << 1,
+    WAChatFieldTimestamp   = 1 << 2,
+    WAChatFieldSender      = 1 << 3,
+    WAChatFieldIsPinned    = 1 << 4,
+    WAChatFieldIsGroup     = 1 << 5,
+    WAChatFieldIsUnread    = 1 << 6,
+    WAChatFieldIsSelected  = 1 << 7,
+    WAChatFieldIndex       = 1 << 8,
+    WAChatFieldAll         = 0x1FF
+};
+
+/// Fields whose values come from the chat row's AXValue
+static const WAChatField WAChatFieldsFromValue = WAChatFieldLastMessage | WAChatFieldTimestamp |
+                                                 WAChatFieldSender | WAChatFieldIsPinned |
+                                                 WAChatFieldIsGroup | WAChatFieldIsUnread;
+
 @interface WAChat : NSObject
 @property (nonatomic, copy) NSString *name;
 @property (nonatomic, copy) NSString *lastMessage;
@@ -29,29 +56,21 @@ typedef NS_ENUM(NSInteger, WAChatFilter) {
 @property (nonatomic, assign) BOOL isUnread;
 @property (nonatomic, assign) BOOL isSelected;               // Currently open/selected chat
 @property (nonatomic, assign) NSInteger index;               // Position in chat list
-@end
 
-typedef NS_ENUM(NSInteger, WAMessageDirection) {
-    WAMessageDirectionIncoming,
-    WAMessageDirectionOutgoing,
-    WAMessageDirectionSystem
-};
+/// Structured form for the app socket (JSON or MessagePack framing)
+- (NSDictionary *)toDictionary;
 
-@interface WAMessage : NSObject
-@property (nonatomic, copy) NSString *text;
-@property (nonatomic, copy, nullable) NSString *sender;      // For incoming/group messages
-@property (nonatomic, copy, nullable) NSString *timestamp;
-@property (nonatomic, assign) WAMessageDirection direction;
-@property (nonatomic, copy, nullable) NSString *replyTo;     // If replying to someone
-@property (nonatomic, copy, nullable) NSString *replyText;   // The quoted text
-@property (nonatomic, strong, nullable) NSArray<NSString *> *reactions;
-@property (nonatomic, assign) BOOL isRead;                   // For outgoing
+/// Same as toDictionary, restricted to the requested fields
+- (NSDictionary *)toDictionaryWithFields:(WAChatField)fields;
 @end
 
 @interface WACurrentChat : NSObject
 @property (nonatomic, copy) NSString *name;
 @property (nonatomic, copy, nullable) NSString *lastSeen;    // "last seen today at 18:52"
+@property (nonatomic, strong, nullable) NSNumber *watermarkFound;  // Delta reads only
 @property (nonatomic, strong) NSArray<WAMessage *> *messages;
+
+- (NSDictionary *)toDictionary;
 @end
 
 #pragma mark - Search Result Models
@@ -60,6 +79,8 @@ typedef NS_ENUM(NSInteger, WAMessageDirection) {
 @interface WASearchChatResult : NSObject
 @property (nonatomic, copy) NSString *chatName;
 @property (nonatomic, copy, nullable) NSString *lastMessagePreview;
+
+- (NSDictionary *)toDictionary;
 @end
 
 /// A message that matches the search query (by content)
@@ -67,6 +88,8 @@ typedef NS_ENUM(NSInteger, WAMessageDirection) {
 @property (nonatomic, copy) NSString *chatName;
 @property (nonatomic, copy, nullable) NSString *sender;
 @property (nonatomic, copy) NSString *messagePreview;
+
+- (NSDictionary *)toDictionary;
 @end
 
 /// Combined search results
@@ -74,6 +97,8 @@ typedef NS_ENUM(NSInteger, WAMessageDirection) {
 @property (nonatomic, copy) NSString *query;
 @property (nonatomic, strong) NSArray<WASearchChatResult *> *chatMatches;
 @property (nonatomic, strong) NSArray<WASearchMessageResult *> *messageMatches;
+
+- (NSDictionary *)toDictionary;
 @end
 
 #pragma mark - Main Class
@@ -81,9 +106,50 @@ typedef NS_ENUM(NSInteger, WAMessageDirection) {
 @interface WAAccessibility : NSObject
 
 @property (readonly) pid_t whatsappPID;
-/// Shared instance
+/// Shared instance: attaches to the first running WhatsApp (personal before Business)
 + (instancetype)shared;
 
+#pragma mark - Instances
+
+/// Bundle identifiers of the WhatsApp builds that can be driven (personal, Business)
++ (NSArray<NSString *> *)supportedBundleIdentifiers;
+
+/// Running WhatsApp processes as {"account", "bundle_id", "pid", "name"}. "account"
+/// is "personal" or "business", suffixed with ":<pid>" when a build runs twice.
++ (NSArray<NSDictionary *> *)runningAccounts;
+
+/// Accessor for a tool's "account" argument: nil or empty gives the shared
+/// instance; otherwise "personal", "business", a bundle id, a PID or
+/// "<account>:<pid>". Each process gets one long-lived accessor with its own
+/// AX caches and operation queue; the shared instance's process gets the
+/// shared instance. Returns nil if nothing running matches.
++ (nullable instancetype)instanceForAccount:(nullable NSString *)account;
+
+/// Bundle identifier this accessor is bound to (nil for the shared instance)
+@property (nonatomic, copy, readonly, nullable) NSString *bundleIdentifier;
+
+/// Serial queue for this instance's UI operations. Operations on different
+/// instances run concurrently; operations on one instance never overlap.
+@property (nonatomic, strong, readonly) dispatch_queue_t operationQueue;
+
+/// Run block synchronously on operationQueue (inline if already on it).
+/// Tool calls run through here so the idle prefetcher can step aside.
+- (void)performOperation:(dispatch_block_t)block;
+
+/// As above, recorded in WAToolMetrics under name. The block runs in its own
+/// WAAXArena, so borrowed elements stay valid until it returns.
+- (void)performOperation:(dispatch_block_t)block named:(NSString *)name;
+
+/// Idle-time cache of likely-next chats, fed by chat lists and searches
+@property (nonatomic, strong, readonly) WAChatPrefetcher *prefetcher;
+
+/// Chat names seen in this account. The shared instance uses [WAChatDirectory shared].
+@property (nonatomic, strong, readonly) WAChatDirectory *chatDirectory;
+
+/// Offline index of this account's messages. The shared instance uses
+/// [WALocalRetriever shared]; others get one named after their account.
+@property (nonatomic, strong, readonly) WALocalRetriever *localRetriever;
+
 /// Check if WhatsApp is running and accessible
 - (BOOL)isWhatsAppAvailable;
 
@@ -94,6 +160,7 @@ typedef NS_ENUM(NSInteger, WAMessageDirection) {
 /// Call this before operations that require the WhatsApp window to be accessible
 - (BOOL)ensureWhatsAppVisible;
 
+/// Borrowed from the current WAAXArena (autoreleased outside one) - never CFRelease it
 - (AXUIElementRef)getMainWindow;
 - (void)pressKey:(CGKeyCode)keyCode withFlags:(CGEventFlags)flags toProcess:(pid_t)pid;
 - (void)typeString:(NSString *)string toProcess:(pid_t)pid;
@@ -119,6 +186,16 @@ typedef NS_ENUM(NSInteger, WAMessageDirection) {
 /// Convert string to filter enum (case-insensitive)
 + (WAChatFilter)chatFilterFromString:(NSString *)string;
 
+#pragma mark - Field Projection
+
+/// Convert tool "fields" names (snake_case dictionary keys) to a field mask.
+/// Returns WAChatFieldAll / WAMessageFieldAll for nil or empty input; unknown names are ignored.
++ (WAChatField)chatFieldsFromNames:(nullable NSArray<NSString *> *)names;
++ (WAMessageField)messageFieldsFromNames:(nullable NSArray<NSString *> *)names;
+
+/// Whether a since argument is a message fingerprint rather than an HH:MM bound
++ (BOOL)isMessageFingerprint:(nullable NSString *)string;
+
 #pragma mark - Chat List
 
 /// Get list of visible chats
@@ -128,6 +205,9 @@ typedef NS_ENUM(NSInteger, WAMessageDirection) {
 /// If filter is not WAChatFilterAll, will switch to that filter first
 - (NSArray<WAChat *> *)getRecentChatsWithFilter:(WAChatFilter)filter;
 
+/// Get list of visible chats, extracting only the requested fields from AX
+- (NSArray<WAChat *> *)getRecentChatsWithFields:(WAChatField)fields;
+
 /// Get chat by name (partial match)
 /// This method is smart about the current UI state:
 /// 1. If in search mode, looks in search results first
@@ -135,37 +215,87 @@ typedef NS_ENUM(NSInteger, WAMessageDirection) {
 /// 3. If still not found, performs a search and looks in results
 - (nullable WAChat *)findChatWithName:(NSString *)name;
 
+/// findChatWithName: reporting each place it looked; the chat goes out as a partial when found
+- (nullable WAChat *)findChatWithName:(NSString *)name progress:(nullable WAProgressReporter *)progress;
+
 /// Navigate to a specific chat by clicking on it
 - (BOOL)openChat:(WAChat *)chat;
 
 /// Open chat by name (convenience method)
 - (BOOL)openChatWithName:(NSString *)name;
 
+/// openChatWithName: with progress from the lookup and the final open
+- (BOOL)openChatWithName:(NSString *)name progress:(nullable WAProgressReporter *)progress;
+
 /// Scroll the chat list down by one page (selects last visible chat, presses Next Chat)
 /// @return Array of WAChat objects representing all visible chats after scrolling
 - (NSArray<WAChat *> *)scrollChatListDown;
+- (NSArray<WAChat *> *)scrollChatListDownWithProgress:(nullable WAProgressReporter *)progress;
 
 /// Scroll the chat list up by one page (selects first visible chat, presses Previous Chat)
 /// @return Array of WAChat objects representing all visible chats after scrolling
 - (NSArray<WAChat *> *)scrollChatListUp;
+- (NSArray<WAChat *> *)scrollChatListUpWithProgress:(nullable WAProgressReporter *)progress;
 
 #pragma mark - Current Chat
 
 /// Get info about the currently open chat
 - (nullable WACurrentChat *)getCurrentChat;
 
+/// getCurrentChat, but with a fingerprint watermark only the messages below it are read
+- (nullable WACurrentChat *)getCurrentChatSince:(nullable NSString *)since;
+
+/// Name shown in the open chat's header, without reading any messages
+- (nullable NSString *)currentChatName;
+
+/// Whether an open chat's header plausibly is the chat requested as name
+/// ("Igor B" for "igor"): contains it after folding, or matches it fuzzily.
+/// Used when opening left the header unchanged.
++ (BOOL)chatHeader:(NSString *)header namesChat:(NSString *)name;
+
+/// Open a chat and wait up to timeout for the header to switch to it. Returns
+/// the header name (at once if it is already open), or nil if the chat wasn't
+/// found or the header never changed to (or already showed) the chat.
+- (nullable NSString *)openChatWithName:(NSString *)name settleTimeout:(NSTimeInterval)timeout;
+
+/// Fingerprint of the bottom message of the open chat, reading as few rows as possible
+- (nullable NSString *)latestMessageFingerprint;
+
+/// Current contents of the compose box (nil if there is none)
+- (nullable NSString *)composerText;
+
 /// Get messages from the currently open chat
 - (NSArray<WAMessage *> *)getMessages;
 
 /// Get messages with limit
 - (NSArray<WAMessage *> *)getMessagesWithLimit:(NSInteger)limit;
 
+/// Get messages with limit, parsing only the requested fields.
+/// since: optional "HH:MM" lower bound, taken as its most recent occurrence:
+/// messages from there on are kept even across midnight (those without a
+/// timestamp stay with their neighbours), or a message fingerprint: rows are then read from the bottom up to that
+/// message and only newer ones are returned, oldest first.
+- (NSArray<WAMessage *> *)getMessagesWithLimit:(NSInteger)limit
+                                        fields:(WAMessageField)fields
+                                         since:(nullable NSString *)since;
+
+/// As above; watermarkFound is NO when since is a fingerprint that is no longer
+/// among the loaded rows, in which case every loaded message is returned
+- (NSArray<WAMessage *> *)getMessagesWithLimit:(NSInteger)limit
+                                        fields:(WAMessageField)fields
+                                         since:(nullable NSString *)since
+                                watermarkFound:(nullable BOOL *)watermarkFound;
+
 #pragma mark - Global Search
 
 /// Perform a global search across all chats and messages
 /// Returns both chat name matches and message content matches
 - (nullable WASearchResults *)globalSearch:(NSString *)query;
 
+/// globalSearch: with a progress stage per UI step. Chat-name matches are sent as
+/// a partial as soon as they are read, then message matches in chunks as parsed.
+- (nullable WASearchResults *)globalSearch:(NSString *)query progress:(nullable WAProgressReporter *)progress;
+
 /// Clear the search field and return to normal chat list view
 - (BOOL)clearSearch;
 
@@ -7,6 +7,15 @@
 
 #import "WAAccessibility.h"
 #import "WALogger.h"
+#import "WAChatDirectory.h"
+#import "WALocalRetriever.h"
+#import "WAAXTreeWalker.h"
+#import "WAAXElementProvider.h"
+#import "WAProgressReporter.h"
+#import "WAChatPrefetcher.h"
+#import "WAAXArena.h"
+#import "WAToolMetrics.h"
+#import "WAMessageCellDecoder.h"
 #import <ApplicationServices/ApplicationServices.h>
 #import <signal.h>
 
@@ -16,29 +25,119 @@
 - (NSString *)description {
     return [NSString stringWithFormat:@"<WAChat: %@ - %@>", self.name, self.lastMessage];
 }
-@end
 
-@implementation WAMessage
-- (NSString *)description {
-    NSString *dir = self.direction == WAMessageDirectionIncoming ? @"←" : 
-                    self.direction == WAMessageDirectionOutgoing ? @"→" : @"•";
-    return [NSString stringWithFormat:@"<%@ %@: %@>", dir, self.sender ?: @"me", self.text];
+- (NSDictionary *)toDictionary {
+    return [self toDictionaryWithFields:WAChatFieldAll];
+}
+
+- (NSDictionary *)toDictionaryWithFields:(WAChatField)fields {
+    NSMutableDictionary *dict = [NSMutableDictionary dictionary];
+    if (fields & WAChatFieldIndex) dict[@"index"] = @(self.index);
+    if ((fields & WAChatFieldName) && self.name) dict[@"name"] = self.name;
+    if ((fields & WAChatFieldLastMessage) && self.lastMessage) dict[@"last_message"] = self.lastMessage;
+    if ((fields & WAChatFieldTimestamp) && self.timestamp) dict[@"timestamp"] = self.timestamp;
+    if ((fields & WAChatFieldSender) && self.sender) dict[@"sender"] = self.sender;
+    if (fields & WAChatFieldIsPinned) dict[@"is_pinned"] = @(self.isPinned);
+    if (fields & WAChatFieldIsGroup) dict[@"is_group"] = @(self.isGroup);
+    if (fields & WAChatFieldIsUnread) dict[@"is_unread"] = @(self.isUnread);
+    if (fields & WAChatFieldIsSelected) dict[@"is_selected"] = @(self.isSelected);
+    return [dict copy];
 }
 @end
 
+/// Fields a fingerprint is computed from
+static const WAMessageField kFingerprintFields =
+    WAMessageFieldText | WAMessageFieldSender | WAMessageFieldTimestamp | WAMessageFieldDirection;
+
+/// 64-bit FNV-1a of direction, sender, timestamp and text as 16 hex digits.
+/// Unlike -[NSString hash] it is stable across launches and OS versions.
+static NSString *WAMessageDigest(WAMessage *message) {
+    NSString *key = [NSString stringWithFormat:@"%ld\x1f%@\x1f%@\x1f%@", (long)message.direction,
+                     message.sender ?: @"", message.timestamp ?: @"", message.text ?: @""];
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const unsigned char *byte = (const unsigned char *)key.UTF8String; *byte; byte++) {
+        hash ^= *byte;
+        hash *= 0x100000001b3ULL;
+    }
+    return [NSString stringWithFormat:@"%016llx", (unsigned long long)hash];
+}
+
+static BOOL WASameTimestamp(NSString *a, NSString *b) {
+    return a == b || [a isEqualToString:b];
+}
+
+/// The ordinal rule, shared by every path that fingerprints: the number of
+/// messages identical to message in the run of same-minute messages directly
+/// above it. Identical messages can only share a minute, so the walk stops at
+/// the first other minute. above is oldest first and may reach past the run.
+static NSUInteger WAFingerprintOrdinal(NSString *digest, WAMessage *message, NSArray<WAMessage *> *above) {
+    NSUInteger ordinal = 0;
+    for (WAMessage *previous in above.reverseObjectEnumerator) {
+        if (!WASameTimestamp(previous.timestamp, message.timestamp)) break;
+        if ([WAMessageDigest(previous) isEqualToString:digest]) ordinal++;
+    }
+    return ordinal;
+}
+
+/// "<digest>.<ordinal>" for message with the messages above it (oldest first)
+static NSString *WAMessageFingerprint(WAMessage *message, NSArray<WAMessage *> *above) {
+    NSString *digest = WAMessageDigest(message);
+    return [NSString stringWithFormat:@"%@.%lu", digest, (unsigned long)WAFingerprintOrdinal(digest, message, above)];
+}
+
+/// Split a "<digest>.<ordinal>" fingerprint; NO for anything else (e.g. an HH:MM bound)
+static BOOL WAParseFingerprint(NSString *string, NSString **digest, NSUInteger *ordinal) {
+    if (string.length < 18 || [string characterAtIndex:16] != '.') return NO;
+    NSString *hex = [string substringToIndex:16].lowercaseString;
+    NSString *count = [string substringFromIndex:17];
+    NSCharacterSet *nonHex = [[NSCharacterSet characterSetWithCharactersInString:@"0123456789abcdef"] invertedSet];
+    if ([hex rangeOfCharacterFromSet:nonHex].location != NSNotFound) return NO;
+    if ([count rangeOfCharacterFromSet:[NSCharacterSet decimalDigitCharacterSet].invertedSet].location != NSNotFound) return NO;
+    *digest = hex;
+    *ordinal = (NSUInteger)count.integerValue;
+    return YES;
+}
+
 @implementation WACurrentChat
+- (NSDictionary *)toDictionary {
+    NSMutableArray *messages = [NSMutableArray arrayWithCapacity:self.messages.count];
+    for (WAMessage *message in self.messages) {
+        [messages addObject:[message toDictionary]];
+    }
+    NSMutableDictionary *dict = [NSMutableDictionary dictionary];
+    if (self.name) dict[@"name"] = self.name;
+    if (self.lastSeen) dict[@"last_seen"] = self.lastSeen;
+    if (self.watermarkFound) dict[@"watermark_found"] = self.watermarkFound;
+    dict[@"messages"] = messages;
+    return [dict copy];
+}
 @end
 
 @implementation WASearchChatResult
 - (NSString *)description {
     return [NSString stringWithFormat:@"<WASearchChatResult: %@>", self.chatName];
 }
+
+- (NSDictionary *)toDictionary {
+    NSMutableDictionary *dict = [NSMutableDictionary dictionary];
+    if (self.chatName) dict[@"chat_name"] = self.chatName;
+    if (self.lastMessagePreview) dict[@"last_message_preview"] = self.lastMessagePreview;
+    return [dict copy];
+}
 @end
 
 @implementation WASearchMessageResult
 - (NSString *)description {
     return [NSString stringWithFormat:@"<WASearchMessageResult: %@ in %@>", self.messagePreview, self.chatName];
 }
+
+- (NSDictionary *)toDictionary {
+    NSMutableDictionary *dict = [NSMutableDictionary dictionary];
+    if (self.chatName) dict[@"chat_name"] = self.chatName;
+    if (self.sender) dict[@"sender"] = self.sender;
+    if (self.messagePreview) dict[@"message_preview"] = self.messagePreview;
+    return [dict copy];
+}
 @end
 
 @implementation WASearchResults
@@ -46,13 +145,57 @@
     return [NSString stringWithFormat:@"<WASearchResults: query='%@' chats=%lu messages=%lu>", 
             self.query, (unsigned long)self.chatMatches.count, (unsigned long)self.messageMatches.count];
 }
+
+- (NSDictionary *)toDictionary {
+    NSMutableArray *chats = [NSMutableArray arrayWithCapacity:self.chatMatches.count];
+    for (WASearchChatResult *chat in self.chatMatches) {
+        [chats addObject:[chat toDictionary]];
+    }
+    NSMutableArray *messages = [NSMutableArray arrayWithCapacity:self.messageMatches.count];
+    for (WASearchMessageResult *message in self.messageMatches) {
+        [messages addObject:[message toDictionary]];
+    }
+    return @{
+        @"query": self.query ?: @"",
+        @"chat_matches": chats,
+        @"message_matches": messages
+    };
+}
 @end
 
 #pragma mark - WAAccessibility
 
+/// Message result groups per progress notification during globalSearch
+static const NSUInteger kSearchProgressChunk = 10;
+
+static NSString * const kPersonalBundleIdentifier = @"net.whatsapp.WhatsApp";
+static NSString * const kBusinessBundleIdentifier = @"net.whatsapp.WhatsAppSMB";
+
+/// Identifies the instance that owns the current operation queue (re-entrancy check)
+static void *kOperationQueueKey = &kOperationQueueKey;
+
+/// The pasteboard and HID event stream are global, so clipboard-based typing
+/// must not interleave between instances driven in parallel
+static NSLock *WAClipboardLock(void) {
+    static NSLock *lock = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        lock = [[NSLock alloc] init];
+    });
+    return lock;
+}
+
 @interface WAAccessibility ()
 @property (nonatomic, assign) pid_t whatsappPID;
+@property (nonatomic, assign) pid_t pinnedPID;                      // 0 = first matching process
+@property (nonatomic, copy, readwrite, nullable) NSString *bundleIdentifier;
+@property (nonatomic, strong, readwrite) dispatch_queue_t operationQueue;
+@property (nonatomic, strong, readwrite) WAChatPrefetcher *prefetcher;
+@property (nonatomic, strong, readwrite) WAChatDirectory *chatDirectory;
+@property (nonatomic, strong, readwrite) WALocalRetriever *localRetriever;
 @property (nonatomic, assign) AXUIElementRef appElement;
+@property (nonatomic, strong, nullable) WAAXElementProvider *treeProvider;
+@property (nonatomic, strong, nullable) WAMessageCellDecoder *cellDecoder;
 @end
 
 @implementation WAAccessibility
@@ -66,6 +209,161 @@
     return instance;
 }
 
+- (instancetype)init {
+    return [self initWithBundleIdentifier:nil pid:0];
+}
+
+- (instancetype)initWithBundleIdentifier:(NSString *)bundleIdentifier pid:(pid_t)pid {
+    self = [super init];
+    if (self) {
+        _bundleIdentifier = [bundleIdentifier copy];
+        _pinnedPID = pid;
+        NSString *label = [NSString stringWithFormat:@"com.mcpwa.whatsapp.%@.%d", bundleIdentifier ?: @"default", pid];
+        _operationQueue = dispatch_queue_create(label.UTF8String, DISPATCH_QUEUE_SERIAL);
+        dispatch_queue_set_specific(_operationQueue, kOperationQueueKey, (__bridge void *)self, NULL);
+        _prefetcher = [[WAChatPrefetcher alloc] initWithAccessibility:self];
+        if (bundleIdentifier) {
+            // Another account: its chats and messages must not mix with the shared instance's
+            _chatDirectory = [[WAChatDirectory alloc] init];
+            _localRetriever = [WALocalRetriever retrieverNamed:[WAAccessibility accountNameForBundleIdentifier:bundleIdentifier]];
+        } else {
+            _chatDirectory = [WAChatDirectory shared];
+            _localRetriever = [WALocalRetriever shared];
+        }
+    }
+    return self;
+}
+
+#pragma mark - Instances
+
++ (NSArray<NSString *> *)supportedBundleIdentifiers {
+    return @[kPersonalBundleIdentifier, kBusinessBundleIdentifier];
+}
+
++ (NSString *)accountNameForBundleIdentifier:(NSString *)bundleIdentifier {
+    return [bundleIdentifier isEqualToString:kBusinessBundleIdentifier] ? @"business" : @"personal";
+}
+
+/// Live WhatsApp processes of the supported builds, personal first
++ (NSArray<NSRunningApplication *> *)runningWhatsAppApplications {
+    NSMutableArray<NSRunningApplication *> *apps = [NSMutableArray array];
+    for (NSString *bundleIdentifier in [self supportedBundleIdentifiers]) {
+        for (NSRunningApplication *app in [NSRunningApplication runningApplicationsWithBundleIdentifier:bundleIdentifier]) {
+            if (!app.terminated) [apps addObject:app];
+        }
+    }
+    return apps;
+}
+
++ (NSArray<NSDictionary *> *)runningAccounts {
+    NSArray<NSRunningApplication *> *apps = [self runningWhatsAppApplications];
+    NSCountedSet<NSString *> *perBundle = [NSCountedSet setWithArray:[apps valueForKey:@"bundleIdentifier"]];
+
+    NSMutableArray<NSDictionary *> *accounts = [NSMutableArray arrayWithCapacity:apps.count];
+    for (NSRunningApplication *app in apps) {
+        NSString *name = [self accountNameForBundleIdentifier:app.bundleIdentifier];
+        // Two copies of the same build are told apart by PID
+        NSString *account = [perBundle countForObject:app.bundleIdentifier] > 1
+            ? [NSString stringWithFormat:@"%@:%d", name, app.processIdentifier] : name;
+        [accounts addObject:@{
+            @"account": account,
+            @"bundle_id": app.bundleIdentifier,
+            @"pid": @(app.processIdentifier),
+            @"name": app.localizedName ?: name
+        }];
+    }
+    return accounts;
+}
+
++ (instancetype)instanceForAccount:(NSString *)account {
+    if (account.length == 0) return [self shared];
+
+    NSString *wanted = account.lowercaseString;
+    NSArray<NSRunningApplication *> *apps = [self runningWhatsAppApplications];
+    // The process the shared instance drives: its live connection, else the one it would pick
+    WAAccessibility *shared = [self shared];
+    pid_t sharedPID = shared.whatsappPID;
+    if (sharedPID <= 0 || kill(sharedPID, 0) != 0) {
+        sharedPID = apps.firstObject.processIdentifier;
+    }
+
+    for (NSRunningApplication *app in apps) {
+        NSString *name = [self accountNameForBundleIdentifier:app.bundleIdentifier];
+        NSString *pid = [NSString stringWithFormat:@"%d", app.processIdentifier];
+        if ([wanted isEqualToString:name] ||
+            [wanted isEqualToString:app.bundleIdentifier.lowercaseString] ||
+            [wanted isEqualToString:pid] ||
+            [wanted isEqualToString:[NSString stringWithFormat:@"%@:%@", name, pid]]) {
+            // One accessor (and one operation queue) per process: naming the
+            // shared instance's process explicitly must not create a second
+            if (app.processIdentifier == sharedPID) return shared;
+            return [self instanceForBundleIdentifier:app.bundleIdentifier pid:app.processIdentifier];
+        }
+    }
+    [WALogger warn:@"instanceForAccount: no running WhatsApp matches '%@'", account];
+    return nil;
+}
+
+/// One accessor per process, reused across tool calls so its AX caches survive
++ (instancetype)instanceForBundleIdentifier:(NSString *)bundleIdentifier pid:(pid_t)pid {
+    static NSMutableDictionary<NSString *, WAAccessibility *> *instances = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        instances = [NSMutableDictionary dictionary];
+    });
+
+    NSString *key = [NSString stringWithFormat:@"%@:%d", bundleIdentifier, pid];
+    @synchronized (instances) {
+        WAAccessibility *instance = instances[key];
+        if (!instance) {
+            // Forget accessors of processes that have since quit
+            for (NSString *staleKey in instances.allKeys) {
+                pid_t stalePID = instances[staleKey].pinnedPID;
+                if (![NSRunningApplication runningApplicationWithProcessIdentifier:stalePID]) {
+                    [instances removeObjectForKey:staleKey];
+                }
+            }
+            instance = [[WAAccessibility alloc] initWithBundleIdentifier:bundleIdentifier pid:pid];
+            instances[key] = instance;
+        }
+        return instance;
+    }
+}
+
+- (NSString *)accountName {
+    if (!self.bundleIdentifier) return @"default";
+    return [WAAccessibility accountNameForBundleIdentifier:self.bundleIdentifier];
+}
+
+- (void)performOperation:(dispatch_block_t)block {
+    [self performOperation:block named:@"operation"];
+}
+
+- (void)performOperation:(dispatch_block_t)block named:(NSString *)name {
+    // Nested calls from inside an operation run inline (and in the outer arena) instead of deadlocking
+    if (dispatch_get_specific(kOperationQueueKey) == (__bridge void *)self) {
+        block();
+        return;
+    }
+    // A prefetch holding the queue stops at its next step once it sees this
+    [self.prefetcher requestWillBegin];
+    dispatch_sync(self.operationQueue, ^{
+        [[WAToolMetrics shared] measureTool:name block:block];
+    });
+    [self.prefetcher requestDidEnd];
+}
+
+/// Processes this accessor may attach to
+- (NSArray<NSRunningApplication *> *)candidateApplications {
+    NSMutableArray<NSRunningApplication *> *candidates = [NSMutableArray array];
+    for (NSRunningApplication *app in [WAAccessibility runningWhatsAppApplications]) {
+        if (self.bundleIdentifier && ![app.bundleIdentifier isEqualToString:self.bundleIdentifier]) continue;
+        if (self.pinnedPID > 0 && app.processIdentifier != self.pinnedPID) continue;
+        [candidates addObject:app];
+    }
+    return candidates;
+}
+
 - (void)dealloc {
     if (_appElement) {
         CFRelease(_appElement);
@@ -174,103 +472,69 @@
 
 #pragma mark - Element Finding
 
-- (void)findElementsIn:(AXUIElementRef)root
-             predicate:(BOOL(^)(AXUIElementRef element, NSString *role, NSString *identifier))predicate
-              maxDepth:(int)maxDepth
-               results:(NSMutableArray *)results
-                 depth:(int)depth {
-    
-    if (depth >= maxDepth || !root) return;
-    
-    @try {
-        // Validate the element before using it
-        CFTypeRef testValue = NULL;
-        AXError testErr = AXUIElementCopyAttributeValue(root, kAXRoleAttribute, &testValue);
-        if (testErr != kAXErrorSuccess) {
-            // Element is invalid or stale
-            return;
-        }
-        
-        NSString *role = nil;
-        if (testValue) {
-            if (CFGetTypeID(testValue) == CFStringGetTypeID()) {
-                role = [self cleanString:(__bridge NSString *)testValue];
-            }
-            CFRelease(testValue);
-        }
-        
-        NSString *identifier = [self identifierOfElement:root];
-        
-        // Call predicate with safe values (role/identifier may be nil)
-        BOOL matches = NO;
-        @try {
-            matches = predicate(root, role ?: @"", identifier ?: @"");
-        } @catch (NSException *e) {
-            // Predicate threw - skip this element
-            matches = NO;
-        }
-        
-        if (matches) {
-            // RETAIN the element before storing - caller must release elements in array
-            CFRetain(root);
-            [results addObject:(__bridge id)root];
-        }
-        
-        NSArray *children = [self childrenOfElement:root];
-        for (id child in children) {
-            if (child && child != [NSNull null]) {
-                AXUIElementRef childRef = (__bridge AXUIElementRef)child;
-                if (childRef) {
-                    [self findElementsIn:childRef
-                               predicate:predicate
-                                maxDepth:maxDepth
-                                 results:results
-                                   depth:depth + 1];
-                }
-            }
-        }
-    } @catch (NSException *exception) {
-        // Log and continue - don't crash
-        NSLog(@"WAAccessibility: Exception in findElementsIn: %@", exception);
-    }
+/// Batched attribute fetcher; strings are cleaned the same way as the
+/// single-attribute helpers
+- (WAAXElementProvider *)elementProvider {
+    WAAXElementProvider *provider = self.treeProvider;
+    if (!provider) {
+        provider = [[WAAXElementProvider alloc] init];
+        __weak typeof(self) weakSelf = self;
+        provider.stringTransform = ^NSString *(NSString *string) {
+            return [weakSelf cleanString:string] ?: string;
+        };
+        self.treeProvider = provider;
+    }
+    return provider;
+}
+
+/// Concurrent walker over the WhatsApp tree
+- (WAAXTreeWalker *)treeWalkerWithMaxDepth:(int)maxDepth {
+    WAAXTreeWalker *walker = [[WAAXTreeWalker alloc] initWithProvider:[self elementProvider]];
+    walker.maxDepth = (NSUInteger)MAX(maxDepth, 0);
+    return walker;
 }
 
-// Returns array of RETAINED elements - caller must CFRelease each element
+// Returns BORROWED elements owned by the current WAAXArena - never CFRelease them.
+// Outside an arena they live as long as the returned array.
 - (NSArray *)findElementsIn:(AXUIElementRef)root
                   predicate:(BOOL(^)(AXUIElementRef element, NSString *role, NSString *identifier))predicate
                    maxDepth:(int)maxDepth {
-    NSMutableArray *results = [NSMutableArray array];
-    [self findElementsIn:root predicate:predicate maxDepth:maxDepth results:results depth:0];
+    if (!root) return @[];
+    
+    // Predicates run on walker threads; they only read AX attributes
+    WAAXTreeWalker *walker = [self treeWalkerWithMaxDepth:maxDepth];
+    NSArray<WAAXTreeMatch *> *matches = [walker findAllFrom:(__bridge id)root
+                                                   matching:^BOOL(id node, NSString *role, NSString *identifier, NSUInteger depth) {
+        return predicate((__bridge AXUIElementRef)node, role, identifier);
+    }];
+    
+    NSMutableArray *results = [NSMutableArray arrayWithCapacity:matches.count];
+    for (WAAXTreeMatch *match in matches) {
+        [results addObject:match.node];
+    }
+    [[WAAXArena currentArena] borrowElements:results];
     return results;
 }
 
-// Returns a RETAINED element - caller must CFRelease
+// Returns a BORROWED element owned by the current WAAXArena - never CFRelease it.
+// Outside an arena it is autoreleased.
 - (AXUIElementRef)findFirstElementIn:(AXUIElementRef)root
                            predicate:(BOOL(^)(AXUIElementRef element, NSString *role, NSString *identifier))predicate
                             maxDepth:(int)maxDepth {
-    NSArray *results = [self findElementsIn:root predicate:predicate maxDepth:maxDepth];
-    AXUIElementRef result = NULL;
-    
-    if (results.count > 0) {
-        // Elements are already retained in array, just take the first one
-        result = (__bridge AXUIElementRef)results[0];
-        // Retain it again since we're returning it and will release the array's copy
-        if (result) {
-            CFRetain(result);
-        }
-    }
+    if (!root) return NULL;
     
-    // Release all elements in the array
-    for (id elem in results) {
-        if (elem && elem != [NSNull null]) {
-            CFRelease((__bridge AXUIElementRef)elem);
-        }
-    }
+    // Stops as soon as nothing earlier in the tree can still match
+    WAAXTreeWalker *walker = [self treeWalkerWithMaxDepth:maxDepth];
+    WAAXTreeMatch *match = [walker findFirstFrom:(__bridge id)root
+                                        matching:^BOOL(id node, NSString *role, NSString *identifier, NSUInteger depth) {
+        return predicate((__bridge AXUIElementRef)node, role, identifier);
+    }];
     
-    return result;
+    if (!match) return NULL;
+    return [WAAXArena adoptInCurrentArena:(AXUIElementRef)CFRetain((__bridge CFTypeRef)match.node)];
 }
 
-// Returns a RETAINED element - caller must CFRelease
+// Returns a BORROWED element, like findFirstElementIn:
 - (AXUIElementRef)findElementWithIdentifier:(NSString *)identifier inElement:(AXUIElementRef)root {
     return [self findFirstElementIn:root predicate:^BOOL(AXUIElementRef element, NSString *role, NSString *ident) {
         return ident && [ident isEqualToString:identifier];
@@ -299,9 +563,9 @@
         self.whatsappPID = 0;
     }
 
-    // Look for WhatsApp in running applications
-    NSArray *apps = [NSRunningApplication runningApplicationsWithBundleIdentifier:@"net.whatsapp.WhatsApp"];
-    [WALogger debug:@"connectToWhatsApp: found %lu apps with bundle id", (unsigned long)apps.count];
+    // Look for WhatsApp in running applications (personal before Business unless pinned)
+    NSArray *apps = [self candidateApplications];
+    [WALogger debug:@"connectToWhatsApp: found %lu candidate apps for %@", (unsigned long)apps.count, [self accountName]];
 
     for (NSRunningApplication *app in apps) {
         [WALogger debug:@"connectToWhatsApp: app PID=%d terminated=%d", app.processIdentifier, app.terminated];
@@ -362,40 +626,39 @@
         [WALogger debug:@"isWhatsAppAvailable: process exists but no windows - app may be minimized or starting up"];
         return NO;
     }
-    CFRelease(window);
 
     [WALogger debug:@"isWhatsAppAvailable: YES"];
     return YES;
 }
 
 - (BOOL)activateWhatsApp {
-    NSArray *apps = [[NSWorkspace sharedWorkspace] runningApplications];
-
-    for (NSRunningApplication *app in apps) {
-        if ([app.bundleIdentifier isEqualToString:@"net.whatsapp.WhatsApp"]) {
-            BOOL activated = [app activateWithOptions:NSApplicationActivateIgnoringOtherApps];
-
-            if (activated) {
-                // Wait until WhatsApp is actually frontmost (up to 1 second)
-                for (int i = 0; i < 20; i++) {
-                    [NSThread sleepForTimeInterval:0.05];
-                    if ([app isActive]) {
-                        // Extra delay to ensure window is ready for keyboard input
-                        [NSThread sleepForTimeInterval:0.15];
-                        return YES;
-                    }
-                }
+    // Prefer the process this accessor is attached to
+    NSRunningApplication *app = self.whatsappPID > 0
+        ? [NSRunningApplication runningApplicationWithProcessIdentifier:self.whatsappPID] : nil;
+    if (!app) {
+        app = [self candidateApplications].firstObject;
+    }
+    if (!app) return NO;
+
+    BOOL activated = [app activateWithOptions:NSApplicationActivateIgnoringOtherApps];
+
+    if (activated) {
+        // Wait until WhatsApp is actually frontmost (up to 1 second)
+        for (int i = 0; i < 20; i++) {
+            [NSThread sleepForTimeInterval:0.05];
+            if ([app isActive]) {
+                // Extra delay to ensure window is ready for keyboard input
+                [NSThread sleepForTimeInterval:0.15];
+                return YES;
             }
-            return activated;
         }
     }
-
-    return NO;
+    return activated;
 }
 
 - (BOOL)ensureWhatsAppVisible {
     // Find WhatsApp in running applications
-    NSArray *apps = [NSRunningApplication runningApplicationsWithBundleIdentifier:@"net.whatsapp.WhatsApp"];
+    NSArray *apps = [self candidateApplications];
     [WALogger debug:@"ensureWhatsAppVisible: found %lu WhatsApp instances", (unsigned long)apps.count];
 
     for (NSRunningApplication *app in apps) {
@@ -414,7 +677,6 @@
         // Check if window is available - if so, we're good
         AXUIElementRef window = [self getMainWindow];
         if (window) {
-            CFRelease(window);
             [WALogger debug:@"ensureWhatsAppVisible: WhatsApp window already available"];
             return YES;
         }
@@ -433,7 +695,7 @@
         [WALogger debug:@"ensureWhatsAppVisible: kAXWindowsAttribute err=%d", (int)err];
 
         if (err == kAXErrorSuccess && windowsValue) {
-            NSArray *windows = (__bridge NSArray *)windowsValue;
+            NSArray *windows = (__bridge_transfer NSArray *)windowsValue;
             [WALogger debug:@"ensureWhatsAppVisible: found %lu windows in array", (unsigned long)windows.count];
 
             for (id winObj in windows) {
@@ -462,8 +724,6 @@
                     [WALogger debug:@"ensureWhatsAppVisible: kAXMinimizedAttribute failed, err=%d", (int)minErr];
                 }
             }
-
-            CFRelease(windowsValue);
         } else {
             [WALogger debug:@"ensureWhatsAppVisible: kAXWindowsAttribute returned nothing or failed"];
         }
@@ -471,7 +731,6 @@
         // Verify we have a window now
         window = [self getMainWindow];
         if (window) {
-            CFRelease(window);
             [WALogger debug:@"ensureWhatsAppVisible: WhatsApp window now available"];
             return YES;
         }
@@ -483,7 +742,6 @@
 
         window = [self getMainWindow];
         if (window) {
-            CFRelease(window);
             [WALogger debug:@"ensureWhatsAppVisible: WhatsApp window available after activation"];
             return YES;
         }
@@ -506,6 +764,17 @@
         return NULL;
     }
 
+    // The main window is the right one when several are open; windows[0] is
+    // whichever was ordered front last (possibly a media viewer or dialog)
+    CFTypeRef mainWindow = NULL;
+    AXError mainErr = AXUIElementCopyAttributeValue(self.appElement, kAXMainWindowAttribute, &mainWindow);
+    if (mainErr == kAXErrorSuccess && mainWindow) {
+        if (CFGetTypeID(mainWindow) == AXUIElementGetTypeID()) {
+            return [WAAXArena adoptInCurrentArena:(AXUIElementRef)mainWindow];
+        }
+        CFRelease(mainWindow);
+    }
+
     CFTypeRef windowsValue = NULL;
     AXError err = AXUIElementCopyAttributeValue(self.appElement, kAXWindowsAttribute, &windowsValue);
 
@@ -515,13 +784,13 @@
     }
 
     // Verify it's an array
-    if (CFGetTypeID(windowsValue) != CFArrayGetTypeID()) {
+    id windowsObject = (__bridge_transfer id)windowsValue;
+    if (![windowsObject isKindOfClass:[NSArray class]]) {
         [WALogger debug:@"getMainWindow: windowsValue is not an array"];
-        CFRelease(windowsValue);
         return NULL;
     }
 
-    NSArray *windows = (__bridge NSArray *)windowsValue;  // Don't transfer - we'll release manually
+    NSArray *windows = windowsObject;
     [WALogger debug:@"getMainWindow: found %lu windows", (unsigned long)windows.count];
     AXUIElementRef result = NULL;
 
@@ -533,15 +802,14 @@
         AXError roleErr = AXUIElementCopyAttributeValue(window, kAXRoleAttribute, &roleValue);
         if (roleErr == kAXErrorSuccess && roleValue) {
             CFRelease(roleValue);
-            // Retain the window since we're returning it and windowsValue will be released
-            result = (AXUIElementRef)CFRetain(window);
+            // Retain the window since we're returning it and the windows array goes away
+            result = [WAAXArena adoptInCurrentArena:(AXUIElementRef)CFRetain(window)];
         } else {
             [WALogger debug:@"getMainWindow: window role query failed, err=%d", (int)roleErr];
         }
     }
 
-    CFRelease(windowsValue);
-    return result;  // Caller is responsible for releasing this
+    return result;  // Borrowed - see getMainWindow in the header
 }
 
 #pragma mark - Search Mode Detection
@@ -557,10 +825,6 @@
     AXUIElementRef clearButton = [self findElementWithIdentifier:@"TokenizedSearchBar_DeleteButton" inElement:window];
     BOOL inSearchMode = (clearButton != NULL);
 
-    if (clearButton) {
-        CFRelease(clearButton);
-    }
-    CFRelease(window);
 
     [WALogger debug:@"isInSearchMode: %@", inSearchMode ? @"YES" : @"NO"];
     return inSearchMode;
@@ -598,6 +862,69 @@
     return WAChatFilterAll;
 }
 
+#pragma mark - Field Projection
+
++ (WAChatField)chatFieldsFromNames:(NSArray<NSString *> *)names {
+    if (names.count == 0) return WAChatFieldAll;
+
+    static NSDictionary<NSString *, NSNumber *> *fieldMap;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        fieldMap = @{
+            @"name": @(WAChatFieldName),
+            @"last_message": @(WAChatFieldLastMessage),
+            @"timestamp": @(WAChatFieldTimestamp),
+            @"sender": @(WAChatFieldSender),
+            @"is_pinned": @(WAChatFieldIsPinned),
+            @"is_group": @(WAChatFieldIsGroup),
+            @"is_unread": @(WAChatFieldIsUnread),
+            @"is_selected": @(WAChatFieldIsSelected),
+            @"index": @(WAChatFieldIndex)
+        };
+    });
+
+    WAChatField fields = 0;
+    for (NSString *name in names) {
+        if (![name isKindOfClass:[NSString class]]) continue;
+        fields |= [fieldMap[name.lowercaseString] unsignedIntegerValue];
+    }
+    return fields ?: WAChatFieldAll;
+}
+
++ (WAMessageField)messageFieldsFromNames:(NSArray<NSString *> *)names {
+    if (names.count == 0) return WAMessageFieldAll;
+
+    static NSDictionary<NSString *, NSNumber *> *fieldMap;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        fieldMap = @{
+            @"text": @(WAMessageFieldText),
+            @"sender": @(WAMessageFieldSender),
+            @"timestamp": @(WAMessageFieldTimestamp),
+            @"direction": @(WAMessageFieldDirection),
+            @"reply_to": @(WAMessageFieldReplyTo),
+            @"reply_text": @(WAMessageFieldReplyText),
+            @"reactions": @(WAMessageFieldReactions),
+            @"is_read": @(WAMessageFieldIsRead),
+            @"fingerprint": @(WAMessageFieldFingerprint),
+            @"media_type": @(WAMessageFieldMediaType)
+        };
+    });
+
+    WAMessageField fields = 0;
+    for (NSString *name in names) {
+        if (![name isKindOfClass:[NSString class]]) continue;
+        fields |= [fieldMap[name.lowercaseString] unsignedIntegerValue];
+    }
+    return fields ?: WAMessageFieldAll;
+}
+
++ (BOOL)isMessageFingerprint:(NSString *)string {
+    NSString *digest = nil;
+    NSUInteger ordinal = 0;
+    return WAParseFingerprint(string, &digest, &ordinal);
+}
+
 - (NSString *)filterButtonIdentifierForFilter:(WAChatFilter)filter {
     // Filter buttons have AXValue like "1 of 4", "2 of 4" etc.
     // But we identify them by their position/index (1-indexed in the UI)
@@ -627,7 +954,6 @@
     AXUIElementRef filterCell = [self findElementWithIdentifier:@"ChatListView_filterCell" inElement:window];
     if (!filterCell) {
         [WALogger warn:@"getSelectedChatFilter: no ChatListView_filterCell"];
-        CFRelease(window);
         return WAChatFilterAll;
     }
 
@@ -676,8 +1002,6 @@
         }
     }
 
-    CFRelease(filterCell);
-    CFRelease(window);
 
     return selectedFilter;
 }
@@ -702,7 +1026,6 @@
     AXUIElementRef filterCell = [self findElementWithIdentifier:@"ChatListView_filterCell" inElement:window];
     if (!filterCell) {
         [WALogger error:@"selectChatFilter: no ChatListView_filterCell"];
-        CFRelease(window);
         return NO;
     }
 
@@ -738,8 +1061,6 @@
         }
     }
 
-    CFRelease(filterCell);
-    CFRelease(window);
 
     if (!result) {
         [WALogger warn:@"selectChatFilter: could not find filter button for '%@'", targetDesc];
@@ -764,6 +1085,10 @@
 }
 
 - (NSArray<WAChat *> *)getRecentChats {
+    return [self getRecentChatsWithFields:WAChatFieldAll];
+}
+
+- (NSArray<WAChat *> *)getRecentChatsWithFields:(WAChatField)fields {
     AXUIElementRef window = [self getMainWindow];
     if (!window) return @[];
     
@@ -779,7 +1104,6 @@
     AXUIElementRef tableView = [self findElementWithIdentifier:@"ChatListView_TableView" inElement:window];
     if (!tableView) {
         [WALogger debug:@"getChats: Could not find ChatListView_TableView"];
-        CFRelease(window);
         return @[];
     }
     
@@ -787,44 +1111,59 @@
     // Note: The currently selected/open chat appears as AXStaticText instead of AXButton
     NSArray *children = [self childrenOfElement:tableView];
 
+    BOOL needsValue = (fields & WAChatFieldsFromValue) != 0;
+    NSSet<NSString *> *filterNames = [NSSet setWithObjects:@"All", @"Unread", @"Favorites", @"Groups", nil];
+
     NSInteger index = 0;
     for (id child in children) {
         AXUIElementRef element = (__bridge AXUIElementRef)child;
 
         NSString *role = [self roleOfElement:element];
-        NSString *desc = [self descriptionOfElement:element];
-        NSString *value = [self valueOfElement:element];
 
         // Chat items are either AXButton (unselected) or AXStaticText (selected/active)
         BOOL isButton = [role isEqualToString:@"AXButton"];
         BOOL isStaticText = [role isEqualToString:@"AXStaticText"];
         if (!isButton && !isStaticText) continue;
 
-        // Skip filter buttons (they have values like "1 of 4", "2 of 4")
-        if (value && [value containsString:@" of "]) continue;
+        NSString *desc = [self descriptionOfElement:element];
 
         // Skip elements without a proper name
         if (!desc || desc.length == 0) continue;
 
+        // AXValue is only fetched when a requested field needs it, or to tell
+        // a filter button ("1 of 4") apart from a chat that shares its name
+        NSString *value = nil;
+        if (needsValue || (isButton && [filterNames containsObject:desc])) {
+            value = [self valueOfElement:element];
+        }
+
+        // Skip filter buttons (they have values like "1 of 4", "2 of 4")
+        if (value && [value containsString:@" of "]) continue;
+
         WAChat *chat = [[WAChat alloc] init];
         chat.index = index++;
         chat.name = desc;
         chat.isSelected = isStaticText;  // Selected chat is rendered as static text
 
-        if (value) {
+        if (value && needsValue) {
             [self parseChatValue:value intoChat:chat];
         }
 
         [chats addObject:chat];
     }
     
+    if (fields & WAChatFieldName) {
+        [self.chatDirectory observeChats:chats];
+    }
+    if (needsValue) {
+        [self.prefetcher noteChatList:chats];  // Pinned/unread flags come from AXValue
+    }
+
     [WALogger debug:@"Found %lu chats", (unsigned long)chats.count];
     for(WAChat* chat in chats) {
         [WALogger debug:@"\t * %@", chat.name];
     }
     
-    CFRelease(tableView);
-    CFRelease(window);
     return chats;
 }
 
@@ -870,7 +1209,6 @@
         return nil;
     }
 
-    NSString *lowerName = [name lowercaseString];
     WAChat *foundChat = nil;
 
     // Find chat results in search (ChatListSearchView_ChatResult)
@@ -880,28 +1218,29 @@
 
     [WALogger debug:@"findChatInSearchResults: found %lu ChatResult elements", (unsigned long)chatResults.count];
 
+    NSMutableArray<NSString *> *chatNames = [NSMutableArray arrayWithCapacity:chatResults.count];
     NSInteger index = 0;
     for (id chatBtn in chatResults) {
-        AXUIElementRef button = (__bridge AXUIElementRef)chatBtn;
-        NSString *chatName = [self descriptionOfElement:button];
+        NSString *chatName = [self descriptionOfElement:(__bridge AXUIElementRef)chatBtn];
         [WALogger debug:@"  [%ld] chatName='%@'", (long)index, chatName ?: @"<nil>"];
-
-        if (chatName && [[chatName lowercaseString] containsString:lowerName]) {
-            foundChat = [[WAChat alloc] init];
-            foundChat.name = chatName;
-            foundChat.index = index;
-            foundChat.lastMessage = [self valueOfElement:button];
-            [WALogger info:@"findChatInSearchResults: FOUND '%@' at index %ld", chatName, (long)index];
-            break;
-        }
+        [chatNames addObject:chatName ?: @""];
         index++;
     }
 
-    // Release all elements
-    for (id btn in chatResults) {
-        CFRelease((__bridge AXUIElementRef)btn);
+    WAChatDirectory *directory = self.chatDirectory;
+    [directory addNames:chatNames];
+
+    // Take the best-ranked result, not the first substring hit
+    WAChatDirectoryMatch *match = [directory bestMatchForQuery:name amongNames:chatNames];
+    if (match) {
+        NSUInteger matchIndex = [chatNames indexOfObject:match.name];
+        foundChat = [[WAChat alloc] init];
+        foundChat.name = match.name;
+        foundChat.index = (NSInteger)matchIndex;
+        foundChat.lastMessage = [self valueOfElement:(__bridge AXUIElementRef)chatResults[matchIndex]];
+        [WALogger info:@"findChatInSearchResults: FOUND '%@' at index %lu", match.name, (unsigned long)matchIndex];
     }
-    CFRelease(window);
+
 
     if (!foundChat) {
         [WALogger debug:@"findChatInSearchResults: NOT FOUND"];
@@ -910,9 +1249,13 @@
 }
 
 - (WAChat *)findChatWithName:(NSString *)name {
+    return [self findChatWithName:name progress:nil];
+}
+
+- (WAChat *)findChatWithName:(NSString *)name progress:(WAProgressReporter *)progress {
     [WALogger info:@"findChatWithName: '%@'", name];
 
-    NSString *lowerName = [name lowercaseString];
+    WAChatDirectory *directory = self.chatDirectory;
 
     // Step 1: Check if we're in search mode
     BOOL inSearchMode = [self isInSearchMode];
@@ -924,28 +1267,40 @@
         WAChat *chat = [self findChatInSearchResults:name];
         if (chat) {
             [WALogger info:@"findChatWithName: found in search results: '%@'", chat.name];
+            [progress completeStage:@"Found in current search results" partial:@{@"chat": chat.name}];
             return chat;
         }
+        [progress completeStage:@"Not in current search results"];
         // If not found in current search results, clear search and try chat list
         [WALogger debug:@"findChatWithName: not in search results, clearing search"];
         [self clearSearch];
         [NSThread sleepForTimeInterval:0.3];
     }
 
-    // Step 2b: In chat list mode - search the visible chat list
+    // Step 2b: In chat list mode - rank the visible chat list
     [WALogger debug:@"findChatWithName: searching visible chat list"];
     NSArray<WAChat *> *chats = [self getRecentChats];
     [WALogger debug:@"findChatWithName: got %lu chats in list", (unsigned long)chats.count];
 
-    for (WAChat *chat in chats) {
-        if ([[chat.name lowercaseString] containsString:lowerName]) {
-            [WALogger info:@"findChatWithName: found in chat list: '%@'", chat.name];
-            return chat;
-        }
+    NSArray<NSString *> *visibleNames = [chats valueForKey:@"name"];
+    WAChatDirectoryMatch *visibleMatch = [directory bestMatchForQuery:name amongNames:visibleNames];
+
+    // The directory also knows chats that are scrolled off-screen or only in RAG
+    WAChatDirectoryMatch *knownMatch = [directory bestMatchForQuery:name];
+
+    // A visible chat wins unless the directory has a strictly better kind of match
+    if (visibleMatch && (!knownMatch || visibleMatch.kind <= knownMatch.kind)) {
+        WAChat *chat = chats[[visibleNames indexOfObject:visibleMatch.name]];
+        [WALogger info:@"findChatWithName: found in chat list: '%@'", chat.name];
+        [progress completeStage:@"Found in chat list" partial:@{@"chat": chat.name}];
+        return chat;
     }
+    [progress completeStage:[NSString stringWithFormat:@"Not among %lu visible chats, searching", (unsigned long)chats.count]];
 
-    // Step 3: Not found in current view - perform a search
-    [WALogger debug:@"findChatWithName: not found in chat list, performing search"];
+    // Step 3: Not found in current view - perform a search, with the precise
+    // full name when the directory resolved one (fewer, unambiguous results)
+    NSString *searchQuery = knownMatch ? knownMatch.name : name;
+    [WALogger debug:@"findChatWithName: not found in chat list, performing search for '%@'", searchQuery];
 
     pid_t waPid = self.whatsappPID;
     if (waPid == 0) {
@@ -964,7 +1319,6 @@
     if (clearButton) {
         [WALogger debug:@"findChatWithName: clearing existing search"];
         [self pressElement:clearButton];
-        CFRelease(clearButton);
         [NSThread sleepForTimeInterval:0.2];
     }
 
@@ -974,18 +1328,19 @@
     [NSThread sleepForTimeInterval:0.5];
 
     // Type the search query
-    [WALogger debug:@"findChatWithName: typing query '%@'", name];
-    [self typeString:name toProcess:waPid];
+    [WALogger debug:@"findChatWithName: typing query '%@'", searchQuery];
+    [self typeString:searchQuery toProcess:waPid];
     [NSThread sleepForTimeInterval:0.8];
+    [progress completeStage:[NSString stringWithFormat:@"Searched for '%@'", searchQuery]];
 
-    CFRelease(window);
 
     // Step 4: Find the chat in search results
     [WALogger debug:@"findChatWithName: looking in new search results"];
-    WAChat *foundChat = [self findChatInSearchResults:name];
+    WAChat *foundChat = [self findChatInSearchResults:searchQuery];
 
     if (foundChat) {
         [WALogger info:@"findChatWithName: found after search: '%@'", foundChat.name];
+        [progress completeStage:@"Found in search results" partial:@{@"chat": foundChat.name}];
     } else {
         [WALogger warn:@"findChatWithName: NOT FOUND anywhere for '%@'", name];
     }
@@ -1016,20 +1371,25 @@
         } maxDepth:15];
 
         if (buttons.count > 0) {
+            // Prefer the exact name so "Igor" doesn't open "Igor Berezovsky"
+            AXUIElementRef target = (__bridge AXUIElementRef)buttons[0];
+            for (id btn in buttons) {
+                if ([[self descriptionOfElement:(__bridge AXUIElementRef)btn] isEqualToString:chat.name]) {
+                    target = (__bridge AXUIElementRef)btn;
+                    break;
+                }
+            }
             // Scroll element into view before pressing (fixes issue with edge elements)
-            AXUIElementPerformAction((__bridge AXUIElementRef)buttons[0], CFSTR("AXScrollToVisible"));
-            result = [self pressElement:(__bridge AXUIElementRef)buttons[0]];
-        }
-
-        for (id btn in buttons) {
-            CFRelease((__bridge AXUIElementRef)btn);
+            AXUIElementPerformAction(target, CFSTR("AXScrollToVisible"));
+            result = [self pressElement:target];
         }
     } else {
         // In normal chat list mode - find ChatListView_TableView and look for button
         AXUIElementRef tableView = [self findElementWithIdentifier:@"ChatListView_TableView" inElement:window];
         if (tableView) {
             NSArray *children = [self childrenOfElement:tableView];
-            
+            AXUIElementRef target = NULL;
+
             for (id child in children) {
                 AXUIElementRef element = (__bridge AXUIElementRef)child;
 
@@ -1037,31 +1397,50 @@
                 if (![role isEqualToString:@"AXButton"]) continue;
 
                 NSString *desc = [self descriptionOfElement:element];
-                if (desc && [[desc lowercaseString] containsString:[chat.name lowercaseString]]) {
-                    // Scroll element into view before pressing (fixes issue with edge elements)
-                    AXUIElementPerformAction(element, CFSTR("AXScrollToVisible"));
-                    result = [self pressElement:element];
+                if ([desc isEqualToString:chat.name]) {
+                    target = element;
                     break;
                 }
+                // Fall back to the first partial match if no exact one is visible
+                if (!target && desc && [[desc lowercaseString] containsString:[chat.name lowercaseString]]) {
+                    target = element;
+                }
+            }
+
+            if (target) {
+                // Scroll element into view before pressing (fixes issue with edge elements)
+                AXUIElementPerformAction(target, CFSTR("AXScrollToVisible"));
+                result = [self pressElement:target];
             }
             
-            CFRelease(tableView);
         }
     }
     
-    CFRelease(window);
     return result;
 }
 
 
 - (BOOL)openChatWithName:(NSString *)name {
-    WAChat *chat = [self findChatWithName:name];
+    return [self openChatWithName:name progress:nil];
+}
+
+- (BOOL)openChatWithName:(NSString *)name progress:(WAProgressReporter *)progress {
+    WAChat *chat = [self findChatWithName:name progress:progress];
     if (!chat) return NO;
-    return [self openChat:chat];
+    BOOL opened = [self openChat:chat];
+    if (opened) {
+        [progress completeStage:[NSString stringWithFormat:@"Opened '%@'", chat.name]];
+    }
+    return opened;
 }
 
 - (NSArray<WAChat *> *)scrollChatListDown {
+    return [self scrollChatListDownWithProgress:nil];
+}
+
+- (NSArray<WAChat *> *)scrollChatListDownWithProgress:(WAProgressReporter *)progress {
     [WALogger info:@"scrollChatListDown"];
+    progress.totalStages = 3;
 
     AXUIElementRef window = [self getMainWindow];
     if (!window) {
@@ -1079,7 +1458,6 @@
     pid_t waPid = self.whatsappPID;
     if (waPid == 0) {
         [WALogger warn:@"scrollChatListDown: no WhatsApp PID"];
-        CFRelease(window);
         return @[];
     }
 
@@ -1091,7 +1469,6 @@
     NSArray<WAChat *> *currentChats = [self getRecentChats];
     if (currentChats.count == 0) {
         [WALogger warn:@"scrollChatListDown: no chats visible"];
-        CFRelease(window);
         return @[];
     }
 
@@ -1099,9 +1476,12 @@
     WAChat *lastChat = [currentChats lastObject];
     [WALogger debug:@"scrollChatListDown: opening last chat: %@", lastChat.name];
 
+    [progress completeStage:[NSString stringWithFormat:@"Read %lu visible chats", (unsigned long)currentChats.count]];
+
     // Use openChat (AXPress) to open the chat
     [self openChat:lastChat];
     [NSThread sleepForTimeInterval:0.3];
+    [progress completeStage:[NSString stringWithFormat:@"Selected '%@'", lastChat.name]];
 
     // Press Command+Shift+] for "Next Chat" ONCE
     // ] = keycode 30
@@ -1111,13 +1491,18 @@
     // Get the new list of visible chats
     NSArray<WAChat *> *newChats = [self getRecentChats];
     [WALogger info:@"scrollChatListDown: now showing %ld chats", (long)newChats.count];
+    [progress completeStage:[NSString stringWithFormat:@"Scrolled, %ld chats visible", (long)newChats.count]];
 
-    CFRelease(window);
     return newChats;
 }
 
 - (NSArray<WAChat *> *)scrollChatListUp {
+    return [self scrollChatListUpWithProgress:nil];
+}
+
+- (NSArray<WAChat *> *)scrollChatListUpWithProgress:(WAProgressReporter *)progress {
     [WALogger info:@"scrollChatListUp"];
+    progress.totalStages = 3;
 
     AXUIElementRef window = [self getMainWindow];
     if (!window) {
@@ -1135,7 +1520,6 @@
     pid_t waPid = self.whatsappPID;
     if (waPid == 0) {
         [WALogger warn:@"scrollChatListUp: no WhatsApp PID"];
-        CFRelease(window);
         return @[];
     }
 
@@ -1147,7 +1531,6 @@
     NSArray<WAChat *> *currentChats = [self getRecentChats];
     if (currentChats.count == 0) {
         [WALogger warn:@"scrollChatListUp: no chats visible"];
-        CFRelease(window);
         return @[];
     }
 
@@ -1155,9 +1538,12 @@
     WAChat *firstChat = [currentChats firstObject];
     [WALogger debug:@"scrollChatListUp: opening first chat: %@", firstChat.name];
 
+    [progress completeStage:[NSString stringWithFormat:@"Read %lu visible chats", (unsigned long)currentChats.count]];
+
     // Use openChat (AXPress) to open the chat
     [self openChat:firstChat];
     [NSThread sleepForTimeInterval:0.3];
+    [progress completeStage:[NSString stringWithFormat:@"Selected '%@'", firstChat.name]];
 
     // Press Command+Shift+[ for "Previous Chat" ONCE
     // [ = keycode 33
@@ -1167,14 +1553,19 @@
     // Get the new list of visible chats
     NSArray<WAChat *> *newChats = [self getRecentChats];
     [WALogger info:@"scrollChatListUp: now showing %ld chats", (long)newChats.count];
+    [progress completeStage:[NSString stringWithFormat:@"Scrolled, %ld chats visible", (long)newChats.count]];
 
-    CFRelease(window);
     return newChats;
 }
 
 #pragma mark - Current Chat
 
 - (WACurrentChat *)getCurrentChat
+{
+    return [self getCurrentChatSince:nil];
+}
+
+- (WACurrentChat *)getCurrentChatSince:(NSString *)since
 {
     AXUIElementRef window = [self getMainWindow];
     if (!window) return nil;
@@ -1188,13 +1579,21 @@
         // Name is in description, "last seen" status is in value
         currentChat.name = [self descriptionOfElement:chatHeader];
         currentChat.lastSeen = [self valueOfElement:chatHeader];
-        CFRelease(chatHeader);
     }
     
     // Get messages
-    currentChat.messages = [self getMessages];
+    if (since.length > 0) {
+        BOOL found = NO;
+        currentChat.messages = [self getMessagesWithLimit:50 fields:WAMessageFieldAll since:since watermarkFound:&found];
+        currentChat.watermarkFound = @(found);
+    } else {
+        currentChat.messages = [self getMessages];
+    }
     
-    CFRelease(window);
+
+    if (currentChat.name.length > 0) {
+        [self.localRetriever addMessages:currentChat.messages chatName:currentChat.name];
+    }
     
     // Return nil if no chat is open (no name and no messages)
     if (!currentChat.name && currentChat.messages.count == 0) {
@@ -1204,65 +1603,274 @@
     return currentChat;
 }
 
+- (NSString *)currentChatName
+{
+    AXUIElementRef window = [self getMainWindow];
+    if (!window) return nil;
+
+    NSString *name = nil;
+    AXUIElementRef chatHeader = [self findElementWithIdentifier:@"NavigationBar_HeaderViewButton" inElement:window];
+    if (chatHeader) {
+        name = [self descriptionOfElement:chatHeader];
+    }
+
+    return name.length > 0 ? name : nil;
+}
+
+- (NSString *)openChatWithName:(NSString *)name settleTimeout:(NSTimeInterval)timeout
+{
+    NSString *previous = [self currentChatName];
+    if (previous && [previous caseInsensitiveCompare:name] == NSOrderedSame) return previous;
+    if (![self openChatWithName:name]) return nil;
+
+    // Poll the header instead of sleeping a fixed time
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:timeout];
+    do {
+        NSString *opened = [self currentChatName];
+        if (opened && ![opened isEqualToString:previous ?: @""]) return opened;
+        [NSThread sleepForTimeInterval:0.1];
+    } while ([deadline timeIntervalSinceNow] > 0);
+
+    // An unchanged header is only fine if the open chat was the target all along
+    if (previous && [WAAccessibility chatHeader:previous namesChat:name]) return previous;
+    return nil;
+}
+
++ (BOOL)chatHeader:(NSString *)header namesChat:(NSString *)name {
+    if (header.length == 0 || name.length == 0) return NO;
+    if ([header rangeOfString:name options:NSCaseInsensitiveSearch].location != NSNotFound) return YES;
+    return [WAChatDirectory matchOfName:header toQuery:name] != nil;
+}
+
+- (NSString *)latestMessageFingerprint
+{
+    AXUIElementRef window = [self getMainWindow];
+    if (!window) return nil;
+    AXUIElementRef messagesTable = [self findElementWithIdentifier:@"ChatMessagesTableView" inElement:window];
+    if (!messagesTable) {
+        return nil;
+    }
+
+    NSString *fingerprint = nil;
+    NSArray *rows = [self childrenOfElement:messagesTable];
+    for (NSInteger i = (NSInteger)rows.count - 1; i >= 0 && !fingerprint; i--) {
+        WAMessage *message = [self messageFromRow:(__bridge AXUIElementRef)rows[i] fields:kFingerprintFields];
+        if (!message) continue;
+        NSArray<WAMessage *> *above = [self sameMinuteMessagesAboveRow:i inRows:rows message:message fields:kFingerprintFields];
+        fingerprint = WAMessageFingerprint(message, above);
+    }
+
+    return fingerprint;
+}
+
+- (NSString *)composerText
+{
+    AXUIElementRef window = [self getMainWindow];
+    if (!window) return nil;
+    AXUIElementRef composeArea = [self findElementWithIdentifier:@"ChatBar_ComposerTextView" inElement:window];
+    NSString *text = composeArea ? [self valueOfElement:composeArea] : nil;
+    return text;
+}
+
+- (NSArray<WAMessage *> *)getMessagesWithLimit:(NSInteger)limit
+{
+    return [self getMessagesWithLimit:limit fields:WAMessageFieldAll since:nil];
+}
+
+/// Minutes since midnight for an "HH:MM" timestamp, or -1 if it doesn't parse
+- (NSInteger)minutesFromTimestamp:(NSString *)timestamp {
+    NSArray<NSString *> *parts = [timestamp componentsSeparatedByString:@":"];
+    if (parts.count != 2) return -1;
+    NSInteger hours = parts[0].integerValue;
+    NSInteger minutes = parts[1].integerValue;
+    if (hours < 0 || hours > 23 || minutes < 0 || minutes > 59) return -1;
+    return hours * 60 + minutes;
+}
+
+- (NSArray<WAMessage *> *)getMessagesWithLimit:(NSInteger)limit
+                                        fields:(WAMessageField)fields
+                                         since:(NSString *)since
+{
+    return [self getMessagesWithLimit:limit fields:fields since:since watermarkFound:NULL];
+}
+
 - (NSArray<WAMessage *> *)getMessagesWithLimit:(NSInteger)limit
+                                        fields:(WAMessageField)fields
+                                         since:(NSString *)since
+                                watermarkFound:(BOOL *)watermarkFound
 {
+    NSString *watermarkDigest = nil;
+    NSUInteger watermarkOrdinal = 0;
+    BOOL isWatermark = WAParseFingerprint(since, &watermarkDigest, &watermarkOrdinal);
+    NSInteger sinceMinutes = (since.length > 0 && !isWatermark) ? [self minutesFromTimestamp:since] : -1;
+
+    WAMessageField parseFields = fields;
+    if (sinceMinutes >= 0) {
+        parseFields |= WAMessageFieldTimestamp;  // Needed for the lower bound even if not returned
+    }
+    if (isWatermark || (fields & WAMessageFieldFingerprint)) {
+        parseFields |= kFingerprintFields;
+    }
+    if (watermarkFound) *watermarkFound = NO;
+
     AXUIElementRef window = [self getMainWindow];
     if (!window) return @[];
     
-    NSMutableArray<WAMessage *> *messages = [NSMutableArray array];
-    
     // Find the messages table - it's ChatMessagesTableView
     AXUIElementRef messagesTable = [self findElementWithIdentifier:@"ChatMessagesTableView" inElement:window];
     
     if (!messagesTable) {
         [WALogger debug:@"getMessages: ChatMessagesTableView not found"];
-        CFRelease(window);
         return @[];
     }
     
     // Get direct children of the messages table
     NSArray *children = [self childrenOfElement:messagesTable];
-    
-    NSInteger count = 0;
-    for (id child in children) {
-        if (count >= limit) break;
-        
-        AXUIElementRef element = (__bridge AXUIElementRef)child;
-        NSString *identifier = [self identifierOfElement:element];
-        
-        // Message cells have id WAMessageBubbleTableViewCell
-        if (![identifier isEqualToString:@"WAMessageBubbleTableViewCell"]) {
-            continue;
+    NSMutableArray<WAMessage *> *messages = [NSMutableArray array];
+    NSArray<WAMessage *> *messagesAbove = @[];
+
+    if (isWatermark) {
+        BOOL found = NO;
+        messages = [[self messagesInRows:children
+                    newerThanDigest:watermarkDigest
+                            ordinal:watermarkOrdinal
+                             fields:parseFields
+                              found:&found
+                      messagesAbove:&messagesAbove] mutableCopy];
+        if (watermarkFound) *watermarkFound = found;
+        // Oldest first, so the last returned fingerprint continues where this page stops
+        if ((NSInteger)messages.count > limit) {
+            [messages removeObjectsInRange:NSMakeRange(limit, messages.count - limit)];
         }
-        
-        // The actual message content is in an AXGenericElement child
-        NSArray *cellChildren = [self childrenOfElement:element];
-        for (id cellChild in cellChildren) {
-            AXUIElementRef contentElement = (__bridge AXUIElementRef)cellChild;
-            NSString *role = [self roleOfElement:contentElement];
-            
-            // Look for AXGenericElement which contains the message description
-            if ([role isEqualToString:@"AXGenericElement"]) {
-                NSString *desc = [self descriptionOfElement:contentElement];
-                if (desc && desc.length > 0) {
-                    WAMessage *message = [self parseMessageDescription:desc];
-                    if (message && message.text.length > 0) {
-                        [messages addObject:message];
-                        count++;
-                    }
-                }
-                break; // Only one content element per cell
-            }
+    } else if (sinceMinutes >= 0) {
+        // The bound needs the newest message, so every row is parsed
+        NSMutableArray<WAMessage *> *all = [NSMutableArray array];
+        for (id child in children) {
+            WAMessage *message = [self messageFromRow:(__bridge AXUIElementRef)child fields:parseFields];
+            if (message) [all addObject:message];
         }
+        NSUInteger first = [self indexOfFirstMessage:all since:sinceMinutes];
+        NSUInteger count = MIN(all.count - first, (NSUInteger)MAX(limit, 0));
+        [messages addObjectsFromArray:[all subarrayWithRange:NSMakeRange(first, count)]];
+    } else {
+        for (id child in children) {
+            if ((NSInteger)messages.count >= limit) break;
+
+            WAMessage *message = [self messageFromRow:(__bridge AXUIElementRef)child fields:parseFields];
+            if (message) [messages addObject:message];
+        }
+    }
+
+    if (parseFields & kFingerprintFields) {
+        [self assignFingerprintsToMessages:messages messagesAbove:messagesAbove];
     }
     
     [WALogger debug:@"getMessages: found %lu messages", (unsigned long)messages.count];
     
-    CFRelease(messagesTable);
-    CFRelease(window);
     return messages;
 }
 
+/// Index of the oldest message at or after the most recent occurrence of the
+/// HH:MM bound (messages.count if none). Read from the bottom up: when the
+/// newest message is earlier in the day than the bound, the bound was
+/// yesterday, so today's messages and yesterday's after the bound are kept
+/// until a message before the bound. Messages without a timestamp don't move it.
+- (NSUInteger)indexOfFirstMessage:(NSArray<WAMessage *> *)messages since:(NSInteger)sinceMinutes {
+    NSInteger newestMinutes = -1;
+    for (WAMessage *message in messages.reverseObjectEnumerator) {
+        newestMinutes = message.timestamp ? [self minutesFromTimestamp:message.timestamp] : -1;
+        if (newestMinutes >= 0) break;
+    }
+    BOOL afterMidnight = newestMinutes >= 0 && newestMinutes < sinceMinutes;
+
+    NSUInteger first = messages.count;
+    for (NSInteger i = (NSInteger)messages.count - 1; i >= 0; i--) {
+        NSInteger minutes = messages[i].timestamp ? [self minutesFromTimestamp:messages[i].timestamp] : -1;
+        if (minutes >= 0) {
+            if (afterMidnight && minutes >= sinceMinutes) {
+                afterMidnight = NO;  // Crossed back into the bound's day
+            } else if (!afterMidnight && minutes < sinceMinutes) {
+                break;
+            }
+        }
+        first = (NSUInteger)i;
+    }
+    return first;
+}
+
+/// Parsed message of one ChatMessagesTableView row, or nil for non-message rows.
+/// One batched fetch per visited node; fields decide how much of the cell is visited.
+- (WAMessage *)messageFromRow:(AXUIElementRef)element fields:(WAMessageField)fields {
+    if (!self.cellDecoder) {
+        self.cellDecoder = [[WAMessageCellDecoder alloc] initWithSource:[self elementProvider]];
+    }
+    return [self.cellDecoder messageFromCell:(__bridge id)element fields:fields];
+}
+
+/// Messages below the watermark row, oldest first. Rows are parsed from the
+/// bottom up and the walk stops at the watermark, so a follow-up read costs only
+/// the new rows. messagesAbove receives the watermark and the same-minute
+/// messages above it, which the new rows' ordinals build on. If the watermark
+/// isn't among the loaded rows every row is returned.
+- (NSArray<WAMessage *> *)messagesInRows:(NSArray *)rows
+                         newerThanDigest:(NSString *)watermarkDigest
+                                 ordinal:(NSUInteger)watermarkOrdinal
+                                  fields:(WAMessageField)fields
+                                   found:(BOOL *)found
+                           messagesAbove:(NSArray<WAMessage *> **)messagesAbove
+{
+    NSMutableArray<WAMessage *> *newer = [NSMutableArray array];
+    *found = NO;
+    *messagesAbove = @[];
+
+    for (NSInteger i = (NSInteger)rows.count - 1; i >= 0; i--) {
+        WAMessage *message = [self messageFromRow:(__bridge AXUIElementRef)rows[i] fields:fields];
+        if (!message) continue;
+
+        NSString *digest = WAMessageDigest(message);
+        if ([digest isEqualToString:watermarkDigest]) {
+            NSArray<WAMessage *> *above = [self sameMinuteMessagesAboveRow:i inRows:rows message:message fields:fields];
+            if (WAFingerprintOrdinal(digest, message, above) == watermarkOrdinal) {
+                *messagesAbove = [above arrayByAddingObject:message];
+                *found = YES;
+                break;
+            }
+        }
+        [newer insertObject:message atIndex:0];
+    }
+
+    [WALogger debug:@"getMessages: watermark %@, %lu newer of %lu rows",
+        *found ? @"found" : @"not loaded", (unsigned long)newer.count, (unsigned long)rows.count];
+    return newer;
+}
+
+/// The run of same-minute messages directly above row index, oldest first;
+/// all that WAFingerprintOrdinal looks at, so rows past it aren't parsed
+- (NSArray<WAMessage *> *)sameMinuteMessagesAboveRow:(NSInteger)index
+                                              inRows:(NSArray *)rows
+                                             message:(WAMessage *)message
+                                              fields:(WAMessageField)fields
+{
+    NSMutableArray<WAMessage *> *above = [NSMutableArray array];
+    for (NSInteger j = index - 1; j >= 0; j--) {
+        WAMessage *previous = [self messageFromRow:(__bridge AXUIElementRef)rows[j] fields:fields];
+        if (!previous) continue;
+        if (!WASameTimestamp(previous.timestamp, message.timestamp)) break;
+        [above insertObject:previous atIndex:0];
+    }
+    return above;
+}
+
+/// Fingerprint each message in order (messagesAbove covers the rows above the
+/// first message that matter)
+- (void)assignFingerprintsToMessages:(NSArray<WAMessage *> *)messages messagesAbove:(NSArray<WAMessage *> *)messagesAbove {
+    NSMutableArray<WAMessage *> *above = [messagesAbove mutableCopy];
+    for (WAMessage *message in messages) {
+        message.fingerprint = WAMessageFingerprint(message, above);
+        [above addObject:message];
+    }
+}
+
 
 - (NSArray<WAMessage *> *)getMessages {
     return [self getMessagesWithLimit:50];
@@ -1270,85 +1878,21 @@
 
 
 - (WAMessage *)parseMessageDescription:(NSString *)desc {
-    // Format examples:
-    // "message, text here, 11:15, Received from Igor Berezovsky"
-    // "Your message, text here, 11:14, Sent to Igor Berezovsky, Red"
-    // "Replying to Igor Berezovsky.\nmessage, да, теперь стартует! 👍, 12:22, Received from Igor"
-    // "Replying to You.\nmessage, форварднул, 12:23, Received from Igor Berezovsky"
-    
-    WAMessage *message = [[WAMessage alloc] init];
-    
-    // Check for reply
-    if ([desc hasPrefix:@"Replying to "]) {
-        NSRange newlineRange = [desc rangeOfString:@"\n"];
-        if (newlineRange.location != NSNotFound) {
-            NSString *replyPart = [desc substringToIndex:newlineRange.location];
-            // Extract who they're replying to
-            NSString *replyTo = [[replyPart stringByReplacingOccurrencesOfString:@"Replying to " withString:@""] 
-                                stringByReplacingOccurrencesOfString:@"." withString:@""];
-            message.replyTo = replyTo;
-            
-            // Continue parsing the rest
-            desc = [desc substringFromIndex:newlineRange.location + 1];
-        }
-    }
-    
-    // Determine direction
-    if ([desc hasPrefix:@"Your message, "]) {
-        message.direction = WAMessageDirectionOutgoing;
-        desc = [desc substringFromIndex:14]; // Remove "Your message, "
-    } else if ([desc hasPrefix:@"message, "]) {
-        message.direction = WAMessageDirectionIncoming;
-        desc = [desc substringFromIndex:9]; // Remove "message, "
-    } else {
-        // System message or unknown format
-        message.direction = WAMessageDirectionSystem;
-        message.text = desc;
-        return message;
-    }
-    
-    // Now parse: "text, timestamp, Received from/Sent to Name"
-    // This is tricky because text itself may contain commas
-    
-    // Find timestamp pattern (HH:MM)
-    NSRegularExpression *timeRegex = [NSRegularExpression regularExpressionWithPattern:@", (\\d{1,2}:\\d{2}), " options:0 error:nil];
-    NSTextCheckingResult *timeMatch = [timeRegex firstMatchInString:desc options:0 range:NSMakeRange(0, desc.length)];
-    
-    if (timeMatch && timeMatch.numberOfRanges >= 2) {
-        // Extract timestamp
-        message.timestamp = [desc substringWithRange:[timeMatch rangeAtIndex:1]];
-        
-        // Text is everything before the timestamp
-        NSRange beforeTime = NSMakeRange(0, timeMatch.range.location);
-        message.text = [desc substringWithRange:beforeTime];
-        
-        // After timestamp is sender/recipient info
-        NSUInteger afterTimeStart = timeMatch.range.location + timeMatch.range.length;
-        NSString *afterTime = [desc substringFromIndex:afterTimeStart];
-        
-        if ([afterTime hasPrefix:@"Received from "]) {
-            NSString *sender = [afterTime stringByReplacingOccurrencesOfString:@"Received from " withString:@""];
-            // May have trailing info, find comma
-            NSRange commaRange = [sender rangeOfString:@", "];
-            if (commaRange.location != NSNotFound) {
-                sender = [sender substringToIndex:commaRange.location];
-            }
-            message.sender = sender;
-        } else if ([afterTime hasPrefix:@"Sent to "]) {
-            // Check for read status
-            message.isRead = ![afterTime containsString:@"Red"]; // "Red" likely means "not read" indicator
-        }
-    } else {
-        // Fallback - just use the whole thing as text
-        message.text = desc;
-    }
-    
-    return message;
+    return [WAMessageCellDecoder messageFromDescription:desc fields:WAMessageFieldAll];
 }
 
 #pragma mark - Keyboard Simulation
 
 - (void)pasteString:(NSString *)string {
+    [WAClipboardLock() lock];
+    @try {
+        [self pasteStringHoldingClipboard:string];
+    } @finally {
+        [WAClipboardLock() unlock];
+    }
+}
+
+- (void)pasteStringHoldingClipboard:(NSString *)string {
     // Save current clipboard contents
     NSPasteboard *pasteboard = [NSPasteboard generalPasteboard];
     NSArray *previousContents = [pasteboard readObjectsForClasses:@[[NSString class]] options:nil];
@@ -1420,6 +1964,15 @@
 }
 
 - (void)typeStringViaClipboard:(NSString *)string toProcess:(pid_t)pid {
+    [WAClipboardLock() lock];
+    @try {
+        [self typeStringViaClipboardHoldingClipboard:string toProcess:pid];
+    } @finally {
+        [WAClipboardLock() unlock];
+    }
+}
+
+- (void)typeStringViaClipboardHoldingClipboard:(NSString *)string toProcess:(pid_t)pid {
     // Save current clipboard
     NSPasteboard *pb = [NSPasteboard generalPasteboard];
 //    NSArray *oldContents = [pb readObjectsForClasses:@[[NSString class], [NSImage class]] options:nil];
@@ -1486,6 +2039,10 @@
 #pragma mark - Global Search
 
 - (WASearchResults *)globalSearch:(NSString *)query {
+    return [self globalSearch:query progress:nil];
+}
+
+- (WASearchResults *)globalSearch:(NSString *)query progress:(WAProgressReporter *)progress {
     if (!query || query.length == 0) return nil;
     
     AXUIElementRef window = [self getMainWindow];
@@ -1498,13 +2055,11 @@
     
     NSMutableArray<WASearchChatResult *> *chatMatches = [NSMutableArray array];
     NSMutableArray<WASearchMessageResult *> *messageMatches = [NSMutableArray array];
-    NSMutableArray *allFoundElements = [NSMutableArray array]; // Track for cleanup
     
     @try {
         // Get WhatsApp's PID for targeted key events (no focus stealing!)
         pid_t waPid = self.whatsappPID;
         if (waPid == 0) {
-            CFRelease(window);
             return results;
         }
         
@@ -1512,19 +2067,19 @@
         AXUIElementRef clearButton = [self findElementWithIdentifier:@"TokenizedSearchBar_DeleteButton" inElement:window];
         if (clearButton) {
             [self pressElement:clearButton];
-            CFRelease(clearButton);
             [NSThread sleepForTimeInterval:0.2];
         }
         
         // 2. Press Cmd+F to open search (sent directly to WhatsApp)
         [self pressKey:3 withFlags:kCGEventFlagMaskCommand toProcess:waPid];  // F
         [NSThread sleepForTimeInterval:0.5];
+        [progress completeStage:@"Search opened"];
         
         // 3. Type query character by character (clipboard paste causes duplication)
         [self typeString:query toProcess:waPid];
+        [progress completeStage:[NSString stringWithFormat:@"Typed '%@'", query]];
         
         // Re-get window
-        CFRelease(window);
         window = [self getMainWindow];
         if (!window) return results;
         
@@ -1532,7 +2087,6 @@
         [NSThread sleepForTimeInterval:0.8];
         
         // Re-get window to refresh element tree
-        CFRelease(window);
         window = [self getMainWindow];
         if (!window) return results;
         
@@ -1544,7 +2098,6 @@
         NSArray *chatResults = [self findElementsIn:window predicate:^BOOL(AXUIElementRef element, NSString *role, NSString *identifier) {
             return [identifier isEqualToString:@"ChatListSearchView_ChatResult"];
         } maxDepth:15];
-        [allFoundElements addObjectsFromArray:chatResults];
         
         for (id chatBtn in chatResults) {
             AXUIElementRef button = (__bridge AXUIElementRef)chatBtn;
@@ -1563,11 +2116,26 @@
             [chatMatches addObject:chatResult];
         }
         
+        // Chat-name matches are complete; hand them out before parsing messages
+        if (progress) {
+            NSMutableArray *chatDicts = [NSMutableArray arrayWithCapacity:chatMatches.count];
+            for (WASearchChatResult *chatResult in chatMatches) {
+                [chatDicts addObject:[chatResult toDictionary]];
+            }
+            [progress completeStage:[NSString stringWithFormat:@"Found %lu chat matches", (unsigned long)chatMatches.count]
+                            partial:@{@"query": query, @"chat_matches": chatDicts}];
+        }
+        
         // 2. Find message matches (ChatListSearchView_MessageResult)
         NSArray *messageResults = [self findElementsIn:window predicate:^BOOL(AXUIElementRef element, NSString *role, NSString *identifier) {
             return [identifier isEqualToString:@"ChatListSearchView_MessageResult"];
         } maxDepth:15];
-        [allFoundElements addObjectsFromArray:messageResults];
+        
+        // From here the number of stages is known: one per chunk of message groups
+        NSUInteger chunkSize = kSearchProgressChunk;
+        progress.totalStages = progress.completedStages + MAX((messageResults.count + chunkSize - 1) / chunkSize, 1);
+        NSUInteger reportedMatches = 0;
+        NSUInteger groupIndex = 0;
         
         for (id msgGroup in messageResults) {
             AXUIElementRef group = (__bridge AXUIElementRef)msgGroup;
@@ -1577,7 +2145,6 @@
             NSArray *textElements = [self findElementsIn:group predicate:^BOOL(AXUIElementRef element, NSString *role, NSString *identifier) {
                 return [role isEqualToString:@"AXStaticText"];
             } maxDepth:3];
-            [allFoundElements addObjectsFromArray:textElements];
             
             for (id textElem in textElements) {
                 AXUIElementRef staticText = (__bridge AXUIElementRef)textElem;
@@ -1594,23 +2161,35 @@
                     [messageMatches addObject:msgResult];
                 }
             }
+            
+            groupIndex++;
+            if (progress && (groupIndex % chunkSize == 0 || groupIndex == messageResults.count)) {
+                NSMutableArray *newMatches = [NSMutableArray array];
+                for (NSUInteger i = reportedMatches; i < messageMatches.count; i++) {
+                    [newMatches addObject:[messageMatches[i] toDictionary]];
+                }
+                reportedMatches = messageMatches.count;
+                [progress completeStage:[NSString stringWithFormat:@"Parsed %lu of %lu message results",
+                                         (unsigned long)groupIndex, (unsigned long)messageResults.count]
+                                partial:@{@"query": query, @"message_matches": newMatches}];
+            }
+        }
+        if (progress && messageResults.count == 0) {
+            [progress completeStage:@"No message results"];
         }
         
         results.chatMatches = chatMatches;
         results.messageMatches = messageMatches;
+
+        // Message previews feed the offline retriever used when RAG is unavailable
+        [self.localRetriever addSearchMatches:messageMatches];
+        [self.prefetcher noteSearchResults:results];
         
     } @catch (NSException *exception) {
         NSLog(@"WAAccessibility: Exception in globalSearch: %@", exception);
     }
     
-    // Release all found elements
-    for (id elem in allFoundElements) {
-        if (elem && elem != [NSNull null]) {
-            CFRelease((__bridge AXUIElementRef)elem);
-        }
-    }
-    
-    CFRelease(window);
+    // Found elements belong to the arena
     return results;
 }
 
@@ -1660,7 +2239,6 @@
     AXUIElementRef clearButton = [self findElementWithIdentifier:@"TokenizedSearchBar_DeleteButton" inElement:window];
     if (clearButton) {
         result = [self pressElement:clearButton];
-        CFRelease(clearButton);
     } else {
         // Fallback: press Escape key to clear search (no focus stealing)
         pid_t waPid = self.whatsappPID;
@@ -1670,7 +2248,6 @@
         }
     }
     
-    CFRelease(window);
     return result;
 }
 
@@ -1682,14 +2259,12 @@
     
     pid_t waPid = self.whatsappPID;
     if (waPid == 0) {
-        CFRelease(window);
         return NO;
     }
     
     // Find the compose text area
     AXUIElementRef composeArea = [self findElementWithIdentifier:@"ChatBar_ComposerTextView" inElement:window];
     if (!composeArea) {
-        CFRelease(window);
         return NO;
     }
     
@@ -1699,16 +2274,17 @@
     
     // Set the text value
     if (![self setValueOfElement:composeArea to:message]) {
-        CFRelease(composeArea);
-        CFRelease(window);
         return NO;
     }
     
     // Send Enter key directly to WhatsApp (no focus stealing)
     [self pressKey:36 withFlags:0 toProcess:waPid];  // 36 = Return key
     
-    CFRelease(composeArea);
-    CFRelease(window);
+
+    // A prefetched copy of this chat no longer ends with the latest message
+    if (self.prefetcher.entryCount > 0) {
+        [self.prefetcher invalidateChat:[self currentChatName]];
+    }
     return YES;
 }
 
@@ -1718,7 +2294,6 @@
     
     pid_t waPid = self.whatsappPID;
     if (waPid == 0) {
-        CFRelease(window);
         return NO;
     }
     
@@ -1729,7 +2304,6 @@
     // Type the query
     [self typeString:query toProcess:waPid];
     
-    CFRelease(window);
     return YES;
 }
 
@@ -1743,10 +2317,8 @@
     AXUIElementRef button = [self findElementWithIdentifier:identifier inElement:window];
     if (button) {
         result = [self pressElement:button];
-        CFRelease(button);
     }
 
-    CFRelease(window);
     return result;
 }
 
@@ -1770,15 +2342,8 @@
         if (buttons.count > 0) {
             result = [self pressElement:(__bridge AXUIElementRef)buttons[0]];
         }
-
-        // Release all found elements
-        for (id btn in buttons) {
-            CFRelease((__bridge AXUIElementRef)btn);
-        }
-        CFRelease(sidebar);
     }
 
-    CFRelease(window);
     return result;
 }
 
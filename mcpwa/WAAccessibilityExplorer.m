@@ -11,6 +11,8 @@
 //
 
 #import "WAAccessibilityExplorer.h"
+#import "WAAXTreeWalker.h"
+#import "WAAXElementProvider.h"
 #import <ApplicationServices/ApplicationServices.h>
 
 @implementation WAAccessibilityExplorer
@@ -88,16 +90,12 @@ static NSFileHandle *outputHandle = nil;
 
 #pragma mark - Tree Walking
 
-+ (void)printElement:(AXUIElementRef)element depth:(int)depth {
-    NSString *indent = [@"" stringByPaddingToLength:depth * 2 withString:@" " startingAtIndex:0];
-    
-    NSString *role = [self roleOfElement:element];
++ (NSString *)describeElement:(AXUIElementRef)element role:(NSString *)role childCount:(NSUInteger)childCount {
     NSString *subrole = [self subroleOfElement:element];
     NSString *title = [self titleOfElement:element];
     NSString *desc = [self descriptionOfElement:element];
     id  value = [self valueOfElement:element];
     NSString *identifier = [self identifierOfElement:element];
-    NSArray *children = [self childrenOfElement:element];
     
     NSMutableArray *parts = [NSMutableArray arrayWithObject:role];
     
@@ -120,29 +118,37 @@ static NSFileHandle *outputHandle = nil;
         }
         [parts addObject:[NSString stringWithFormat:@"val:\"%@\"", v]];
     }
-    [parts addObject:[NSString stringWithFormat:@"[%lu children]", (unsigned long)children.count]];
+    [parts addObject:[NSString stringWithFormat:@"[%lu children]", (unsigned long)childCount]];
     
-    [self log:@"%@%@", indent, [parts componentsJoinedByString:@" "]];
+    return [parts componentsJoinedByString:@" "];
 }
 
-+ (void)dumpTree:(AXUIElementRef)element maxDepth:(int)maxDepth {
-    [self walkElement:element depth:0 maxDepth:maxDepth];
++ (void)printElement:(AXUIElementRef)element depth:(int)depth {
+    NSString *indent = [@"" stringByPaddingToLength:depth * 2 withString:@" " startingAtIndex:0];
+    NSString *line = [self describeElement:element
+                                      role:[self roleOfElement:element]
+                                childCount:[self childrenOfElement:element].count];
+    [self log:@"%@%@", indent, line];
 }
 
-+ (void)walkElement:(AXUIElementRef)element depth:(int)depth maxDepth:(int)maxDepth {
-    if (depth >= maxDepth) {
-        NSString *indent = [@"" stringByPaddingToLength:depth * 2 withString:@" " startingAtIndex:0];
-        [self log:@"%@... (max depth)", indent];
-        return;
-    }
-    
-    [self printElement:element depth:depth];
-    
-    NSArray *children = [self childrenOfElement:element];
-    for (id child in children) {
-        AXUIElementRef childRef = (__bridge AXUIElementRef)child;
-        [self walkElement:childRef depth:depth + 1 maxDepth:maxDepth];
-    }
+/// Walker over live elements; dump lines use the describeElement: format
++ (WAAXTreeWalker *)walkerWithMaxDepth:(int)maxDepth {
+    WAAXElementProvider *provider = [[WAAXElementProvider alloc] init];
+    provider.lineFormatter = ^NSString *(id node, NSString *role, NSString *identifier, NSUInteger childCount) {
+        return [WAAccessibilityExplorer describeElement:(__bridge AXUIElementRef)node role:role childCount:childCount];
+    };
+    WAAXTreeWalker *walker = [[WAAXTreeWalker alloc] initWithProvider:provider];
+    walker.maxDepth = (NSUInteger)MAX(maxDepth, 0);
+    return walker;
+}
+
++ (void)dumpTree:(AXUIElementRef)element maxDepth:(int)maxDepth {
+    // Siblings are fetched concurrently; lines still come out in tree order
+    WAAXTreeWalker *walker = [self walkerWithMaxDepth:maxDepth];
+    [walker dumpFrom:(__bridge id)element lineHandler:^(NSString *line) {
+        [self log:@"%@", line];
+    }];
+    [self log:@"(%lu elements in %.2fs)", (unsigned long)walker.lastNodesFetched, walker.lastDuration];
 }
 
 #pragma mark - Element Finding
@@ -152,34 +158,19 @@ static NSFileHandle *outputHandle = nil;
             maxDepth:(int)maxDepth
              results:(NSMutableArray *)results {
     
-    [self searchElement:root predicate:predicate depth:0 maxDepth:maxDepth results:results];
-}
-
-+ (void)searchElement:(AXUIElementRef)element
-            predicate:(BOOL(^)(AXUIElementRef, NSString *, int))predicate
-                depth:(int)depth
-             maxDepth:(int)maxDepth
-              results:(NSMutableArray *)results {
-    
-    if (depth >= maxDepth) return;
+    WAAXTreeWalker *walker = [self walkerWithMaxDepth:maxDepth];
+    NSArray<WAAXTreeMatch *> *matches = [walker findAllFrom:(__bridge id)root
+                                                   matching:^BOOL(id node, NSString *role, NSString *identifier, NSUInteger depth) {
+        return predicate((__bridge AXUIElementRef)node, role, (int)depth);
+    }];
     
-    NSString *role = [self roleOfElement:element];
-    if (predicate(element, role, depth)) {
+    for (WAAXTreeMatch *match in matches) {
         [results addObject:@{
-            @"element": (__bridge id)element,
-            @"role": role,
-            @"depth": @(depth)
+            @"element": match.node,
+            @"role": match.role,
+            @"depth": @(match.depth)
         }];
     }
-    
-    NSArray *children = [self childrenOfElement:element];
-    for (id child in children) {
-        [self searchElement:(__bridge AXUIElementRef)child
-                  predicate:predicate
-                      depth:depth + 1
-                   maxDepth:maxDepth
-                    results:results];
-    }
 }
 
 + (void)findElementsWithRole:(NSString *)targetRole inElement:(AXUIElementRef)root {
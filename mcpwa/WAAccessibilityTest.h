@@ -57,6 +57,38 @@
 + (void)testReadChatList;
 + (void)testParsingUnitTests;
 
+/// Check BM25 ranking, result fusion and the offline fallback of RAGClient search:
+/// against the in-process stub (no network, no WhatsApp)
++ (void)testLocalRetriever;
+
+/// Exercise RAG endpoint ranking, benching and hedge delays with synthetic latencies,
+/// then hedging, failover and stream latency against two in-process stub replicas
++ (void)testEndpointPool;
+
+/// Compare sequential and concurrent tree walks over a synthetic tree with simulated IPC latency
++ (void)testTreeWalker;
+
+/// Time 1, 10 and 50 RAG searches one by one, fanned out and via /search/batch against an in-process stub
++ (void)testBatchSearch;
+
+/// Decode recorded message cell subtrees, checking each field and the node fetches (no WhatsApp needed)
++ (void)testMessageCellDecoder;
+
+/// Match chat names across scripts, typos and short queries in a fresh WAChatDirectory,
+/// and check that each account's accessor keeps its own directory and index
++ (void)testChatDirectory;
+
+/// Send to a chat that is already open under a longer header, against a fake chat
++ (void)testSendQueueOpenChat;
+
+/// Page results through cursors (directly and via whatsapp_batch search) and check the HH:MM since bound
++ (void)testResultPager;
+
+/// Round-trip MessagePack frames and compare socket bytes and CPU of JSON lines vs frames,
+/// then time round trips through two shim connections, one per framing, over socketpairs, and
+/// check a server message that arrives in the same read as the handshake response is forwarded
++ (void)testShimFraming;
+
 #pragma mark - Chat Filter Tests
 
 /// Test getting the currently selected chat filter
@@ -7,7 +7,315 @@
 #import "WAAccessibility.h"
 #import "WASearchResult.h"
 #import "WASearchResultsAccessor.h"
+#import "WALocalRetriever.h"
+#import "RAGEndpointPool.h"
+#import "RAGClient.h"
+#import "WAAXTreeWalker.h"
+#import "WAMessageCellDecoderTest.h"
+#import "WAChatDirectory.h"
+#import "WASendQueue.h"
+#import "WAResultPager.h"
+#import "WABatchPlanner.h"
 #import "WALogger.h"
+#import "MCPMsgPack.h"
+#import "MCPServerConnection.h"
+#import <sys/resource.h>
+#import <sys/socket.h>
+#import <unistd.h>
+
+#pragma mark - RAG Stub Server
+
+static NSString * const kRAGStubHost = @"rag-stub.invalid";
+static const NSTimeInterval kRAGStubRoundTrip = 0.030;   // Per HTTP request
+static const NSTimeInterval kRAGStubQueryCost = 0.004;   // Embedding and lookup per query
+static BOOL gRAGStubSupportsBatch = YES;
+static NSDictionary<NSString *, NSNumber *> *gRAGStubHostDelays;   // Extra latency by host
+static NSSet<NSString *> *gRAGStubDownHosts;                       // Hosts that refuse connections
+static NSMutableArray<NSString *> *gRAGStubEvents;                 // "start <host>" / "cancel <host>", when set
+
+/// In-process stand-in for the RAG service used by testBatchSearch and
+/// testEndpointPool, answering kRAGStubHost and any subdomain of it. POST /search
+/// answers after one round trip plus one query's work. POST /search/batch sends
+/// headers after a round trip, then one NDJSON line per query as it is "done",
+/// odd ids first so the client has to demultiplex; or 404 when batch support is off.
+/// GET /health and POST /query/stream (one chunk, then done) answer after a round trip.
+/// Each host adds its gRAGStubHostDelays entry; hosts in gRAGStubDownHosts fail at once.
+@interface WARAGStubProtocol : NSURLProtocol
+@property (nonatomic, strong) NSRunLoop *clientRunLoop;
+@property (atomic, assign) BOOL stopped;
+@property (atomic, assign) BOOL finished;
+@end
+
+@implementation WARAGStubProtocol
+
++ (BOOL)canInitWithRequest:(NSURLRequest *)request {
+    NSString *host = request.URL.host;
+    return [host isEqualToString:kRAGStubHost] || [host hasSuffix:[@"." stringByAppendingString:kRAGStubHost]];
+}
+
++ (void)recordEvent:(NSString *)event host:(NSString *)host {
+    NSMutableArray<NSString *> *events = gRAGStubEvents;
+    @synchronized (events) {
+        [events addObject:[NSString stringWithFormat:@"%@ %@", event, host]];
+    }
+}
+
++ (NSURLRequest *)canonicalRequestForRequest:(NSURLRequest *)request {
+    return request;
+}
+
+/// Session tasks hand protocols the body as a stream
++ (NSDictionary *)bodyOfRequest:(NSURLRequest *)request {
+    NSData *data = request.HTTPBody;
+    if (!data && request.HTTPBodyStream) {
+        NSMutableData *buffer = [NSMutableData data];
+        NSInputStream *stream = request.HTTPBodyStream;
+        uint8_t chunk[4096];
+        NSInteger count;
+        [stream open];
+        while ((count = [stream read:chunk maxLength:sizeof(chunk)]) > 0) {
+            [buffer appendBytes:chunk length:count];
+        }
+        [stream close];
+        data = buffer;
+    }
+    id json = data ? [NSJSONSerialization JSONObjectWithData:data options:0 error:nil] : nil;
+    return [json isKindOfClass:[NSDictionary class]] ? json : @{};
+}
+
+/// k hits echoing the query text, so callers can check results landed on the right query
++ (NSArray *)resultsForQuery:(NSDictionary *)query {
+    NSInteger k = [query[@"k"] integerValue] ?: 5;
+    NSMutableArray *results = [NSMutableArray arrayWithCapacity:k];
+    for (NSInteger i = 0; i < k; i++) {
+        [results addObject:@{@"text": [NSString stringWithFormat:@"%@ #%ld", query[@"query"], (long)i],
+                             @"score": @(1.0 - i * 0.1)}];
+    }
+    return results;
+}
+
+/// Client callbacks must happen on the loading thread's run loop
+- (void)after:(NSTimeInterval)delay perform:(dispatch_block_t)block {
+    CFRunLoopRef runLoop = self.clientRunLoop.getCFRunLoop;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)),
+                   dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        CFRunLoopPerformBlock(runLoop, kCFRunLoopCommonModes, ^{
+            if (!self.stopped) block();
+        });
+        CFRunLoopWakeUp(runLoop);
+    });
+}
+
+- (void)respondWithStatus:(NSInteger)status contentType:(NSString *)contentType {
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:self.request.URL
+                                                              statusCode:status
+                                                             HTTPVersion:@"HTTP/1.1"
+                                                            headerFields:@{@"Content-Type": contentType}];
+    [self.client URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+}
+
+- (void)finish {
+    self.finished = YES;
+    [self.client URLProtocolDidFinishLoading:self];
+}
+
+- (void)streamLines:(NSArray<NSData *> *)lines from:(NSUInteger)index {
+    if (index == lines.count) {
+        [self finish];
+        return;
+    }
+    [self after:kRAGStubQueryCost perform:^{
+        [self.client URLProtocol:self didLoadData:lines[index]];
+        [self streamLines:lines from:index + 1];
+    }];
+}
+
+- (void)startLoading {
+    self.clientRunLoop = [NSRunLoop currentRunLoop];
+    NSDictionary *body = [WARAGStubProtocol bodyOfRequest:self.request];
+    NSString *path = self.request.URL.path;
+    NSString *host = self.request.URL.host;
+    NSTimeInterval roundTrip = kRAGStubRoundTrip + gRAGStubHostDelays[host].doubleValue;
+    [WARAGStubProtocol recordEvent:@"start" host:host];
+
+    if ([gRAGStubDownHosts containsObject:host]) {
+        [self after:0 perform:^{
+            self.finished = YES;
+            [self.client URLProtocol:self didFailWithError:[NSError errorWithDomain:NSURLErrorDomain
+                                                                               code:NSURLErrorCannotConnectToHost
+                                                                           userInfo:nil]];
+        }];
+    } else if ([path isEqualToString:@"/search"]) {
+        NSData *data = [NSJSONSerialization dataWithJSONObject:[WARAGStubProtocol resultsForQuery:body] options:0 error:nil];
+        [self after:roundTrip + kRAGStubQueryCost perform:^{
+            [self respondWithStatus:200 contentType:@"application/json"];
+            [self.client URLProtocol:self didLoadData:data];
+            [self finish];
+        }];
+    } else if ([path isEqualToString:@"/health"]) {
+        [self after:roundTrip perform:^{
+            [self respondWithStatus:200 contentType:@"application/json"];
+            [self.client URLProtocol:self didLoadData:[@"{\"status\":\"ok\"}" dataUsingEncoding:NSUTF8StringEncoding]];
+            [self finish];
+        }];
+    } else if ([path isEqualToString:@"/query/stream"]) {
+        NSArray<NSData *> *events = @[
+            [@"data: {\"type\":\"chunk\",\"text\":\"stub answer\"}\n\n" dataUsingEncoding:NSUTF8StringEncoding],
+            [@"data: {\"type\":\"done\",\"model\":\"stub\",\"sources\":[]}\n\n" dataUsingEncoding:NSUTF8StringEncoding]
+        ];
+        [self after:roundTrip perform:^{
+            [self respondWithStatus:200 contentType:@"text/event-stream"];
+            [self streamLines:events from:0];
+        }];
+    } else if ([path isEqualToString:@"/search/batch"] && gRAGStubSupportsBatch) {
+        NSArray<NSDictionary *> *queries = [body[@"queries"] isKindOfClass:[NSArray class]] ? body[@"queries"] : @[];
+        NSMutableArray<NSData *> *lines = [NSMutableArray arrayWithCapacity:queries.count];
+        for (NSUInteger parity = 1; parity <= 2; parity++) {
+            for (NSUInteger i = parity % 2; i < queries.count; i += 2) {
+                NSMutableData *line = [[NSJSONSerialization dataWithJSONObject:@{
+                    @"id": queries[i][@"id"] ?: @(i),
+                    @"results": [WARAGStubProtocol resultsForQuery:queries[i]]
+                } options:0 error:nil] mutableCopy];
+                [line appendBytes:"\n" length:1];
+                [lines addObject:line];
+            }
+        }
+        [self after:roundTrip perform:^{
+            [self respondWithStatus:200 contentType:@"application/x-ndjson"];
+            [self streamLines:lines from:0];
+        }];
+    } else {
+        [self after:roundTrip perform:^{
+            [self respondWithStatus:404 contentType:@"application/json"];
+            [self.client URLProtocol:self didLoadData:[@"{\"detail\":\"Not Found\"}" dataUsingEncoding:NSUTF8StringEncoding]];
+            [self finish];
+        }];
+    }
+}
+
+- (void)stopLoading {
+    self.stopped = YES;
+    if (!self.finished) {
+        [WARAGStubProtocol recordEvent:@"cancel" host:self.request.URL.host];
+    }
+}
+
+@end
+
+/// Collects what a RAGClient search: reports, for testLocalRetriever
+@interface WARAGSearchRecorder : NSObject <RAGClientDelegate>
+@property (atomic, strong, nullable) RAGSearchResult *localResponse;
+@property (atomic, strong, nullable) RAGSearchResult *finalResponse;
+@property (nonatomic, strong) dispatch_semaphore_t done;
+@end
+
+@implementation WARAGSearchRecorder
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _done = dispatch_semaphore_create(0);
+    }
+    return self;
+}
+
+- (void)ragClient:(id)client didReceiveLocalSearchResults:(RAGSearchResult *)response {
+    self.localResponse = response;
+}
+
+- (void)ragClient:(id)client didCompleteSearchWithResponse:(RAGSearchResult *)response {
+    self.finalResponse = response;
+    dispatch_semaphore_signal(self.done);
+}
+
+- (void)ragClient:(id)client didFailWithError:(NSError *)error {
+    dispatch_semaphore_signal(self.done);
+}
+
+@end
+
+/// RAGClient's private hedging entry point, driven directly by testEndpointPool
+@interface RAGClient (Hedging)
+- (id)sendHedgedRequest:(NSURLRequest *(^)(NSString *endpoint))makeRequest
+             completion:(void (^)(NSData * _Nullable data, NSHTTPURLResponse * _Nullable response, NSError * _Nullable error))completion;
+@end
+
+/// Per-account accessors, normally made by +instanceForAccount: for a running process
+@interface WAAccessibility (Accounts)
+- (instancetype)initWithBundleIdentifier:(nullable NSString *)bundleIdentifier pid:(pid_t)pid;
+@end
+
+/// The HH:MM since bound of getMessages, checked by testResultPager without a chat open
+@interface WAAccessibility (SinceBound)
+- (NSInteger)minutesFromTimestamp:(NSString *)timestamp;
+- (NSUInteger)indexOfFirstMessage:(NSArray<WAMessage *> *)messages since:(NSInteger)sinceMinutes;
+@end
+
+#pragma mark - Fake Chat
+
+/// WAAccessibility stand-in for send-queue tests: one open chat whose header
+/// only changes if openHeader is set, and a transcript that sends append to
+@interface WAFakeChatAccessibility : WAAccessibility
+@property (atomic, copy) NSString *header;
+@property (atomic, copy) NSString *openHeader;          // Header after openChatWithName:, nil = unchanged
+@property (atomic, assign) NSUInteger openCalls;
+@property (atomic, strong) NSMutableArray<WAMessage *> *transcript;
+@end
+
+@implementation WAFakeChatAccessibility
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _transcript = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (BOOL)isWhatsAppAvailable {
+    return YES;
+}
+
+- (NSString *)currentChatName {
+    return self.header;
+}
+
+- (BOOL)openChatWithName:(NSString *)name {
+    self.openCalls++;
+    if (self.openHeader) self.header = self.openHeader;
+    return YES;
+}
+
+- (NSString *)latestMessageFingerprint {
+    return self.transcript.lastObject.fingerprint;
+}
+
+- (BOOL)sendMessage:(NSString *)message {
+    WAMessage *sent = [[WAMessage alloc] init];
+    sent.text = message;
+    sent.direction = WAMessageDirectionOutgoing;
+    sent.fingerprint = [NSString stringWithFormat:@"%016lx.0", (unsigned long)self.transcript.count + 1];
+    [self.transcript addObject:sent];
+    return YES;
+}
+
+- (NSString *)composerText {
+    return @"";
+}
+
+- (NSArray<WAMessage *> *)getMessagesWithLimit:(NSInteger)limit
+                                        fields:(WAMessageField)fields
+                                         since:(NSString *)since
+                                watermarkFound:(BOOL *)watermarkFound {
+    NSUInteger start = 0;
+    for (NSUInteger i = 0; i < self.transcript.count; i++) {
+        if ([self.transcript[i].fingerprint isEqualToString:since]) start = i + 1;
+    }
+    if (watermarkFound) *watermarkFound = start > 0;
+    return [self.transcript subarrayWithRange:NSMakeRange(start, self.transcript.count - start)];
+}
+
+@end
 
 @implementation WAAccessibilityTest
 
@@ -757,7 +1065,6 @@
     
     if (waPid == 0) {
         NSLog(@"ERROR: can't get the WhatsApp PID");
-        CFRelease(window);
         return;
     }
 
@@ -770,8 +1077,6 @@
     } @catch (NSException *exception) {
         NSLog(@"WAAccessibility: Exception in globalSearch: %@", exception);
     }
-        
-    CFRelease(window);
 }
 
 +(void) testPressCmdF
@@ -786,7 +1091,6 @@
     
     if (waPid == 0) {
         NSLog(@"ERROR: can't get the WhatsApp PID");
-        CFRelease(window);
         return;
     }
 
@@ -798,8 +1102,6 @@
     } @catch (NSException *exception) {
         NSLog(@"WAAccessibility: Exception in globalSearch: %@", exception);
     }
-        
-    CFRelease(window);
 }
 
 +(void) testPressCmdV
@@ -814,7 +1116,6 @@
     
     if (waPid == 0) {
         NSLog(@"ERROR: can't get the WhatsApp PID");
-        CFRelease(window);
         return;
     }
 
@@ -826,8 +1127,6 @@
     } @catch (NSException *exception) {
         NSLog(@"WAAccessibility: Exception in globalSearch: %@", exception);
     }
-        
-    CFRelease(window);
 }
 
 +(void) testPressA
@@ -842,7 +1141,6 @@
     
     if (waPid == 0) {
         NSLog(@"ERROR: can't get the WhatsApp PID");
-        CFRelease(window);
         return;
     }
 
@@ -854,8 +1152,6 @@
     } @catch (NSException *exception) {
         NSLog(@"WAAccessibility: Exception in globalSearch: %@", exception);
     }
-        
-    CFRelease(window);
 }
 
 +(void) testPressX
@@ -870,7 +1166,6 @@
     
     if (waPid == 0) {
         NSLog(@"ERROR: can't get the WhatsApp PID");
-        CFRelease(window);
         return;
     }
 
@@ -882,8 +1177,6 @@
     } @catch (NSException *exception) {
         NSLog(@"WAAccessibility: Exception in globalSearch: %@", exception);
     }
-        
-    CFRelease(window);
 }
 
 +(void) testTypeInABC
@@ -898,7 +1191,6 @@
     
     if (waPid == 0) {
         NSLog(@"ERROR: can't get the WhatsApp PID");
-        CFRelease(window);
         return;
     }
 
@@ -915,8 +1207,6 @@
     } @catch (NSException *exception) {
         NSLog(@"WAAccessibility: Exception in globalSearch: %@", exception);
     }
-        
-    CFRelease(window);
 }
 
 + (void)testGetCurrentChat {
@@ -991,6 +1281,885 @@
     NSLog(@"\n=== END PARSING TESTS ===\n");
 }
 
++ (void)testLocalRetriever {
+    NSLog(@"\n\n=== LOCAL RETRIEVER TESTS (offline) ===\n");
+
+    WALocalRetriever *retriever = [[WALocalRetriever alloc] initWithIndexPath:nil];
+
+    NSArray<NSString *> *texts = @[
+        @"Bonjour! pour Grasse, 13 et 14 decembre",
+        @"да, теперь стартует! 👍",
+        @"Here Evren used ChatGPT to some extent as well",
+        @"Tournament in Grasse is moved to Sunday"
+    ];
+    NSMutableArray<WAMessage *> *messages = [NSMutableArray array];
+    for (NSString *text in texts) {
+        WAMessage *message = [[WAMessage alloc] init];
+        message.text = text;
+        message.sender = @"Igor Berezovsky";
+        message.timestamp = @"12:22";
+        message.direction = WAMessageDirectionIncoming;
+        [messages addObject:message];
+    }
+    [retriever addMessages:messages chatName:@"Chess club Monaco"];
+    [retriever addMessages:messages chatName:@"Chess club Monaco"];  // Duplicates are ignored
+
+    __block NSUInteger passed = 0, failed = 0;
+    void (^check)(NSString *, id, id) = ^(NSString *label, id actual, id expected) {
+        BOOL ok = actual == expected || [actual isEqual:expected];
+        ok ? passed++ : failed++;
+        if (ok) {
+            NSLog(@"PASS %@", label);
+        } else {
+            NSLog(@"FAIL %@: %@ (expected %@)", label, actual ?: @"nil", expected ?: @"nil");
+        }
+    };
+    NSArray *(^textsOf)(NSArray<NSDictionary *> *) = ^NSArray *(NSArray<NSDictionary *> *hits) {
+        return [hits valueForKey:@"text"];
+    };
+
+    check(@"indexed documents (duplicates ignored)", @(retriever.documentCount), @(texts.count));
+
+    for (NSString *query in @[@"grasse", @"СТАРТУЕТ", @"chatgpt evren", @"igor", @"nothing-here"]) {
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        NSArray<NSDictionary *> *hits = [retriever search:query k:3];
+        double ms = (CFAbsoluteTimeGetCurrent() - start) * 1000.0;
+        NSLog(@"'%@' -> %lu hits in %.2f ms", query, (unsigned long)hits.count, ms);
+        for (NSDictionary *hit in hits) {
+            NSLog(@"    %.3f  %@", [hit[@"score"] doubleValue], hit[@"text"]);
+        }
+    }
+
+    // BM25: both query terms beat one; folding matches case across scripts
+    check(@"BM25 'grasse sunday'", textsOf([retriever search:@"grasse sunday" k:3]),
+          (@[texts[3], texts[0]]));
+    check(@"BM25 'СТАРТУЕТ'", textsOf([retriever search:@"СТАРТУЕТ" k:3]), @[texts[1]]);
+    check(@"BM25 'bridge' (no such word)", textsOf([retriever search:@"bridge" k:3]), @[]);
+
+    // Remote chunk containing a local message should merge into one hybrid hit
+    NSArray *local = [retriever search:@"grasse" k:3];
+    NSArray *remote = @[
+        @{@"chat_name": @"Chess club Monaco", @"content": @"Igor: Tournament in Grasse is moved to Sunday. See you there"},
+        @{@"chat_name": @"Family", @"content": @"Grasse trip photos"}
+    ];
+    NSArray *fused = [WALocalRetriever fuseLocalResults:local remoteResults:remote limit:5];
+    NSLog(@"Fused %lu local + %lu remote -> %lu", (unsigned long)local.count, (unsigned long)remote.count, (unsigned long)fused.count);
+    for (NSDictionary *hit in fused) {
+        NSLog(@"    %.4f  [%@] %@", [hit[@"score"] doubleValue], hit[@"source"], hit[@"content"]);
+    }
+    check(@"RRF merges the shared message", [fused.firstObject valueForKey:@"source"], @"hybrid");
+    check(@"RRF keeps every other hit", @(fused.count), @(local.count + remote.count - 1));
+
+    // End to end through RAGClient search: with the stub service as the remote half
+    NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+    configuration.protocolClasses = @[[WARAGStubProtocol class]];
+    RAGClient *client = [[RAGClient alloc] initWithBaseURLs:@[[@"http://" stringByAppendingString:kRAGStubHost]]
+                                       sessionConfiguration:configuration];
+    client.localRetriever = retriever;
+    RAGSearchResult *(^search)(NSString *, NSInteger, WARAGSearchRecorder *) = ^RAGSearchResult *(NSString *query, NSInteger k, WARAGSearchRecorder *recorder) {
+        client.delegate = recorder;
+        [client search:query k:k chatFilter:0];
+        dispatch_semaphore_wait(recorder.done, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(5 * NSEC_PER_SEC)));
+        return recorder.finalResponse;
+    };
+
+    // The stub echoes the query, so nothing merges and RRF interleaves equal ranks, remote first
+    WARAGSearchRecorder *recorder = [[WARAGSearchRecorder alloc] init];
+    RAGSearchResult *response = search(@"grasse sunday", 4, recorder);
+    check(@"local results delivered first", textsOf(recorder.localResponse.results), (@[texts[3], texts[0]]));
+    check(@"fused sources", [response.results valueForKey:@"source"], (@[@"remote", @"local", @"remote", @"local"]));
+    check(@"fused texts", textsOf(response.results),
+          (@[@"grasse sunday #0", texts[3], @"grasse sunday #1", texts[0]]));
+    check(@"fused is not a fallback", @(response.isLocalFallback), @NO);
+
+    // Service down: the offline hits stand in, marked as a fallback
+    gRAGStubDownHosts = [NSSet setWithObject:kRAGStubHost];
+    recorder = [[WARAGSearchRecorder alloc] init];
+    response = search(@"grasse sunday", 4, recorder);
+    gRAGStubDownHosts = nil;
+    check(@"fallback flagged", @(response.isLocalFallback), @YES);
+    check(@"fallback results", textsOf(response.results), (@[texts[3], texts[0]]));
+
+    NSLog(@"Local retriever: %lu passed, %lu failed", (unsigned long)passed, (unsigned long)failed);
+    NSLog(@"\n=== END LOCAL RETRIEVER TESTS ===\n");
+}
+
++ (void)testEndpointPool {
+    NSLog(@"\n\n=== ENDPOINT POOL TESTS (offline) ===\n");
+
+    NSString *fast = @"http://localhost:8000", *slow = @"http://localhost:8001", *flaky = @"http://localhost:8002";
+    RAGEndpointPool *pool = [[RAGEndpointPool alloc] initWithBaseURLs:@[slow, @"http://localhost:8001/", flaky, fast]];
+    NSLog(@"Endpoints: %@ (expected 3, trailing slash deduplicated)", pool.baseURLs);
+    NSLog(@"Hedge delay before samples: %.3fs (expected 0.500)", [pool hedgeDelayForEndpoint:fast]);
+
+    // Injected delays: fast ~40ms with an occasional 200ms outlier, slow ~400ms, flaky fast but failing
+    for (NSInteger i = 0; i < 40; i++) {
+        [pool recordSuccessForEndpoint:fast latency:(i % 10 == 0) ? 0.200 : 0.040];
+        [pool recordSuccessForEndpoint:slow latency:0.400];
+        if (i % 2 == 0) {
+            [pool recordSuccessForEndpoint:flaky latency:0.030];
+        } else {
+            [pool recordFailureForEndpoint:flaky];
+        }
+    }
+    NSLog(@"Ranked: %@ (expected fast first)", [pool rankedEndpoints]);
+    NSLog(@"Hedge delay for fast: %.3fs (expected p95 = 0.200)", [pool hedgeDelayForEndpoint:fast]);
+
+    // Three straight failures bench the fast endpoint until its cooldown passes
+    for (NSInteger i = 0; i < 3; i++) {
+        [pool recordFailureForEndpoint:fast];
+    }
+    NSLog(@"After fast fails 3x: best = %@ (expected not fast)", [pool bestEndpoint]);
+    for (RAGEndpointStats *stats in [pool allStats]) {
+        NSLog(@"    %@", stats);
+    }
+
+    [self testHedgedRequests];
+
+    NSLog(@"\n=== END ENDPOINT POOL TESTS ===\n");
+}
+
+/// Two stub replicas behind a real RAGClient: the hedge fires at the primary's p95 and
+/// the loser is cancelled, a refused connection fails over without waiting for the
+/// timer, the failed replica is skipped afterwards, and stream queries feed the pool.
++ (void)testHedgedRequests {
+    __block NSUInteger passed = 0, failed = 0;
+    void (^check)(NSString *, id, id) = ^(NSString *label, id actual, id expected) {
+        BOOL ok = actual == expected || [actual isEqual:expected];
+        ok ? passed++ : failed++;
+        if (ok) {
+            NSLog(@"PASS %@", label);
+        } else {
+            NSLog(@"FAIL %@: %@ (expected %@)", label, actual ?: @"nil", expected ?: @"nil");
+        }
+    };
+    BOOL (^waitUntil)(BOOL (^)(void)) = ^BOOL(BOOL (^condition)(void)) {
+        CFAbsoluteTime deadline = CFAbsoluteTimeGetCurrent() + 2.0;
+        while (!condition()) {
+            if (CFAbsoluteTimeGetCurrent() > deadline) return NO;
+            usleep(5000);
+        }
+        return YES;
+    };
+
+    NSString *primaryHost = [@"primary." stringByAppendingString:kRAGStubHost];
+    NSString *backupHost = [@"backup." stringByAppendingString:kRAGStubHost];
+    NSString *primary = [@"http://" stringByAppendingString:primaryHost];
+    NSString *backup = [@"http://" stringByAppendingString:backupHost];
+
+    NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+    configuration.protocolClasses = @[[WARAGStubProtocol class]];
+    RAGClient *client = [[RAGClient alloc] initWithBaseURLs:@[primary, backup] sessionConfiguration:configuration];
+    client.localRetriever = nil;
+    RAGEndpointPool *pool = client.endpointPool;
+    RAGEndpointStats *(^statsFor)(NSString *) = ^RAGEndpointStats *(NSString *endpoint) {
+        for (RAGEndpointStats *stats in [pool allStats]) {
+            if ([stats.baseURL isEqualToString:endpoint]) return stats;
+        }
+        return nil;
+    };
+
+    // Let the startup health pings land, then give the primary a 200ms p95 and the backup 400ms
+    waitUntil(^BOOL{ return statsFor(primary).sampleCount > 0 && statsFor(backup).sampleCount > 0; });
+    for (NSInteger i = 0; i < 20; i++) {
+        [pool recordSuccessForEndpoint:primary latency:0.200];
+        [pool recordSuccessForEndpoint:backup latency:0.400];
+    }
+    NSTimeInterval hedgeDelay = [pool hedgeDelayForEndpoint:primary];
+    check(@"primary ranked first", [pool bestEndpoint], primary);
+    check(@"hedge delay is the primary's p95", @(hedgeDelay), @0.200);
+
+    // One /search through sendHedgedRequest; returns the answering host and the elapsed time
+    __block NSTimeInterval elapsed = 0;
+    NSString *(^search)(void) = ^NSString *{
+        @synchronized (gRAGStubEvents) {
+            [gRAGStubEvents removeAllObjects];
+        }
+        dispatch_semaphore_t done = dispatch_semaphore_create(0);
+        __block NSString *winner = nil;
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        [client sendHedgedRequest:^NSURLRequest *(NSString *endpoint) {
+            NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:[endpoint stringByAppendingString:@"/search"]]];
+            request.HTTPMethod = @"POST";
+            request.HTTPBody = [@"{\"query\":\"hedge\",\"k\":1}" dataUsingEncoding:NSUTF8StringEncoding];
+            return request;
+        } completion:^(NSData *data, NSHTTPURLResponse *response, NSError *error) {
+            winner = error ? nil : response.URL.host;
+            dispatch_semaphore_signal(done);
+        }];
+        dispatch_semaphore_wait(done, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(5 * NSEC_PER_SEC)));
+        elapsed = CFAbsoluteTimeGetCurrent() - start;
+        return winner;
+    };
+    BOOL (^sawEvent)(NSString *) = ^BOOL(NSString *event) {
+        @synchronized (gRAGStubEvents) {
+            return [gRAGStubEvents containsObject:event];
+        }
+    };
+
+    gRAGStubEvents = [NSMutableArray array];
+
+    // Primary stalls for a second: the backup is asked at the p95 mark and wins
+    gRAGStubHostDelays = @{primaryHost: @1.0};
+    check(@"stalled primary: backup answers", search(), backupHost);
+    check(@"stalled primary: hedge fired", @(sawEvent([@"start " stringByAppendingString:backupHost])), @YES);
+    check(@"stalled primary: answered after the hedge delay, well before the stall",
+          @(elapsed >= hedgeDelay && elapsed < hedgeDelay + 0.3), @YES);
+    check(@"stalled primary: losing request cancelled",
+          @(waitUntil(^BOOL{ return sawEvent([@"cancel " stringByAppendingString:primaryHost]); })), @YES);
+    NSLog(@"    %.0fms with a %.0fms hedge delay", elapsed * 1000.0, hedgeDelay * 1000.0);
+    gRAGStubHostDelays = nil;
+
+    // Primary refuses connections: fail over at once instead of waiting out the hedge delay
+    gRAGStubDownHosts = [NSSet setWithObject:primaryHost];
+    NSUInteger failuresBefore = statsFor(primary).consecutiveFailures;
+    check(@"down primary: backup answers", search(), backupHost);
+    check(@"down primary: failed over before the hedge timer", @(elapsed < hedgeDelay), @YES);
+    check(@"down primary: failure recorded", @(statsFor(primary).consecutiveFailures), @(failuresBefore + 1));
+
+    // The failure and the backup's fast answers now rank the primary second; it isn't asked
+    check(@"after failure: backup ranked first", [pool bestEndpoint], backup);
+    check(@"after failure: backup answers", search(), backupHost);
+    check(@"after failure: primary skipped", @(sawEvent([@"start " stringByAppendingString:primaryHost])), @NO);
+    gRAGStubDownHosts = nil;
+
+    // Stream queries report time to headers like every other request
+    NSUInteger samplesBefore = statsFor(backup).sampleCount;
+    [client queryStream:@"hedge"];
+    check(@"stream query sampled by the pool",
+          @(waitUntil(^BOOL{ return statsFor(backup).sampleCount == samplesBefore + 1; })), @YES);
+    NSLog(@"    %@", statsFor(backup));
+
+    gRAGStubEvents = nil;
+    NSLog(@"Hedged requests: %lu passed, %lu failed", (unsigned long)passed, (unsigned long)failed);
+}
+
++ (void)testTreeWalker {
+    NSLog(@"\n\n=== TREE WALKER TESTS (synthetic tree) ===\n");
+
+    // 4-ary tree, 5 levels deep (1365 nodes), 1ms per fetch like a cheap AX round-trip
+    NSDictionary *tree = [WASyntheticAXTreeProvider treeWithBreadth:4 depth:5];
+    WASyntheticAXTreeProvider *provider = [[WASyntheticAXTreeProvider alloc] init];
+    provider.latency = 0.001;
+    WAAXTreeWalker *walker = [[WAAXTreeWalker alloc] initWithProvider:provider];
+
+    WAAXNodePredicate leaves = ^BOOL(id node, NSString *role, NSString *identifier, NSUInteger depth) {
+        return [role isEqualToString:@"AXStaticText"];
+    };
+    NSArray<NSString *> *(^identifiers)(NSArray<WAAXTreeMatch *> *) = ^(NSArray<WAAXTreeMatch *> *matches) {
+        return [matches valueForKey:@"identifier"];
+    };
+
+    walker.maxConcurrency = 1;
+    NSArray *sequential = identifiers([walker findAllFrom:tree matching:leaves]);
+    NSTimeInterval sequentialTime = walker.lastDuration;
+    NSLog(@"Sequential findAll: %lu matches, %lu fetches, %.3fs",
+          (unsigned long)sequential.count, (unsigned long)walker.lastNodesFetched, sequentialTime);
+
+    walker.maxConcurrency = 8;
+    NSArray *concurrent = identifiers([walker findAllFrom:tree matching:leaves]);
+    NSLog(@"Concurrent findAll: %lu matches, %.3fs (%.1fx), same order: %@",
+          (unsigned long)concurrent.count, walker.lastDuration,
+          sequentialTime / MAX(walker.lastDuration, 0.0001),
+          [sequential isEqualToArray:concurrent] ? @"YES" : @"NO");
+
+    // findFirst must agree with the sequential pre-order and stop early
+    WAAXTreeMatch *first = [walker findFirstFrom:tree matching:^BOOL(id node, NSString *role, NSString *identifier, NSUInteger depth) {
+        return [identifier hasPrefix:@"n.1."] && [role isEqualToString:@"AXStaticText"];
+    }];
+    NSLog(@"findFirst: %@ (expected n.1.0.0.0.0) after %lu fetches", first.identifier, (unsigned long)walker.lastNodesFetched);
+
+    // Branch budgets: nothing below n.2 is fetched, and n.3 gets one more level
+    walker.identifierPrefixDepthLimits = @{@"n.2": @0, @"n.3": @1};
+    NSArray *pruned = [walker findAllFrom:tree matching:^BOOL(id node, NSString *role, NSString *identifier, NSUInteger depth) {
+        return YES;
+    }];
+    NSLog(@"Pruned walk: %lu nodes (expected %d)", (unsigned long)pruned.count, 1 + 2 * 341 + 1 + 5);
+    walker.identifierPrefixDepthLimits = nil;
+
+    // Dumps are ordered and truncated at maxDepth
+    walker.maxDepth = 3;
+    NSMutableArray<NSString *> *lines = [NSMutableArray array];
+    [walker dumpFrom:tree lineHandler:^(NSString *line) {
+        [lines addObject:line];
+    }];
+    NSLog(@"Dump to depth 3: %lu lines (expected 1 + 4 + 16 + 64 markers)", (unsigned long)lines.count);
+    for (NSString *line in [lines subarrayWithRange:NSMakeRange(0, MIN(lines.count, (NSUInteger)6))]) {
+        NSLog(@"    %@", line);
+    }
+
+    NSLog(@"\n=== END TREE WALKER TESTS ===\n");
+}
+
++ (void)testBatchSearch {
+    NSLog(@"\n\n=== BATCH SEARCH BENCHMARK (stub server) ===\n");
+
+    NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+    configuration.protocolClasses = @[[WARAGStubProtocol class]];
+    NSString *baseURL = [NSString stringWithFormat:@"http://%@", kRAGStubHost];
+    RAGClient *(^makeClient)(void) = ^RAGClient *{
+        RAGClient *client = [[RAGClient alloc] initWithBaseURLs:@[baseURL] sessionConfiguration:configuration];
+        client.localRetriever = nil;  // Time the network path only
+        return client;
+    };
+
+    // One batch to completion; counts results that came back under the wrong query
+    __block NSUInteger misrouted = 0;
+    NSTimeInterval (^runBatch)(RAGClient *, NSArray<RAGSearchQuery *> *) = ^NSTimeInterval(RAGClient *client, NSArray<RAGSearchQuery *> *queries) {
+        dispatch_semaphore_t done = dispatch_semaphore_create(0);
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        [client searchBatch:queries resultHandler:nil completion:^(NSArray<RAGSearchResult *> *results) {
+            [results enumerateObjectsUsingBlock:^(RAGSearchResult *result, NSUInteger i, BOOL *stop) {
+                NSString *text = [result.results.firstObject[@"text"] description];
+                if (![text hasPrefix:[queries[i].query stringByAppendingString:@" #"]]) misrouted++;
+            }];
+            dispatch_semaphore_signal(done);
+        }];
+        dispatch_semaphore_wait(done, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(30 * NSEC_PER_SEC)));
+        return CFAbsoluteTimeGetCurrent() - start;
+    };
+
+    RAGClient *batchClient = makeClient();
+    gRAGStubSupportsBatch = NO;
+    RAGClient *fanOutClient = makeClient();
+    runBatch(fanOutClient, @[[RAGSearchQuery queryWithText:@"warm" k:1 chatFilter:0],
+                             [RAGSearchQuery queryWithText:@"up" k:1 chatFilter:0]]);
+    NSLog(@"After a 404 from /search/batch: supportsBatchSearch = %@ (expected NO)",
+          fanOutClient.supportsBatchSearch ? @"YES" : @"NO");
+
+    // The stub isn't bound by per-host connection limits, so fan-out here is its best case
+    for (NSNumber *size in @[@1, @10, @50]) {
+        NSMutableArray<RAGSearchQuery *> *queries = [NSMutableArray array];
+        for (NSInteger i = 0; i < size.integerValue; i++) {
+            [queries addObject:[RAGSearchQuery queryWithText:[NSString stringWithFormat:@"query %ld", (long)i]
+                                                           k:5
+                                                  chatFilter:i % 3]];
+        }
+
+        NSTimeInterval sequential = 0;
+        for (RAGSearchQuery *query in queries) {
+            sequential += runBatch(fanOutClient, @[query]);
+        }
+        NSTimeInterval fanOut = runBatch(fanOutClient, queries);
+        gRAGStubSupportsBatch = YES;
+        NSTimeInterval batched = runBatch(batchClient, queries);
+        gRAGStubSupportsBatch = NO;
+
+        NSLog(@"%2ld queries: one by one %5.0fms, fan-out %5.0fms, batch endpoint %5.0fms",
+              (long)size.integerValue, sequential * 1000.0, fanOut * 1000.0, batched * 1000.0);
+    }
+    gRAGStubSupportsBatch = YES;
+    NSLog(@"Misrouted results: %lu (expected 0)", (unsigned long)misrouted);
+
+    NSLog(@"\n=== END BATCH SEARCH BENCHMARK ===\n");
+}
+
++ (void)testMessageCellDecoder {
+    // Foundation-only, so it also builds and runs headless
+    [WAMessageCellDecoderTest runRecordedCellChecks];
+}
+
++ (void)testSendQueueOpenChat {
+    NSLog(@"\n\n=== SEND QUEUE OPEN CHAT TESTS (fake chat) ===\n");
+
+    __block NSUInteger passed = 0, failed = 0;
+    void (^check)(NSString *, id, id) = ^(NSString *label, id actual, id expected) {
+        BOOL ok = actual == expected || [actual isEqual:expected];
+        ok ? passed++ : failed++;
+        NSLog(@"%@ %@: %@%@", ok ? @"PASS" : @"FAIL", label, actual ?: @"nil",
+              ok ? @"" : [NSString stringWithFormat:@" (expected %@)", expected ?: @"nil"]);
+    };
+
+    // Already open under a longer header: opening leaves it unchanged, which must count
+    WAFakeChatAccessibility *open = [[WAFakeChatAccessibility alloc] init];
+    open.header = @"Igor B";
+    WASendQueue *queue = [[WASendQueue alloc] initWithAccessibility:open];
+    queue.initialBackoff = 0.01;
+    queue.confirmTimeout = 0.5;
+    [queue enqueueMessage:@"See you at 10" toChat:@"igor"];
+    [queue enqueueMessage:@"Bring the clock" toChat:@"igor"];
+    NSDictionary *response = [queue run];
+    check(@"'igor' with 'Igor B' open: confirmed", response[@"confirmed"], @2);
+    check(@"'igor' with 'Igor B' open: failed", response[@"failed"], @0);
+    check(@"'igor' with 'Igor B' open: sent to", [response[@"results"] firstObject][@"chat"], @"Igor B");
+    check(@"'igor' with 'Igor B' open: attempts", [response[@"results"] firstObject][@"attempts"], @1);
+    check(@"'igor' with 'Igor B' open: messages in chat", @(open.transcript.count), @2);
+
+    // Another chat open and the header never switches: nothing is sent
+    WAFakeChatAccessibility *other = [[WAFakeChatAccessibility alloc] init];
+    other.header = @"Mama";
+    queue = [[WASendQueue alloc] initWithAccessibility:other];
+    queue.maxAttempts = 1;
+    [queue enqueueMessage:@"See you at 10" toChat:@"igor"];
+    response = [queue run];
+    check(@"'igor' with 'Mama' open: failed", response[@"failed"], @1);
+    check(@"'igor' with 'Mama' open: messages in chat", @(other.transcript.count), @0);
+
+    // Header switches to the chat: sent there
+    other.openHeader = @"Igor Berezovsky";
+    queue = [[WASendQueue alloc] initWithAccessibility:other];
+    [queue enqueueMessage:@"See you at 10" toChat:@"igor"];
+    response = [queue run];
+    check(@"'igor' after switch: sent to", [response[@"results"] firstObject][@"chat"], @"Igor Berezovsky");
+    check(@"'igor' after switch: confirmed", response[@"confirmed"], @1);
+
+    check(@"header 'Igor B' names 'igor'", @([WAAccessibility chatHeader:@"Igor B" namesChat:@"igor"]), @YES);
+    check(@"header 'Игорь Петров' names 'igor petrov'", @([WAAccessibility chatHeader:@"Игорь Петров" namesChat:@"igor petrov"]), @YES);
+    check(@"header 'Mama' names 'igor'", @([WAAccessibility chatHeader:@"Mama" namesChat:@"igor"]), @NO);
+
+    NSLog(@"Send queue open chat: %lu passed, %lu failed", (unsigned long)passed, (unsigned long)failed);
+    NSLog(@"\n=== END SEND QUEUE OPEN CHAT TESTS ===\n");
+}
+
++ (void)testResultPager {
+    NSLog(@"\n\n=== RESULT PAGER TESTS (no WhatsApp needed) ===\n");
+
+    __block NSUInteger passed = 0, failed = 0;
+    void (^check)(NSString *, id, id) = ^(NSString *label, id actual, id expected) {
+        BOOL ok = actual == expected || [actual isEqual:expected];
+        ok ? passed++ : failed++;
+        NSLog(@"%@ %@: %@%@", ok ? @"PASS" : @"FAIL", label, actual ?: @"nil",
+              ok ? @"" : [NSString stringWithFormat:@" (expected %@)", expected ?: @"nil"]);
+    };
+
+    NSMutableArray<NSDictionary *> *items = [NSMutableArray array];
+    for (NSInteger i = 0; i < 45; i++) {
+        [items addObject:@{@"n": @(i)}];
+    }
+    WAResultPager *pager = [WAResultPager shared];
+
+    // 45 items by 20: two full pages, then the last five with no cursor
+    WAResultPage *first = [pager firstPageOfItems:items limit:20];
+    check(@"first page: items", [first.items valueForKey:@"n"], [[items subarrayWithRange:NSMakeRange(0, 20)] valueForKey:@"n"]);
+    check(@"first page: total", @(first.total), @45);
+    check(@"first page: has cursor", @(first.nextCursor.length > 0), @YES);
+
+    NSError *error = nil;
+    WAResultPage *second = [pager pageForCursor:first.nextCursor limit:0 error:&error];
+    check(@"second page: items (limit of the first page)", [second.items valueForKey:@"n"],
+          [[items subarrayWithRange:NSMakeRange(20, 20)] valueForKey:@"n"]);
+    check(@"second page: new cursor", @(second.nextCursor.length > 0 && ![second.nextCursor isEqualToString:first.nextCursor]), @YES);
+
+    WAResultPage *last = [pager pageForCursor:second.nextCursor limit:0 error:&error];
+    check(@"last page: items", [last.items valueForKey:@"n"], [[items subarrayWithRange:NSMakeRange(40, 5)] valueForKey:@"n"]);
+    check(@"last page: no cursor", last.nextCursor, nil);
+    check(@"last page: total", @(last.total), @45);
+
+    WAResultPage *exact = [pager firstPageOfItems:[items subarrayWithRange:NSMakeRange(0, 20)] limit:20];
+    check(@"exactly one page: no cursor", exact.nextCursor, nil);
+
+    // A used cursor and a made-up one are both refused
+    error = nil;
+    check(@"replayed cursor: page", [pager pageForCursor:first.nextCursor limit:0 error:&error], nil);
+    check(@"replayed cursor: error", @(error.code), @1);
+    error = nil;
+    check(@"unknown cursor: page", [pager pageForCursor:@"not-a-cursor" limit:0 error:&error], nil);
+    check(@"unknown cursor: error", error.domain, @"WAResultPager");
+
+    // Through whatsapp_batch: a cursor-only search pages without touching WhatsApp
+    WAResultPage *searchPage = [pager firstPageOfItems:items limit:20];
+    WABatchExecutor *executor = [[WABatchExecutor alloc] initWithAccessibility:[[WAFakeChatAccessibility alloc] init]];
+    NSDictionary *response = [executor runWithArguments:@{
+        @"operations": @[@{@"op": @"search", @"cursor": searchPage.nextCursor, @"limit": @30}],
+        @"clear_search": @NO
+    }];
+    NSDictionary *result = [response[@"results"] firstObject];
+    check(@"batch cursor: ok", result[@"ok"], @YES);
+    check(@"batch cursor: matches", [result[@"message_matches"] valueForKey:@"n"],
+          [[items subarrayWithRange:NSMakeRange(20, 25)] valueForKey:@"n"]);
+    check(@"batch cursor: total", result[@"total_message_matches"], @45);
+    check(@"batch cursor: last page", result[@"next_cursor"], nil);
+
+    response = [executor runWithArguments:@{
+        @"operations": @[@{@"op": @"search", @"cursor": searchPage.nextCursor}],
+        @"clear_search": @NO
+    }];
+    result = [response[@"results"] firstObject];
+    check(@"batch replayed cursor: ok", result[@"ok"], @NO);
+    check(@"batch replayed cursor: error", @([result[@"error"] length] > 0), @YES);
+
+    NSString *parseError = nil;
+    check(@"search without query or cursor: rejected",
+          [WABatchOperation operationWithDictionary:@{@"op": @"search"} index:0 error:&parseError], nil);
+    check(@"search with cursor only: parsed",
+          [WABatchOperation operationWithDictionary:@{@"op": @"search", @"cursor": @"c"} index:0 error:&parseError].cursor, @"c");
+
+    // since: HH:MM keeps messages from the bound's most recent occurrence
+    WAAccessibility *accessibility = [[WAAccessibility alloc] init];
+    NSArray<WAMessage *> *(^messagesAt)(NSArray<NSString *> *) = ^NSArray<WAMessage *> *(NSArray<NSString *> *times) {
+        NSMutableArray<WAMessage *> *messages = [NSMutableArray array];
+        for (NSString *time in times) {
+            WAMessage *message = [[WAMessage alloc] init];
+            message.text = time;
+            message.timestamp = time.length > 0 ? time : nil;
+            [messages addObject:message];
+        }
+        return messages;
+    };
+    NSUInteger (^firstSince)(NSArray<NSString *> *, NSString *) = ^NSUInteger(NSArray<NSString *> *times, NSString *since) {
+        return [accessibility indexOfFirstMessage:messagesAt(times) since:[accessibility minutesFromTimestamp:since]];
+    };
+
+    check(@"since 12:00 same day", @(firstSince(@[@"11:00", @"11:59", @"12:00", @"12:30"], @"12:00")), @2);
+    check(@"since 23:30 read after midnight", @(firstSince(@[@"23:00", @"23:30", @"23:50", @"00:05", @"00:10"], @"23:30")), @1);
+    check(@"since 23:30 before midnight", @(firstSince(@[@"22:00", @"23:45"], @"23:30")), @1);
+    check(@"since 18:00 read next morning", @(firstSince(@[@"17:00", @"18:30", @"08:00", @"09:00"], @"18:00")), @1);
+    check(@"since 09:00 untimed rows stay in", @(firstSince(@[@"08:00", @"09:15", @"", @"09:20"], @"09:00")), @1);
+    check(@"since '9:5' parses", @([accessibility minutesFromTimestamp:@"9:5"]), @545);
+    check(@"since '25:00' rejected", @([accessibility minutesFromTimestamp:@"25:00"]), @-1);
+
+    NSLog(@"Result pager: %lu passed, %lu failed", (unsigned long)passed, (unsigned long)failed);
+    NSLog(@"\n=== END RESULT PAGER TESTS ===\n");
+}
+
++ (void)testChatDirectory {
+    NSLog(@"\n\n=== CHAT DIRECTORY TESTS (no WhatsApp needed) ===\n");
+
+    WAChatDirectory *directory = [[WAChatDirectory alloc] init];
+    [directory addNames:@[@"Igor Berezovsky", @"Игорь Петров", @"Zoë Martin", @"Mama",
+                          @"Tania Melamed", @"Grasse Chess Club"]];
+
+    __block NSUInteger passed = 0, failed = 0;
+    void (^check)(NSString *, NSString *, NSString *) = ^(NSString *label, NSString *actual, NSString *expected) {
+        BOOL ok = actual == expected || [actual isEqualToString:expected];
+        ok ? passed++ : failed++;
+        NSLog(@"%@ %@: %@%@", ok ? @"PASS" : @"FAIL", label, actual ?: @"nil",
+              ok ? @"" : [NSString stringWithFormat:@" (expected %@)", expected ?: @"nil"]);
+    };
+    NSString *(^top)(NSString *) = ^NSString *(NSString *query) {
+        return [directory matchesForQuery:query limit:1].firstObject.name;
+    };
+
+    // Transliteration and folding
+    check(@"normalized 'Игорь Петров'", [WAChatDirectory normalizedName:@"Игорь Петров"], @"igor petrov");
+    check(@"normalized 'Zoë  MARTIN!'", [WAChatDirectory normalizedName:@"Zoë  MARTIN!"], @"zoe martin");
+    check(@"'петров' (Cyrillic query)", top(@"петров"), @"Игорь Петров");
+    check(@"'petrov' (Latin query, Cyrillic name)", top(@"petrov"), @"Игорь Петров");
+    check(@"'zoe'", top(@"zoe"), @"Zoë Martin");
+
+    // Queries under three characters are substrings the trigram index can't find
+    check(@"'vs' (mid-word)", top(@"vs"), @"Igor Berezovsky");
+    check(@"'ss' (mid-word)", top(@"ss"), @"Grasse Chess Club");
+    check(@"'ig' matches both Igors", [@([directory matchesForQuery:@"ig" limit:0].count) stringValue], @"2");
+
+    // Ranking and thresholds
+    check(@"best 'mama'", [directory bestMatchForQuery:@"mama"].name, @"Mama");
+    check(@"'Tanya Melamed' (typo, fuzzy)", top(@"Tanya Melamed"), @"Tania Melamed");
+    check(@"best 'Tanya Melamed' (fuzzy is not enough)", [directory bestMatchForQuery:@"Tanya Melamed"].name, nil);
+    check(@"among visible names", [directory bestMatchForQuery:@"chess" amongNames:@[@"Mama", @"Grasse Chess Club"]].name,
+          @"Grasse Chess Club");
+
+    // Each account's accessor resolves names and indexes messages on its own
+    WAAccessibility *business = [[WAAccessibility alloc] initWithBundleIdentifier:[WAAccessibility supportedBundleIdentifiers].lastObject
+                                                                              pid:0];
+    [business.chatDirectory addNames:@[@"Supplier Orders"]];
+    check(@"shared accessor uses the shared directory",
+          @([WAAccessibility shared].chatDirectory == [WAChatDirectory shared]), @YES);
+    check(@"business accessor has its own directory",
+          @(business.chatDirectory != [WAChatDirectory shared]), @YES);
+    check(@"business chat not in the shared directory",
+          [[WAChatDirectory shared] bestMatchForQuery:@"Supplier Orders"].name, nil);
+    check(@"business accessor has its own index",
+          @(business.localRetriever != [WAAccessibility shared].localRetriever), @YES);
+    check(@"business index is reused by name",
+          @(business.localRetriever == [WALocalRetriever retrieverNamed:@"business"]), @YES);
+
+    NSLog(@"Chat directory: %lu passed, %lu failed", (unsigned long)passed, (unsigned long)failed);
+    NSLog(@"\n=== END CHAT DIRECTORY TESTS ===\n");
+}
+
+/// User plus system CPU time of this process, in seconds
+static NSTimeInterval WAProcessCPUTime(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+         + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+/// Next message from the fake app's end of a socketpair: a JSON line, or a
+/// frame once MessagePack is negotiated. nil on EOF or malformed input.
+static NSDictionary *WAFakeAppReadMessage(int fd, NSMutableData *buffer, BOOL binary) {
+    while (YES) {
+        if (binary) {
+            NSError *error = nil;
+            id message = [MCPMsgPack nextObjectFromBuffer:buffer error:&error];
+            if (error) return nil;
+            if (message) return message;
+        } else {
+            NSRange newline = [buffer rangeOfData:[NSData dataWithBytes:"\n" length:1]
+                                          options:0
+                                            range:NSMakeRange(0, buffer.length)];
+            if (newline.location != NSNotFound) {
+                NSData *line = [buffer subdataWithRange:NSMakeRange(0, newline.location)];
+                [buffer replaceBytesInRange:NSMakeRange(0, NSMaxRange(newline)) withBytes:NULL length:0];
+                return [NSJSONSerialization JSONObjectWithData:line options:0 error:nil];
+            }
+        }
+        uint8_t chunk[16384];
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n <= 0) return nil;
+        [buffer appendBytes:chunk length:n];
+    }
+}
+
+/// message as the fake app writes it in the given framing
+static NSData *WAFakeAppEncode(NSDictionary *message, BOOL binary) {
+    if (binary) return [MCPMsgPack frameWithObject:message];
+    NSMutableData *line = [[NSJSONSerialization dataWithJSONObject:message options:0 error:nil] mutableCopy];
+    [line appendBytes:"\n" length:1];
+    return line;
+}
+
+static BOOL WAFakeAppWrite(int fd, NSData *data) {
+    const uint8_t *bytes = data.bytes;
+    for (NSUInteger offset = 0; offset < data.length; ) {
+        ssize_t n = write(fd, bytes + offset, data.length - offset);
+        if (n <= 0) return NO;
+        offset += (NSUInteger)n;
+    }
+    return YES;
+}
+
+/// The app's side of the socket in a background thread: answers initialize,
+/// choosing MessagePack if acceptMsgPack, then answers every request with
+/// result under the request's id until the shim side closes. A greeting goes
+/// out in the same write as the initialize response, in the chosen framing,
+/// so the shim reads both at once. Owns fd.
+static void WAServeFakeApp(int fd, BOOL acceptMsgPack, NSDictionary *result, NSDictionary *greeting) {
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        NSMutableData *buffer = [NSMutableData data];
+        NSDictionary *initialize = WAFakeAppReadMessage(fd, buffer, NO);
+        NSMutableDictionary *capabilities = [@{@"tools": @{}} mutableCopy];
+        if (acceptMsgPack) {
+            capabilities[@"experimental"] = @{@"mcpwa/transport": @{@"framing": MCPFramingMsgPack}};
+        }
+        NSDictionary *initResponse = @{@"jsonrpc": @"2.0", @"id": initialize[@"id"] ?: [NSNull null],
+                                       @"result": @{@"protocolVersion": @"2024-11-05", @"capabilities": capabilities}};
+        NSMutableData *reply = [WAFakeAppEncode(initResponse, NO) mutableCopy];
+        if (greeting) [reply appendData:WAFakeAppEncode(greeting, acceptMsgPack)];
+        BOOL alive = initialize && WAFakeAppWrite(fd, reply);
+
+        NSDictionary *message;
+        while (alive && (message = WAFakeAppReadMessage(fd, buffer, acceptMsgPack))) {
+            if (!message[@"id"]) continue;  // notifications/initialized
+            @autoreleasepool {
+                NSDictionary *response = @{@"jsonrpc": @"2.0", @"id": message[@"id"], @"result": result};
+                alive = WAFakeAppWrite(fd, WAFakeAppEncode(response, acceptMsgPack));
+            }
+        }
+        close(fd);
+    });
+}
+
+/// A shim connection wired to a fake app over a socketpair (handshake not yet done)
+static MCPServerConnection *WAConnectFakeApp(BOOL acceptMsgPack, NSDictionary *result, NSDictionary *greeting) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return nil;
+    int one = 1;
+    setsockopt(fds[0], SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+    setsockopt(fds[1], SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+    WAServeFakeApp(fds[1], acceptMsgPack, result, greeting);
+    return [[MCPServerConnection alloc] initWithFileDescriptor:fds[0]];
+}
+
++ (void)testShimFraming {
+    NSLog(@"\n\n=== SHIM FRAMING TESTS (fake server) ===\n");
+
+    // Round trip: every JSON-RPC value type, decoded from frames delivered a byte at a time
+    NSArray *messages = @[
+        @{@"jsonrpc": @"2.0", @"id": @1, @"result": @{@"tools": @[], @"isError": @NO}},
+        @{@"jsonrpc": @"2.0", @"method": @"notifications/progress",
+          @"params": @{@"progressToken": @"t-1", @"progress": @0.25, @"total": @4}},
+        @{@"jsonrpc": @"2.0", @"id": @"abc", @"result": @{
+              @"text": @"да, теперь стартует! 👍", @"empty": @"", @"none": [NSNull null],
+              @"negative": @(-40000), @"large": @(5000000000LL), @"flag": @YES,
+              @"nested": @[@[@1, @2], @{@"k": @"v"}]}},
+        @{@"jsonrpc": @"2.0", @"id": @2, @"result": @{@"content": @[
+              @{@"type": @"text", @"text": [@"" stringByPaddingToLength:70000 withString:@"x" startingAtIndex:0]}]}}
+    ];
+    NSMutableData *stream = [NSMutableData data];
+    for (NSDictionary *message in messages) {
+        [stream appendData:[MCPMsgPack frameWithObject:message]];
+    }
+    NSMutableData *buffer = [NSMutableData data];
+    NSMutableArray *decoded = [NSMutableArray array];
+    NSError *error = nil;
+    const uint8_t *bytes = stream.bytes;
+    for (NSUInteger i = 0; i < stream.length && !error; i++) {
+        [buffer appendBytes:bytes + i length:1];
+        id message;
+        while ((message = [MCPMsgPack nextObjectFromBuffer:buffer error:&error])) {
+            [decoded addObject:message];
+        }
+    }
+    NSUInteger matched = 0;
+    for (NSUInteger i = 0; i < MIN(decoded.count, messages.count); i++) {
+        if ([decoded[i] isEqual:messages[i]]) matched++;
+    }
+    NSLog(@"Round trip: %lu/%lu messages equal, %lu bytes left, error: %@ (expected %lu/%lu, 0, none)",
+          (unsigned long)matched, (unsigned long)messages.count, (unsigned long)buffer.length,
+          error.localizedDescription ?: @"none", (unsigned long)messages.count, (unsigned long)messages.count);
+    NSNumber *flag = decoded.count > 2 ? decoded[2][@"result"][@"flag"] : nil;
+    NSLog(@"Booleans stay booleans: %@ (expected YES)",
+          flag && CFGetTypeID((__bridge CFTypeRef)flag) == CFBooleanGetTypeID() ? @"YES" : @"NO");
+
+    // Oversized length prefix is an error, not a wait for more bytes
+    uint32_t oversized = CFSwapInt32HostToBig(MCPMaxFrameLength + 1);
+    NSMutableData *bad = [NSMutableData dataWithBytes:&oversized length:4];
+    error = nil;
+    [MCPMsgPack nextObjectFromBuffer:bad error:&error];
+    NSLog(@"Oversized frame rejected: %@ (expected YES)", error ? @"YES" : @"NO");
+
+    // Benchmark: a server answering list_chats pages with progress notifications,
+    // read by the shim in 16KB chunks and written to the client as JSON lines
+    NSMutableArray *chats = [NSMutableArray array];
+    for (NSInteger i = 0; i < 50; i++) {
+        [chats addObject:@{@"name": [NSString stringWithFormat:@"Chat %ld", (long)i],
+                           @"last_message": @"Tournament in Grasse is moved to Sunday, 10:00 start",
+                           @"timestamp": @"12:24", @"sender": @"Igor Berezovsky",
+                           @"is_pinned": @(i < 3), @"is_group": @(i % 4 == 0),
+                           @"is_unread": @(i % 7 == 0), @"index": @(i)}];
+    }
+    NSDictionary *page = @{@"jsonrpc": @"2.0", @"id": @1, @"result": @{@"content": @[
+        @{@"type": @"text", @"text": @"50 chats"}], @"structuredContent": @{@"chats": chats, @"next_cursor": @"c50"}}};
+    NSDictionary *progress = @{@"jsonrpc": @"2.0", @"method": @"notifications/progress",
+                               @"params": @{@"progressToken": @"p", @"progress": @1, @"total": @3}};
+    const NSUInteger responses = 500;
+    const NSUInteger chunkSize = 16384;
+
+    for (NSNumber *binary in @[@NO, @YES]) {
+        NSTimeInterval cpu = WAProcessCPUTime();
+        NSMutableData *wire = [NSMutableData data];
+        for (NSUInteger i = 0; i < responses; i++) {
+            for (NSDictionary *message in @[progress, page]) {
+                if (binary.boolValue) {
+                    [wire appendData:[MCPMsgPack frameWithObject:message]];
+                } else {
+                    [wire appendData:[NSJSONSerialization dataWithJSONObject:message options:0 error:nil]];
+                    [wire appendBytes:"\n" length:1];
+                }
+            }
+        }
+        NSTimeInterval serverCPU = WAProcessCPUTime() - cpu;
+
+        // Shim side, as its forwarder does it
+        cpu = WAProcessCPUTime();
+        NSMutableData *pending = [NSMutableData data];
+        NSUInteger forwarded = 0, clientBytes = 0;
+        for (NSUInteger offset = 0; offset < wire.length; offset += chunkSize) {
+            @autoreleasepool {
+                [pending appendData:[wire subdataWithRange:NSMakeRange(offset, MIN(chunkSize, wire.length - offset))]];
+                if (binary.boolValue) {
+                    id message;
+                    while ((message = [MCPMsgPack nextObjectFromBuffer:pending error:NULL])) {
+                        clientBytes += [NSJSONSerialization dataWithJSONObject:message options:0 error:nil].length + 1;
+                        forwarded++;
+                    }
+                } else {
+                    NSRange newline = [pending rangeOfData:[NSData dataWithBytes:"\n" length:1]
+                                                   options:NSDataSearchBackwards
+                                                     range:NSMakeRange(0, pending.length)];
+                    if (newline.location == NSNotFound) continue;
+                    NSData *complete = [pending subdataWithRange:NSMakeRange(0, NSMaxRange(newline))];
+                    const char *start = complete.bytes;
+                    for (NSUInteger i = 0; i < complete.length; i++) {
+                        if (start[i] == '\n') forwarded++;
+                    }
+                    clientBytes += complete.length;
+                    [pending replaceBytesInRange:NSMakeRange(0, NSMaxRange(newline)) withBytes:NULL length:0];
+                }
+            }
+        }
+        NSTimeInterval shimCPU = WAProcessCPUTime() - cpu;
+
+        NSLog(@"%@: %lu bytes on the socket, %lu messages and %lu bytes to the client, "
+              @"server encode %.0fms CPU, shim %.0fms CPU",
+              binary.boolValue ? @"MessagePack frames" : @"JSON lines        ",
+              (unsigned long)wire.length, (unsigned long)forwarded, (unsigned long)clientBytes,
+              serverCPU * 1000.0, shimCPU * 1000.0);
+    }
+    NSLog(@"Expected %lu messages forwarded in both modes", (unsigned long)responses * 2);
+
+    // Over a socketpair: each connection keeps the framing its own handshake
+    // picked, also while another connection negotiates something else
+    MCPServerConnection *framed = WAConnectFakeApp(YES, page[@"result"], nil);
+    MCPServerConnection *plain = WAConnectFakeApp(NO, page[@"result"], nil);
+    BOOL framedUp = [framed initializeWithTimeout:2.0] != nil;
+    BOOL plainUp = [plain initializeWithTimeout:2.0] != nil;
+    NSLog(@"Handshakes: MessagePack side %@, JSON side %@ (expected YES, YES)",
+          framedUp ? @"YES" : @"NO", plainUp ? @"YES" : @"NO");
+    NSLog(@"Framing after both handshakes: %@ and %@ (expected msgpack and json)",
+          framed.binaryFraming ? @"msgpack" : @"json", plain.binaryFraming ? @"msgpack" : @"json");
+
+    // Round trips of a 50-chat page through each connection, interleaved so a
+    // shared framing flag would garble one side
+    const NSUInteger roundTrips = 200;
+    NSTimeInterval elapsed[2] = {0, 0};
+    NSUInteger answered[2] = {0, 0};
+    NSArray<MCPServerConnection *> *connections = @[plain, framed];
+    for (NSUInteger i = 0; i < roundTrips; i++) {
+        for (NSUInteger side = 0; side < connections.count; side++) {
+            @autoreleasepool {
+                NSDictionary *request = @{@"jsonrpc": @"2.0", @"id": @(i + 1), @"method": @"tools/call",
+                                          @"params": @{@"name": @"whatsapp_list_chats", @"arguments": @{}}};
+                CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+                NSDictionary *response = nil;
+                @try {
+                    [connections[side] sendMessage:request];
+                    response = [connections[side] readResponseWithId:request[@"id"] timeout:2.0];
+                } @catch (NSException *e) {
+                    response = nil;
+                }
+                elapsed[side] += CFAbsoluteTimeGetCurrent() - start;
+                if ([response[@"result"] isEqual:page[@"result"]]) answered[side]++;
+            }
+        }
+    }
+    for (NSUInteger side = 0; side < connections.count; side++) {
+        NSLog(@"%@ round trips: %lu/%lu answered, %.3fms each",
+              side ? @"MessagePack" : @"JSON       ", (unsigned long)answered[side], (unsigned long)roundTrips,
+              elapsed[side] * 1000.0 / roundTrips);
+    }
+
+    // The initialize response and the first server message in one read: the
+    // message stays buffered and is the first thing forwarded to the client
+    for (NSNumber *binary in @[@NO, @YES]) {
+        MCPServerConnection *connection = WAConnectFakeApp(binary.boolValue, @{}, progress);
+        BOOL up = [connection initializeWithTimeout:2.0] != nil;
+        NSMutableArray<NSDictionary *> *forwarded = [NSMutableArray array];
+        dispatch_semaphore_t first = dispatch_semaphore_create(0);
+        dispatch_semaphore_t drained = dispatch_semaphore_create(0);
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            [connection forwardServerMessagesTo:^(NSData *lines) {
+                for (NSString *line in [[[NSString alloc] initWithData:lines encoding:NSUTF8StringEncoding]
+                                        componentsSeparatedByString:@"\n"]) {
+                    if (line.length == 0) continue;
+                    id message = [NSJSONSerialization JSONObjectWithData:[line dataUsingEncoding:NSUTF8StringEncoding]
+                                                                 options:0 error:nil];
+                    @synchronized (forwarded) {
+                        [forwarded addObject:message ?: @{}];
+                    }
+                }
+                dispatch_semaphore_signal(first);
+            }];
+            dispatch_semaphore_signal(drained);
+        });
+        dispatch_semaphore_wait(first, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(2 * NSEC_PER_SEC)));
+        [connection shutdown];
+        dispatch_semaphore_wait(drained, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(2 * NSEC_PER_SEC)));
+        NSArray<NSDictionary *> *seen;
+        @synchronized (forwarded) {
+            seen = [forwarded copy];
+        }
+        NSLog(@"Handshake and first %@ in one read: handshake %@, forwarded %lu, first is the progress notification %@ "
+              @"(expected YES, 1, YES)",
+              binary.boolValue ? @"frame" : @"line ", up ? @"YES" : @"NO", (unsigned long)seen.count,
+              [seen.firstObject isEqual:progress] ? @"YES" : @"NO");
+    }
+
+    NSLog(@"\n=== END SHIM FRAMING TESTS ===\n");
+}
+
 #pragma mark - Chat Filter Tests
 
 + (void)testGetChatFilter {
@@ -0,0 +1,86 @@
+// WABatchPlanner.h
+// Planning and execution for the whatsapp_batch tool
+
+#import <Foundation/Foundation.h>
+
+@class WAAccessibility;
+@class WAProgressReporter;
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(NSInteger, WABatchOperationKind) {
+    WABatchOperationOpen,
+    WABatchOperationRead,
+    WABatchOperationSearch,
+    WABatchOperationSend,
+    WABatchOperationFilter
+};
+
+/// One entry of the batch "operations" argument
+@interface WABatchOperation : NSObject
+@property (nonatomic, assign) WABatchOperationKind kind;
+@property (nonatomic, assign) NSUInteger index;               // Position in the request
+@property (nonatomic, copy, nullable) NSString *chat;         // open/read/send; reads and sends inherit the previous chat
+@property (nonatomic, copy, nullable) NSString *text;         // search query or message to send
+@property (nonatomic, copy, nullable) NSString *filter;       // filter, or search filter
+@property (nonatomic, assign) NSInteger limit;                // read/search; 0 = default
+@property (nonatomic, copy, nullable) NSArray<NSString *> *fields;  // read
+@property (nonatomic, copy, nullable) NSString *since;        // read: HH:MM or a message fingerprint
+@property (nonatomic, assign) NSTimeInterval maxAge;          // read: accept a prefetched copy this old; 0 = read the UI
+@property (nonatomic, copy, nullable) NSString *cursor;       // search: next_cursor of an earlier search; query is then ignored
+
+/// Parse {"op": "open"|"read"|"search"|"send"|"filter", ...}; nil with *error if malformed
++ (nullable instancetype)operationWithDictionary:(NSDictionary *)dictionary
+                                           index:(NSUInteger)index
+                                           error:(NSString * _Nullable * _Nullable)error;
+
+/// "open", "read", ...
++ (NSString *)nameForKind:(WABatchOperationKind)kind;
+@end
+
+/**
+ * Orders batch operations to minimise UI navigation.
+ *
+ * Sends, searches and filter changes are barriers and keep their position.
+ * Between barriers, opens and reads are grouped by chat (chats in order of
+ * first mention, each chat's operations in request order), so every chat is
+ * opened once per run of reads instead of once per read.
+ */
+@interface WABatchPlanner : NSObject
+
+/// Parse the tool's "operations" array; nil with *error on the first malformed entry
++ (nullable NSArray<WABatchOperation *> *)operationsFromArray:(NSArray *)array
+                                                        error:(NSString * _Nullable * _Nullable)error;
+
+/// Execution order for operations
++ (NSArray<WABatchOperation *> *)planOperations:(NSArray<WABatchOperation *> *)operations;
+
+@end
+
+/**
+ * Runs a planned batch against WhatsApp in one call, tracking which chat is
+ * open, the last search and the active filter so repeated opens, identical
+ * searches and no-op filter changes are skipped.
+ */
+@interface WABatchExecutor : NSObject
+
+- (instancetype)initWithAccessibility:(WAAccessibility *)accessibility NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Leave the chat list out of search mode when done (default YES)
+@property (nonatomic, assign) BOOL clearSearchWhenDone;
+
+/// Reports one stage per operation, with that operation's result as the partial
+@property (nonatomic, strong, nullable) WAProgressReporter *progress;
+
+/// Run the tool arguments {"operations": [...], "clear_search": bool}.
+/// Returns {"results": [...] in request order, "plan": [request indexes in run order], "total_ms": n},
+/// or {"error": "..."} if the arguments are invalid or WhatsApp is unavailable.
+- (NSDictionary *)runWithArguments:(NSDictionary *)arguments;
+
+/// Run already-parsed operations (planned here)
+- (NSDictionary *)runOperations:(NSArray<WABatchOperation *> *)operations;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,522 @@
+// WABatchPlanner.m
+// Planning and execution for the whatsapp_batch tool
+
+#import "WABatchPlanner.h"
+#import "WAAccessibility.h"
+#import "WAChatPrefetcher.h"
+#import "WALocalRetriever.h"
+#import "WAProgressReporter.h"
+#import "WAResultPager.h"
+#import "WALogger.h"
+
+static const NSTimeInterval kOpenSettleTimeout = 1.0;   // Max wait for the header to show the new chat
+static const NSTimeInterval kOpenSettlePoll = 0.1;
+
+#pragma mark - WABatchOperation
+
+@implementation WABatchOperation
+
++ (NSString *)nameForKind:(WABatchOperationKind)kind {
+    switch (kind) {
+        case WABatchOperationOpen: return @"open";
+        case WABatchOperationRead: return @"read";
+        case WABatchOperationSearch: return @"search";
+        case WABatchOperationSend: return @"send";
+        case WABatchOperationFilter: return @"filter";
+    }
+    return @"unknown";
+}
+
+/// String argument or nil (empty strings count as missing)
+static NSString *WAStringArgument(NSDictionary *dictionary, NSString *key) {
+    id value = dictionary[key];
+    return [value isKindOfClass:[NSString class]] && [value length] > 0 ? value : nil;
+}
+
++ (instancetype)operationWithDictionary:(NSDictionary *)dictionary index:(NSUInteger)index error:(NSString **)error {
+    if (![dictionary isKindOfClass:[NSDictionary class]]) {
+        if (error) *error = [NSString stringWithFormat:@"operations[%lu] is not an object", (unsigned long)index];
+        return nil;
+    }
+
+    NSDictionary<NSString *, NSNumber *> *kinds = @{
+        @"open": @(WABatchOperationOpen),
+        @"read": @(WABatchOperationRead),
+        @"search": @(WABatchOperationSearch),
+        @"send": @(WABatchOperationSend),
+        @"filter": @(WABatchOperationFilter)
+    };
+    NSString *opName = WAStringArgument(dictionary, @"op");
+    NSNumber *kind = opName ? kinds[opName.lowercaseString] : nil;
+    if (!kind) {
+        if (error) *error = [NSString stringWithFormat:@"operations[%lu]: unknown op '%@'", (unsigned long)index, opName ?: @""];
+        return nil;
+    }
+
+    WABatchOperation *operation = [[WABatchOperation alloc] init];
+    operation.kind = kind.integerValue;
+    operation.index = index;
+    operation.chat = WAStringArgument(dictionary, @"chat");
+    operation.filter = WAStringArgument(dictionary, @"filter");
+    operation.since = WAStringArgument(dictionary, @"since");
+    operation.cursor = WAStringArgument(dictionary, @"cursor");
+    operation.limit = [dictionary[@"limit"] isKindOfClass:[NSNumber class]] ? [dictionary[@"limit"] integerValue] : 0;
+    operation.maxAge = [dictionary[@"max_age"] isKindOfClass:[NSNumber class]] ? [dictionary[@"max_age"] doubleValue] : 0;
+    if ([dictionary[@"fields"] isKindOfClass:[NSArray class]]) {
+        operation.fields = dictionary[@"fields"];
+    }
+
+    NSString *missing = nil;
+    switch (operation.kind) {
+        case WABatchOperationOpen:
+            if (!operation.chat) missing = @"chat";
+            break;
+        case WABatchOperationRead:
+            break;
+        case WABatchOperationSearch:
+            operation.text = WAStringArgument(dictionary, @"query");
+            if (!operation.text && !operation.cursor) missing = @"query";
+            break;
+        case WABatchOperationSend:
+            operation.text = WAStringArgument(dictionary, @"message");
+            if (!operation.text) missing = @"message";
+            break;
+        case WABatchOperationFilter:
+            if (!operation.filter) missing = @"filter";
+            break;
+    }
+    if (missing) {
+        if (error) *error = [NSString stringWithFormat:@"operations[%lu]: %@ requires '%@'", (unsigned long)index, opName, missing];
+        return nil;
+    }
+    return operation;
+}
+
+@end
+
+#pragma mark - WABatchPlanner
+
+@implementation WABatchPlanner
+
++ (NSArray<WABatchOperation *> *)operationsFromArray:(NSArray *)array error:(NSString **)error {
+    if (![array isKindOfClass:[NSArray class]] || array.count == 0) {
+        if (error) *error = @"operations must be a non-empty array";
+        return nil;
+    }
+
+    NSMutableArray<WABatchOperation *> *operations = [NSMutableArray arrayWithCapacity:array.count];
+    NSString *lastChat = nil;
+    for (NSUInteger i = 0; i < array.count; i++) {
+        WABatchOperation *operation = [WABatchOperation operationWithDictionary:array[i] index:i error:error];
+        if (!operation) return nil;
+
+        // Reads and sends without a chat act on the chat named most recently
+        // before them, so their target doesn't change when the plan reorders
+        BOOL takesChat = operation.kind == WABatchOperationRead || operation.kind == WABatchOperationSend;
+        if (takesChat && !operation.chat) {
+            operation.chat = lastChat;
+        }
+        if (operation.chat) {
+            lastChat = operation.chat;
+        }
+        [operations addObject:operation];
+    }
+    return operations;
+}
+
++ (NSArray<WABatchOperation *> *)planOperations:(NSArray<WABatchOperation *> *)operations {
+    NSMutableArray<WABatchOperation *> *plan = [NSMutableArray arrayWithCapacity:operations.count];
+    NSMutableArray<WABatchOperation *> *segment = [NSMutableArray array];
+
+    for (WABatchOperation *operation in operations) {
+        BOOL movable = (operation.kind == WABatchOperationOpen || operation.kind == WABatchOperationRead) &&
+                       operation.chat != nil;
+        if (movable) {
+            [segment addObject:operation];
+        } else {
+            // Sends change chat contents and searches/filters change what the
+            // list shows, so nothing moves across them
+            [self appendSegment:segment toPlan:plan];
+            [segment removeAllObjects];
+            [plan addObject:operation];
+        }
+    }
+    [self appendSegment:segment toPlan:plan];
+    return plan;
+}
+
+/// Append a run of opens/reads grouped by chat, chats in order of first mention
++ (void)appendSegment:(NSArray<WABatchOperation *> *)segment toPlan:(NSMutableArray<WABatchOperation *> *)plan {
+    NSMutableArray<NSString *> *chatOrder = [NSMutableArray array];
+    NSMutableDictionary<NSString *, NSMutableArray<WABatchOperation *> *> *byChat = [NSMutableDictionary dictionary];
+
+    for (WABatchOperation *operation in segment) {
+        NSString *key = operation.chat.lowercaseString;
+        if (!byChat[key]) {
+            byChat[key] = [NSMutableArray array];
+            [chatOrder addObject:key];
+        }
+        [byChat[key] addObject:operation];
+    }
+    for (NSString *key in chatOrder) {
+        [plan addObjectsFromArray:byChat[key]];
+    }
+}
+
+@end
+
+#pragma mark - WABatchExecutor
+
+@interface WABatchExecutor ()
+@property (nonatomic, strong) WAAccessibility *accessibility;
+
+// UI state as far as this batch knows it
+@property (nonatomic, copy, nullable) NSString *openChatName;                   // Header name of the open chat
+@property (nonatomic, assign) BOOL openChatKnown;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSString *> *resolvedNames;   // Lowercased request -> header name
+@property (nonatomic, copy, nullable) NSString *searchKey;                      // "filter|query" of results on screen
+@property (nonatomic, strong, nullable) WASearchResults *searchResults;
+@property (nonatomic, assign) WAChatFilter filter;
+@property (nonatomic, assign) BOOL filterKnown;
+@end
+
+@implementation WABatchExecutor
+
+- (instancetype)initWithAccessibility:(WAAccessibility *)accessibility {
+    self = [super init];
+    if (self) {
+        _accessibility = accessibility;
+        _clearSearchWhenDone = YES;
+    }
+    return self;
+}
+
+- (NSDictionary *)runWithArguments:(NSDictionary *)arguments {
+    NSString *error = nil;
+    NSArray<WABatchOperation *> *operations = [WABatchPlanner operationsFromArray:arguments[@"operations"] error:&error];
+    if (!operations) {
+        return @{@"error": error ?: @"invalid operations"};
+    }
+    if ([arguments[@"clear_search"] isKindOfClass:[NSNumber class]]) {
+        self.clearSearchWhenDone = [arguments[@"clear_search"] boolValue];
+    }
+    return [self runOperations:operations];
+}
+
+- (NSDictionary *)runOperations:(NSArray<WABatchOperation *> *)operations {
+    // The whole batch holds this instance's queue so no other tool call can
+    // move the UI between planned steps; other accounts are unaffected
+    __block NSDictionary *response = nil;
+    [self.accessibility performOperation:^{
+        response = [self runOperationsOnQueue:operations];
+    } named:@"whatsapp_batch"];
+    return response;
+}
+
+- (NSDictionary *)runOperationsOnQueue:(NSArray<WABatchOperation *> *)operations {
+    if (![self.accessibility isWhatsAppAvailable]) {
+        return @{@"error": @"WhatsApp is not running or accessibility permission is missing"};
+    }
+
+    CFAbsoluteTime batchStart = CFAbsoluteTimeGetCurrent();
+    [self resetState];
+
+    NSArray<WABatchOperation *> *plan = [WABatchPlanner planOperations:operations];
+    self.progress.totalStages = plan.count;
+    NSMutableArray *results = [NSMutableArray arrayWithCapacity:operations.count];
+    for (NSUInteger i = 0; i < operations.count; i++) {
+        [results addObject:[NSNull null]];
+    }
+
+    for (WABatchOperation *operation in plan) {
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        NSMutableDictionary *result = [NSMutableDictionary dictionary];
+        result[@"index"] = @(operation.index);
+        result[@"op"] = [WABatchOperation nameForKind:operation.kind];
+
+        NSString *error = nil;
+        BOOL ok = [self runOperation:operation result:result error:&error];
+        result[@"ok"] = @(ok);
+        if (error) result[@"error"] = error;
+        result[@"duration_ms"] = @(llround((CFAbsoluteTimeGetCurrent() - start) * 1000.0));
+
+        if (operation.index < results.count) {
+            results[operation.index] = result;
+        }
+        [self.progress completeStage:[NSString stringWithFormat:@"%@ %@", result[@"op"], ok ? @"done" : @"failed"]
+                             partial:result];
+    }
+
+    BOOL clearedSearch = NO;
+    if (self.clearSearchWhenDone && [self.accessibility isInSearchMode]) {
+        clearedSearch = [self.accessibility clearSearch];
+    }
+
+    NSInteger totalMs = llround((CFAbsoluteTimeGetCurrent() - batchStart) * 1000.0);
+    [WALogger info:@"batch: %lu operations in %ldms", (unsigned long)operations.count, (long)totalMs];
+
+    return @{
+        @"results": results,
+        @"plan": [plan valueForKey:@"index"],
+        @"cleared_search": @(clearedSearch),
+        @"total_ms": @(totalMs)
+    };
+}
+
+- (void)resetState {
+    self.openChatName = nil;
+    self.openChatKnown = NO;
+    self.resolvedNames = [NSMutableDictionary dictionary];
+    self.searchKey = nil;
+    self.searchResults = nil;
+    self.filterKnown = NO;
+}
+
+#pragma mark - Operations
+
+- (BOOL)runOperation:(WABatchOperation *)operation result:(NSMutableDictionary *)result error:(NSString **)error {
+    switch (operation.kind) {
+        case WABatchOperationOpen:
+            return [self runOpen:operation result:result error:error];
+        case WABatchOperationRead:
+            return [self runRead:operation result:result error:error];
+        case WABatchOperationSearch:
+            return [self runSearch:operation result:result error:error];
+        case WABatchOperationSend:
+            return [self runSend:operation result:result error:error];
+        case WABatchOperationFilter:
+            return [self runFilter:operation result:result error:error];
+    }
+    return NO;
+}
+
+- (BOOL)runOpen:(WABatchOperation *)operation result:(NSMutableDictionary *)result error:(NSString **)error {
+    BOOL reused = NO;
+    if (![self ensureChatOpen:operation.chat reused:&reused error:error]) return NO;
+    result[@"chat"] = self.openChatName ?: operation.chat;
+    result[@"reused"] = @(reused);
+    return YES;
+}
+
+- (BOOL)runRead:(WABatchOperation *)operation result:(NSMutableDictionary *)result error:(NSString **)error {
+    if ([self runCachedRead:operation result:result]) return YES;
+
+    if (operation.chat) {
+        BOOL reused = NO;
+        if (![self ensureChatOpen:operation.chat reused:&reused error:error]) return NO;
+        result[@"reused"] = @(reused);
+    }
+
+    NSInteger limit = operation.limit > 0 ? operation.limit : WAResultPager.defaultLimit;
+    WAMessageField fields = [WAAccessibility messageFieldsFromNames:operation.fields];
+    BOOL watermarkFound = NO;
+    NSArray<WAMessage *> *messages = [self.accessibility getMessagesWithLimit:limit
+                                                                       fields:fields
+                                                                        since:operation.since
+                                                               watermarkFound:&watermarkFound];
+    if ([WAAccessibility isMessageFingerprint:operation.since]) {
+        result[@"watermark_found"] = @(watermarkFound);
+    }
+
+    NSString *chatName = [self currentOpenChatName];
+    if (chatName.length > 0 && fields == WAMessageFieldAll) {
+        [self.accessibility.localRetriever addMessages:messages chatName:chatName];
+    }
+
+    NSMutableArray *items = [NSMutableArray arrayWithCapacity:messages.count];
+    for (WAMessage *message in messages) {
+        [items addObject:[message toDictionaryWithFields:fields]];
+    }
+    if (chatName) result[@"chat"] = chatName;
+    result[@"messages"] = items;
+    return YES;
+}
+
+/// Answer a read from the prefetch cache without opening the chat, if allowed and fresh enough
+- (BOOL)runCachedRead:(WABatchOperation *)operation result:(NSMutableDictionary *)result {
+    if (operation.maxAge <= 0 || !operation.chat || operation.since.length > 0) return NO;
+
+    NSInteger limit = operation.limit > 0 ? operation.limit : WAResultPager.defaultLimit;
+    if (limit > WAChatPrefetcher.messagesPerChat) return NO;
+
+    NSTimeInterval age = 0;
+    NSArray<WAMessage *> *messages = [self.accessibility.prefetcher cachedMessagesForChat:operation.chat
+                                                                                  maxAge:operation.maxAge
+                                                                                     age:&age];
+    if (!messages) return NO;
+
+    WAMessageField fields = [WAAccessibility messageFieldsFromNames:operation.fields];
+    NSMutableArray *items = [NSMutableArray arrayWithCapacity:MIN(messages.count, (NSUInteger)limit)];
+    for (WAMessage *message in messages) {
+        if (items.count >= (NSUInteger)limit) break;
+        [items addObject:[message toDictionaryWithFields:fields]];
+    }
+    result[@"chat"] = operation.chat;
+    result[@"messages"] = items;
+    result[@"cached"] = @YES;
+    result[@"age_s"] = @(round(age * 10.0) / 10.0);
+    return YES;
+}
+
+- (BOOL)runSearch:(WABatchOperation *)operation result:(NSMutableDictionary *)result error:(NSString **)error {
+    if (operation.cursor) {
+        // Next page of an earlier search; WhatsApp isn't touched
+        NSError *pageError = nil;
+        WAResultPage *page = [[WAResultPager shared] pageForCursor:operation.cursor
+                                                             limit:operation.limit
+                                                             error:&pageError];
+        if (!page) {
+            if (error) *error = pageError.localizedDescription ?: @"Invalid cursor";
+            return NO;
+        }
+        [self addSearchPage:page toResult:result];
+        return YES;
+    }
+
+    NSString *key = [NSString stringWithFormat:@"%@|%@", operation.filter.lowercaseString ?: @"", operation.text];
+    BOOL reused = self.searchResults && [key isEqualToString:self.searchKey];
+
+    if (!reused) {
+        if (operation.filter && ![self applyFilter:[WAAccessibility chatFilterFromString:operation.filter]
+                                                showingChatList:NO
+                                                        skipped:NULL]) {
+            if (error) *error = [NSString stringWithFormat:@"Could not select filter '%@'", operation.filter];
+            return NO;
+        }
+        WASearchResults *searchResults = [self.accessibility globalSearch:operation.text];
+        if (!searchResults) {
+            if (error) *error = @"Search failed";
+            self.searchKey = nil;
+            self.searchResults = nil;
+            return NO;
+        }
+        self.searchKey = key;
+        self.searchResults = searchResults;
+    }
+
+    NSDictionary *dict = [self.searchResults toDictionary];
+    NSArray *messageMatches = dict[@"message_matches"];
+    WAResultPage *page = [[WAResultPager shared] firstPageOfItems:messageMatches ?: @[] limit:operation.limit];
+    result[@"query"] = operation.text;
+    result[@"reused"] = @(reused);
+    result[@"chat_matches"] = dict[@"chat_matches"];
+    [self addSearchPage:page toResult:result];
+    return YES;
+}
+
+/// message_matches, total_message_matches and next_cursor (only if more remain)
+- (void)addSearchPage:(WAResultPage *)page toResult:(NSMutableDictionary *)result {
+    result[@"message_matches"] = page.items;
+    result[@"total_message_matches"] = @(page.total);
+    result[@"next_cursor"] = page.nextCursor;
+}
+
+- (BOOL)runSend:(WABatchOperation *)operation result:(NSMutableDictionary *)result error:(NSString **)error {
+    // Never send unless the intended chat is confirmed open
+    if (operation.chat) {
+        BOOL reused = NO;
+        if (![self ensureChatOpen:operation.chat reused:&reused error:error]) return NO;
+    }
+    NSString *chatName = [self currentOpenChatName];
+    if (chatName) result[@"chat"] = chatName;
+
+    if (![self.accessibility sendMessage:operation.text]) {
+        if (error) *error = @"Failed to send message";
+        return NO;
+    }
+    return YES;
+}
+
+- (BOOL)runFilter:(WABatchOperation *)operation result:(NSMutableDictionary *)result error:(NSString **)error {
+    WAChatFilter filter = [WAAccessibility chatFilterFromString:operation.filter];
+    BOOL skipped = NO;
+    if (![self applyFilter:filter showingChatList:YES skipped:&skipped]) {
+        if (error) *error = [NSString stringWithFormat:@"Could not select filter '%@'", operation.filter];
+        return NO;
+    }
+    result[@"filter"] = [WAAccessibility stringFromChatFilter:filter];
+    result[@"skipped"] = @(skipped);
+    return YES;
+}
+
+#pragma mark - State Transitions
+
+/// Header name of the open chat, read from the UI once and then tracked
+- (NSString *)currentOpenChatName {
+    if (!self.openChatKnown) {
+        self.openChatName = [self.accessibility currentChatName];
+        self.openChatKnown = YES;
+    }
+    return self.openChatName;
+}
+
+- (BOOL)ensureChatOpen:(NSString *)chat reused:(BOOL *)reused error:(NSString **)error {
+    NSString *current = [self currentOpenChatName];
+    NSString *target = self.resolvedNames[chat.lowercaseString] ?: chat;
+    if (current && [current caseInsensitiveCompare:target] == NSOrderedSame) {
+        *reused = YES;
+        return YES;
+    }
+
+    if (![self.accessibility openChatWithName:chat]) {
+        if (error) *error = [NSString stringWithFormat:@"Chat '%@' not found", chat];
+        // findChatWithName may have run or cleared a search on the way
+        self.searchKey = nil;
+        self.openChatKnown = NO;
+        return NO;
+    }
+
+    // Wait for the header to switch instead of sleeping a fixed time
+    NSString *opened = nil;
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:kOpenSettleTimeout];
+    do {
+        NSString *name = [self.accessibility currentChatName];
+        if (name && ![name isEqualToString:current ?: @""]) {
+            opened = name;
+            break;
+        }
+        [NSThread sleepForTimeInterval:kOpenSettlePoll];
+    } while ([deadline timeIntervalSinceNow] > 0);
+    self.searchKey = nil;
+
+    // An unchanged header is only fine if the open chat was the target all along
+    if (!opened && current && [WAAccessibility chatHeader:current namesChat:chat]) {
+        opened = current;
+    }
+    if (!opened) {
+        if (error) *error = [NSString stringWithFormat:@"Chat '%@' did not open", chat];
+        self.openChatKnown = NO;
+        return NO;
+    }
+
+    self.openChatName = opened;
+    self.openChatKnown = YES;
+    self.resolvedNames[chat.lowercaseString] = opened;
+    *reused = NO;
+    return YES;
+}
+
+/// Select filter unless it is already active (and, if chatList, the list is
+/// showing rather than search results)
+- (BOOL)applyFilter:(WAChatFilter)filter showingChatList:(BOOL)chatList skipped:(BOOL *)skipped {
+    if (!self.filterKnown) {
+        self.filter = [self.accessibility getSelectedChatFilter];
+        self.filterKnown = YES;
+    }
+    BOOL listShowing = !chatList || (!self.searchKey && ![self.accessibility isInSearchMode]);
+    if (self.filter == filter && listShowing) {
+        if (skipped) *skipped = YES;
+        return YES;
+    }
+
+    // selectChatFilter leaves search mode first
+    BOOL ok = [self.accessibility selectChatFilter:filter];
+    self.searchKey = nil;
+    self.searchResults = nil;
+    self.filterKnown = ok;
+    if (ok) self.filter = filter;
+    if (skipped) *skipped = NO;
+    return ok;
+}
+
+@end
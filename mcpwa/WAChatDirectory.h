@@ -0,0 +1,70 @@
+// WAChatDirectory.h
+// In-memory directory of known chat names with ranked fuzzy lookup
+
+#import <Foundation/Foundation.h>
+
+@class WAChat;
+@class RAGClient;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// How a directory entry matched the query, strongest first
+typedef NS_ENUM(NSInteger, WAChatMatchKind) {
+    WAChatMatchKindExact = 0,      // Same name after folding
+    WAChatMatchKindPrefix,         // Name starts with the query
+    WAChatMatchKindWordPrefix,     // A word in the name starts with the query
+    WAChatMatchKindSubstring,      // Query appears inside the name
+    WAChatMatchKindFuzzy           // Trigram overlap only (typos, partial transliteration)
+};
+
+@interface WAChatDirectoryMatch : NSObject
+@property (nonatomic, copy) NSString *name;          // Full chat name as WhatsApp shows it
+@property (nonatomic, assign) WAChatMatchKind kind;
+@property (nonatomic, assign) double score;          // 0..1, higher is better
+@end
+
+/**
+ * Resolves a user-supplied chat name ("igor", "Игорь", "mama") to the full
+ * name of a known chat without touching the WhatsApp UI.
+ *
+ * Names are fed from every WAChat the accessibility layer observes and from
+ * the RAG service's chat list. Matching is case, diacritic and script
+ * insensitive (Cyrillic and other scripts are transliterated to Latin) and
+ * uses a trigram index for candidate lookup.
+ */
+@interface WAChatDirectory : NSObject
+
++ (instancetype)shared;
+
+/// Number of distinct chat names known
+@property (readonly) NSUInteger count;
+
+/// Record chats seen in the chat list or search results
+- (void)observeChats:(NSArray<WAChat *> *)chats;
+
+/// Record chat names from any other source
+- (void)addNames:(NSArray<NSString *> *)names;
+
+/// Pull the RAG service's chat list into the directory (asynchronous)
+- (void)refreshFromRAGClient:(RAGClient *)client;
+
+/// Ranked matches for query, best first
+- (NSArray<WAChatDirectoryMatch *> *)matchesForQuery:(NSString *)query limit:(NSUInteger)limit;
+
+/// The single best match, or nil if nothing matches at least as a substring
+- (nullable WAChatDirectoryMatch *)bestMatchForQuery:(NSString *)query;
+
+/// Rank an arbitrary list of names (e.g. the visible chat list) against query
+/// using the same scoring. Returns nil if none matches.
+- (nullable WAChatDirectoryMatch *)bestMatchForQuery:(NSString *)query amongNames:(NSArray<NSString *> *)names;
+
+/// Score a single name against query with the same rules, fuzzy matches
+/// included; nil if it doesn't match at all
++ (nullable WAChatDirectoryMatch *)matchOfName:(NSString *)name toQuery:(NSString *)query;
+
+/// Case/diacritic/script-folded form used for matching
++ (NSString *)normalizedName:(NSString *)name;
+
+@end
+
+NS_ASSUME_NONNULL_END
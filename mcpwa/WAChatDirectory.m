@@ -0,0 +1,304 @@
+// WAChatDirectory.m
+// In-memory directory of known chat names with ranked fuzzy lookup
+
+#import "WAChatDirectory.h"
+#import "WAAccessibility.h"
+#import "RAGClient.h"
+#import "WALogger.h"
+
+/// Minimum trigram similarity (Dice coefficient) for a fuzzy match
+static const double kFuzzyThreshold = 0.4;
+
+@implementation WAChatDirectoryMatch
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<WAChatDirectoryMatch: %@ kind=%ld score=%.3f>",
+            self.name, (long)self.kind, self.score];
+}
+
+@end
+
+#pragma mark - Entry
+
+@interface WAChatDirectoryEntry : NSObject
+@property (nonatomic, copy) NSString *name;
+@property (nonatomic, copy) NSString *normalized;
+@property (nonatomic, strong) NSSet<NSString *> *trigrams;
+@property (nonatomic, assign) BOOL seenInUI;   // Observed in WhatsApp itself, not only in RAG
+@end
+
+@implementation WAChatDirectoryEntry
+@end
+
+#pragma mark - WAChatDirectory
+
+@interface WAChatDirectory ()
+@property (nonatomic, strong) NSMutableArray<WAChatDirectoryEntry *> *entries;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSNumber *> *entryIndexByName;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSMutableIndexSet *> *trigramIndex;
+@end
+
+@implementation WAChatDirectory
+
++ (instancetype)shared {
+    static WAChatDirectory *instance = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        instance = [[self alloc] init];
+    });
+    return instance;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _entries = [NSMutableArray array];
+        _entryIndexByName = [NSMutableDictionary dictionary];
+        _trigramIndex = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (NSUInteger)count {
+    @synchronized (self) {
+        return self.entries.count;
+    }
+}
+
+#pragma mark - Normalization
+
++ (NSString *)normalizedName:(NSString *)name {
+    if (name.length == 0) return @"";
+
+    // "Игорь" -> "Igor'", "Zoë" -> "zoe", "ＡＢＣ" -> "abc"
+    NSString *latin = [name stringByApplyingTransform:NSStringTransformToLatin reverse:NO] ?: name;
+    NSString *folded = [latin stringByFoldingWithOptions:NSCaseInsensitiveSearch |
+                                                         NSDiacriticInsensitiveSearch |
+                                                         NSWidthInsensitiveSearch
+                                                  locale:nil];
+
+    // Collapse punctuation, emoji and whitespace runs to single spaces
+    NSMutableString *result = [NSMutableString stringWithCapacity:folded.length];
+    NSCharacterSet *alnum = [NSCharacterSet alphanumericCharacterSet];
+    __block BOOL pendingSpace = NO;
+    [folded enumerateSubstringsInRange:NSMakeRange(0, folded.length)
+                               options:NSStringEnumerationByComposedCharacterSequences
+                            usingBlock:^(NSString *ch, NSRange r, NSRange er, BOOL *stop) {
+        if ([ch rangeOfCharacterFromSet:alnum].location != NSNotFound) {
+            if (pendingSpace && result.length > 0) [result appendString:@" "];
+            pendingSpace = NO;
+            [result appendString:ch];
+        } else {
+            pendingSpace = YES;
+        }
+    }];
+    return result;
+}
+
++ (NSSet<NSString *> *)trigramsOfNormalized:(NSString *)normalized {
+    NSString *padded = [NSString stringWithFormat:@" %@ ", normalized];
+    NSMutableSet<NSString *> *trigrams = [NSMutableSet set];
+    for (NSUInteger i = 0; i + 3 <= padded.length; i++) {
+        [trigrams addObject:[padded substringWithRange:NSMakeRange(i, 3)]];
+    }
+    return trigrams;
+}
+
+#pragma mark - Feeding
+
+- (void)observeChats:(NSArray<WAChat *> *)chats {
+    @synchronized (self) {
+        for (WAChat *chat in chats) {
+            [self addName:chat.name seenInUI:YES];
+        }
+    }
+}
+
+- (void)addNames:(NSArray<NSString *> *)names {
+    @synchronized (self) {
+        for (NSString *name in names) {
+            [self addName:name seenInUI:NO];
+        }
+    }
+}
+
+- (void)refreshFromRAGClient:(RAGClient *)client {
+    [client listChatsWithCompletion:^(NSArray<RAGChatItem *> *chats, NSString *error) {
+        if (error) {
+            [WALogger warn:@"[ChatDirectory] RAG chat list unavailable: %@", error];
+            return;
+        }
+        NSMutableArray<NSString *> *names = [NSMutableArray arrayWithCapacity:chats.count];
+        for (RAGChatItem *chat in chats) {
+            if (chat.name.length > 0) [names addObject:chat.name];
+        }
+        [self addNames:names];
+        [WALogger info:@"[ChatDirectory] %lu names after RAG refresh", (unsigned long)self.count];
+    }];
+}
+
+/// Caller holds the lock
+- (void)addName:(NSString *)name seenInUI:(BOOL)seenInUI {
+    if (![name isKindOfClass:[NSString class]] || name.length == 0) return;
+
+    NSNumber *existing = self.entryIndexByName[name];
+    if (existing) {
+        if (seenInUI) self.entries[existing.unsignedIntegerValue].seenInUI = YES;
+        return;
+    }
+
+    NSString *normalized = [WAChatDirectory normalizedName:name];
+    if (normalized.length == 0) return;
+
+    WAChatDirectoryEntry *entry = [[WAChatDirectoryEntry alloc] init];
+    entry.name = name;
+    entry.normalized = normalized;
+    entry.trigrams = [WAChatDirectory trigramsOfNormalized:normalized];
+    entry.seenInUI = seenInUI;
+
+    NSUInteger entryIndex = self.entries.count;
+    [self.entries addObject:entry];
+    self.entryIndexByName[name] = @(entryIndex);
+
+    for (NSString *trigram in entry.trigrams) {
+        NSMutableIndexSet *posting = self.trigramIndex[trigram];
+        if (!posting) {
+            posting = [NSMutableIndexSet indexSet];
+            self.trigramIndex[trigram] = posting;
+        }
+        [posting addIndex:entryIndex];
+    }
+}
+
+#pragma mark - Matching
+
+/// Score one entry against a normalized query; nil if it doesn't match at all.
+/// The kind dominates the score; within a kind, closer length and having
+/// been seen in WhatsApp break ties.
++ (WAChatDirectoryMatch *)matchEntry:(WAChatDirectoryEntry *)entry
+                             toQuery:(NSString *)query
+                      queryTrigrams:(NSSet<NSString *> *)queryTrigrams {
+    NSString *target = entry.normalized;
+    WAChatMatchKind kind;
+    double base;
+
+    if ([target isEqualToString:query]) {
+        kind = WAChatMatchKindExact;
+        base = 1.0;
+    } else if ([target hasPrefix:query]) {
+        kind = WAChatMatchKindPrefix;
+        base = 0.9;
+    } else if ([target rangeOfString:[@" " stringByAppendingString:query]].location != NSNotFound) {
+        kind = WAChatMatchKindWordPrefix;
+        base = 0.8;
+    } else if ([target rangeOfString:query].location != NSNotFound) {
+        kind = WAChatMatchKindSubstring;
+        base = 0.7;
+    } else {
+        NSMutableSet *shared = [entry.trigrams mutableCopy];
+        [shared intersectSet:queryTrigrams];
+        double dice = 2.0 * shared.count / (double)(entry.trigrams.count + queryTrigrams.count);
+        if (dice < kFuzzyThreshold) return nil;
+        kind = WAChatMatchKindFuzzy;
+        base = 0.6 * dice;
+    }
+
+    double coverage = (double)MIN(query.length, target.length) / (double)MAX(query.length, target.length);
+
+    WAChatDirectoryMatch *match = [[WAChatDirectoryMatch alloc] init];
+    match.name = entry.name;
+    match.kind = kind;
+    match.score = base + 0.05 * coverage + (entry.seenInUI ? 0.04 : 0.0);
+    return match;
+}
+
+- (NSArray<WAChatDirectoryMatch *> *)matchesForQuery:(NSString *)query limit:(NSUInteger)limit {
+    NSString *normalizedQuery = [WAChatDirectory normalizedName:query];
+    if (normalizedQuery.length == 0) return @[];
+
+    NSSet<NSString *> *queryTrigrams = [WAChatDirectory trigramsOfNormalized:normalizedQuery];
+    NSMutableArray<WAChatDirectoryMatch *> *matches = [NSMutableArray array];
+
+    @synchronized (self) {
+        // A query of three or more characters shares at least one padded trigram
+        // with every name it is a substring or fuzzy match of, so the posting lists
+        // give a complete candidate set. Shorter queries only have padded trigrams
+        // (" go", "go ") that names containing them mid-word lack; scan those.
+        NSMutableIndexSet *candidates = [NSMutableIndexSet indexSet];
+        if (normalizedQuery.length < 3) {
+            [candidates addIndexesInRange:NSMakeRange(0, self.entries.count)];
+        } else {
+            for (NSString *trigram in queryTrigrams) {
+                NSIndexSet *posting = self.trigramIndex[trigram];
+                if (posting) [candidates addIndexes:posting];
+            }
+        }
+
+        [candidates enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+            WAChatDirectoryMatch *match = [WAChatDirectory matchEntry:self.entries[idx]
+                                                              toQuery:normalizedQuery
+                                                       queryTrigrams:queryTrigrams];
+            if (match) [matches addObject:match];
+        }];
+    }
+
+    [matches sortUsingComparator:^NSComparisonResult(WAChatDirectoryMatch *a, WAChatDirectoryMatch *b) {
+        if (a.score != b.score) return a.score > b.score ? NSOrderedAscending : NSOrderedDescending;
+        return [a.name compare:b.name];
+    }];
+
+    if (limit > 0 && matches.count > limit) {
+        return [matches subarrayWithRange:NSMakeRange(0, limit)];
+    }
+    return matches;
+}
+
+- (WAChatDirectoryMatch *)bestMatchForQuery:(NSString *)query {
+    WAChatDirectoryMatch *best = [self matchesForQuery:query limit:1].firstObject;
+    if (!best || best.kind == WAChatMatchKindFuzzy) return nil;
+    return best;
+}
+
++ (WAChatDirectoryMatch *)matchOfName:(NSString *)name toQuery:(NSString *)query {
+    NSString *normalizedQuery = [self normalizedName:query];
+    if (normalizedQuery.length == 0) return nil;
+
+    WAChatDirectoryEntry *entry = [[WAChatDirectoryEntry alloc] init];
+    entry.name = name;
+    entry.normalized = [self normalizedName:name];
+    entry.trigrams = [self trigramsOfNormalized:entry.normalized];
+    return [self matchEntry:entry toQuery:normalizedQuery queryTrigrams:[self trigramsOfNormalized:normalizedQuery]];
+}
+
+- (WAChatDirectoryMatch *)bestMatchForQuery:(NSString *)query amongNames:(NSArray<NSString *> *)names {
+    NSString *normalizedQuery = [WAChatDirectory normalizedName:query];
+    if (normalizedQuery.length == 0) return nil;
+    NSSet<NSString *> *queryTrigrams = [WAChatDirectory trigramsOfNormalized:normalizedQuery];
+
+    WAChatDirectoryMatch *best = nil;
+    for (NSString *name in names) {
+        // Reuse the indexed entry when we have one to skip re-transliterating
+        WAChatDirectoryEntry *entry = nil;
+        @synchronized (self) {
+            NSNumber *existing = self.entryIndexByName[name];
+            if (existing) entry = self.entries[existing.unsignedIntegerValue];
+        }
+        if (!entry) {
+            entry = [[WAChatDirectoryEntry alloc] init];
+            entry.name = name;
+            entry.normalized = [WAChatDirectory normalizedName:name];
+            entry.trigrams = [WAChatDirectory trigramsOfNormalized:entry.normalized];
+            entry.seenInUI = YES;
+        }
+
+        WAChatDirectoryMatch *match = [WAChatDirectory matchEntry:entry
+                                                          toQuery:normalizedQuery
+                                                   queryTrigrams:queryTrigrams];
+        if (match && match.kind != WAChatMatchKindFuzzy && (!best || match.score > best.score)) {
+            best = match;
+        }
+    }
+    return best;
+}
+
+@end
@@ -0,0 +1,91 @@
+// WAChatPrefetcher.h
+// Idle-time prefetch of likely-next chats into a message cache
+
+#import <Foundation/Foundation.h>
+
+@class WAAccessibility;
+@class WAChat;
+@class WAMessage;
+@class WASearchResults;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Reads the chats an agent is likely to open next while no tool call is
+ * pending, so a following get_messages can be answered without navigating.
+ *
+ * Candidates come from the chat list (pinned, optionally unread) and from
+ * search hits, ranked by hit position and how recently they were seen. Once
+ * the accessor has been idle for idleDelay, the top maxChats candidates
+ * without a fresh entry are opened one at a time on the accessor's operation
+ * queue, their messages cached with a fetch time, and the chat that was open
+ * before is reopened.
+ *
+ * Tool calls go through -[WAAccessibility performOperation:], which brackets
+ * them with requestWillBegin/requestDidEnd. A prefetch checks for a waiting
+ * request before every UI step and stops at the first one it sees, so a real
+ * request waits for at most one step plus the restore.
+ */
+@interface WAChatPrefetcher : NSObject
+
+- (instancetype)initWithAccessibility:(WAAccessibility *)accessibility NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Prefetch at all (default YES). Cached entries stay readable when off.
+@property (atomic, assign) BOOL enabled;
+
+/// Chats visited per idle period (default 3)
+@property (atomic, assign) NSUInteger maxChats;
+
+/// Quiet time after the last request before prefetching starts (default 2s)
+@property (atomic, assign) NSTimeInterval idleDelay;
+
+/// Entries younger than this are not fetched again (default 60s)
+@property (atomic, assign) NSTimeInterval refreshInterval;
+
+/// Also visit unread chats (default NO). Opening a chat marks it read and
+/// sends read receipts, which the user may not want from a background fetch.
+/// Applies to every source: pinned chats and search hits that the last chat
+/// list showed as unread are skipped as well.
+@property (atomic, assign) BOOL visitsUnreadChats;
+
+#pragma mark - Candidates
+
+/// Rank pinned (and unread) chats from a chat list read with value fields
+- (void)noteChatList:(NSArray<WAChat *> *)chats;
+
+/// Rank the chats of search hits, chat-name matches ahead of message matches
+- (void)noteSearchResults:(WASearchResults *)results;
+
+#pragma mark - Requests
+
+/// A tool call is about to wait for the operation queue
+- (void)requestWillBegin;
+
+/// The tool call finished; restarts the idle timer when none are left
+- (void)requestDidEnd;
+
+#pragma mark - Cache
+
+/// Cached messages for chatName (exact or fuzzy match) if no older than maxAge.
+/// Counts a hit or miss; *age receives the entry's age on a hit.
+- (nullable NSArray<WAMessage *> *)cachedMessagesForChat:(NSString *)chatName
+                                                  maxAge:(NSTimeInterval)maxAge
+                                                     age:(nullable NSTimeInterval *)age;
+
+/// Messages read per prefetched chat; a cached copy answers any smaller limit
+@property (class, readonly) NSInteger messagesPerChat;
+
+/// Number of cached chats
+@property (readonly) NSUInteger entryCount;
+
+/// Drop one chat's entry (e.g. after sending to it), or everything when nil
+- (void)invalidateChat:(nullable NSString *)chatName;
+
+/// {"enabled", "entries", "hits", "misses", "hit_rate", "mean_hit_age_s",
+///  "oldest_entry_age_s", "prefetched_chats", "yielded_runs"}
+- (NSDictionary *)statistics;
+
+@end
+
+NS_ASSUME_NONNULL_END
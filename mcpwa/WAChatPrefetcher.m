@@ -0,0 +1,414 @@
+// WAChatPrefetcher.m
+// Idle-time prefetch of likely-next chats into a message cache
+
+#import <Cocoa/Cocoa.h>
+#import "WAChatPrefetcher.h"
+#import "WAAccessibility.h"
+#import "WAChatDirectory.h"
+#import "WALogger.h"
+#import "WAToolMetrics.h"
+
+static const NSInteger kPrefetchMessageLimit = 50;          // Same window as getMessages
+static const NSUInteger kMaxCacheEntries = 20;
+static const NSTimeInterval kCandidateHalfLife = 120.0;     // Score halves every two minutes
+static const NSTimeInterval kCandidateLifetime = 600.0;     // Forget candidates not seen for ten minutes
+static const NSTimeInterval kOpenSettleTimeout = 1.0;
+static const NSTimeInterval kOpenSettlePoll = 0.1;
+
+// Relative weight of each candidate source at hit position 0
+static const double kSearchChatWeight = 1.0;
+static const double kSearchMessageWeight = 0.7;
+static const double kUnreadWeight = 0.6;
+static const double kPinnedWeight = 0.5;
+
+#pragma mark - Records
+
+@interface WAPrefetchCandidate : NSObject
+@property (nonatomic, copy) NSString *name;
+@property (nonatomic, assign) double weight;            // Source weight / (1 + hit position)
+@property (nonatomic, assign) CFAbsoluteTime notedAt;
+@end
+
+@implementation WAPrefetchCandidate
+- (double)scoreAt:(CFAbsoluteTime)now {
+    return self.weight * exp2(-(now - self.notedAt) / kCandidateHalfLife);
+}
+@end
+
+@interface WAPrefetchEntry : NSObject
+@property (nonatomic, copy) NSString *chatName;         // Header name when fetched
+@property (nonatomic, strong) NSArray<WAMessage *> *messages;
+@property (nonatomic, assign) CFAbsoluteTime fetchedAt;
+@end
+
+@implementation WAPrefetchEntry
+@end
+
+#pragma mark - Prefetcher
+
+@interface WAChatPrefetcher ()
+@property (nonatomic, weak) WAAccessibility *accessibility;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, WAPrefetchCandidate *> *candidates;  // By folded name
+@property (nonatomic, strong) NSMutableDictionary<NSString *, WAPrefetchEntry *> *entries;         // By folded name
+@property (nonatomic, strong) NSMutableSet<NSString *> *unreadKeys;     // Unread in the last chat list, by folded name
+@property (nonatomic, assign) NSUInteger pendingRequests;
+@property (nonatomic, assign) NSUInteger idleGeneration;      // Bumped by every request; stale timers bail out
+@property (nonatomic, assign) BOOL prefetching;
+
+// Statistics
+@property (nonatomic, assign) NSUInteger hits;
+@property (nonatomic, assign) NSUInteger misses;
+@property (nonatomic, assign) NSTimeInterval totalHitAge;
+@property (nonatomic, assign) NSUInteger prefetchedChats;
+@property (nonatomic, assign) NSUInteger yieldedRuns;
+@end
+
+@implementation WAChatPrefetcher
+
+- (instancetype)initWithAccessibility:(WAAccessibility *)accessibility {
+    self = [super init];
+    if (self) {
+        _accessibility = accessibility;
+        _candidates = [NSMutableDictionary dictionary];
+        _entries = [NSMutableDictionary dictionary];
+        _unreadKeys = [NSMutableSet set];
+        _enabled = YES;
+        _maxChats = 3;
+        _idleDelay = 2.0;
+        _refreshInterval = 60.0;
+    }
+    return self;
+}
+
++ (NSInteger)messagesPerChat {
+    return kPrefetchMessageLimit;
+}
+
++ (NSString *)keyForName:(NSString *)name {
+    return [WAChatDirectory normalizedName:name];
+}
+
+#pragma mark - Candidates
+
+- (void)noteChatList:(NSArray<WAChat *> *)chats {
+    // Remembered so search hits on these chats can be skipped too
+    @synchronized (self) {
+        for (WAChat *chat in chats) {
+            if (chat.name.length == 0) continue;
+            NSString *key = [WAChatPrefetcher keyForName:chat.name];
+            if (chat.isUnread) [self.unreadKeys addObject:key];
+            else [self.unreadKeys removeObject:key];
+        }
+    }
+
+    NSMutableArray<NSString *> *names = [NSMutableArray array];
+    NSMutableArray<NSNumber *> *weights = [NSMutableArray array];
+    NSUInteger position = 0;
+    for (WAChat *chat in chats) {
+        double weight = 0;
+        if (chat.isUnread) weight = kUnreadWeight;
+        else if (chat.isPinned) weight = kPinnedWeight;
+        if (weight == 0) continue;
+        [names addObject:chat.name];
+        [weights addObject:@(weight / (1.0 + position++))];
+    }
+    [self noteNames:names weights:weights];
+}
+
+- (void)noteSearchResults:(WASearchResults *)results {
+    NSMutableArray<NSString *> *names = [NSMutableArray array];
+    NSMutableArray<NSNumber *> *weights = [NSMutableArray array];
+    NSUInteger position = 0;
+    for (WASearchChatResult *match in results.chatMatches) {
+        [names addObject:match.chatName];
+        [weights addObject:@(kSearchChatWeight / (1.0 + position++))];
+    }
+    position = 0;
+    for (WASearchMessageResult *match in results.messageMatches) {
+        [names addObject:match.chatName];
+        [weights addObject:@(kSearchMessageWeight / (1.0 + position++))];
+    }
+    [self noteNames:names weights:weights];
+}
+
+- (void)noteNames:(NSArray<NSString *> *)names weights:(NSArray<NSNumber *> *)weights {
+    if (names.count == 0) return;
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    @synchronized (self) {
+        // Our own navigation reads the chat list too; that says nothing about the agent
+        if (self.prefetching) return;
+        [names enumerateObjectsUsingBlock:^(NSString *name, NSUInteger i, BOOL *stop) {
+            if (name.length == 0) return;
+            NSString *key = [WAChatPrefetcher keyForName:name];
+            if ([self isUnreadKey:key]) return;
+            WAPrefetchCandidate *candidate = self.candidates[key];
+            double weight = weights[i].doubleValue;
+            if (!candidate) {
+                candidate = [[WAPrefetchCandidate alloc] init];
+                candidate.name = name;
+                self.candidates[key] = candidate;
+            } else if ([candidate scoreAt:now] > weight) {
+                return;  // Seen recently at a better position
+            }
+            candidate.weight = weight;
+            candidate.notedAt = now;
+        }];
+    }
+    [self scheduleIdlePrefetch];
+}
+
+/// Whether opening the chat would mark it read when that isn't wanted.
+/// Search hits carry no unread state, so the last chat list is the source.
+- (BOOL)isUnreadKey:(NSString *)key {
+    @synchronized (self) {
+        return !self.visitsUnreadChats && [self.unreadKeys containsObject:key];
+    }
+}
+
+/// Best candidates without a fresh cache entry, highest score first
+- (NSArray<NSString *> *)chatsToPrefetch {
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    @synchronized (self) {
+        for (NSString *key in self.candidates.allKeys) {
+            if (now - self.candidates[key].notedAt > kCandidateLifetime) {
+                [self.candidates removeObjectForKey:key];
+            }
+        }
+        NSMutableArray<WAPrefetchCandidate *> *due = [NSMutableArray array];
+        [self.candidates enumerateKeysAndObjectsUsingBlock:^(NSString *key, WAPrefetchCandidate *candidate, BOOL *stop) {
+            // May have turned unread since it was noted
+            if ([self isUnreadKey:key]) return;
+            WAPrefetchEntry *entry = self.entries[key];
+            if (entry && now - entry.fetchedAt < self.refreshInterval) return;
+            [due addObject:candidate];
+        }];
+        [due sortUsingComparator:^NSComparisonResult(WAPrefetchCandidate *a, WAPrefetchCandidate *b) {
+            double scoreA = [a scoreAt:now], scoreB = [b scoreAt:now];
+            if (scoreA == scoreB) return NSOrderedSame;
+            return scoreA > scoreB ? NSOrderedAscending : NSOrderedDescending;
+        }];
+        NSUInteger count = MIN(due.count, self.maxChats);
+        return [[due subarrayWithRange:NSMakeRange(0, count)] valueForKey:@"name"];
+    }
+}
+
+#pragma mark - Requests
+
+- (void)requestWillBegin {
+    @synchronized (self) {
+        self.pendingRequests++;
+        self.idleGeneration++;
+    }
+}
+
+- (void)requestDidEnd {
+    @synchronized (self) {
+        if (self.pendingRequests > 0) self.pendingRequests--;
+    }
+    [self scheduleIdlePrefetch];
+}
+
+/// True once a real request is waiting (or prefetching was turned off)
+- (BOOL)shouldYield {
+    @synchronized (self) {
+        return self.pendingRequests > 0 || !self.enabled;
+    }
+}
+
+- (void)scheduleIdlePrefetch {
+    NSUInteger generation;
+    @synchronized (self) {
+        if (!self.enabled || self.pendingRequests > 0 || self.candidates.count == 0) return;
+        generation = ++self.idleGeneration;
+    }
+
+    dispatch_time_t when = dispatch_time(DISPATCH_TIME_NOW, (int64_t)(self.idleDelay * NSEC_PER_SEC));
+    dispatch_after(when, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        @synchronized (self) {
+            // Any request or newer schedule since then restarted the idle clock
+            if (generation != self.idleGeneration || self.pendingRequests > 0) return;
+        }
+        WAAccessibility *accessibility = self.accessibility;
+        if (!accessibility) return;
+        dispatch_async(accessibility.operationQueue, ^{
+            [[WAToolMetrics shared] measureTool:@"prefetch" block:^{
+                [self runPrefetch];
+            }];
+        });
+    });
+}
+
+#pragma mark - Prefetch
+
+/// Runs on the accessor's operation queue
+- (void)runPrefetch {
+    WAAccessibility *accessibility = self.accessibility;
+    if (!accessibility || [self shouldYield]) return;
+
+    NSArray<NSString *> *targets = [self chatsToPrefetch];
+    if (targets.count == 0) return;
+    if (![accessibility isWhatsAppAvailable]) return;
+
+    // Don't switch chats under someone who is using WhatsApp right now
+    NSRunningApplication *app = [NSRunningApplication runningApplicationWithProcessIdentifier:accessibility.whatsappPID];
+    if (app.isActive) {
+        [WALogger debug:@"prefetch: WhatsApp is frontmost, skipping"];
+        return;
+    }
+
+    @synchronized (self) {
+        self.prefetching = YES;
+    }
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    NSString *original = [accessibility currentChatName];
+    NSString *shown = original;
+    NSUInteger fetched = 0;
+    BOOL yielded = NO;
+
+    for (NSString *name in targets) {
+        if ([self shouldYield]) { yielded = YES; break; }
+
+        if (!shown || [shown caseInsensitiveCompare:name] != NSOrderedSame) {
+            if (![accessibility openChatWithName:name]) {
+                [WALogger debug:@"prefetch: could not open '%@'", name];
+                @synchronized (self) {
+                    [self.candidates removeObjectForKey:[WAChatPrefetcher keyForName:name]];
+                }
+                shown = [accessibility currentChatName];
+                continue;
+            }
+            NSString *opened = [self waitForChatOtherThan:shown];
+            // Reading before the header switched would cache the previous chat's messages
+            if (!opened) {
+                shown = [accessibility currentChatName];
+                continue;
+            }
+            shown = opened;
+        }
+
+        if ([self shouldYield]) { yielded = YES; break; }
+
+        NSArray<WAMessage *> *messages = [accessibility getMessagesWithLimit:kPrefetchMessageLimit];
+        [self storeMessages:messages forChat:shown];
+        fetched++;
+    }
+
+    // Put back the chat the user had open, even when a request is waiting for us
+    if (original && (!shown || [shown caseInsensitiveCompare:original] != NSOrderedSame)) {
+        if (![accessibility openChatWithName:original]) {
+            [WALogger warn:@"prefetch: could not reopen '%@'", original];
+        }
+    }
+
+    @synchronized (self) {
+        self.prefetching = NO;
+        self.prefetchedChats += fetched;
+        if (yielded) self.yieldedRuns++;
+    }
+
+    NSDictionary *stats = [self statistics];
+    [WALogger info:@"prefetch: %lu of %lu chats in %ldms%@ (hit rate %@, %@ entries)",
+        (unsigned long)fetched, (unsigned long)targets.count,
+        (long)llround((CFAbsoluteTimeGetCurrent() - start) * 1000.0),
+        yielded ? @", yielded to a request" : @"",
+        stats[@"hit_rate"], stats[@"entries"]];
+}
+
+/// Header name once it differs from previous, or nil if it never switched
+- (NSString *)waitForChatOtherThan:(NSString *)previous {
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:kOpenSettleTimeout];
+    do {
+        NSString *name = [self.accessibility currentChatName];
+        if (name && ![name isEqualToString:previous ?: @""]) return name;
+        [NSThread sleepForTimeInterval:kOpenSettlePoll];
+    } while ([deadline timeIntervalSinceNow] > 0);
+    return nil;
+}
+
+#pragma mark - Cache
+
+- (void)storeMessages:(NSArray<WAMessage *> *)messages forChat:(NSString *)chatName {
+    WAPrefetchEntry *entry = [[WAPrefetchEntry alloc] init];
+    entry.chatName = chatName;
+    entry.messages = [messages copy];
+    entry.fetchedAt = CFAbsoluteTimeGetCurrent();
+
+    @synchronized (self) {
+        self.entries[[WAChatPrefetcher keyForName:chatName]] = entry;
+        if (self.entries.count > kMaxCacheEntries) {
+            NSString *oldestKey = nil;
+            CFAbsoluteTime oldest = DBL_MAX;
+            for (NSString *key in self.entries) {
+                if (self.entries[key].fetchedAt < oldest) {
+                    oldest = self.entries[key].fetchedAt;
+                    oldestKey = key;
+                }
+            }
+            [self.entries removeObjectForKey:oldestKey];
+        }
+    }
+}
+
+- (NSArray<WAMessage *> *)cachedMessagesForChat:(NSString *)chatName
+                                         maxAge:(NSTimeInterval)maxAge
+                                            age:(NSTimeInterval *)age {
+    @synchronized (self) {
+        WAPrefetchEntry *entry = self.entries[[WAChatPrefetcher keyForName:chatName]];
+        if (!entry && self.entries.count > 0) {
+            // Tool arguments are often partial names ("igor" for "Igor B")
+            NSArray<NSString *> *names = [self.entries.allValues valueForKey:@"chatName"];
+            WAChatDirectoryMatch *match = [self.accessibility.chatDirectory bestMatchForQuery:chatName amongNames:names];
+            if (match) entry = self.entries[[WAChatPrefetcher keyForName:match.name]];
+        }
+
+        NSTimeInterval entryAge = entry ? CFAbsoluteTimeGetCurrent() - entry.fetchedAt : 0;
+        if (!entry || entryAge > maxAge) {
+            self.misses++;
+            return nil;
+        }
+        self.hits++;
+        self.totalHitAge += entryAge;
+        if (age) *age = entryAge;
+        return entry.messages;
+    }
+}
+
+- (NSUInteger)entryCount {
+    @synchronized (self) {
+        return self.entries.count;
+    }
+}
+
+- (void)invalidateChat:(NSString *)chatName {
+    @synchronized (self) {
+        if (chatName) {
+            [self.entries removeObjectForKey:[WAChatPrefetcher keyForName:chatName]];
+        } else {
+            [self.entries removeAllObjects];
+        }
+    }
+}
+
+- (NSDictionary *)statistics {
+    @synchronized (self) {
+        CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+        NSTimeInterval oldestAge = 0;
+        for (WAPrefetchEntry *entry in self.entries.allValues) {
+            oldestAge = MAX(oldestAge, now - entry.fetchedAt);
+        }
+        NSUInteger lookups = self.hits + self.misses;
+        return @{
+            @"enabled": @(self.enabled),
+            @"entries": @(self.entries.count),
+            @"hits": @(self.hits),
+            @"misses": @(self.misses),
+            @"hit_rate": @(lookups > 0 ? round((double)self.hits / lookups * 1000.0) / 1000.0 : 0),
+            @"mean_hit_age_s": @(self.hits > 0 ? round(self.totalHitAge / self.hits * 10.0) / 10.0 : 0),
+            @"oldest_entry_age_s": @(round(oldestAge * 10.0) / 10.0),
+            @"prefetched_chats": @(self.prefetchedChats),
+            @"yielded_runs": @(self.yieldedRuns)
+        };
+    }
+}
+
+@end
@@ -0,0 +1,71 @@
+// WAConversationStore.h
+// Append-only on-disk storage for bot chat conversations
+
+#import <Foundation/Foundation.h>
+
+@class ChatDisplayMessage;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Index entry for a saved conversation
+@interface WAConversationInfo : NSObject
+@property (nonatomic, copy) NSString *identifier;
+@property (nonatomic, copy, nullable) NSString *title;
+@property (nonatomic, strong) NSDate *createdAt;
+@property (nonatomic, strong) NSDate *updatedAt;
+@property (nonatomic, assign) NSUInteger messageCount;
+@end
+
+/**
+ * One conversation's message log.
+ *
+ * Messages are appended as small length-prefixed binary records to
+ * <id>.log. Only the record offsets (8 bytes per message) stay in memory;
+ * message bodies are read back from the memory-mapped log on demand, so
+ * callers can keep a bounded window of ChatDisplayMessage objects resident.
+ */
+@interface WAConversation : NSObject
+
+@property (nonatomic, copy, readonly) NSString *identifier;
+@property (nonatomic, copy, nullable) NSString *title;
+@property (nonatomic, readonly) NSUInteger messageCount;
+
+/// Append a message; its index is the messageCount before the call
+- (void)appendMessage:(ChatDisplayMessage *)message;
+
+/// Read messages back from disk; range is clamped to messageCount
+- (NSArray<ChatDisplayMessage *> *)messagesInRange:(NSRange)range;
+
+@end
+
+/**
+ * Saved bot chat conversations under Application Support/mcpwa/conversations,
+ * with an index plist so the list can be shown without opening any log.
+ */
+@interface WAConversationStore : NSObject
+
+/// Shared store in Application Support/mcpwa/conversations
++ (instancetype)shared;
+
+/// Store rooted at directory (created on first write)
+- (instancetype)initWithDirectory:(NSString *)directory NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Saved conversations, most recently updated first. Empty conversations are omitted.
+- (NSArray<WAConversationInfo *> *)conversations;
+
+/// Start a new, empty conversation
+- (WAConversation *)createConversation;
+
+/// Reopen a saved conversation (reads only record headers)
+- (nullable WAConversation *)openConversation:(NSString *)identifier;
+
+/// Remove a conversation's log and index entry
+- (void)deleteConversation:(NSString *)identifier;
+
+/// Write the pending index update now (normally batched)
+- (void)flush;
+
+@end
+
+NS_ASSUME_NONNULL_END
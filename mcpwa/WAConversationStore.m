@@ -0,0 +1,359 @@
+// WAConversationStore.m
+// Append-only on-disk storage for bot chat conversations
+
+#import "WAConversationStore.h"
+#import "BotChatWindowController.h"
+#import "WALogger.h"
+
+static NSString *const kIndexFileName = @"index.plist";
+static NSString *const kLogExtension = @"log";
+static const NSTimeInterval kIndexSaveDelay = 2.0;
+
+// Record: [u32 payload length][u8 type][u32 text length][text][u16 function length][function], big-endian
+static const NSUInteger kRecordHeaderLength = 4;
+static const NSUInteger kMinPayloadLength = 1 + 4 + 2;
+
+@interface WAConversationStore ()
+- (void)conversationDidChange:(WAConversation *)conversation;
+@end
+
+#pragma mark - WAConversationInfo
+
+@implementation WAConversationInfo
+
+- (NSDictionary *)toPlist {
+    NSMutableDictionary *dict = [NSMutableDictionary dictionary];
+    dict[@"id"] = self.identifier;
+    if (self.title) dict[@"title"] = self.title;
+    dict[@"created"] = self.createdAt;
+    dict[@"updated"] = self.updatedAt;
+    dict[@"count"] = @(self.messageCount);
+    return dict;
+}
+
++ (nullable instancetype)infoFromPlist:(NSDictionary *)dict {
+    if (![dict isKindOfClass:[NSDictionary class]] || ![dict[@"id"] isKindOfClass:[NSString class]]) return nil;
+    WAConversationInfo *info = [[WAConversationInfo alloc] init];
+    info.identifier = dict[@"id"];
+    info.title = [dict[@"title"] isKindOfClass:[NSString class]] ? dict[@"title"] : nil;
+    info.createdAt = [dict[@"created"] isKindOfClass:[NSDate class]] ? dict[@"created"] : [NSDate date];
+    info.updatedAt = [dict[@"updated"] isKindOfClass:[NSDate class]] ? dict[@"updated"] : info.createdAt;
+    info.messageCount = [dict[@"count"] unsignedIntegerValue];
+    return info;
+}
+
+@end
+
+#pragma mark - WAConversation
+
+@interface WAConversation ()
+@property (nonatomic, copy, readwrite) NSString *identifier;
+@property (nonatomic, copy) NSString *path;
+@property (nonatomic, weak) WAConversationStore *store;
+@property (nonatomic, strong) NSMutableData *offsets;          // uint64_t per record
+@property (nonatomic, assign) unsigned long long fileLength;
+@property (nonatomic, strong, nullable) NSFileHandle *writeHandle;
+@property (nonatomic, strong, nullable) NSData *mappedLog;     // Remapped when reads go past its end
+- (void)restoreTitle:(nullable NSString *)title;
+@end
+
+@implementation WAConversation
+
+- (instancetype)initWithIdentifier:(NSString *)identifier path:(NSString *)path store:(WAConversationStore *)store {
+    self = [super init];
+    if (self) {
+        _identifier = [identifier copy];
+        _path = [path copy];
+        _store = store;
+        _offsets = [NSMutableData data];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [_writeHandle closeFile];
+}
+
+- (NSUInteger)messageCount {
+    return self.offsets.length / sizeof(uint64_t);
+}
+
+/// Set the title from the index without marking the conversation updated
+- (void)restoreTitle:(nullable NSString *)title {
+    _title = [title copy];
+}
+
+- (void)setTitle:(NSString *)title {
+    if ([_title isEqualToString:title]) return;
+    _title = [title copy];
+    [self.store conversationDidChange:self];
+}
+
+/// Walk record headers to rebuild the offset table; drops a torn trailing record
+- (void)loadOffsets {
+    NSData *log = [NSData dataWithContentsOfFile:self.path options:NSDataReadingMappedIfSafe error:nil];
+    const uint8_t *bytes = log.bytes;
+    NSUInteger length = log.length;
+    NSUInteger offset = 0;
+
+    while (length - offset >= kRecordHeaderLength) {
+        uint32_t be;
+        memcpy(&be, bytes + offset, sizeof(be));
+        NSUInteger payload = CFSwapInt32BigToHost(be);
+        if (payload < kMinPayloadLength || length - offset - kRecordHeaderLength < payload) break;
+
+        uint64_t recordOffset = offset;
+        [self.offsets appendBytes:&recordOffset length:sizeof(recordOffset)];
+        offset += kRecordHeaderLength + payload;
+    }
+
+    if (offset < length) {
+        [WALogger warn:@"[Conversations] %@: dropping %lu bytes of incomplete record",
+            self.identifier, (unsigned long)(length - offset)];
+        NSFileHandle *handle = [NSFileHandle fileHandleForWritingAtPath:self.path];
+        [handle truncateFileAtOffset:offset];
+        [handle closeFile];
+    }
+    self.fileLength = offset;
+    self.mappedLog = log;
+}
+
+- (void)appendMessage:(ChatDisplayMessage *)message {
+    NSData *text = [message.text ?: @"" dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *function = [message.functionName ?: @"" dataUsingEncoding:NSUTF8StringEncoding];
+    if (function.length > UINT16_MAX) function = [function subdataWithRange:NSMakeRange(0, UINT16_MAX)];
+
+    uint32_t payload = (uint32_t)(kMinPayloadLength + text.length + function.length);
+    NSMutableData *record = [NSMutableData dataWithCapacity:kRecordHeaderLength + payload];
+    uint32_t be32 = CFSwapInt32HostToBig(payload);
+    [record appendBytes:&be32 length:4];
+    uint8_t type = (uint8_t)message.type;
+    [record appendBytes:&type length:1];
+    be32 = CFSwapInt32HostToBig((uint32_t)text.length);
+    [record appendBytes:&be32 length:4];
+    [record appendData:text];
+    uint16_t be16 = CFSwapInt16HostToBig((uint16_t)function.length);
+    [record appendBytes:&be16 length:2];
+    [record appendData:function];
+
+    if (!self.writeHandle) {
+        NSFileManager *fm = [NSFileManager defaultManager];
+        [fm createDirectoryAtPath:[self.path stringByDeletingLastPathComponent]
+      withIntermediateDirectories:YES attributes:nil error:nil];
+        if (![fm fileExistsAtPath:self.path]) {
+            [fm createFileAtPath:self.path contents:nil attributes:nil];
+        }
+        self.writeHandle = [NSFileHandle fileHandleForWritingAtPath:self.path];
+        if (!self.writeHandle) {
+            [WALogger error:@"[Conversations] Cannot open %@ for writing", self.path];
+            return;
+        }
+    }
+
+    @try {
+        [self.writeHandle seekToFileOffset:self.fileLength];
+        [self.writeHandle writeData:record];
+    } @catch (NSException *exception) {
+        [WALogger error:@"[Conversations] Write failed: %@", exception.reason];
+        return;
+    }
+
+    uint64_t recordOffset = self.fileLength;
+    [self.offsets appendBytes:&recordOffset length:sizeof(recordOffset)];
+    self.fileLength += record.length;
+    [self.store conversationDidChange:self];
+}
+
+- (NSArray<ChatDisplayMessage *> *)messagesInRange:(NSRange)range {
+    NSUInteger count = self.messageCount;
+    if (range.location >= count) return @[];
+    range.length = MIN(range.length, count - range.location);
+    if (range.length == 0) return @[];
+
+    if (self.mappedLog.length < self.fileLength) {
+        self.mappedLog = [NSData dataWithContentsOfFile:self.path options:NSDataReadingMappedIfSafe error:nil];
+    }
+    const uint8_t *bytes = self.mappedLog.bytes;
+    NSUInteger length = self.mappedLog.length;
+    const uint64_t *offsets = self.offsets.bytes;
+
+    NSMutableArray<ChatDisplayMessage *> *messages = [NSMutableArray arrayWithCapacity:range.length];
+    for (NSUInteger i = range.location; i < NSMaxRange(range); i++) {
+        NSUInteger offset = (NSUInteger)offsets[i];
+        if (offset + kRecordHeaderLength + kMinPayloadLength > length) break;
+
+        const uint8_t *p = bytes + offset + kRecordHeaderLength;
+        uint32_t be32;
+        memcpy(&be32, p + 1, 4);
+        NSUInteger textLength = CFSwapInt32BigToHost(be32);
+        if (offset + kRecordHeaderLength + kMinPayloadLength + textLength > length) break;
+        uint16_t be16;
+        memcpy(&be16, p + 5 + textLength, 2);
+        NSUInteger functionLength = CFSwapInt16BigToHost(be16);
+        if (offset + kRecordHeaderLength + kMinPayloadLength + textLength + functionLength > length) break;
+
+        ChatDisplayMessage *message = [[ChatDisplayMessage alloc] init];
+        message.type = (ChatMessageType)p[0];
+        message.text = [[NSString alloc] initWithBytes:p + 5 length:textLength encoding:NSUTF8StringEncoding] ?: @"";
+        if (functionLength > 0) {
+            message.functionName = [[NSString alloc] initWithBytes:p + 7 + textLength
+                                                            length:functionLength
+                                                          encoding:NSUTF8StringEncoding];
+        }
+        [messages addObject:message];
+    }
+    return messages;
+}
+
+@end
+
+#pragma mark - WAConversationStore
+
+@interface WAConversationStore ()
+@property (nonatomic, copy) NSString *directory;
+@property (nonatomic, strong, nullable) NSMutableDictionary<NSString *, WAConversationInfo *> *index;
+@property (nonatomic, assign) BOOL saveScheduled;
+@end
+
+@implementation WAConversationStore
+
++ (instancetype)shared {
+    static WAConversationStore *instance = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSString *support = NSSearchPathForDirectoriesInDomains(NSApplicationSupportDirectory, NSUserDomainMask, YES).firstObject;
+        instance = [[self alloc] initWithDirectory:[support stringByAppendingPathComponent:@"mcpwa/conversations"]];
+    });
+    return instance;
+}
+
+- (instancetype)initWithDirectory:(NSString *)directory {
+    self = [super init];
+    if (self) {
+        _directory = [directory copy];
+    }
+    return self;
+}
+
+#pragma mark - Index
+
+- (NSString *)indexPath {
+    return [self.directory stringByAppendingPathComponent:kIndexFileName];
+}
+
+- (NSString *)logPathForIdentifier:(NSString *)identifier {
+    return [[self.directory stringByAppendingPathComponent:identifier] stringByAppendingPathExtension:kLogExtension];
+}
+
+- (NSMutableDictionary<NSString *, WAConversationInfo *> *)loadedIndex {
+    if (self.index) return self.index;
+
+    self.index = [NSMutableDictionary dictionary];
+    NSData *data = [NSData dataWithContentsOfFile:[self indexPath]];
+    if (!data) return self.index;
+
+    NSArray *entries = [NSPropertyListSerialization propertyListWithData:data options:0 format:NULL error:nil];
+    if (![entries isKindOfClass:[NSArray class]]) {
+        [WALogger warn:@"[Conversations] Ignoring unreadable index"];
+        return self.index;
+    }
+    for (NSDictionary *entry in entries) {
+        WAConversationInfo *info = [WAConversationInfo infoFromPlist:entry];
+        if (info) self.index[info.identifier] = info;
+    }
+    return self.index;
+}
+
+- (void)conversationDidChange:(WAConversation *)conversation {
+    NSMutableDictionary<NSString *, WAConversationInfo *> *index = [self loadedIndex];
+    WAConversationInfo *info = index[conversation.identifier];
+    if (!info) {
+        info = [[WAConversationInfo alloc] init];
+        info.identifier = conversation.identifier;
+        info.createdAt = [NSDate date];
+        index[conversation.identifier] = info;
+    }
+    info.title = conversation.title;
+    info.messageCount = conversation.messageCount;
+    info.updatedAt = [NSDate date];
+    [self scheduleSave];
+}
+
+/// Coalesce bursts of appends into one index write
+- (void)scheduleSave {
+    if (self.saveScheduled) return;
+    self.saveScheduled = YES;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(kIndexSaveDelay * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        if (self.saveScheduled) [self flush];
+    });
+}
+
+- (void)flush {
+    self.saveScheduled = NO;
+    if (!self.index) return;
+
+    NSMutableArray *entries = [NSMutableArray arrayWithCapacity:self.index.count];
+    for (WAConversationInfo *info in self.index.allValues) {
+        [entries addObject:[info toPlist]];
+    }
+
+    NSError *error = nil;
+    NSData *data = [NSPropertyListSerialization dataWithPropertyList:entries
+                                                              format:NSPropertyListBinaryFormat_v1_0
+                                                             options:0
+                                                               error:&error];
+    if (!data) {
+        [WALogger error:@"[Conversations] Failed to serialize index: %@", error.localizedDescription];
+        return;
+    }
+
+    [[NSFileManager defaultManager] createDirectoryAtPath:self.directory
+                              withIntermediateDirectories:YES attributes:nil error:nil];
+    if (![data writeToFile:[self indexPath] options:NSDataWritingAtomic error:&error]) {
+        [WALogger error:@"[Conversations] Failed to write index: %@", error.localizedDescription];
+    }
+}
+
+#pragma mark - Conversations
+
+- (NSArray<WAConversationInfo *> *)conversations {
+    NSMutableArray<WAConversationInfo *> *result = [NSMutableArray array];
+    for (WAConversationInfo *info in [self loadedIndex].allValues) {
+        if (info.messageCount > 0) [result addObject:info];
+    }
+    [result sortUsingComparator:^NSComparisonResult(WAConversationInfo *a, WAConversationInfo *b) {
+        return [b.updatedAt compare:a.updatedAt];
+    }];
+    return result;
+}
+
+- (WAConversation *)createConversation {
+    NSString *identifier = [NSUUID UUID].UUIDString;
+    // Not added to the index until its first message, so empty sessions leave no trace
+    return [[WAConversation alloc] initWithIdentifier:identifier
+                                                 path:[self logPathForIdentifier:identifier]
+                                                store:self];
+}
+
+- (WAConversation *)openConversation:(NSString *)identifier {
+    WAConversationInfo *info = [self loadedIndex][identifier];
+    NSString *path = [self logPathForIdentifier:identifier];
+    if (!info || ![[NSFileManager defaultManager] fileExistsAtPath:path]) return nil;
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    WAConversation *conversation = [[WAConversation alloc] initWithIdentifier:identifier path:path store:self];
+    [conversation loadOffsets];
+    [conversation restoreTitle:info.title];
+
+    [WALogger info:@"[Conversations] Opened %@ (%lu messages) in %.1f ms", identifier,
+        (unsigned long)conversation.messageCount, (CFAbsoluteTimeGetCurrent() - start) * 1000.0];
+    return conversation;
+}
+
+- (void)deleteConversation:(NSString *)identifier {
+    [[self loadedIndex] removeObjectForKey:identifier];
+    [[NSFileManager defaultManager] removeItemAtPath:[self logPathForIdentifier:identifier] error:nil];
+    [self flush];
+}
+
+@end
@@ -0,0 +1,58 @@
+// WALocalRetriever.h
+// Offline BM25 retrieval over captured WhatsApp messages
+
+#import <Foundation/Foundation.h>
+
+@class WAMessage;
+@class WASearchMessageResult;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Lexical search over messages the app has already read through accessibility.
+ *
+ * Documents are kept in a compact inverted index (term -> packed docId/tf pairs)
+ * persisted as a binary plist in Application Support/mcpwa. Results are
+ * dictionaries shaped like the RAG service's /search results (chat_name,
+ * content, text, sender, timestamp, score) plus "source": "local", so they can
+ * be shown or fused with remote results without special casing.
+ */
+@interface WALocalRetriever : NSObject
+
+/// Shared retriever backed by Application Support/mcpwa/local-index.plist
++ (instancetype)shared;
+
+/// Retriever backed by Application Support/mcpwa/local-index-<name>.plist,
+/// one instance per name, so each WhatsApp account keeps its own index
++ (instancetype)retrieverNamed:(NSString *)name;
+
+/// Create a retriever with its own index file (nil = in memory only)
+- (instancetype)initWithIndexPath:(nullable NSString *)path NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Number of indexed documents
+@property (readonly) NSUInteger documentCount;
+
+/// Index messages read from a chat. Duplicates are ignored.
+- (void)addMessages:(NSArray<WAMessage *> *)messages chatName:(NSString *)chatName;
+
+/// Index message matches from a WhatsApp global search
+- (void)addSearchMatches:(NSArray<WASearchMessageResult *> *)matches;
+
+/// BM25 top-k for query, best first
+- (NSArray<NSDictionary *> *)search:(NSString *)query k:(NSInteger)k;
+
+/// Write pending changes to disk now (normally batched)
+- (void)flush;
+
+/// Reciprocal-rank fusion of ranked lists. Items from different lists are
+/// treated as the same hit when they share a chat and one's text contains the
+/// other's. Fused items carry "score" = RRF score and "source" = "hybrid" when
+/// both lists contributed.
++ (NSArray<NSDictionary *> *)fuseLocalResults:(NSArray<NSDictionary *> *)local
+                                remoteResults:(NSArray<NSDictionary *> *)remote
+                                        limit:(NSInteger)limit;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,440 @@
+// WALocalRetriever.m
+// Offline BM25 retrieval over captured WhatsApp messages
+
+#import "WALocalRetriever.h"
+#import "WAAccessibility.h"
+#import "WALogger.h"
+
+static const double kBM25K1 = 1.2;
+static const double kBM25B = 0.75;
+static const double kRRFConstant = 60.0;
+static const NSUInteger kMaxDocuments = 20000;
+static const NSInteger kIndexVersion = 1;
+static const NSTimeInterval kSaveDelay = 2.0;
+
+/// One posting: document id and term frequency, packed into NSData
+typedef struct {
+    uint32_t docId;
+    uint32_t tf;
+} WAPosting;
+
+@interface WALocalRetriever ()
+@property (nonatomic, copy, nullable) NSString *indexPath;
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (atomic, assign) BOOL ready;                                     // Index read from disk; any thread
+
+// Everything below is only touched on queue
+@property (nonatomic, strong) NSMutableArray<NSDictionary *> *docs;        // {c, s, t, x}
+@property (nonatomic, strong) NSMutableData *docLengths;                   // uint32 per doc
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSMutableData *> *postings;
+@property (nonatomic, strong) NSMutableSet<NSString *> *docKeys;
+@property (nonatomic, assign) uint64_t totalLength;
+@property (nonatomic, assign) BOOL loaded;
+@property (nonatomic, assign) BOOL saveScheduled;
+@end
+
+@implementation WALocalRetriever
+
++ (instancetype)shared {
+    static WALocalRetriever *instance = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSString *support = NSSearchPathForDirectoriesInDomains(NSApplicationSupportDirectory, NSUserDomainMask, YES).firstObject;
+        NSString *path = [support stringByAppendingPathComponent:@"mcpwa/local-index.plist"];
+        instance = [[self alloc] initWithIndexPath:path];
+    });
+    return instance;
+}
+
++ (instancetype)retrieverNamed:(NSString *)name {
+    static NSMutableDictionary<NSString *, WALocalRetriever *> *instances = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        instances = [NSMutableDictionary dictionary];
+    });
+
+    @synchronized (instances) {
+        WALocalRetriever *retriever = instances[name];
+        if (!retriever) {
+            NSString *support = NSSearchPathForDirectoriesInDomains(NSApplicationSupportDirectory, NSUserDomainMask, YES).firstObject;
+            NSString *file = [NSString stringWithFormat:@"mcpwa/local-index-%@.plist", name];
+            retriever = [[self alloc] initWithIndexPath:[support stringByAppendingPathComponent:file]];
+            instances[name] = retriever;
+        }
+        return retriever;
+    }
+}
+
+- (instancetype)initWithIndexPath:(NSString *)path {
+    self = [super init];
+    if (self) {
+        _indexPath = [path copy];
+        _queue = dispatch_queue_create("com.mcpwa.localretriever", DISPATCH_QUEUE_SERIAL);
+        _docs = [NSMutableArray array];
+        _docLengths = [NSMutableData data];
+        _postings = [NSMutableDictionary dictionary];
+        _docKeys = [NSMutableSet set];
+
+        // Read the file in the background so the first search doesn't pay for it
+        dispatch_async(_queue, ^{
+            [self loadIfNeeded];
+        });
+    }
+    return self;
+}
+
+- (NSUInteger)documentCount {
+    __block NSUInteger count = 0;
+    dispatch_sync(self.queue, ^{
+        [self loadIfNeeded];
+        count = self.docs.count;
+    });
+    return count;
+}
+
+#pragma mark - Tokenizing
+
++ (NSArray<NSString *> *)tokensForText:(NSString *)text {
+    if (text.length == 0) return @[];
+
+    NSMutableArray<NSString *> *tokens = [NSMutableArray array];
+    NSCharacterSet *alnum = [NSCharacterSet alphanumericCharacterSet];
+
+    // Word tokenizer handles scripts without spaces as well as Latin/Cyrillic
+    CFStringTokenizerRef tokenizer = CFStringTokenizerCreate(kCFAllocatorDefault,
+                                                             (__bridge CFStringRef)text,
+                                                             CFRangeMake(0, (CFIndex)text.length),
+                                                             kCFStringTokenizerUnitWord,
+                                                             NULL);
+    while (CFStringTokenizerAdvanceToNextToken(tokenizer) != kCFStringTokenizerTokenNone) {
+        CFRange range = CFStringTokenizerGetCurrentTokenRange(tokenizer);
+        NSString *word = [text substringWithRange:NSMakeRange((NSUInteger)range.location, (NSUInteger)range.length)];
+        if ([word rangeOfCharacterFromSet:alnum].location == NSNotFound) continue;
+        [tokens addObject:[word stringByFoldingWithOptions:NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch
+                                                    locale:nil]];
+    }
+    CFRelease(tokenizer);
+    return tokens;
+}
+
+#pragma mark - Indexing
+
+- (void)addMessages:(NSArray<WAMessage *> *)messages chatName:(NSString *)chatName {
+    if (messages.count == 0 || chatName.length == 0) return;
+
+    NSMutableArray<NSDictionary *> *docs = [NSMutableArray arrayWithCapacity:messages.count];
+    for (WAMessage *message in messages) {
+        if (message.text.length == 0 || message.direction == WAMessageDirectionSystem) continue;
+        NSString *sender = message.direction == WAMessageDirectionOutgoing ? @"You" : (message.sender ?: chatName);
+        [docs addObject:@{@"c": chatName, @"s": sender, @"t": message.timestamp ?: @"", @"x": message.text}];
+    }
+    [self addDocuments:docs];
+}
+
+- (void)addSearchMatches:(NSArray<WASearchMessageResult *> *)matches {
+    NSMutableArray<NSDictionary *> *docs = [NSMutableArray arrayWithCapacity:matches.count];
+    for (WASearchMessageResult *match in matches) {
+        if (match.chatName.length == 0 || match.messagePreview.length == 0) continue;
+        [docs addObject:@{@"c": match.chatName, @"s": match.sender ?: @"", @"t": @"", @"x": match.messagePreview}];
+    }
+    [self addDocuments:docs];
+}
+
+- (void)addDocuments:(NSArray<NSDictionary *> *)docs {
+    if (docs.count == 0) return;
+
+    dispatch_async(self.queue, ^{
+        [self loadIfNeeded];
+
+        NSUInteger added = 0;
+        for (NSDictionary *doc in docs) {
+            NSString *key = [NSString stringWithFormat:@"%@\x1f%@\x1f%@\x1f%@", doc[@"c"], doc[@"s"], doc[@"t"], doc[@"x"]];
+            if ([self.docKeys containsObject:key]) continue;
+            [self.docKeys addObject:key];
+            [self indexDocument:doc];
+            added++;
+        }
+        if (added == 0) return;
+
+        if (self.docs.count > kMaxDocuments) {
+            [self dropOldestDocuments:self.docs.count - kMaxDocuments * 3 / 4];
+        }
+        [WALogger debug:@"[LocalRetriever] Indexed %lu new messages (%lu total)",
+         (unsigned long)added, (unsigned long)self.docs.count];
+        [self scheduleSave];
+    });
+}
+
+/// Append one document to the in-memory index (on queue)
+- (void)indexDocument:(NSDictionary *)doc {
+    uint32_t docId = (uint32_t)self.docs.count;
+    [self.docs addObject:doc];
+
+    // Chat and sender names are searchable too ("what did Igor say about...")
+    NSMutableArray<NSString *> *tokens = [[WALocalRetriever tokensForText:doc[@"x"]] mutableCopy];
+    [tokens addObjectsFromArray:[WALocalRetriever tokensForText:doc[@"c"]]];
+    [tokens addObjectsFromArray:[WALocalRetriever tokensForText:doc[@"s"]]];
+
+    NSCountedSet<NSString *> *counts = [[NSCountedSet alloc] initWithArray:tokens];
+    for (NSString *term in counts) {
+        NSMutableData *list = self.postings[term];
+        if (!list) {
+            list = [NSMutableData data];
+            self.postings[term] = list;
+        }
+        WAPosting posting = { docId, (uint32_t)[counts countForObject:term] };
+        [list appendBytes:&posting length:sizeof(posting)];
+    }
+
+    uint32_t length = (uint32_t)tokens.count;
+    [self.docLengths appendBytes:&length length:sizeof(length)];
+    self.totalLength += length;
+}
+
+/// Drop the oldest documents and rebuild the postings (on queue)
+- (void)dropOldestDocuments:(NSUInteger)count {
+    NSArray<NSDictionary *> *keep = [self.docs subarrayWithRange:NSMakeRange(count, self.docs.count - count)];
+    [self resetIndex];
+    for (NSDictionary *doc in keep) {
+        [self.docKeys addObject:[NSString stringWithFormat:@"%@\x1f%@\x1f%@\x1f%@", doc[@"c"], doc[@"s"], doc[@"t"], doc[@"x"]]];
+        [self indexDocument:doc];
+    }
+}
+
+- (void)resetIndex {
+    [self.docs removeAllObjects];
+    [self.docKeys removeAllObjects];
+    [self.postings removeAllObjects];
+    self.docLengths.length = 0;
+    self.totalLength = 0;
+}
+
+#pragma mark - Search
+
+- (NSArray<NSDictionary *> *)search:(NSString *)query k:(NSInteger)k {
+    NSArray<NSString *> *queryTerms = [[NSOrderedSet orderedSetWithArray:[WALocalRetriever tokensForText:query]] array];
+    if (queryTerms.count == 0) return @[];
+    if (k <= 0) k = 5;
+
+    // The UI asks for instant results; it gets none rather than waiting for the index to load
+    if ([NSThread isMainThread] && !self.ready) {
+        [WALogger debug:@"[LocalRetriever] Index still loading, no local results for '%@'", query];
+        return @[];
+    }
+
+    __block NSArray<NSDictionary *> *results = @[];
+    dispatch_sync(self.queue, ^{
+        [self loadIfNeeded];
+
+        NSUInteger docCount = self.docs.count;
+        if (docCount == 0) return;
+
+        double avgLength = (double)self.totalLength / (double)docCount;
+        const uint32_t *lengths = self.docLengths.bytes;
+        double *scores = calloc(docCount, sizeof(double));
+
+        for (NSString *term in queryTerms) {
+            NSData *list = self.postings[term];
+            if (!list) continue;
+
+            const WAPosting *postings = list.bytes;
+            NSUInteger df = list.length / sizeof(WAPosting);
+            double idf = log(1.0 + ((double)docCount - df + 0.5) / (df + 0.5));
+
+            for (NSUInteger i = 0; i < df; i++) {
+                double tf = postings[i].tf;
+                double norm = kBM25K1 * (1.0 - kBM25B + kBM25B * lengths[postings[i].docId] / avgLength);
+                scores[postings[i].docId] += idf * tf * (kBM25K1 + 1.0) / (tf + norm);
+            }
+        }
+
+        NSMutableArray<NSNumber *> *hits = [NSMutableArray array];
+        for (NSUInteger i = 0; i < docCount; i++) {
+            if (scores[i] > 0) [hits addObject:@(i)];
+        }
+        [hits sortUsingComparator:^NSComparisonResult(NSNumber *a, NSNumber *b) {
+            double sa = scores[a.unsignedIntegerValue], sb = scores[b.unsignedIntegerValue];
+            if (sa != sb) return sa > sb ? NSOrderedAscending : NSOrderedDescending;
+            // Newer documents first on ties
+            return [b compare:a];
+        }];
+
+        NSMutableArray<NSDictionary *> *top = [NSMutableArray array];
+        for (NSNumber *hit in hits) {
+            if ((NSInteger)top.count >= k) break;
+            NSDictionary *doc = self.docs[hit.unsignedIntegerValue];
+            NSMutableDictionary *item = [NSMutableDictionary dictionary];
+            item[@"chat_name"] = doc[@"c"];
+            item[@"title"] = doc[@"c"];
+            item[@"content"] = doc[@"x"];
+            item[@"text"] = doc[@"x"];
+            if ([doc[@"s"] length] > 0) item[@"sender"] = doc[@"s"];
+            if ([doc[@"t"] length] > 0) item[@"timestamp"] = doc[@"t"];
+            item[@"score"] = @(scores[hit.unsignedIntegerValue]);
+            item[@"source"] = @"local";
+            [top addObject:[item copy]];
+        }
+        free(scores);
+        results = top;
+    });
+    return results;
+}
+
+#pragma mark - Fusion
+
++ (NSString *)textOfResult:(NSDictionary *)result {
+    id text = result[@"content"] ?: result[@"text"];
+    return [text isKindOfClass:[NSString class]] ? text : @"";
+}
+
++ (BOOL)result:(NSDictionary *)a isSameHitAs:(NSDictionary *)b {
+    NSString *chatA = a[@"chat_name"], *chatB = b[@"chat_name"];
+    if ([chatA isKindOfClass:[NSString class]] && [chatB isKindOfClass:[NSString class]] &&
+        [chatA caseInsensitiveCompare:chatB] != NSOrderedSame) {
+        return NO;
+    }
+
+    NSString *textA = [self textOfResult:a], *textB = [self textOfResult:b];
+    NSString *shorter = textA.length <= textB.length ? textA : textB;
+    NSString *longer = textA.length <= textB.length ? textB : textA;
+    if (shorter.length < 8) return [textA isEqualToString:textB] && textA.length > 0;
+    return [longer rangeOfString:shorter options:NSCaseInsensitiveSearch].location != NSNotFound;
+}
+
++ (NSArray<NSDictionary *> *)fuseLocalResults:(NSArray<NSDictionary *> *)local
+                                remoteResults:(NSArray<NSDictionary *> *)remote
+                                        limit:(NSInteger)limit {
+    NSMutableArray<NSMutableDictionary *> *fused = [NSMutableArray array];
+    NSMutableArray<NSNumber *> *fusedScores = [NSMutableArray array];
+
+    // Remote first so its richer chunk text and metadata win on merged hits
+    [remote enumerateObjectsUsingBlock:^(NSDictionary *result, NSUInteger rank, BOOL *stop) {
+        if (![result isKindOfClass:[NSDictionary class]]) return;
+        NSMutableDictionary *item = [result mutableCopy];
+        item[@"source"] = @"remote";
+        [fused addObject:item];
+        [fusedScores addObject:@(1.0 / (kRRFConstant + rank + 1))];
+    }];
+
+    NSUInteger remoteCount = fused.count;
+    [local enumerateObjectsUsingBlock:^(NSDictionary *result, NSUInteger rank, BOOL *stop) {
+        double contribution = 1.0 / (kRRFConstant + rank + 1);
+        for (NSUInteger i = 0; i < remoteCount; i++) {
+            if ([self result:fused[i] isSameHitAs:result]) {
+                fused[i][@"source"] = @"hybrid";
+                fusedScores[i] = @(fusedScores[i].doubleValue + contribution);
+                return;
+            }
+        }
+        [fused addObject:[result mutableCopy]];
+        [fusedScores addObject:@(contribution)];
+    }];
+
+    for (NSUInteger i = 0; i < fused.count; i++) {
+        fused[i][@"score"] = fusedScores[i];
+    }
+
+    [fused sortWithOptions:NSSortStable usingComparator:^NSComparisonResult(NSDictionary *a, NSDictionary *b) {
+        return [b[@"score"] compare:a[@"score"]];
+    }];
+
+    if (limit > 0 && (NSInteger)fused.count > limit) {
+        return [fused subarrayWithRange:NSMakeRange(0, (NSUInteger)limit)];
+    }
+    return fused;
+}
+
+#pragma mark - Persistence
+
+/// Read the index from disk once (on queue)
+- (void)loadIfNeeded {
+    if (self.loaded) return;
+    self.loaded = YES;
+    [self readIndex];
+    self.ready = YES;
+}
+
+- (void)readIndex {
+    if (!self.indexPath) return;
+
+    NSData *data = [NSData dataWithContentsOfFile:self.indexPath];
+    if (!data) return;
+
+    NSError *error = nil;
+    NSDictionary *plist = [NSPropertyListSerialization propertyListWithData:data options:0 format:NULL error:&error];
+    if (![plist isKindOfClass:[NSDictionary class]] || [plist[@"version"] integerValue] != kIndexVersion) {
+        [WALogger warn:@"[LocalRetriever] Ignoring unreadable index: %@", error.localizedDescription ?: @"version mismatch"];
+        return;
+    }
+
+    NSArray *docs = plist[@"docs"];
+    NSData *lengths = plist[@"lengths"];
+    NSDictionary<NSString *, NSData *> *postings = plist[@"postings"];
+    if (![docs isKindOfClass:[NSArray class]] || ![lengths isKindOfClass:[NSData class]] ||
+        ![postings isKindOfClass:[NSDictionary class]] || lengths.length != docs.count * sizeof(uint32_t)) {
+        [WALogger warn:@"[LocalRetriever] Ignoring inconsistent index"];
+        return;
+    }
+
+    [self.docs setArray:docs];
+    [self.docLengths setData:lengths];
+    const uint32_t *lengthValues = lengths.bytes;
+    for (NSUInteger i = 0; i < docs.count; i++) {
+        self.totalLength += lengthValues[i];
+    }
+    [postings enumerateKeysAndObjectsUsingBlock:^(NSString *term, NSData *list, BOOL *stop) {
+        self.postings[term] = [list mutableCopy];
+    }];
+    for (NSDictionary *doc in docs) {
+        [self.docKeys addObject:[NSString stringWithFormat:@"%@\x1f%@\x1f%@\x1f%@", doc[@"c"], doc[@"s"], doc[@"t"], doc[@"x"]]];
+    }
+
+    [WALogger info:@"[LocalRetriever] Loaded %lu documents, %lu terms",
+     (unsigned long)docs.count, (unsigned long)postings.count];
+}
+
+/// Coalesce bursts of additions into one write (on queue)
+- (void)scheduleSave {
+    if (!self.indexPath || self.saveScheduled) return;
+    self.saveScheduled = YES;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(kSaveDelay * NSEC_PER_SEC)), self.queue, ^{
+        self.saveScheduled = NO;
+        [self writeIndex];
+    });
+}
+
+- (void)flush {
+    dispatch_sync(self.queue, ^{
+        if (self.loaded) [self writeIndex];
+    });
+}
+
+/// Serialize the index as a binary plist (on queue)
+- (void)writeIndex {
+    if (!self.indexPath) return;
+
+    NSDictionary *plist = @{
+        @"version": @(kIndexVersion),
+        @"docs": self.docs,
+        @"lengths": self.docLengths,
+        @"postings": self.postings
+    };
+
+    NSError *error = nil;
+    NSData *data = [NSPropertyListSerialization dataWithPropertyList:plist
+                                                              format:NSPropertyListBinaryFormat_v1_0
+                                                             options:0
+                                                               error:&error];
+    if (!data) {
+        [WALogger error:@"[LocalRetriever] Failed to serialize index: %@", error.localizedDescription];
+        return;
+    }
+
+    [[NSFileManager defaultManager] createDirectoryAtPath:[self.indexPath stringByDeletingLastPathComponent]
+                              withIntermediateDirectories:YES attributes:nil error:nil];
+    if (![data writeToFile:self.indexPath options:NSDataWritingAtomic error:&error]) {
+        [WALogger error:@"[LocalRetriever] Failed to write index: %@", error.localizedDescription];
+    }
+}
+
+@end
@@ -0,0 +1,65 @@
+// WAMessage.h
+// Data model for chat messages read from WhatsApp (Foundation only)
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(NSInteger, WAMessageDirection) {
+    WAMessageDirectionIncoming,
+    WAMessageDirectionOutgoing,
+    WAMessageDirectionSystem
+};
+
+/// Attachment shown in a message bubble
+typedef NS_ENUM(NSInteger, WAMessageMediaType) {
+    WAMessageMediaTypeNone,
+    WAMessageMediaTypeImage,
+    WAMessageMediaTypeVideo,      // Including GIFs
+    WAMessageMediaTypeVoice,      // Voice note
+    WAMessageMediaTypeAudio,      // Audio file
+    WAMessageMediaTypeDocument,
+    WAMessageMediaTypeSticker,
+    WAMessageMediaTypeLink        // Link preview
+};
+
+/// Message fields that can be requested individually
+typedef NS_OPTIONS(NSUInteger, WAMessageField) {
+    WAMessageFieldText      = 1 << 0,
+    WAMessageFieldSender    = 1 << 1,
+    WAMessageFieldTimestamp = 1 << 2,
+    WAMessageFieldDirection = 1 << 3,
+    WAMessageFieldReplyTo   = 1 << 4,
+    WAMessageFieldReplyText = 1 << 5,
+    WAMessageFieldReactions = 1 << 6,
+    WAMessageFieldIsRead    = 1 << 7,
+    WAMessageFieldFingerprint = 1 << 8,
+    WAMessageFieldMediaType = 1 << 9,
+    WAMessageFieldAll       = 0x3FF
+};
+
+@interface WAMessage : NSObject
+@property (nonatomic, copy) NSString *text;
+@property (nonatomic, copy, nullable) NSString *sender;      // For incoming/group messages
+@property (nonatomic, copy, nullable) NSString *timestamp;
+@property (nonatomic, assign) WAMessageDirection direction;
+@property (nonatomic, copy, nullable) NSString *replyTo;     // If replying to someone
+@property (nonatomic, copy, nullable) NSString *replyText;   // The quoted text
+@property (nonatomic, strong, nullable) NSArray<NSString *> *reactions;
+@property (nonatomic, assign) BOOL isRead;                   // For outgoing
+@property (nonatomic, assign) WAMessageMediaType mediaType;
+/// "<digest>.<n>": digest of direction, sender, timestamp and text, n = identical
+/// messages in the run of same-minute messages above it. Stable while the
+/// message is loaded; pass it back as since.
+@property (nonatomic, copy, nullable) NSString *fingerprint;
+
+- (NSDictionary *)toDictionary;
+
+/// Same as toDictionary, restricted to the requested fields
+- (NSDictionary *)toDictionaryWithFields:(WAMessageField)fields;
+
+/// "image", "video", ... ("none" for WAMessageMediaTypeNone)
++ (NSString *)nameForMediaType:(WAMessageMediaType)mediaType;
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,55 @@
+// WAMessage.m
+// Data model for chat messages read from WhatsApp (Foundation only)
+
+#import "WAMessage.h"
+
+@implementation WAMessage
+- (NSString *)description {
+    NSString *dir = self.direction == WAMessageDirectionIncoming ? @"←" : 
+                    self.direction == WAMessageDirectionOutgoing ? @"→" : @"•";
+    return [NSString stringWithFormat:@"<%@ %@: %@>", dir, self.sender ?: @"me", self.text];
+}
+
+- (NSDictionary *)toDictionary {
+    return [self toDictionaryWithFields:WAMessageFieldAll];
+}
+
+- (NSDictionary *)toDictionaryWithFields:(WAMessageField)fields {
+    NSMutableDictionary *dict = [NSMutableDictionary dictionary];
+    if (fields & WAMessageFieldDirection) {
+        switch (self.direction) {
+            case WAMessageDirectionIncoming: dict[@"direction"] = @"incoming"; break;
+            case WAMessageDirectionOutgoing: dict[@"direction"] = @"outgoing"; break;
+            case WAMessageDirectionSystem: dict[@"direction"] = @"system"; break;
+        }
+    }
+    if ((fields & WAMessageFieldText) && self.text) dict[@"text"] = self.text;
+    if ((fields & WAMessageFieldSender) && self.sender) dict[@"sender"] = self.sender;
+    if ((fields & WAMessageFieldTimestamp) && self.timestamp) dict[@"timestamp"] = self.timestamp;
+    if ((fields & WAMessageFieldReplyTo) && self.replyTo) dict[@"reply_to"] = self.replyTo;
+    if ((fields & WAMessageFieldReplyText) && self.replyText) dict[@"reply_text"] = self.replyText;
+    if ((fields & WAMessageFieldReactions) && self.reactions.count > 0) dict[@"reactions"] = self.reactions;
+    if ((fields & WAMessageFieldIsRead) && self.direction == WAMessageDirectionOutgoing) {
+        dict[@"is_read"] = @(self.isRead);
+    }
+    if ((fields & WAMessageFieldFingerprint) && self.fingerprint) dict[@"fingerprint"] = self.fingerprint;
+    if ((fields & WAMessageFieldMediaType) && self.mediaType != WAMessageMediaTypeNone) {
+        dict[@"media_type"] = [WAMessage nameForMediaType:self.mediaType];
+    }
+    return [dict copy];
+}
+
++ (NSString *)nameForMediaType:(WAMessageMediaType)mediaType {
+    switch (mediaType) {
+        case WAMessageMediaTypeNone: return @"none";
+        case WAMessageMediaTypeImage: return @"image";
+        case WAMessageMediaTypeVideo: return @"video";
+        case WAMessageMediaTypeVoice: return @"voice";
+        case WAMessageMediaTypeAudio: return @"audio";
+        case WAMessageMediaTypeDocument: return @"document";
+        case WAMessageMediaTypeSticker: return @"sticker";
+        case WAMessageMediaTypeLink: return @"link";
+    }
+    return @"none";
+}
+@end
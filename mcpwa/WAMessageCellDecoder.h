@@ -0,0 +1,58 @@
+// WAMessageCellDecoder.h
+// Single-pass decoding of chat message cells into WAMessage
+
+#import <Foundation/Foundation.h>
+#import "WAMessage.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Source of node snapshots. A snapshot is a dictionary with "role", and
+/// optionally "id", "desc", "value" (strings) and "children" (child nodes),
+/// fetched in one round-trip. Recorded subtrees are snapshots whose children
+/// are snapshots themselves.
+@protocol WAMessageCellSource <NSObject>
+- (nullable NSDictionary *)snapshotOfNode:(id)node;
+@end
+
+/**
+ * Turns a WAMessageBubbleTableViewCell into a WAMessage.
+ *
+ * The first AXGenericElement child carries the message description (text,
+ * time, direction, sender, reply target). When reply text, reactions, read
+ * state or media type are requested, the rest of the cell's subtree is
+ * visited once as well, fetching each node a single time:
+ *  - a quoted-message view gives replyTo/replyText
+ *  - a reactions view gives the reaction emoji
+ *  - an attachment view gives mediaType
+ *  - a delivery receipt gives isRead for outgoing messages
+ * Otherwise only the cell and its direct children are fetched.
+ */
+@interface WAMessageCellDecoder : NSObject
+
+- (instancetype)initWithSource:(id<WAMessageCellSource>)source NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+@property (nonatomic, strong, readonly) id<WAMessageCellSource> source;
+
+/// Levels below the cell that are visited (default 6)
+@property (nonatomic, assign) NSUInteger maxDepth;
+
+/// Message in cell, or nil if it isn't a message bubble or has no text
+- (nullable WAMessage *)messageFromCell:(id)cell fields:(WAMessageField)fields;
+
+/// Parse a bubble's AXDescription, e.g.
+/// "Replying to Igor.\nmessage, text here, 11:15, Received from Igor"
++ (WAMessage *)messageFromDescription:(NSString *)desc fields:(WAMessageField)fields;
+
+/// Attachment kind named by an element's identifier or description
++ (WAMessageMediaType)mediaTypeForIdentifier:(nullable NSString *)identifier
+                                 description:(nullable NSString *)desc;
+
+@end
+
+/// Serves recorded snapshots, counting fetches (for tests without WhatsApp)
+@interface WARecordedCellSource : NSObject <WAMessageCellSource>
+@property (atomic, readonly) NSUInteger fetchCount;
+@end
+
+NS_ASSUME_NONNULL_END
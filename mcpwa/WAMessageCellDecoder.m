@@ -0,0 +1,376 @@
+// WAMessageCellDecoder.m
+// Single-pass decoding of chat message cells into WAMessage
+
+#import "WAMessageCellDecoder.h"
+
+static NSString * const kMessageCellIdentifier = @"WAMessageBubbleTableViewCell";
+
+/// Fields that need more of the cell than its description element
+static const WAMessageField kSubtreeFields = WAMessageFieldReplyTo | WAMessageFieldReplyText |
+    WAMessageFieldReactions | WAMessageFieldIsRead | WAMessageFieldMediaType;
+
+/// Non-empty string under key, or nil
+static NSString *WASnapshotString(NSDictionary *snapshot, NSString *key) {
+    id value = snapshot[key];
+    return [value isKindOfClass:[NSString class]] && [value length] > 0 ? value : nil;
+}
+
+static BOOL WAContainsText(NSString *string, NSString *part) {
+    return string && [string rangeOfString:part options:NSCaseInsensitiveSearch].location != NSNotFound;
+}
+
+/// "read", "delivered", "sent" or "pending" for a delivery receipt element
+static NSString *WAReceiptState(NSString *identifier, NSString *desc) {
+    NSString *lower = desc.lowercaseString;
+    NSArray<NSString *> *states = @[@"read", @"delivered", @"sent", @"pending"];
+    if ([states containsObject:lower]) return lower;
+    if (lower && (WAContainsText(identifier, @"Receipt") || WAContainsText(identifier, @"DeliveryStatus"))) {
+        for (NSString *state in states) {
+            if ([lower containsString:state]) return state;
+        }
+    }
+    return nil;
+}
+
+/// Emoji in text, one entry per composed sequence (so skin tones and ZWJ
+/// sequences stay whole); counts and names around them are dropped
+static NSArray<NSString *> *WAEmojiInText(NSString *text) {
+    NSMutableArray<NSString *> *emoji = [NSMutableArray array];
+    NSCharacterSet *symbols = [NSCharacterSet symbolCharacterSet];
+    [text enumerateSubstringsInRange:NSMakeRange(0, text.length)
+                             options:NSStringEnumerationByComposedCharacterSequences
+                          usingBlock:^(NSString *sequence, NSRange range, NSRange enclosing, BOOL *stop) {
+        UTF32Char scalar = 0;
+        [sequence getBytes:&scalar maxLength:sizeof(scalar) usedLength:NULL
+                  encoding:NSUTF32LittleEndianStringEncoding options:0
+                     range:[sequence rangeOfComposedCharacterSequenceAtIndex:0] remainingRange:NULL];
+        scalar = NSSwapLittleIntToHost(scalar);
+        if (scalar >= 0x2000 && [symbols longCharacterIsMember:scalar]) {
+            [emoji addObject:sequence];
+        }
+    }];
+    return emoji;
+}
+
+/// What the subtree walk found besides the description
+@interface WAMessageCellParts : NSObject
+@property (nonatomic, copy, nullable) NSString *quotedAuthor;
+@property (nonatomic, copy, nullable) NSString *quotedText;
+@property (nonatomic, strong) NSMutableOrderedSet<NSString *> *reactions;
+@property (nonatomic, assign) WAMessageMediaType mediaType;
+@property (nonatomic, copy, nullable) NSString *receipt;
+@end
+
+@implementation WAMessageCellParts
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _reactions = [NSMutableOrderedSet orderedSet];
+    }
+    return self;
+}
+@end
+
+@implementation WAMessageCellDecoder
+
+- (instancetype)initWithSource:(id<WAMessageCellSource>)source {
+    self = [super init];
+    if (self) {
+        _source = source;
+        _maxDepth = 6;
+    }
+    return self;
+}
+
+#pragma mark - Cells
+
+- (WAMessage *)messageFromCell:(id)cell fields:(WAMessageField)fields {
+    NSDictionary *root = [self.source snapshotOfNode:cell];
+    if (![WASnapshotString(root, @"id") isEqualToString:kMessageCellIdentifier]) {
+        return nil;
+    }
+
+    BOOL wantsSubtree = (fields & kSubtreeFields) != 0;
+    WAMessage *message = nil;
+    WAMessageCellParts *parts = [[WAMessageCellParts alloc] init];
+
+    for (id child in root[@"children"]) {
+        NSDictionary *snapshot = [self.source snapshotOfNode:child];
+        if (!snapshot) continue;
+
+        // The AXGenericElement child holds the message description; only one per cell
+        if (!message && [snapshot[@"role"] isEqualToString:@"AXGenericElement"]) {
+            NSString *desc = WASnapshotString(snapshot, @"desc");
+            if (!desc) return nil;
+            message = [WAMessageCellDecoder messageFromDescription:desc fields:fields];
+            if (message.text.length == 0) return nil;
+            if (!wantsSubtree) return message;
+            // Quotes, media and reactions may sit inside the content element
+            [self visitChildrenOf:snapshot depth:1 parts:parts];
+            continue;
+        }
+        if (wantsSubtree) {
+            [self visitSnapshot:snapshot depth:1 parts:parts];
+        }
+    }
+
+    if (message) {
+        [self applyParts:parts toMessage:message fields:fields];
+    }
+    return message;
+}
+
+- (void)visitSnapshot:(NSDictionary *)snapshot depth:(NSUInteger)depth parts:(WAMessageCellParts *)parts {
+    NSString *identifier = WASnapshotString(snapshot, @"id");
+    NSString *desc = WASnapshotString(snapshot, @"desc");
+
+    if (WAContainsText(identifier, @"Quote") || [desc hasPrefix:@"Quoted message"]) {
+        if (!parts.quotedText) [self readQuote:snapshot depth:depth parts:parts];
+        return;
+    }
+    if (WAContainsText(identifier, @"Reaction") || [desc hasPrefix:@"Reaction"]) {
+        [self readReactions:snapshot depth:depth parts:parts];
+        return;
+    }
+    NSString *receipt = WAReceiptState(identifier, desc);
+    if (receipt) {
+        parts.receipt = receipt;
+        return;
+    }
+    WAMessageMediaType mediaType = [WAMessageCellDecoder mediaTypeForIdentifier:identifier description:desc];
+    if (mediaType != WAMessageMediaTypeNone) {
+        // Thumbnails and durations below it add nothing
+        if (parts.mediaType == WAMessageMediaTypeNone) parts.mediaType = mediaType;
+        return;
+    }
+    [self visitChildrenOf:snapshot depth:depth parts:parts];
+}
+
+- (void)visitChildrenOf:(NSDictionary *)snapshot depth:(NSUInteger)depth parts:(WAMessageCellParts *)parts {
+    if (depth >= self.maxDepth) return;
+    for (id child in snapshot[@"children"]) {
+        NSDictionary *childSnapshot = [self.source snapshotOfNode:child];
+        if (childSnapshot) [self visitSnapshot:childSnapshot depth:depth + 1 parts:parts];
+    }
+}
+
+/// Strings of a subtree in pre-order: static text values (or descriptions),
+/// plus descriptions of other elements when includeLabels is set
+- (void)collectTextOf:(NSDictionary *)snapshot depth:(NSUInteger)depth
+        includeLabels:(BOOL)includeLabels into:(NSMutableArray<NSString *> *)lines {
+    if ([snapshot[@"role"] isEqualToString:@"AXStaticText"]) {
+        NSString *text = WASnapshotString(snapshot, @"value") ?: WASnapshotString(snapshot, @"desc");
+        if (text) [lines addObject:text];
+    } else if (includeLabels) {
+        NSString *label = WASnapshotString(snapshot, @"desc");
+        if (label) [lines addObject:label];
+    }
+    if (depth >= self.maxDepth) return;
+    for (id child in snapshot[@"children"]) {
+        NSDictionary *childSnapshot = [self.source snapshotOfNode:child];
+        if (childSnapshot) [self collectTextOf:childSnapshot depth:depth + 1 includeLabels:includeLabels into:lines];
+    }
+}
+
+/// Quoted message: author line, then the quoted text
+- (void)readQuote:(NSDictionary *)snapshot depth:(NSUInteger)depth parts:(WAMessageCellParts *)parts {
+    NSMutableArray<NSString *> *lines = [NSMutableArray array];
+    [self collectTextOf:snapshot depth:depth includeLabels:NO into:lines];
+
+    if (lines.count >= 2) {
+        parts.quotedAuthor = lines.firstObject;
+        parts.quotedText = [[lines subarrayWithRange:NSMakeRange(1, lines.count - 1)] componentsJoinedByString:@"\n"];
+        return;
+    }
+    if (lines.count == 1) {
+        parts.quotedText = lines.firstObject;
+        return;
+    }
+
+    // No text children: "Quoted message, Author, text"
+    NSString *desc = WASnapshotString(snapshot, @"desc");
+    if ([desc hasPrefix:@"Quoted message, "]) {
+        NSString *rest = [desc substringFromIndex:16];
+        NSRange comma = [rest rangeOfString:@", "];
+        if (comma.location != NSNotFound) {
+            parts.quotedAuthor = [rest substringToIndex:comma.location];
+            parts.quotedText = [rest substringFromIndex:NSMaxRange(comma)];
+        } else {
+            parts.quotedText = rest;
+        }
+    }
+}
+
+/// Reaction emoji from the view's description and its children's
+- (void)readReactions:(NSDictionary *)snapshot depth:(NSUInteger)depth parts:(WAMessageCellParts *)parts {
+    NSMutableArray<NSString *> *lines = [NSMutableArray array];
+    [self collectTextOf:snapshot depth:depth includeLabels:YES into:lines];
+    NSString *value = WASnapshotString(snapshot, @"value");
+    if (value) [lines addObject:value];
+    for (NSString *line in lines) {
+        [parts.reactions addObjectsFromArray:WAEmojiInText(line)];
+    }
+}
+
+- (void)applyParts:(WAMessageCellParts *)parts toMessage:(WAMessage *)message fields:(WAMessageField)fields {
+    if ((fields & WAMessageFieldReplyTo) && !message.replyTo && parts.quotedAuthor) {
+        message.replyTo = parts.quotedAuthor;
+    }
+    if ((fields & WAMessageFieldReplyText) && parts.quotedText) {
+        message.replyText = parts.quotedText;
+    }
+    if ((fields & WAMessageFieldReactions) && parts.reactions.count > 0) {
+        message.reactions = parts.reactions.array;
+    }
+    if (fields & WAMessageFieldMediaType) {
+        // Media without a recognisable view still names itself in the text ("Photo")
+        message.mediaType = parts.mediaType != WAMessageMediaTypeNone ? parts.mediaType
+            : [WAMessageCellDecoder mediaTypeForIdentifier:nil description:message.text];
+    }
+    if ((fields & WAMessageFieldIsRead) && parts.receipt && message.direction == WAMessageDirectionOutgoing) {
+        message.isRead = [parts.receipt isEqualToString:@"read"];
+    }
+}
+
+#pragma mark - Media
+
++ (WAMessageMediaType)mediaTypeForIdentifier:(NSString *)identifier description:(NSString *)desc {
+    if (identifier) {
+        if (WAContainsText(identifier, @"Sticker")) return WAMessageMediaTypeSticker;
+        if (WAContainsText(identifier, @"Voice") || WAContainsText(identifier, @"PTT")) return WAMessageMediaTypeVoice;
+        if (WAContainsText(identifier, @"Audio")) return WAMessageMediaTypeAudio;
+        if (WAContainsText(identifier, @"Video") || WAContainsText(identifier, @"Gif")) return WAMessageMediaTypeVideo;
+        if (WAContainsText(identifier, @"LinkPreview")) return WAMessageMediaTypeLink;
+        if (WAContainsText(identifier, @"NonvisualMedia")) {
+            // Same split as search results: links versus files
+            return WAContainsText(desc, @"http") ? WAMessageMediaTypeLink : WAMessageMediaTypeDocument;
+        }
+        if (WAContainsText(identifier, @"Document")) return WAMessageMediaTypeDocument;
+        if (WAContainsText(identifier, @"Image") || WAContainsText(identifier, @"Photo") ||
+            WAContainsText(identifier, @"VisualMedia")) return WAMessageMediaTypeImage;
+    }
+
+    // Labels: "Photo", "Voice message, 0:07", "Document, report.pdf"
+    static NSDictionary<NSString *, NSNumber *> *labels;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        labels = @{
+            @"Photo": @(WAMessageMediaTypeImage),
+            @"Image": @(WAMessageMediaTypeImage),
+            @"Video": @(WAMessageMediaTypeVideo),
+            @"GIF": @(WAMessageMediaTypeVideo),
+            @"Voice message": @(WAMessageMediaTypeVoice),
+            @"Audio": @(WAMessageMediaTypeAudio),
+            @"Document": @(WAMessageMediaTypeDocument),
+            @"Sticker": @(WAMessageMediaTypeSticker)
+        };
+    });
+    if (!desc) return WAMessageMediaTypeNone;
+    NSRange comma = [desc rangeOfString:@", "];
+    NSString *label = comma.location == NSNotFound ? desc : [desc substringToIndex:comma.location];
+    NSNumber *mediaType = labels[label];
+    return mediaType ? (WAMessageMediaType)mediaType.integerValue : WAMessageMediaTypeNone;
+}
+
+#pragma mark - Descriptions
+
++ (WAMessage *)messageFromDescription:(NSString *)desc fields:(WAMessageField)fields {
+    // Format examples:
+    // "message, text here, 11:15, Received from Igor Berezovsky"
+    // "Your message, text here, 11:14, Sent to Igor Berezovsky, Red"
+    // "Replying to Igor Berezovsky.\nmessage, да, теперь стартует! 👍, 12:22, Received from Igor"
+    // "Replying to You.\nmessage, форварднул, 12:23, Received from Igor Berezovsky"
+    
+    WAMessage *message = [[WAMessage alloc] init];
+    
+    // Check for reply
+    if ([desc hasPrefix:@"Replying to "]) {
+        NSRange newlineRange = [desc rangeOfString:@"\n"];
+        if (newlineRange.location != NSNotFound) {
+            if (fields & WAMessageFieldReplyTo) {
+                NSString *replyPart = [desc substringToIndex:newlineRange.location];
+                // Extract who they're replying to
+                NSString *replyTo = [[replyPart stringByReplacingOccurrencesOfString:@"Replying to " withString:@""] 
+                                    stringByReplacingOccurrencesOfString:@"." withString:@""];
+                message.replyTo = replyTo;
+            }
+            
+            // Continue parsing the rest
+            desc = [desc substringFromIndex:newlineRange.location + 1];
+        }
+    }
+    
+    // Determine direction
+    if ([desc hasPrefix:@"Your message, "]) {
+        message.direction = WAMessageDirectionOutgoing;
+        desc = [desc substringFromIndex:14]; // Remove "Your message, "
+    } else if ([desc hasPrefix:@"message, "]) {
+        message.direction = WAMessageDirectionIncoming;
+        desc = [desc substringFromIndex:9]; // Remove "message, "
+    } else {
+        // System message or unknown format
+        message.direction = WAMessageDirectionSystem;
+        message.text = desc;
+        return message;
+    }
+    
+    // Now parse: "text, timestamp, Received from/Sent to Name"
+    // This is tricky because text itself may contain commas
+    
+    // Find timestamp pattern (HH:MM)
+    NSRegularExpression *timeRegex = [NSRegularExpression regularExpressionWithPattern:@", (\\d{1,2}:\\d{2}), " options:0 error:nil];
+    NSTextCheckingResult *timeMatch = [timeRegex firstMatchInString:desc options:0 range:NSMakeRange(0, desc.length)];
+    
+    if (timeMatch && timeMatch.numberOfRanges >= 2) {
+        // Extract timestamp
+        message.timestamp = [desc substringWithRange:[timeMatch rangeAtIndex:1]];
+        
+        // Text is everything before the timestamp
+        NSRange beforeTime = NSMakeRange(0, timeMatch.range.location);
+        message.text = [desc substringWithRange:beforeTime];
+        
+        // After timestamp is sender/recipient info
+        if (!(fields & (WAMessageFieldSender | WAMessageFieldIsRead))) {
+            return message;
+        }
+        NSUInteger afterTimeStart = timeMatch.range.location + timeMatch.range.length;
+        NSString *afterTime = [desc substringFromIndex:afterTimeStart];
+        
+        if ([afterTime hasPrefix:@"Received from "]) {
+            NSString *sender = [afterTime stringByReplacingOccurrencesOfString:@"Received from " withString:@""];
+            // May have trailing info, find comma
+            NSRange commaRange = [sender rangeOfString:@", "];
+            if (commaRange.location != NSNotFound) {
+                sender = [sender substringToIndex:commaRange.location];
+            }
+            message.sender = sender;
+        } else if ([afterTime hasPrefix:@"Sent to "]) {
+            // Check for read status
+            message.isRead = ![afterTime containsString:@"Red"]; // "Red" likely means "not read" indicator
+        }
+    } else {
+        // Fallback - just use the whole thing as text
+        message.text = desc;
+    }
+    
+    return message;
+}
+
+@end
+
+#pragma mark - WARecordedCellSource
+
+@interface WARecordedCellSource ()
+@property (atomic, readwrite) NSUInteger fetchCount;
+@end
+
+@implementation WARecordedCellSource
+
+- (NSDictionary *)snapshotOfNode:(id)node {
+    @synchronized (self) {
+        self.fetchCount = self.fetchCount + 1;
+    }
+    return [node isKindOfClass:[NSDictionary class]] ? node : nil;
+}
+
+@end
@@ -0,0 +1,29 @@
+// WAMessageCellDecoderTest.h
+// Recorded-cell checks for WAMessageCellDecoder (Foundation only, no WhatsApp needed)
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Decodes recorded message cell subtrees and compares every field with its
+ * expected value, plus how many nodes each decode fetched. Uses only
+ * WAMessage, WAMessageCellDecoder and WARecordedCellSource, so it also builds
+ * without the app, on macOS and on Linux with GNUstep Base (`make check` at
+ * the repository root, which CI runs on both). By hand, from mcpwa/:
+ *
+ *   clang -fobjc-arc -framework Foundation -DWA_CELL_DECODER_TEST_MAIN \
+ *       WAMessage.m WAMessageCellDecoder.m WAMessageCellDecoderTest.m -o cellcheck
+ *
+ *   clang $(gnustep-config --objc-flags) -fblocks -DWA_CELL_DECODER_TEST_MAIN \
+ *       WAMessage.m WAMessageCellDecoder.m WAMessageCellDecoderTest.m -o cellcheck \
+ *       $(gnustep-config --base-libs) -ldispatch -lBlocksRuntime
+ */
+@interface WAMessageCellDecoderTest : NSObject
+
+/// Log PASS/FAIL per check and a summary; YES if every check passed
++ (BOOL)runRecordedCellChecks;
+
+@end
+
+NS_ASSUME_NONNULL_END
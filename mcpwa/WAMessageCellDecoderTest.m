@@ -0,0 +1,141 @@
+// WAMessageCellDecoderTest.m
+// Recorded-cell checks for WAMessageCellDecoder (Foundation only, no WhatsApp needed)
+
+#import "WAMessageCellDecoderTest.h"
+#import "WAMessageCellDecoder.h"
+
+@implementation WAMessageCellDecoderTest
+
+/// Nodes in a recorded subtree, cell included
++ (NSUInteger)nodeCountOfSnapshot:(NSDictionary *)snapshot {
+    NSUInteger count = 1;
+    for (NSDictionary *child in snapshot[@"children"]) {
+        count += [self nodeCountOfSnapshot:child];
+    }
+    return count;
+}
+
++ (BOOL)runRecordedCellChecks {
+    NSLog(@"\n\n=== MESSAGE CELL DECODER TESTS (recorded cells) ===\n");
+
+    // Cell subtrees in the form WAAXElementProvider snapshots them
+    NSDictionary *plain = @{@"role": @"AXGroup", @"id": @"WAMessageBubbleTableViewCell", @"children": @[
+        @{@"role": @"AXGenericElement", @"desc": @"message, Bonjour! pour Grasse, 12:22, Received from Igor Berezovsky"}
+    ]};
+    NSDictionary *reply = @{@"role": @"AXGroup", @"id": @"WAMessageBubbleTableViewCell", @"children": @[
+        @{@"role": @"AXGenericElement",
+          @"desc": @"Replying to Igor Berezovsky.\nmessage, да, теперь стартует! 👍, 12:24, Received from Tania Melamed",
+          @"children": @[
+              @{@"role": @"AXGroup", @"id": @"WAQuotedMessageView", @"children": @[
+                  @{@"role": @"AXStaticText", @"value": @"Igor Berezovsky"},
+                  @{@"role": @"AXStaticText", @"value": @"Tournament in Grasse is moved to Sunday"}
+              ]},
+              @{@"role": @"AXStaticText", @"value": @"да, теперь стартует! 👍"}
+          ]},
+        @{@"role": @"AXButton", @"id": @"WAMessageReactionsView", @"desc": @"Reactions: 👍 2, ❤️ 1, 👍🏽 1"}
+    ]};
+    NSDictionary *photo = @{@"role": @"AXGroup", @"id": @"WAMessageBubbleTableViewCell", @"children": @[
+        @{@"role": @"AXGenericElement", @"desc": @"Your message, Photo, 11:14, Sent to Igor Berezovsky",
+          @"children": @[
+              @{@"role": @"AXImage", @"id": @"WAMessageBubbleVisualMedia", @"children": @[
+                  @{@"role": @"AXImage", @"desc": @"Thumbnail"}
+              ]}
+          ]},
+        @{@"role": @"AXImage", @"desc": @"Delivered"}
+    ]};
+    NSDictionary *voice = @{@"role": @"AXGroup", @"id": @"WAMessageBubbleTableViewCell", @"children": @[
+        @{@"role": @"AXGenericElement", @"desc": @"message, Voice message, 09:30, Received from Igor Berezovsky",
+          @"children": @[
+              @{@"role": @"AXButton", @"id": @"WAVoiceNotePlayerView", @"desc": @"Play"}
+          ]}
+    ]};
+    NSDictionary *dateHeader = @{@"role": @"AXGroup", @"id": @"WADateSeparatorCell", @"children": @[
+        @{@"role": @"AXStaticText", @"value": @"Today"}
+    ]};
+
+    NSArray<NSDictionary *> *cells = @[plain, reply, photo, voice, dateHeader];
+    NSArray<NSString *> *names = @[@"plain", @"reply", @"photo", @"voice", @"date header"];
+    // toDictionary of the decoded message with all fields; NSNull = not a message
+    NSArray *expected = @[
+        @{@"direction": @"incoming", @"text": @"Bonjour! pour Grasse", @"timestamp": @"12:22",
+          @"sender": @"Igor Berezovsky"},
+        @{@"direction": @"incoming", @"text": @"да, теперь стартует! 👍", @"timestamp": @"12:24",
+          @"sender": @"Tania Melamed", @"reply_to": @"Igor Berezovsky",
+          @"reply_text": @"Tournament in Grasse is moved to Sunday", @"reactions": @[@"👍", @"❤️", @"👍🏽"]},
+        @{@"direction": @"outgoing", @"text": @"Photo", @"timestamp": @"11:14", @"is_read": @NO,
+          @"media_type": @"image"},
+        @{@"direction": @"incoming", @"text": @"Voice message", @"timestamp": @"09:30",
+          @"sender": @"Igor Berezovsky", @"media_type": @"voice"},
+        [NSNull null]
+    ];
+    // Text fields fetch the cell and its children up to the description element
+    NSArray<NSNumber *> *expectedCheapFetches = @[@2, @2, @2, @2, @1];
+
+    __block NSUInteger passed = 0, failed = 0;
+    void (^check)(NSString *, id, id) = ^(NSString *label, id actual, id expectedValue) {
+        BOOL ok = actual == expectedValue || [actual isEqual:expectedValue];
+        ok ? passed++ : failed++;
+        if (ok) {
+            NSLog(@"PASS %@", label);
+        } else {
+            NSLog(@"FAIL %@: %@ (expected %@)", label, actual ?: @"nil", expectedValue ?: @"nil");
+        }
+    };
+
+    WAMessageField cheapFields = WAMessageFieldText | WAMessageFieldSender | WAMessageFieldTimestamp | WAMessageFieldDirection;
+    for (NSUInteger i = 0; i < cells.count; i++) {
+        WARecordedCellSource *source = [[WARecordedCellSource alloc] init];
+        WAMessageCellDecoder *decoder = [[WAMessageCellDecoder alloc] initWithSource:source];
+
+        WAMessage *message = [decoder messageFromCell:cells[i] fields:WAMessageFieldAll];
+        NSUInteger fullFetches = source.fetchCount;
+        [decoder messageFromCell:cells[i] fields:cheapFields];
+        NSUInteger cheapFetches = source.fetchCount - fullFetches;
+
+        if (expected[i] == [NSNull null]) {
+            check([NSString stringWithFormat:@"%@: not a message", names[i]], message, nil);
+        } else {
+            // Field by field, so a failure names the field; then nothing extra
+            NSDictionary *actual = [message toDictionary];
+            NSDictionary *wanted = expected[i];
+            for (NSString *key in [wanted.allKeys sortedArrayUsingSelector:@selector(compare:)]) {
+                check([NSString stringWithFormat:@"%@: %@", names[i], key], actual[key], wanted[key]);
+            }
+            NSMutableSet *extra = [NSMutableSet setWithArray:actual.allKeys ?: @[]];
+            [extra minusSet:[NSSet setWithArray:wanted.allKeys]];
+            check([NSString stringWithFormat:@"%@: no other fields", names[i]],
+                  [extra.allObjects sortedArrayUsingSelector:@selector(compare:)], @[]);
+        }
+
+        // All fields: no node fetched twice (media views aren't descended into)
+        NSUInteger nodes = [self nodeCountOfSnapshot:cells[i]];
+        check([NSString stringWithFormat:@"%@: all-field fetches within %lu nodes", names[i], (unsigned long)nodes],
+              @(fullFetches <= nodes), @YES);
+        check([NSString stringWithFormat:@"%@: text-field fetches", names[i]], @(cheapFetches), expectedCheapFetches[i]);
+    }
+
+    // Labels alone also name the media
+    check(@"label 'Document, report.pdf, 2 pages'",
+          [WAMessage nameForMediaType:[WAMessageCellDecoder mediaTypeForIdentifier:nil description:@"Document, report.pdf, 2 pages"]],
+          @"document");
+    check(@"label 'Sticker'",
+          [WAMessage nameForMediaType:[WAMessageCellDecoder mediaTypeForIdentifier:nil description:@"Sticker"]],
+          @"sticker");
+    check(@"label 'Photos from Grasse'",
+          [WAMessage nameForMediaType:[WAMessageCellDecoder mediaTypeForIdentifier:nil description:@"Photos from Grasse"]],
+          @"none");
+
+    NSLog(@"Message cell decoder: %lu passed, %lu failed", (unsigned long)passed, (unsigned long)failed);
+    NSLog(@"\n=== END MESSAGE CELL DECODER TESTS ===\n");
+    return failed == 0;
+}
+
+@end
+
+#ifdef WA_CELL_DECODER_TEST_MAIN
+int main(int argc, const char *argv[]) {
+    @autoreleasepool {
+        return [WAMessageCellDecoderTest runRecordedCellChecks] ? 0 : 1;
+    }
+}
+#endif
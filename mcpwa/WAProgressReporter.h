@@ -0,0 +1,47 @@
+// WAProgressReporter.h
+// MCP progress notifications for long-running tool calls
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Delivers one JSON-RPC notification to the client connection
+typedef void (^WAProgressSender)(NSDictionary *notification);
+
+/**
+ * Emits notifications/progress for one tools/call that carried
+ * params._meta.progressToken.
+ *
+ * Each stage bumps progress and sends a short message. Stages may also carry a
+ * partial result under params._meta["mcpwa/partial"], so clients that know about
+ * it can show e.g. chat-name matches before message matches are parsed.
+ * Clients that don't simply see ordinary progress.
+ *
+ * Long-running WAAccessibility methods take an optional reporter; messaging
+ * nil is a no-op, so callers without a token pass nil.
+ */
+@interface WAProgressReporter : NSObject
+
+/// Reporter for a tools/call request, or nil if it has no progress token
++ (nullable instancetype)reporterForRequest:(NSDictionary *)request sender:(WAProgressSender)sender;
+
+- (instancetype)initWithToken:(id)token sender:(WAProgressSender)sender NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+@property (nonatomic, strong, readonly) id token;
+
+/// Expected number of stages, sent as "total" (0 = unknown)
+@property (nonatomic, assign) NSUInteger totalStages;
+
+/// Stages reported so far
+@property (nonatomic, readonly) NSUInteger completedStages;
+
+/// Report a finished stage
+- (void)completeStage:(NSString *)message;
+
+/// Report a finished stage together with a partial payload
+- (void)completeStage:(NSString *)message partial:(nullable NSDictionary *)partial;
+
+@end
+
+NS_ASSUME_NONNULL_END
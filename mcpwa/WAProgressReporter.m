@@ -0,0 +1,68 @@
+// WAProgressReporter.m
+// MCP progress notifications for long-running tool calls
+
+#import "WAProgressReporter.h"
+#import "WALogger.h"
+
+static NSString * const kPartialMetaKey = @"mcpwa/partial";
+
+@interface WAProgressReporter ()
+@property (nonatomic, strong, readwrite) id token;
+@property (nonatomic, copy) WAProgressSender sender;
+@property (nonatomic, readwrite) NSUInteger completedStages;
+@end
+
+@implementation WAProgressReporter
+
++ (instancetype)reporterForRequest:(NSDictionary *)request sender:(WAProgressSender)sender {
+    NSDictionary *params = request[@"params"];
+    if (![params isKindOfClass:[NSDictionary class]]) return nil;
+    NSDictionary *meta = params[@"_meta"];
+    if (![meta isKindOfClass:[NSDictionary class]]) return nil;
+
+    // The spec allows string or integer tokens
+    id token = meta[@"progressToken"];
+    if (![token isKindOfClass:[NSString class]] && ![token isKindOfClass:[NSNumber class]]) return nil;
+    return [[self alloc] initWithToken:token sender:sender];
+}
+
+- (instancetype)initWithToken:(id)token sender:(WAProgressSender)sender {
+    self = [super init];
+    if (self) {
+        _token = token;
+        _sender = [sender copy];
+    }
+    return self;
+}
+
+- (void)completeStage:(NSString *)message {
+    [self completeStage:message partial:nil];
+}
+
+- (void)completeStage:(NSString *)message partial:(NSDictionary *)partial {
+    NSUInteger progress;
+    @synchronized (self) {
+        progress = ++self.completedStages;
+    }
+
+    NSMutableDictionary *params = [NSMutableDictionary dictionary];
+    params[@"progressToken"] = self.token;
+    params[@"progress"] = @(progress);
+    // Progress must never exceed total, so drop total once stages overrun it
+    if (self.totalStages >= progress) {
+        params[@"total"] = @(self.totalStages);
+    }
+    params[@"message"] = message;
+    if (partial) {
+        params[@"_meta"] = @{kPartialMetaKey: partial};
+    }
+
+    [WALogger debug:@"progress %@: %lu %@", self.token, (unsigned long)progress, message];
+    self.sender(@{
+        @"jsonrpc": @"2.0",
+        @"method": @"notifications/progress",
+        @"params": params
+    });
+}
+
+@end
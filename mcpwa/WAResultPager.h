@@ -0,0 +1,45 @@
+// WAResultPager.h
+// Server-side cursors for paging large tool results
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// One page of a paged tool result
+@interface WAResultPage : NSObject
+@property (nonatomic, strong) NSArray<NSDictionary *> *items;
+@property (nonatomic, copy, nullable) NSString *nextCursor;  // nil on the last page
+@property (nonatomic, assign) NSInteger total;               // Items in the whole result set
+
+/// {itemsKey: [...], "total": n, "next_cursor": "..."} for the tool response
+- (NSDictionary *)toDictionaryWithItemsKey:(NSString *)itemsKey;
+@end
+
+/**
+ * Holds the tail of a result set between tool calls so the client only ever
+ * receives `limit` items at a time. Cursors are opaque tokens; the items stay
+ * in the app and expire after a few minutes of inactivity.
+ */
+@interface WAResultPager : NSObject
+
+/// Default page size when the caller does not pass a limit
+@property (class, readonly) NSInteger defaultLimit;
+
++ (instancetype)shared;
+
+/// Return the first page of items. If more remain, they are parked behind nextCursor.
+/// limit <= 0 uses defaultLimit.
+- (WAResultPage *)firstPageOfItems:(NSArray<NSDictionary *> *)items limit:(NSInteger)limit;
+
+/// Return the page following cursor. limit <= 0 reuses the limit of the first page.
+/// Returns nil if the cursor is unknown or expired; *error describes why.
+- (nullable WAResultPage *)pageForCursor:(NSString *)cursor
+                                   limit:(NSInteger)limit
+                                   error:(NSError * _Nullable * _Nullable)error;
+
+/// Drop all parked result sets (e.g. on stop_session)
+- (void)invalidateAll;
+
+@end
+
+NS_ASSUME_NONNULL_END
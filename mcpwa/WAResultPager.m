@@ -0,0 +1,151 @@
+// WAResultPager.m
+// Server-side cursors for paging large tool results
+
+#import "WAResultPager.h"
+#import "WALogger.h"
+
+static const NSTimeInterval kCursorTTL = 300.0;
+static const NSUInteger kMaxOpenCursors = 32;
+
+@implementation WAResultPage
+
+- (NSDictionary *)toDictionaryWithItemsKey:(NSString *)itemsKey {
+    NSMutableDictionary *dict = [NSMutableDictionary dictionary];
+    dict[itemsKey] = self.items ?: @[];
+    dict[@"total"] = @(self.total);
+    if (self.nextCursor) dict[@"next_cursor"] = self.nextCursor;
+    return [dict copy];
+}
+
+@end
+
+#pragma mark - Cursor State
+
+@interface WAResultCursor : NSObject
+@property (nonatomic, strong) NSArray<NSDictionary *> *items;
+@property (nonatomic, assign) NSUInteger offset;
+@property (nonatomic, assign) NSInteger limit;
+@property (nonatomic, strong) NSDate *lastAccess;
+@end
+
+@implementation WAResultCursor
+@end
+
+#pragma mark - WAResultPager
+
+@interface WAResultPager ()
+@property (nonatomic, strong) NSMutableDictionary<NSString *, WAResultCursor *> *cursors;
+@end
+
+@implementation WAResultPager
+
++ (NSInteger)defaultLimit {
+    return 20;
+}
+
++ (instancetype)shared {
+    static WAResultPager *instance = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        instance = [[self alloc] init];
+    });
+    return instance;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _cursors = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (WAResultPage *)firstPageOfItems:(NSArray<NSDictionary *> *)items limit:(NSInteger)limit {
+    WAResultCursor *cursor = [[WAResultCursor alloc] init];
+    cursor.items = [items copy];
+    cursor.limit = limit > 0 ? limit : WAResultPager.defaultLimit;
+
+    @synchronized (self) {
+        [self evictExpiredCursors];
+        return [self takePageFromCursor:cursor limit:cursor.limit];
+    }
+}
+
+- (WAResultPage *)pageForCursor:(NSString *)token limit:(NSInteger)limit error:(NSError **)error {
+    @synchronized (self) {
+        [self evictExpiredCursors];
+
+        WAResultCursor *cursor = self.cursors[token];
+        if (!cursor) {
+            if (error) {
+                *error = [NSError errorWithDomain:@"WAResultPager" code:1
+                                         userInfo:@{NSLocalizedDescriptionKey: @"Cursor is unknown or expired; repeat the original call"}];
+            }
+            return nil;
+        }
+        [self.cursors removeObjectForKey:token];
+        return [self takePageFromCursor:cursor limit:limit > 0 ? limit : cursor.limit];
+    }
+}
+
+- (void)invalidateAll {
+    @synchronized (self) {
+        [self.cursors removeAllObjects];
+    }
+}
+
+#pragma mark - Private
+
+/// Slice the next page off cursor and park the remainder (caller holds the lock)
+- (WAResultPage *)takePageFromCursor:(WAResultCursor *)cursor limit:(NSInteger)limit {
+    NSUInteger remaining = cursor.items.count - cursor.offset;
+    NSUInteger pageLength = MIN(remaining, (NSUInteger)limit);
+
+    WAResultPage *page = [[WAResultPage alloc] init];
+    page.items = [cursor.items subarrayWithRange:NSMakeRange(cursor.offset, pageLength)];
+    page.total = cursor.items.count;
+
+    cursor.offset += pageLength;
+    if (cursor.offset < cursor.items.count) {
+        if (self.cursors.count >= kMaxOpenCursors) {
+            [self evictOldestCursor];
+        }
+        // Re-issue a fresh token per page so a replayed cursor can't skip ahead
+        NSString *nextToken = [[NSUUID UUID] UUIDString];
+        cursor.lastAccess = [NSDate date];
+        self.cursors[nextToken] = cursor;
+        page.nextCursor = nextToken;
+    }
+
+    [WALogger debug:@"WAResultPager: page %lu/%lu items%@",
+     (unsigned long)cursor.offset, (unsigned long)cursor.items.count,
+     page.nextCursor ? @", more pending" : @""];
+    return page;
+}
+
+- (void)evictExpiredCursors {
+    NSDate *cutoff = [NSDate dateWithTimeIntervalSinceNow:-kCursorTTL];
+    NSMutableArray<NSString *> *expired = [NSMutableArray array];
+    [self.cursors enumerateKeysAndObjectsUsingBlock:^(NSString *key, WAResultCursor *cursor, BOOL *stop) {
+        if ([cursor.lastAccess compare:cutoff] == NSOrderedAscending) {
+            [expired addObject:key];
+        }
+    }];
+    [self.cursors removeObjectsForKeys:expired];
+}
+
+- (void)evictOldestCursor {
+    __block NSString *oldestKey = nil;
+    __block NSDate *oldestDate = nil;
+    [self.cursors enumerateKeysAndObjectsUsingBlock:^(NSString *key, WAResultCursor *cursor, BOOL *stop) {
+        if (!oldestDate || [cursor.lastAccess compare:oldestDate] == NSOrderedAscending) {
+            oldestKey = key;
+            oldestDate = cursor.lastAccess;
+        }
+    }];
+    if (oldestKey) {
+        [self.cursors removeObjectForKey:oldestKey];
+    }
+}
+
+@end
@@ -35,7 +35,8 @@ typedef NS_ENUM(NSInteger, WASearchResultAttachment) {
 @property (nonatomic, assign) WASearchResultAttachment attachmentType;
 @property (nonatomic, copy, nullable) NSString *attachmentDescription;  // Link URL or image label
 
-// The raw AXUIElementRef for clicking (not retained across calls)
+// The raw AXUIElementRef for clicking; borrowed from the tool call's
+// WAAXArena, so only valid until that call returns
 @property (nonatomic, assign) AXUIElementRef elementRef;
 
 #pragma mark - Parsing
@@ -9,6 +9,12 @@ NS_ASSUME_NONNULL_BEGIN
 
 @interface WASearchResultsAccessor : NSObject
 
+/// Reads from the first running WhatsApp (personal before Business)
+- (instancetype)init;
+
+/// Reads from a specific WhatsApp process, e.g. one of several accounts
+- (instancetype)initWithProcessIdentifier:(pid_t)pid NS_DESIGNATED_INITIALIZER;
+
 /**
  * Get all visible search results from WhatsApp's search panel
  * Call this after performing a search and waiting for results
@@ -3,17 +3,25 @@
 
 #import <Cocoa/Cocoa.h>
 #import "WASearchResultsAccessor.h"
+#import "WAAccessibility.h"
+#import "WAAXArena.h"
 
 @interface WASearchResultsAccessor ()
 @property (nonatomic, assign) AXUIElementRef whatsAppApp;
+@property (nonatomic, assign) pid_t pid;                // 0 = first running WhatsApp
 @property (nonatomic, strong) NSMutableArray<WASearchResult *> *cachedResults;
 @end
 
 @implementation WASearchResultsAccessor
 
 - (instancetype)init {
+    return [self initWithProcessIdentifier:0];
+}
+
+- (instancetype)initWithProcessIdentifier:(pid_t)pid {
     self = [super init];
     if (self) {
+        _pid = pid;
         _cachedResults = [NSMutableArray array];
         [self findWhatsApp];
     }
@@ -34,14 +42,20 @@
         _whatsAppApp = NULL;
     }
     
-    NSArray *apps = [NSRunningApplication runningApplicationsWithBundleIdentifier:@"net.whatsapp.WhatsApp"];
-    if (apps.count == 0) {
-        return NO;
+    if (self.pid > 0) {
+        _whatsAppApp = AXUIElementCreateApplication(self.pid);
+        return (_whatsAppApp != NULL);
     }
     
-    NSRunningApplication *app = apps.firstObject;
-    _whatsAppApp = AXUIElementCreateApplication(app.processIdentifier);
-    return (_whatsAppApp != NULL);
+    for (NSString *bundleIdentifier in [WAAccessibility supportedBundleIdentifiers]) {
+        NSArray *apps = [NSRunningApplication runningApplicationsWithBundleIdentifier:bundleIdentifier];
+        NSRunningApplication *app = apps.firstObject;
+        if (app) {
+            _whatsAppApp = AXUIElementCreateApplication(app.processIdentifier);
+            return (_whatsAppApp != NULL);
+        }
+    }
+    return NO;
 }
 
 #pragma mark - AX Helpers
@@ -93,17 +107,15 @@
         return NULL;
     }
     
-    AXUIElementRef window = (AXUIElementRef)windowValue;
-    AXUIElementRef result = [self findElementWithDescription:@"Search results" 
-                                                  startingFrom:window 
-                                                     maxDepth:8];
-    
-    CFRelease(window);
-    return result;
+    AXUIElementRef window = [WAAXArena adoptInCurrentArena:(AXUIElementRef)windowValue];
+    return [self findElementWithDescription:@"Search results" 
+                               startingFrom:window 
+                                   maxDepth:8];
 }
 
 /**
- * Recursive search for element with matching AXDescription
+ * Recursive search for element with matching AXDescription.
+ * The match is borrowed from the current WAAXArena (autoreleased outside one).
  */
 - (AXUIElementRef)findElementWithDescription:(NSString *)targetDesc 
                                 startingFrom:(AXUIElementRef)element 
@@ -114,8 +126,7 @@
     
     NSString *desc = [self getStringAttribute:kAXDescriptionAttribute fromElement:element];
     if ([desc isEqualToString:targetDesc]) {
-        CFRetain(element);
-        return element;
+        return [WAAXArena adoptInCurrentArena:(AXUIElementRef)CFRetain(element)];
     }
     
     NSArray *children = [self getChildren:element];
@@ -161,7 +172,6 @@
         }
     }
     
-    CFRelease(container);
     return [_cachedResults copy];
 }
 
@@ -188,8 +198,8 @@
         return nil;
     }
     
-    // Store element ref for clicking (caller must use immediately, not retained)
-    result.elementRef = element;
+    // Store element ref for clicking: kept alive by the tool call's arena, if any
+    result.elementRef = [[WAAXArena currentArena] borrow:element] ?: element;
     
     // Check for attachment button
     if (children.count > 1) {
@@ -269,7 +279,6 @@
     }
     
     NSLog(@"Scanned %ld MessageResults total", (long)resultIndex);
-    CFRelease(container);
     return success;
 }
 @end
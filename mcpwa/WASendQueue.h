@@ -0,0 +1,83 @@
+// WASendQueue.h
+// Outgoing message queue with delivery confirmation
+
+#import <Foundation/Foundation.h>
+
+@class WAAccessibility;
+@class WAProgressReporter;
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(NSInteger, WASendJobStatus) {
+    WASendJobStatusPending,
+    WASendJobStatusConfirmed,     // Seen as a new outgoing message in the chat
+    WASendJobStatusUnconfirmed,   // Sent (compose box emptied) but never seen; not resent
+    WASendJobStatusFailed         // Chat not found or the message could not be sent
+};
+
+/// One (chat, text) job
+@interface WASendJob : NSObject
+@property (nonatomic, assign) NSUInteger index;              // Position in the request
+@property (nonatomic, copy) NSString *chat;                  // As requested
+@property (nonatomic, copy) NSString *text;
+@property (nonatomic, assign) WASendJobStatus status;
+@property (nonatomic, copy, nullable) NSString *chatName;    // Header name the message went to
+@property (nonatomic, copy, nullable) NSString *fingerprint; // Of the confirmed message
+@property (nonatomic, assign) NSUInteger attempts;
+@property (nonatomic, copy, nullable) NSString *error;
+@property (nonatomic, assign) NSTimeInterval duration;
+
+/// {"index", "chat", "status", "attempts", "duration_ms", "fingerprint"?, "error"?}
+- (NSDictionary *)toDictionary;
+
++ (NSString *)nameForStatus:(WASendJobStatus)status;
+@end
+
+/**
+ * Sends queued messages chat by chat and confirms each one.
+ *
+ * Jobs are grouped by target (chats in order of first mention, each chat's
+ * messages in request order), so every chat is opened once. Before each send
+ * the bottom message's fingerprint is taken as a watermark; the send counts as
+ * confirmed once an outgoing message with the same text appears below it.
+ *
+ * A failed attempt is retried after a doubling backoff, but only when it is
+ * safe: the chat could not be opened, the compose box could not be set, or
+ * the text is still sitting in the compose box. If the box was emptied but the
+ * bubble never showed up, the message probably went out, so the job is
+ * reported unconfirmed instead of risking a duplicate.
+ */
+@interface WASendQueue : NSObject
+
+- (instancetype)initWithAccessibility:(WAAccessibility *)accessibility NS_DESIGNATED_INITIALIZER;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Attempts per job, including the first (default 3)
+@property (nonatomic, assign) NSUInteger maxAttempts;
+
+/// Wait before the first retry; doubles on each further one (default 0.5s)
+@property (nonatomic, assign) NSTimeInterval initialBackoff;
+
+/// How long to watch for the outgoing bubble (default 3s)
+@property (nonatomic, assign) NSTimeInterval confirmTimeout;
+
+/// Reports one stage per job, with that job's result as the partial
+@property (nonatomic, strong, nullable) WAProgressReporter *progress;
+
+/// Queued jobs in request order
+@property (nonatomic, readonly) NSArray<WASendJob *> *jobs;
+
+- (void)enqueueMessage:(NSString *)text toChat:(NSString *)chat;
+
+/// Run the tool arguments {"messages": [{"chat", "message"}, ...]} and/or
+/// {"chats": [...], "message": "..."} (one text to many chats).
+/// Returns {"results": [...] in request order, "confirmed", "unconfirmed",
+/// "failed", "total_ms"}, or {"error": "..."} if the arguments are invalid.
+- (NSDictionary *)runWithArguments:(NSDictionary *)arguments;
+
+/// Send every pending job; holds the accessor's operation queue throughout
+- (NSDictionary *)run;
+
+@end
+
+NS_ASSUME_NONNULL_END
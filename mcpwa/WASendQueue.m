@@ -0,0 +1,284 @@
+// WASendQueue.m
+// Outgoing message queue with delivery confirmation
+
+#import "WASendQueue.h"
+#import "WAAccessibility.h"
+#import "WAProgressReporter.h"
+#import "WALogger.h"
+
+static const NSTimeInterval kOpenSettleTimeout = 1.0;
+static const NSTimeInterval kConfirmPoll = 0.25;
+static const NSInteger kConfirmReadLimit = 20;           // New rows inspected per poll
+static const NSUInteger kConfirmCompareLength = 100;     // Long texts are matched on their start
+
+#pragma mark - WASendJob
+
+@implementation WASendJob
+
++ (NSString *)nameForStatus:(WASendJobStatus)status {
+    switch (status) {
+        case WASendJobStatusPending: return @"pending";
+        case WASendJobStatusConfirmed: return @"confirmed";
+        case WASendJobStatusUnconfirmed: return @"unconfirmed";
+        case WASendJobStatusFailed: return @"failed";
+    }
+    return @"unknown";
+}
+
+- (NSDictionary *)toDictionary {
+    NSMutableDictionary *dict = [NSMutableDictionary dictionary];
+    dict[@"index"] = @(self.index);
+    dict[@"chat"] = self.chatName ?: self.chat;
+    dict[@"status"] = [WASendJob nameForStatus:self.status];
+    dict[@"attempts"] = @(self.attempts);
+    dict[@"duration_ms"] = @(llround(self.duration * 1000.0));
+    if (self.fingerprint) dict[@"fingerprint"] = self.fingerprint;
+    if (self.error) dict[@"error"] = self.error;
+    return [dict copy];
+}
+
+@end
+
+#pragma mark - WASendQueue
+
+/// String argument or nil (empty strings count as missing)
+static NSString *WASendStringArgument(NSDictionary *dictionary, NSString *key) {
+    id value = dictionary[key];
+    return [value isKindOfClass:[NSString class]] && [value length] > 0 ? value : nil;
+}
+
+/// Whitespace-collapsed form used to match a sent text against its bubble
+static NSString *WANormalizedMessageText(NSString *text) {
+    NSArray<NSString *> *words = [text componentsSeparatedByCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+    NSString *joined = [[words filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"length > 0"]] componentsJoinedByString:@" "];
+    return joined.length > kConfirmCompareLength ? [joined substringToIndex:kConfirmCompareLength] : joined;
+}
+
+@interface WASendQueue ()
+@property (nonatomic, strong) WAAccessibility *accessibility;
+@property (nonatomic, strong) NSMutableArray<WASendJob *> *queuedJobs;
+@end
+
+@implementation WASendQueue
+
+- (instancetype)initWithAccessibility:(WAAccessibility *)accessibility {
+    self = [super init];
+    if (self) {
+        _accessibility = accessibility;
+        _queuedJobs = [NSMutableArray array];
+        _maxAttempts = 3;
+        _initialBackoff = 0.5;
+        _confirmTimeout = 3.0;
+    }
+    return self;
+}
+
+- (NSArray<WASendJob *> *)jobs {
+    return [self.queuedJobs copy];
+}
+
+- (void)enqueueMessage:(NSString *)text toChat:(NSString *)chat {
+    WASendJob *job = [[WASendJob alloc] init];
+    job.index = self.queuedJobs.count;
+    job.chat = chat;
+    job.text = text;
+    [self.queuedJobs addObject:job];
+}
+
+- (NSDictionary *)runWithArguments:(NSDictionary *)arguments {
+    id messages = arguments[@"messages"];
+    if (messages && ![messages isKindOfClass:[NSArray class]]) {
+        return @{@"error": @"messages must be an array"};
+    }
+    NSUInteger position = 0;
+    for (NSDictionary *item in messages) {
+        NSString *chat = [item isKindOfClass:[NSDictionary class]] ? WASendStringArgument(item, @"chat") : nil;
+        NSString *text = [item isKindOfClass:[NSDictionary class]] ? WASendStringArgument(item, @"message") : nil;
+        if (!chat || !text) {
+            return @{@"error": [NSString stringWithFormat:@"messages[%lu]: chat and message are required", (unsigned long)position]};
+        }
+        [self enqueueMessage:text toChat:chat];
+        position++;
+    }
+
+    // One announcement to many chats
+    id chats = arguments[@"chats"];
+    if (chats) {
+        NSString *text = WASendStringArgument(arguments, @"message");
+        if (![chats isKindOfClass:[NSArray class]] || !text) {
+            return @{@"error": @"chats must be an array of names and message is required with it"};
+        }
+        for (NSString *chat in chats) {
+            if (![chat isKindOfClass:[NSString class]] || chat.length == 0) continue;
+            [self enqueueMessage:text toChat:chat];
+        }
+    }
+
+    if (self.queuedJobs.count == 0) {
+        return @{@"error": @"Nothing to send"};
+    }
+    return [self run];
+}
+
+- (NSDictionary *)run {
+    __block NSDictionary *response = nil;
+    [self.accessibility performOperation:^{
+        response = [self runOnQueue];
+    } named:@"whatsapp_send_bulk"];
+    return response;
+}
+
+- (NSDictionary *)runOnQueue {
+    if (![self.accessibility isWhatsAppAvailable]) {
+        return @{@"error": @"WhatsApp is not running or accessibility permission is missing"};
+    }
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    NSArray<NSArray<WASendJob *> *> *groups = [self jobsGroupedByChat];
+    self.progress.totalStages = self.queuedJobs.count;
+
+    for (NSArray<WASendJob *> *group in groups) {
+        NSString *chatName = nil;
+        NSString *missingChatError = nil;
+        for (WASendJob *job in group) {
+            if (job.status != WASendJobStatusPending) continue;
+            if (missingChatError) {
+                // Every attempt to find this chat already failed; don't search again per job
+                job.status = WASendJobStatusFailed;
+                job.error = missingChatError;
+            } else {
+                chatName = [self sendJob:job openChat:chatName];
+                if (job.status == WASendJobStatusFailed && !job.chatName) {
+                    missingChatError = job.error;
+                }
+            }
+            [self.progress completeStage:[NSString stringWithFormat:@"%@: %@", job.chatName ?: job.chat, [WASendJob nameForStatus:job.status]]
+                                 partial:[job toDictionary]];
+        }
+    }
+
+    NSMutableArray *results = [NSMutableArray arrayWithCapacity:self.queuedJobs.count];
+    NSCountedSet<NSNumber *> *statuses = [NSCountedSet set];
+    for (WASendJob *job in self.queuedJobs) {
+        [results addObject:[job toDictionary]];
+        [statuses addObject:@(job.status)];
+    }
+
+    NSInteger totalMs = llround((CFAbsoluteTimeGetCurrent() - start) * 1000.0);
+    [WALogger info:@"send queue: %lu jobs to %lu chats in %ldms (%lu confirmed)",
+        (unsigned long)self.queuedJobs.count, (unsigned long)groups.count, (long)totalMs,
+        (unsigned long)[statuses countForObject:@(WASendJobStatusConfirmed)]];
+
+    return @{
+        @"results": results,
+        @"confirmed": @([statuses countForObject:@(WASendJobStatusConfirmed)]),
+        @"unconfirmed": @([statuses countForObject:@(WASendJobStatusUnconfirmed)]),
+        @"failed": @([statuses countForObject:@(WASendJobStatusFailed)]),
+        @"total_ms": @(totalMs)
+    };
+}
+
+/// Jobs per target chat: chats in order of first mention, jobs in request order
+- (NSArray<NSArray<WASendJob *> *> *)jobsGroupedByChat {
+    NSMutableArray<NSMutableArray<WASendJob *> *> *groups = [NSMutableArray array];
+    NSMutableDictionary<NSString *, NSMutableArray<WASendJob *> *> *byChat = [NSMutableDictionary dictionary];
+    for (WASendJob *job in self.queuedJobs) {
+        NSString *key = job.chat.lowercaseString;
+        NSMutableArray<WASendJob *> *group = byChat[key];
+        if (!group) {
+            group = [NSMutableArray array];
+            byChat[key] = group;
+            [groups addObject:group];
+        }
+        [group addObject:job];
+    }
+    return groups;
+}
+
+#pragma mark - Sending
+
+/// Send one job with retries. openChat is the header name this job's chat was
+/// opened under by an earlier job of the group (nil = not yet); returns the
+/// header name to reuse for the next job, or nil to open again.
+- (NSString *)sendJob:(WASendJob *)job openChat:(NSString *)openChat {
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    NSString *chatName = openChat;
+
+    while (job.attempts < self.maxAttempts) {
+        if (job.attempts > 0) {
+            NSTimeInterval backoff = self.initialBackoff * (1 << (job.attempts - 1));
+            [WALogger debug:@"send queue: retrying job %lu in %.1fs (%@)", (unsigned long)job.index, backoff, job.error];
+            [NSThread sleepForTimeInterval:backoff];
+        }
+        job.attempts++;
+
+        // Never send unless the intended chat is confirmed open; the user may have moved it
+        NSString *current = [self.accessibility currentChatName];
+        if (!chatName || !current || ![current isEqualToString:chatName]) {
+            chatName = [self.accessibility openChatWithName:job.chat settleTimeout:kOpenSettleTimeout];
+            if (!chatName) {
+                job.error = [NSString stringWithFormat:@"Chat '%@' not found", job.chat];
+                continue;
+            }
+        }
+        job.chatName = chatName;
+
+        NSString *watermark = [self.accessibility latestMessageFingerprint];
+        if (![self.accessibility sendMessage:job.text]) {
+            job.error = @"Could not set the compose box";
+            continue;
+        }
+
+        NSString *fingerprint = [self confirmText:job.text belowWatermark:watermark];
+        if (fingerprint) {
+            job.status = WASendJobStatusConfirmed;
+            job.fingerprint = fingerprint;
+            job.error = nil;
+            break;
+        }
+
+        // Still in the compose box: Return didn't take, so sending again can't duplicate
+        NSString *pending = [self.accessibility composerText];
+        if ([WANormalizedMessageText(pending ?: @"") isEqualToString:WANormalizedMessageText(job.text)]) {
+            job.error = @"Message stayed in the compose box";
+            continue;
+        }
+
+        job.status = WASendJobStatusUnconfirmed;
+        job.error = @"Sent, but no matching outgoing message appeared";
+        break;
+    }
+
+    if (job.status == WASendJobStatusPending) {
+        job.status = WASendJobStatusFailed;
+    }
+    job.duration = CFAbsoluteTimeGetCurrent() - start;
+    return job.status == WASendJobStatusFailed ? nil : chatName;
+}
+
+/// Fingerprint of a new outgoing message with text below watermark, polled
+/// until confirmTimeout; nil if none shows up
+- (NSString *)confirmText:(NSString *)text belowWatermark:(NSString *)watermark {
+    NSString *wanted = WANormalizedMessageText(text);
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:self.confirmTimeout];
+    do {
+        [NSThread sleepForTimeInterval:kConfirmPoll];
+        // No watermark means the chat was empty, so every row is new
+        BOOL watermarkFound = NO;
+        NSArray<WAMessage *> *messages = [self.accessibility getMessagesWithLimit:kConfirmReadLimit
+                                                                           fields:WAMessageFieldText | WAMessageFieldDirection | WAMessageFieldFingerprint
+                                                                            since:watermark
+                                                                   watermarkFound:&watermarkFound];
+        // Without the watermark older rows are mixed in and could match an earlier copy
+        if (watermark && !watermarkFound) continue;
+        for (WAMessage *message in messages) {
+            if (message.direction == WAMessageDirectionOutgoing &&
+                [WANormalizedMessageText(message.text) isEqualToString:wanted]) {
+                return message.fingerprint;
+            }
+        }
+    } while ([deadline timeIntervalSinceNow] > 0);
+    return nil;
+}
+
+@end
@@ -0,0 +1,37 @@
+// WAToolMetrics.h
+// Per-tool call counts, timings and AX reference accounting
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Runs each tool call inside its own WAAXArena and keeps running totals per
+ * tool name: calls, time, and how many AX references the call created and
+ * left behind.
+ *
+ * Debug builds assert that no reference is outstanding once a call's arena
+ * has closed; release builds log a warning and count it instead.
+ *
+ * The totals are written to the log as one JSON info line every five
+ * minutes in which any tool ran, and at quit.
+ */
+@interface WAToolMetrics : NSObject
+
++ (instancetype)shared;
+
+/// Run block as one call of tool inside a fresh arena and record it
+- (void)measureTool:(NSString *)tool block:(dispatch_block_t)block;
+
+/// {tool: {"calls", "total_ms", "max_ms", "ax_refs_created", "ax_refs_peak",
+///  "ax_refs_outstanding"}}; peak is the most refs one call owned at once
+- (NSDictionary<NSString *, NSDictionary *> *)toDictionary;
+
+/// Log toDictionary as one "[ToolMetrics]" info line if anything ran since the last one
+- (void)logSummary;
+
+- (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
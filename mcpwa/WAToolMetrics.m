@@ -0,0 +1,140 @@
+// WAToolMetrics.m
+// Per-tool call counts, timings and AX reference accounting
+
+#import "WAToolMetrics.h"
+#import "WAAXArena.h"
+#import "WALogger.h"
+
+static const NSTimeInterval kSummaryLogInterval = 300.0;   // Totals go to the log every five minutes
+
+/// Running totals for one tool name
+@interface WAToolMetricsEntry : NSObject
+@property (nonatomic, assign) NSUInteger calls;
+@property (nonatomic, assign) NSTimeInterval totalTime;
+@property (nonatomic, assign) NSTimeInterval maxTime;
+@property (nonatomic, assign) NSUInteger refsCreated;
+@property (nonatomic, assign) NSUInteger refsPeak;
+@property (nonatomic, assign) NSUInteger refsOutstanding;
+@end
+
+@implementation WAToolMetricsEntry
+@end
+
+@interface WAToolMetrics ()
+@property (nonatomic, strong) NSMutableDictionary<NSString *, WAToolMetricsEntry *> *entries;
+@property (nonatomic, strong) dispatch_source_t summaryTimer;
+@property (nonatomic, assign) BOOL changedSinceSummary;
+@end
+
+@implementation WAToolMetrics
+
++ (instancetype)shared {
+    static WAToolMetrics *instance = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        instance = [[WAToolMetrics alloc] init];
+    });
+    return instance;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _entries = [NSMutableDictionary dictionary];
+
+        dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0,
+                                                         dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+        dispatch_source_set_timer(timer,
+                                  dispatch_time(DISPATCH_TIME_NOW, (int64_t)(kSummaryLogInterval * NSEC_PER_SEC)),
+                                  (uint64_t)(kSummaryLogInterval * NSEC_PER_SEC),
+                                  (uint64_t)(10 * NSEC_PER_SEC));
+        __weak typeof(self) weakSelf = self;
+        dispatch_source_set_event_handler(timer, ^{
+            [weakSelf logSummary];
+        });
+        dispatch_resume(timer);
+        _summaryTimer = timer;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_summaryTimer) dispatch_source_cancel(_summaryTimer);
+}
+
+- (void)measureTool:(NSString *)tool block:(dispatch_block_t)block {
+    WAAXArena *arena = [[WAAXArena alloc] initWithName:tool];
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    [arena open];
+    @try {
+        // Drained first so autoreleased arrays of elements don't count as survivors
+        @autoreleasepool {
+            block();
+        }
+    } @finally {
+        [arena close];
+        [self recordTool:tool duration:CFAbsoluteTimeGetCurrent() - start arena:arena];
+    }
+}
+
+- (void)recordTool:(NSString *)tool duration:(NSTimeInterval)duration arena:(WAAXArena *)arena {
+    NSUInteger outstanding = arena.outstandingCount;
+    @synchronized (self) {
+        WAToolMetricsEntry *entry = self.entries[tool];
+        if (!entry) {
+            entry = [[WAToolMetricsEntry alloc] init];
+            self.entries[tool] = entry;
+        }
+        entry.calls++;
+        entry.totalTime += duration;
+        entry.maxTime = MAX(entry.maxTime, duration);
+        entry.refsCreated += arena.createdCount;
+        entry.refsPeak = MAX(entry.refsPeak, arena.peakCount);
+        entry.refsOutstanding += outstanding;
+        self.changedSinceSummary = YES;
+    }
+
+    [WALogger debug:@"%@: %.0fms, %lu AX refs (peak %lu owned)", tool, duration * 1000.0,
+        (unsigned long)arena.createdCount, (unsigned long)arena.peakCount];
+    // Logged, not asserted: retain counts also see references the system holds for a while
+    if (outstanding > 0) {
+        [WALogger warn:@"%@: %lu AX refs still retained after the call", tool, (unsigned long)outstanding];
+    }
+}
+
+- (NSDictionary<NSString *, NSDictionary *> *)toDictionary {
+    NSMutableDictionary<NSString *, NSDictionary *> *dict = [NSMutableDictionary dictionary];
+    @synchronized (self) {
+        [self.entries enumerateKeysAndObjectsUsingBlock:^(NSString *tool, WAToolMetricsEntry *entry, BOOL *stop) {
+            dict[tool] = @{
+                @"calls": @(entry.calls),
+                @"total_ms": @(llround(entry.totalTime * 1000.0)),
+                @"max_ms": @(llround(entry.maxTime * 1000.0)),
+                @"ax_refs_created": @(entry.refsCreated),
+                @"ax_refs_peak": @(entry.refsPeak),
+                @"ax_refs_outstanding": @(entry.refsOutstanding)
+            };
+        }];
+    }
+    return [dict copy];
+}
+
+- (void)logSummary {
+    @synchronized (self) {
+        if (!self.changedSinceSummary) return;
+        self.changedSinceSummary = NO;
+    }
+    NSData *json = [NSJSONSerialization dataWithJSONObject:[self toDictionary]
+                                                   options:NSJSONWritingSortedKeys
+                                                     error:nil];
+    if (!json) return;
+    [WALogger info:@"[ToolMetrics] %@", [[NSString alloc] initWithData:json encoding:NSUTF8StringEncoding]];
+}
+
+- (void)reset {
+    @synchronized (self) {
+        [self.entries removeAllObjects];
+    }
+}
+
+@end